@@ -0,0 +1,41 @@
+/**
+ * @file ActionDelegate.h
+ * @brief Item delegate that paints a push button in a table's action column.
+ */
+
+#ifndef ACTIONDELEGATE_H
+#define ACTIONDELEGATE_H
+
+#include <QStyledItemDelegate>
+#include <QPersistentModelIndex>
+
+/**
+ * @class ActionDelegate
+ * @brief Draws the cell's display text as a button and reports clicks.
+ *
+ * Replaces one QPushButton widget per row: nothing is allocated per row,
+ * the button is only painted for visible cells. Cells with empty text
+ * are drawn as a plain "-".
+ */
+class ActionDelegate : public QStyledItemDelegate {
+    Q_OBJECT
+
+public:
+    explicit ActionDelegate(QObject *parent = nullptr);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    bool editorEvent(QEvent *event, QAbstractItemModel *model, const QStyleOptionViewItem &option,
+                     const QModelIndex &index) override;
+
+signals:
+    /**
+     * @brief Emitted when the button in the given cell is clicked.
+     */
+    void clicked(const QModelIndex &index);
+
+private:
+    QPersistentModelIndex pressed; ///< Cell whose button is held down
+};
+
+#endif // ACTIONDELEGATE_H
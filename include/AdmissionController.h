@@ -0,0 +1,157 @@
+/**
+ * @file AdmissionController.h
+ * @brief Flash-sale admission control per (train, date).
+ */
+
+#ifndef ADMISSIONCONTROLLER_H
+#define ADMISSIONCONTROLLER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <unordered_map>
+
+using namespace std;
+
+/**
+ * @brief Tuning knobs, applied to every (train, date) separately.
+ */
+struct AdmissionConfig {
+    double tokensPerSecond = 2000.0;  ///< Sustained booking attempts admitted per second
+    double burst = 200.0;             ///< Token bucket capacity
+    size_t maxQueuedPerUser = 2;      ///< Waiting requests one user may have
+    size_t maxQueued = 10000;         ///< Waiting requests in total
+    chrono::milliseconds maxWait{500}; ///< Longest time a request waits in the queue
+    bool waitForToken = true;         ///< false: bookings use tryAdmit and never wait (event-loop callers)
+};
+
+/**
+ * @enum AdmissionDecision
+ * @brief Outcome of AdmissionController::admit.
+ */
+enum AdmissionDecision {
+    ADMITTED,             ///< Go ahead and book
+    REJECTED_SOLD_OUT,    ///< Cached flag says nothing is left
+    REJECTED_QUEUE_FULL,  ///< User or global queue bound reached
+    REJECTED_TIMEOUT,     ///< Waited maxWait without getting a token
+    DEFERRED              ///< No token free right now (tryAdmit only); ask again later
+};
+
+/**
+ * @brief Snapshot of the admission counters (all train-dates together).
+ */
+struct AdmissionCounters {
+    uint64_t admitted = 0;         ///< Admitted, immediately or after queueing (less those released)
+    uint64_t queued = 0;           ///< Had to wait for a token
+    uint64_t rejectedSoldOut = 0;
+    uint64_t rejectedQueueFull = 0;
+    uint64_t rejectedTimeout = 0;
+    uint64_t deferred = 0;         ///< Told to retry by tryAdmit
+};
+
+/**
+ * @class AdmissionController
+ * @brief Token buckets, per-user fair queues and a sold-out cache.
+ *
+ * Each (train, date) has a token bucket. A request that finds a token and
+ * nobody waiting is admitted at once. Otherwise it joins its user's queue,
+ * and waiting requests are served round-robin across users as tokens
+ * refill, so one aggressive client cannot starve the rest. Once the
+ * inventory of a train-date is exhausted, the booking path marks it sold
+ * out and further requests (and searches) are answered from that flag
+ * without looking at segment counts.
+ */
+class AdmissionController {
+public:
+    explicit AdmissionController(const AdmissionConfig& config = AdmissionConfig());
+
+    /**
+     * @brief Asks to book on a train-date; may wait up to maxWait.
+     */
+    AdmissionDecision admit(const string& trainId, const string& date, const string& username);
+
+    /**
+     * @brief Asks to book on a train-date without waiting: ADMITTED if a
+     * token is free and nobody is queued, DEFERRED otherwise. Deferred
+     * callers keep no place in the queue.
+     */
+    AdmissionDecision tryAdmit(const string& trainId, const string& date);
+
+    /**
+     * @brief Gives back the token of an admission that was not used (a
+     * multi-leg booking refused on a later leg), waking the next waiter.
+     */
+    void release(const string& trainId, const string& date);
+
+    /**
+     * @brief Reads the cached sold-out flag.
+     */
+    bool isSoldOut(const string& trainId, const string& date) const;
+
+    /**
+     * @brief Sets or clears the sold-out flag. Setting it also turns away
+     * every request waiting for that train-date.
+     */
+    void setSoldOut(const string& trainId, const string& date, bool soldOut);
+
+    AdmissionCounters getCounters() const;
+
+    /**
+     * @brief Number of train-dates with admission state.
+     */
+    size_t getEntryCount() const;
+    const AdmissionConfig& getConfig() const { return config; }
+
+private:
+    using Clock = chrono::steady_clock;
+
+    struct Waiter {
+        bool granted = false;
+    };
+
+    /**
+     * @brief State of one train-date.
+     */
+    struct TrainDate {
+        atomic<bool> soldOut{false};
+        mutex mtx;
+        condition_variable cv;
+        double tokens;
+        Clock::time_point lastRefill;
+        unordered_map<string, deque<Waiter*>> queues; ///< Waiting requests per user
+        deque<string> rotation;                        ///< Users with waiters, in service order
+        size_t queued = 0;
+    };
+
+    struct Shard {
+        mutable shared_mutex mtx;
+        unordered_map<string, unique_ptr<TrainDate>> entries;
+    };
+
+    AdmissionConfig config;
+    vector<unique_ptr<Shard>> shards;
+
+    atomic<uint64_t> admittedCount{0};
+    atomic<uint64_t> queuedCount{0};
+    atomic<uint64_t> soldOutCount{0};
+    atomic<uint64_t> queueFullCount{0};
+    atomic<uint64_t> timeoutCount{0};
+    atomic<uint64_t> deferredCount{0};
+
+    TrainDate* find(const string& key) const;
+    TrainDate& findOrCreate(const string& key);
+    void refill(TrainDate& td, Clock::time_point now) const;
+    bool takeFreeToken(TrainDate& td, Clock::time_point now);
+    void dispatch(TrainDate& td, Clock::time_point now);
+    void removeWaiter(TrainDate& td, const string& username, Waiter* waiter);
+
+    static string makeKey(const string& trainId, const string& date) { return trainId + '\n' + date; }
+};
+
+#endif // ADMISSIONCONTROLLER_H
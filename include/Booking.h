@@ -0,0 +1,98 @@
+/**
+ * @file Booking.h
+ * @brief Result types shared by the booking paths of SystemManager.
+ */
+
+#ifndef BOOKING_H
+#define BOOKING_H
+
+#include <string>
+#include "Money.h"
+#include "SeatClass.h"
+
+using namespace std;
+
+/**
+ * @enum BookingStatus
+ * @brief Outcome of a booking attempt.
+ */
+enum BookingStatus {
+    BOOKED,            ///< Seats reserved and order created
+    NOT_LOGGED_IN,     ///< Session unknown or expired
+    UNKNOWN_TRAIN,     ///< No train with this ID
+    INVALID_STATIONS,  ///< Station not on the route, or stations out of order
+    SOLD_OUT,          ///< Not enough seats on at least one segment
+    INVALID_COUNT,     ///< Ticket count is not positive
+    REJECTED_BUSY,     ///< Turned away by admission control (queue full or timed out)
+    NOT_RUNNING,       ///< The train's calendar has no service on that date
+    RETRY_LATER,       ///< No admission token free right now (admission control not waiting); try again shortly
+    INVALID_DATE       ///< The date is malformed or does not exist
+};
+
+/// Number of BookingStatus values (for per-status arrays)
+const int BOOKING_STATUS_COUNT = INVALID_DATE + 1;
+
+/**
+ * @brief Result of a booking attempt.
+ */
+struct BookingResult {
+    BookingStatus status = NOT_LOGGED_IN;
+    string orderId;      ///< Set when status is BOOKED (empty for admin bookings)
+    Money price;         ///< Total price of the order
+};
+
+/**
+ * @brief One leg of a multi-train trip.
+ */
+struct TripLeg {
+    string trainId;
+    string startStation;
+    string endStation;
+    string date;                         ///< Travel date at startStation
+    SeatClass seatClass = SECOND_CLASS;
+};
+
+/**
+ * @brief A seat reservation processed as part of a batch.
+ * The caller fills leg and count; the batch fills the remaining fields.
+ */
+struct SeatRequest {
+    TripLeg leg;
+    int count = 1;
+    BookingStatus status = BOOKED; ///< Outcome of the reservation
+    Money price;                   ///< Total price if reserved
+    int departureMinutes = -1;     ///< Departure time at the boarding station if reserved
+};
+
+/**
+ * @brief Progress, then result, of a train cancellation.
+ */
+struct TrainCancellation {
+    bool found = false;          ///< The train exists
+    size_t droppedDates = 0;     ///< Dates whose inventory was dropped
+    size_t affectedOrders = 0;   ///< Orders on the cancelled runs (refunded ones included)
+    size_t processedOrders = 0;  ///< Affected orders handled so far
+    size_t refundedOrders = 0;   ///< Orders cancelled, including other legs of their journeys
+    Money refundedAmount;        ///< Total price of the orders cancelled
+};
+
+/**
+ * @brief Human-readable name of a booking status.
+ */
+inline const char* bookingStatusName(BookingStatus status) {
+    switch (status) {
+        case BOOKED: return "booked";
+        case NOT_LOGGED_IN: return "not logged in";
+        case UNKNOWN_TRAIN: return "unknown train";
+        case INVALID_STATIONS: return "invalid stations";
+        case SOLD_OUT: return "sold out";
+        case INVALID_COUNT: return "invalid ticket count";
+        case REJECTED_BUSY: return "too busy, try again";
+        case NOT_RUNNING: return "train does not run on that date";
+        case RETRY_LATER: return "queued, retry shortly";
+        case INVALID_DATE: return "invalid date";
+    }
+    return "unknown";
+}
+
+#endif // BOOKING_H
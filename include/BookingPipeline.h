@@ -0,0 +1,123 @@
+/**
+ * @file BookingPipeline.h
+ * @brief Definition of the asynchronous, batching booking pipeline.
+ */
+
+#ifndef BOOKINGPIPELINE_H
+#define BOOKINGPIPELINE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <future>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include "SystemManager.h"
+
+using namespace std;
+
+/**
+ * @class BookingPipeline
+ * @brief Disruptor-style booking pipeline for flash-sale traffic.
+ *
+ * Requests are written into a pre-allocated ring buffer. Producers claim a
+ * sequence number with one atomic increment and publish the slot when it is
+ * filled; no lock is taken on the submit path. Two stages follow the ring,
+ * each on its own thread:
+ *  1. Sequencer/inventory: takes every published request up to maxBatch,
+ *     groups them by (train, date) and reserves seats in one pass per group.
+ *  2. Orders: creates and indexes the orders for reserved seats, then
+ *     completes the callers' futures or callbacks.
+ * A slot is reused only after stage 2 has finished with it, so producers
+ * wait when the ring is full. Sessions and admission control are checked
+ * on the submitting thread, before a slot is claimed, and every booking
+ * is reported to metrics and the trace recorder like placeBooking.
+ *
+ * Submitting must stop before the pipeline is destroyed; requests already
+ * submitted are completed first.
+ */
+class BookingPipeline {
+public:
+    using Callback = function<void(const BookingResult&)>;
+
+    /**
+     * @brief Constructor. Starts the stage threads.
+     * @param system Backend whose inventory and orders are updated
+     * @param capacity Ring size, rounded up to a power of two
+     * @param maxBatch Most requests taken by one inventory pass
+     */
+    explicit BookingPipeline(SystemManager& system, size_t capacity = 4096, size_t maxBatch = 512);
+    ~BookingPipeline();
+
+    BookingPipeline(const BookingPipeline&) = delete;
+    BookingPipeline& operator=(const BookingPipeline&) = delete;
+
+    /**
+     * @brief Submits a booking; the result arrives through the future.
+     */
+    future<BookingResult> submit(const string& session, const string& trainId, const string& start,
+                                 const string& end, const string& date, int count = 1,
+                                 SeatClass seatClass = SECOND_CLASS);
+
+    /**
+     * @brief Submits a booking; done is invoked on the pipeline's order
+     * thread, or on the caller's if the booking is turned away before it
+     * enters the ring.
+     */
+    void submit(const string& session, const string& trainId, const string& start,
+                const string& end, const string& date, int count, SeatClass seatClass, Callback done);
+
+    uint64_t getBatchCount() const { return batchCount.load(); }
+    uint64_t getProcessedCount() const { return processedCount.load(); }
+
+private:
+    struct Slot {
+        atomic<int64_t> sequence{-1}; ///< Sequence of the request in this slot once published
+        shared_ptr<User> user;
+        string session;               ///< For the trace record
+        chrono::steady_clock::time_point started; ///< When the request was submitted
+        SeatRequest request;
+        Callback done;
+    };
+
+    /**
+     * @brief A sequence counter on its own cache line.
+     */
+    struct alignas(64) Sequence {
+        atomic<int64_t> value{-1};
+    };
+
+    SystemManager& system;
+    vector<Slot> ring;
+    int64_t mask;
+    size_t maxBatch;
+
+    alignas(64) atomic<int64_t> claimSequence{0}; ///< Next sequence handed to a producer
+    Sequence inventorySequence;  ///< Last sequence finished by stage 1
+    Sequence completedSequence;  ///< Last sequence finished by stage 2 (gates producers)
+
+    atomic<bool> running{true};
+    atomic<uint64_t> batchCount{0};
+    atomic<uint64_t> processedCount{0};
+
+    // Idle stages park here instead of spinning forever
+    mutex waitMutex;
+    condition_variable waitCv;
+    atomic<int> sleepers{0};
+
+    thread inventoryThread;
+    thread orderThread;
+
+    void publish(shared_ptr<User> user, const string& session, chrono::steady_clock::time_point started,
+                 const TripLeg& leg, int count, Callback done);
+    void inventoryStage();
+    void orderStage();
+    void waitForWork();
+    void wakeStages();
+};
+
+#endif // BOOKINGPIPELINE_H
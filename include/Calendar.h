@@ -0,0 +1,97 @@
+/**
+ * @file Calendar.h
+ * @brief Date and clock arithmetic on integers.
+ *
+ * Dates are day numbers (days since 1970-01-01) and times are minutes.
+ * "YYYY-MM-DD" and "HH:MM" strings are only parsed and formatted at the
+ * edges: route entry, protocol and GUI output.
+ */
+
+#ifndef CALENDAR_H
+#define CALENDAR_H
+
+#include <string>
+#include <ctime>
+
+using namespace std;
+
+/// Minutes in one day
+const int MINUTES_PER_DAY = 24 * 60;
+
+namespace Calendar {
+
+/**
+ * @brief Parses a "YYYY-MM-DD" date into days since 1970-01-01.
+ * @return false if the text is malformed or the date does not exist
+ * ("2023-02-31"). Dates accepted are in canonical form, so
+ * formatDate(day) gives the same text back.
+ */
+bool parseDate(const string& date, int& day);
+
+/**
+ * @brief Whether a "YYYY-MM-DD" date exists (see parseDate).
+ */
+inline bool isValidDate(const string& date) {
+    int day;
+    return parseDate(date, day);
+}
+
+/**
+ * @brief Days since 1970-01-01 of a "YYYY-MM-DD" date (0 if invalid).
+ * For dates already validated with parseDate; check untrusted input first.
+ */
+int dayNumber(const string& date);
+
+/**
+ * @brief Days since 1970-01-01 (UTC) of a timestamp.
+ */
+inline int dayNumber(time_t t) { return static_cast<int>(t / 86400); }
+
+/**
+ * @brief Day of the week of a day number, 0 = Monday ... 6 = Sunday.
+ */
+inline int weekday(int day) {
+    // 1970-01-01 was a Thursday
+    int w = (day + 3) % 7;
+    return w < 0 ? w + 7 : w;
+}
+
+/**
+ * @brief "YYYY-MM-DD" of a day number.
+ */
+string formatDate(int day);
+
+/**
+ * @brief The date a number of days after (or before, if negative) another.
+ */
+string addDays(const string& date, int days);
+
+/**
+ * @brief Minutes of an "HH:MM" time (-1 if malformed). Hours past 23 are
+ * accepted, so "25:30" is 01:30 on the following day.
+ */
+int parseClock(const string& clock);
+
+/**
+ * @brief "HH:MM" of the time of day of a minute count (days are dropped;
+ * -30 is "23:30").
+ */
+string formatClock(int minutes);
+
+} // namespace Calendar
+
+/**
+ * @brief Departure time-of-day filter for searches, in minutes after midnight, inclusive.
+ */
+struct TimeWindow {
+    int earliest = 0;
+    int latest = MINUTES_PER_DAY - 1;
+
+    bool isAllDay() const { return earliest <= 0 && latest >= MINUTES_PER_DAY - 1; }
+    bool contains(int minutes) const {
+        int timeOfDay = minutes % MINUTES_PER_DAY;
+        return timeOfDay >= earliest && timeOfDay <= latest;
+    }
+};
+
+#endif // CALENDAR_H
@@ -0,0 +1,177 @@
+/**
+ * @file CallTrace.h
+ * @brief Recording and reading of SystemManager call traces.
+ *
+ * A trace is a binary file holding one record per public call (register,
+ * login, logout, search, book, transfer, journey, refund) with its
+ * arguments, its start time and its outcome. Traces are replayed by
+ * TraceReplayer to reproduce a production workload against a fresh
+ * SystemManager.
+ *
+ * File layout: the magic "RTRC", a format version and the wall-clock time
+ * the recording started, then the records. All integers are LEB128 varints
+ * (signed values zigzag-encoded). Record start times are stored as deltas
+ * from the previous record. Strings are interned: the first occurrence is
+ * written in full and later ones as an index into the table of strings
+ * seen so far, so station names, train IDs and session tokens cost a byte
+ * or two after their first use.
+ *
+ * Traces contain passwords (register and login arguments); treat them as
+ * confidential.
+ */
+
+#ifndef CALLTRACE_H
+#define CALLTRACE_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <fstream>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+
+using namespace std;
+
+/**
+ * @enum TraceOp
+ * @brief The SystemManager call a trace record describes.
+ *
+ * Arguments and result per operation:
+ * - TRACE_REGISTER: user, password, name, idCard; result 1 on success
+ * - TRACE_LOGIN: user, password; result 1 on success, output = session token
+ * - TRACE_LOGOUT: token; result 1
+ * - TRACE_SEARCH: from, to, date[, earliest, latest departure "HH:MM"]; result = number of trains found
+ * - TRACE_BOOK: token, trainId, from, to, date, count, seat class; result = BookingStatus, output = order ID
+ * - TRACE_REFUND: token, orderId; result 1 on success
+ * - TRACE_TRANSFER, TRACE_JOURNEY: token, count, then trainId, from, to, date, seat class
+ *   for each leg; result = BookingStatus, output = the order IDs separated by spaces
+ */
+enum TraceOp {
+    TRACE_REGISTER = 1,
+    TRACE_LOGIN,
+    TRACE_LOGOUT,
+    TRACE_SEARCH,
+    TRACE_BOOK,
+    TRACE_REFUND,
+    TRACE_TRANSFER,
+    TRACE_JOURNEY
+};
+
+/// One past the largest TraceOp value (for per-operation arrays)
+const int TRACE_OP_LIMIT = TRACE_JOURNEY + 1;
+
+/// Trace arguments per leg of a TRACE_TRANSFER or TRACE_JOURNEY record
+const size_t TRACE_LEG_ARGS = 5;
+
+/**
+ * @brief Short lowercase name of an operation ("book", "search", ...).
+ */
+const char* traceOpName(TraceOp op);
+
+/**
+ * @brief One recorded call.
+ */
+struct TraceRecord {
+    TraceOp op = TRACE_SEARCH;
+    int64_t startNs = 0;     ///< Call start, in nanoseconds since the recording started
+    int64_t durationNs = 0;  ///< Time the call took when recorded
+    vector<string> args;     ///< Call arguments (see TraceOp)
+    int64_t result = 0;      ///< Outcome (see TraceOp)
+    string output;           ///< Token or order ID produced by the call, if any
+};
+
+/**
+ * @class TraceRecorder
+ * @brief Appends call records to a trace file. Thread-safe.
+ *
+ * Records are encoded into a memory buffer under a mutex and written out in
+ * large chunks, so recording costs one lock and a few bytes per call.
+ */
+class TraceRecorder {
+public:
+    TraceRecorder() = default;
+    ~TraceRecorder();
+
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    /**
+     * @brief Creates (truncates) a trace file and writes its header.
+     * The recording clock starts now.
+     */
+    bool open(const string& path);
+
+    /**
+     * @brief Flushes buffered records and closes the file.
+     */
+    void close();
+
+    bool isOpen() const;
+
+    /**
+     * @brief Records one completed call.
+     * @param start When the call began; the duration is measured up to now
+     */
+    void record(TraceOp op, chrono::steady_clock::time_point start, const vector<string>& args,
+                int64_t result, const string& output = "");
+
+    /**
+     * @brief Writes buffered records to the file.
+     */
+    void flush();
+
+    uint64_t getRecordCount() const;
+
+private:
+    mutable mutex mtx;
+    ofstream file;
+    string buffer;                             ///< Encoded records not yet written
+    unordered_map<string, uint32_t> strings;   ///< Interned string to table index
+    chrono::steady_clock::time_point origin;   ///< Recording start
+    int64_t lastStartNs = 0;
+    uint64_t recordCount = 0;
+
+    void writeString(const string& s);
+    void flushLocked();
+};
+
+/**
+ * @class TraceReader
+ * @brief Reads the records of a trace file in order.
+ */
+class TraceReader {
+public:
+    /**
+     * @brief Loads a trace file and checks its header.
+     * @return false if the file cannot be read or is not a trace.
+     */
+    bool open(const string& path);
+
+    /**
+     * @brief Decodes the next record.
+     * @return false at the end of the trace or on a corrupt record (see getLastError()).
+     */
+    bool next(TraceRecord& record);
+
+    /**
+     * @brief Wall-clock time the recording started.
+     */
+    time_t getStartTime() const { return startTime; }
+
+    const string& getLastError() const { return lastError; }
+
+private:
+    string data;
+    size_t pos = 0;
+    time_t startTime = 0;
+    int64_t lastStartNs = 0;
+    vector<string> strings;
+    string lastError;
+
+    bool readVarint(uint64_t& value);
+    bool readString(string& s);
+};
+
+#endif // CALLTRACE_H
@@ -0,0 +1,110 @@
+/**
+ * @file ChangeFeed.h
+ * @brief Subscriptions to seat inventory changes for downstream consumers.
+ *
+ * Each subscription owns a bounded lock-free queue. Inventory events that
+ * match its filter are pushed from the booking thread with a single
+ * tryPush; when the queue is full the event is dropped and counted, so a
+ * slow or stalled consumer never delays a booking. Consumers drain their
+ * queue in batches with poll(), from any number of threads. A consumer
+ * that sees getDropped() grow has missed changes and should resynchronise
+ * from SystemManager::getOccupancy().
+ */
+
+#ifndef CHANGEFEED_H
+#define CHANGEFEED_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include "InventoryEvents.h"
+#include "MpmcQueue.h"
+
+using namespace std;
+
+/// Default queue size of a subscription
+const size_t FEED_DEFAULT_CAPACITY = 4096;
+
+/**
+ * @brief Which changes a subscription receives. Empty sets match everything.
+ */
+struct FeedFilter {
+    set<string> trains;
+    set<string> dates;
+
+    bool matches(const InventoryEvent& event) const {
+        return (trains.empty() || trains.count(event.trainId)) && (dates.empty() || dates.count(event.date));
+    }
+};
+
+/**
+ * @class FeedSubscription
+ * @brief One consumer's queue of inventory changes.
+ */
+class FeedSubscription {
+public:
+    FeedSubscription(FeedFilter filter, size_t capacity);
+
+    /**
+     * @brief Moves up to maxEvents queued events to the end of batch.
+     * Safe to call from several consumer threads at once.
+     * @return Number of events appended.
+     */
+    size_t poll(vector<InventoryEvent>& batch, size_t maxEvents = 256);
+
+    /// Events discarded because the queue was full
+    uint64_t getDropped() const { return dropped.load(memory_order_relaxed); }
+    /// Events queued so far
+    uint64_t getPublished() const { return published.load(memory_order_relaxed); }
+    size_t getCapacity() const { return queue.capacity(); }
+    const FeedFilter& getFilter() const { return filter; }
+
+private:
+    friend class ChangeFeed;
+
+    const FeedFilter filter;
+    MpmcQueue<InventoryEvent> queue;
+    atomic<uint64_t> published{0};
+    atomic<uint64_t> dropped{0};
+
+    /**
+     * @brief Called on booking threads; never blocks.
+     */
+    void offer(const InventoryEvent& event);
+};
+
+/**
+ * @class ChangeFeed
+ * @brief Routes inventory events to the subscriptions whose filter matches.
+ *
+ * Registers itself with the event hub while it has subscribers, so trains
+ * build no events when nobody is subscribed.
+ */
+class ChangeFeed : public InventoryListener {
+public:
+    explicit ChangeFeed(InventoryEventHub& hub) : hub(hub) {}
+    ~ChangeFeed();
+
+    shared_ptr<FeedSubscription> subscribe(FeedFilter filter, size_t capacity);
+
+    /**
+     * @return False if the subscription was not active.
+     */
+    bool unsubscribe(const shared_ptr<FeedSubscription>& subscription);
+
+    size_t getSubscriberCount() const;
+
+    void onInventoryChange(const InventoryEvent& event) override;
+
+private:
+    InventoryEventHub& hub;
+    mutex registrationMutex;   ///< Serializes (un)subscribing; never held by delivery
+    mutable shared_mutex mtx;  ///< Guards subscriptions; taken inside the hub's lock on delivery
+    vector<shared_ptr<FeedSubscription>> subscriptions;
+};
+
+#endif // CHANGEFEED_H
@@ -0,0 +1,56 @@
+/**
+ * @file Clock.h
+ * @brief Wall-clock sources used for order timestamps.
+ *
+ * SystemManager reads the time through a Clock so that tests and trace
+ * replays can control the timestamps (and thus the order IDs) it produces.
+ */
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <atomic>
+#include <ctime>
+
+using namespace std;
+
+/**
+ * @class Clock
+ * @brief Source of the current wall-clock time. Implementations must be thread-safe.
+ */
+class Clock {
+public:
+    virtual ~Clock() = default;
+
+    /**
+     * @brief Current time in seconds since the epoch.
+     */
+    virtual time_t now() const = 0;
+};
+
+/**
+ * @class SystemClock
+ * @brief The real time of day (default).
+ */
+class SystemClock : public Clock {
+public:
+    time_t now() const override { return time(nullptr); }
+};
+
+/**
+ * @class ManualClock
+ * @brief A clock that only moves when told to.
+ */
+class ManualClock : public Clock {
+public:
+    explicit ManualClock(time_t start = 0) : current(start) {}
+
+    time_t now() const override { return current.load(memory_order_relaxed); }
+    void set(time_t t) { current.store(t, memory_order_relaxed); }
+    void advance(time_t seconds) { current.fetch_add(seconds, memory_order_relaxed); }
+
+private:
+    atomic<time_t> current;
+};
+
+#endif // CLOCK_H
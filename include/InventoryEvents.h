@@ -0,0 +1,92 @@
+/**
+ * @file InventoryEvents.h
+ * @brief Seat inventory change events and their listeners.
+ *
+ * Train::bookTickets, bookSegments and releaseTickets report every change
+ * of a date's seat counts to the train's listener, synchronously and on the
+ * thread that owns the train (under the trains lock in direct mode, on the
+ * shard worker in sharded mode). SystemManager installs its
+ * InventoryEventHub on every train it holds; consumers register with
+ * SystemManager::addInventoryListener.
+ */
+
+#ifndef INVENTORYEVENTS_H
+#define INVENTORYEVENTS_H
+
+#include <string>
+#include <vector>
+#include <shared_mutex>
+#include <atomic>
+#include <cstdint>
+#include "SeatClass.h"
+
+using namespace std;
+
+/**
+ * @brief One change to a contiguous range of segments of a train on a date.
+ */
+struct InventoryEvent {
+    string trainId;
+    string date;
+    int startSegment;    ///< First segment changed
+    int endSegment;      ///< One past the last segment changed
+    int delta;           ///< Seats added to each segment (negative for bookings)
+    int newMin;          ///< Fewest free seats (all classes) on the range after the change
+    int totalSeats;      ///< Train capacity per segment (all classes)
+    int segmentCount;    ///< Segments on the train's route
+    uint64_t version;    ///< Train::getInventoryVersion() after the change
+    SeatClass seatClass; ///< Class whose seats changed
+};
+
+/**
+ * @brief Free seats of one train on one date, as taken by SystemManager::getOccupancy().
+ */
+struct TrainOccupancy {
+    string trainId;
+    int totalSeats;
+    vector<int> freeSeats;   ///< Per segment, all classes
+    uint64_t version;        ///< Events up to this version are already included
+};
+
+/**
+ * @class InventoryListener
+ * @brief Receives inventory events. Must not call back into the SystemManager.
+ */
+class InventoryListener {
+public:
+    virtual ~InventoryListener() = default;
+
+    virtual void onInventoryChange(const InventoryEvent& event) = 0;
+
+    /**
+     * @brief Trains skip building events while this returns false.
+     */
+    virtual bool isListening() const { return true; }
+};
+
+/**
+ * @class InventoryEventHub
+ * @brief Fans events out to the listeners registered with a SystemManager.
+ *
+ * Delivery holds a shared lock, so removeListener() returns only once no
+ * event is being delivered to the removed listener.
+ */
+class InventoryEventHub : public InventoryListener {
+public:
+    void addListener(InventoryListener* listener);
+
+    /**
+     * @return False if the listener was not registered.
+     */
+    bool removeListener(InventoryListener* listener);
+
+    void onInventoryChange(const InventoryEvent& event) override;
+    bool isListening() const override { return active.load(memory_order_acquire); }
+
+private:
+    mutable shared_mutex mtx;
+    vector<InventoryListener*> listeners;
+    atomic<bool> active{false};   ///< listeners is non-empty
+};
+
+#endif // INVENTORYEVENTS_H
@@ -11,10 +11,17 @@
 #include <QLineEdit>
 #include <QPushButton>
 #include <QTableWidget>
+#include <QTableView>
 #include <QLabel>
 #include <QDateEdit>
 #include <QComboBox>
+#include <QCheckBox>
+#include <QTimer>
 #include "SystemManager.h"
+#include "TableModels.h"
+#include "ActionDelegate.h"
+#include "SearchController.h"
+#include "OccupancyDashboard.h"
 
 /**
  * @class MainWindow
@@ -43,14 +50,24 @@ private slots:
 
     // Passenger Slots
     void handleSearch();
+    void scheduleLiveSearch();
+    void runLiveSearch();
+    void searchFinished(int resultCount);
     void refreshOrderTable();
+    void bookResult(const QModelIndex &index);
+    void refundOrder(const QModelIndex &index);
 
     // Admin Slots
     void handleAddTrain();
     void refreshTrainTable();
+    void showOccupancyDate();
+    void updateOccupancyTotals(int sold, int capacity);
+    void showMetrics();
+    void showMemoryReport();
 
 private:
     SystemManager systemManager; ///< Backend controller
+    string sessionToken;         ///< Session of the logged-in user (empty when logged out)
     QStackedWidget *stackedWidget; ///< Stacked widget for page navigation
 
     // Login Page Widgets
@@ -68,12 +85,23 @@ private:
     QLineEdit *searchStartInput;
     QLineEdit *searchEndInput;
     QDateEdit *searchDateInput;
-    QTableWidget *trainResultTable;
-    QTableWidget *orderHistoryTable;
+    QComboBox *seatClassInput;        ///< Class shown in the results and booked
+    QCheckBox *liveSearchCheck;
+    QTimer *liveSearchTimer;          ///< Debounces live search while typing
+    SearchController *searchController;
+    bool reportEmptySearch = false;   ///< Explicit searches tell the user when nothing was found
+    QTableView *trainResultTable;
+    QTableView *orderHistoryTable;
+    TrainResultModel *trainResultModel;
+    OrderHistoryModel *orderHistoryModel;
     
     // Admin Dashboard Widgets
     QWidget *adminPage;
     QTableWidget *allTrainsTable;
+    QDateEdit *occupancyDateInput;
+    QLabel *occupancyTotalsLabel;
+    QTableView *occupancyTable;
+    OccupancyModel *occupancyModel;
     // Add Train Inputs
     QLineEdit *addTrainIdInput;
     QLineEdit *addTrainTypeInput;
@@ -93,6 +121,7 @@ private:
     
     void updatePassengerView();
     void updateAdminView();
+    void appendTrainRow(const Train& train);
 };
 
 #endif // MAINWINDOW_H
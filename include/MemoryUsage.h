@@ -0,0 +1,107 @@
+/**
+ * @file MemoryUsage.h
+ * @brief Memory accounting helpers and the per-subsystem memory report.
+ *
+ * Sizes are computed by walking the data structures rather than by
+ * hooking the allocator: each container reports its own footprint plus
+ * the heap memory its elements own. Node-based containers are charged an
+ * estimate of their per-node bookkeeping (tree links, bucket pointers,
+ * cached hashes), so totals are close to, but not exactly, what the
+ * allocator sees.
+ */
+
+#ifndef MEMORYUSAGE_H
+#define MEMORYUSAGE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <cstddef>
+
+using namespace std;
+
+namespace MemoryUsage {
+
+/// Red-black tree node links and colour
+const size_t MAP_NODE_OVERHEAD = 4 * sizeof(void*);
+/// Hash node next pointer and cached hash
+const size_t HASH_NODE_OVERHEAD = sizeof(void*) + sizeof(size_t);
+
+/**
+ * @brief Heap bytes owned by a string (0 while it fits the inline buffer).
+ */
+inline size_t heapBytes(const string& s) {
+    static const size_t inlineCapacity = string().capacity();
+    return s.capacity() > inlineCapacity ? s.capacity() + 1 : 0;
+}
+
+/**
+ * @brief Heap bytes of a vector's element buffer (not what the elements own).
+ */
+template <class T>
+size_t bufferBytes(const vector<T>& v) {
+    return v.capacity() * sizeof(T);
+}
+
+/**
+ * @brief Heap bytes of a map's nodes (not what keys and values own).
+ */
+template <class K, class V, class C, class A>
+size_t nodeBytes(const map<K, V, C, A>& m) {
+    return m.size() * (MAP_NODE_OVERHEAD + sizeof(typename map<K, V, C, A>::value_type));
+}
+
+/**
+ * @brief Heap bytes of an unordered_map's buckets and nodes (not what keys and values own).
+ */
+template <class K, class V, class H, class E, class A>
+size_t nodeBytes(const unordered_map<K, V, H, E, A>& m) {
+    return m.bucket_count() * sizeof(void*) +
+           m.size() * (HASH_NODE_OVERHEAD + sizeof(typename unordered_map<K, V, H, E, A>::value_type));
+}
+
+} // namespace MemoryUsage
+
+/**
+ * @brief Memory attributed to one train.
+ */
+struct TrainMemory {
+    string trainId;
+    size_t routeBytes = 0;      ///< Stops and station names (possibly shared with other trains)
+    size_t inventoryBytes = 0;  ///< Per-date seat counts, including the date keys
+    size_t inventoryDates = 0;  ///< Dates with inventory allocated
+};
+
+/**
+ * @brief Bytes used per subsystem, as computed by SystemManager::getMemoryReport().
+ */
+struct MemoryReport {
+    size_t trains = 0;         ///< Train objects and the train table
+    size_t routes = 0;         ///< Distinct routes (shared routes counted once)
+    size_t inventory = 0;      ///< All per-date seat inventory
+    size_t users = 0;          ///< User objects and the user table, excluding order histories
+    size_t orders = 0;         ///< Order histories
+    size_t orderIndex = 0;     ///< Order ID and train order indexes
+    size_t stationIndex = 0;   ///< Station to trains search index (current timetable version)
+    size_t timetable = 0;      ///< Schedules of the current timetable version, without routes
+    size_t sessions = 0;       ///< Session table
+    size_t orderCount = 0;
+    size_t routeCount = 0;     ///< Distinct routes
+    size_t unsharedRoutes = 0; ///< What the routes would take with one copy per train
+    vector<TrainMemory> perTrain; ///< Sorted by total bytes, largest first
+
+    size_t total() const { return trains + routes + inventory + users + orders + orderIndex + stationIndex + timetable + sessions; }
+
+    /**
+     * @brief Human-readable breakdown with the topTrains largest trains.
+     */
+    string toText(size_t topTrains = 10) const;
+
+    /**
+     * @brief Single-line JSON with the subsystem totals and the topTrains largest trains.
+     */
+    string toJson(size_t topTrains = 10) const;
+};
+
+#endif // MEMORYUSAGE_H
@@ -0,0 +1,143 @@
+/**
+ * @file Metrics.h
+ * @brief Latency histograms and outcome counters for SystemManager calls.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+#include "Booking.h"
+
+using namespace std;
+
+/**
+ * @enum MetricOp
+ * @brief The operations whose latency is measured.
+ */
+enum MetricOp {
+    METRIC_SEARCH,
+    METRIC_BOOK,
+    METRIC_REFUND,
+    METRIC_LOGIN,
+    METRIC_REGISTER,
+    METRIC_OP_COUNT
+};
+
+/**
+ * @brief Short lowercase name of an operation ("search", "book", ...).
+ */
+const char* metricOpName(MetricOp op);
+
+/**
+ * @class LatencyHistogram
+ * @brief Log-linear (HDR-style) histogram of durations in nanoseconds.
+ *
+ * Values below 16 ns get a bucket each; above that, every power of two is
+ * split into 16 equal sub-buckets, so any recorded value is known to within
+ * 1/16 (about 6%). Values beyond 2^41 ns (about 37 minutes) share the last
+ * bucket.
+ */
+class LatencyHistogram {
+public:
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int MAX_MAGNITUDE = 41;
+    static const int BUCKET_COUNT = (MAX_MAGNITUDE - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    static size_t bucketIndex(uint64_t ns);
+    static uint64_t bucketLowerBound(size_t index);
+
+    LatencyHistogram() : counts(BUCKET_COUNT, 0) {}
+
+    void record(uint64_t ns);
+    void merge(const LatencyHistogram& other);
+
+    uint64_t getCount() const { return total; }
+    uint64_t getMax() const { return maxValue; }
+    double getMean() const { return total ? static_cast<double>(sum) / total : 0.0; }
+
+    /**
+     * @brief Value at quantile q (0..1), reported as its bucket's lower bound.
+     */
+    uint64_t percentile(double q) const;
+
+private:
+    friend class Metrics;
+    vector<uint64_t> counts;
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t maxValue = 0;
+};
+
+/**
+ * @brief Point-in-time totals across all threads.
+ */
+struct MetricsSnapshot {
+    LatencyHistogram latency[METRIC_OP_COUNT];
+    uint64_t failures[METRIC_OP_COUNT] = {};         ///< Calls that did not succeed, per operation
+    uint64_t bookingOutcomes[BOOKING_STATUS_COUNT] = {}; ///< placeBooking results by status
+
+    /**
+     * @brief Human-readable table of percentiles and outcome counts.
+     */
+    string toText() const;
+
+    /**
+     * @brief The same data as a single-line JSON object.
+     */
+    string toJson() const;
+};
+
+/**
+ * @class Metrics
+ * @brief Per-thread counters aggregated on demand.
+ *
+ * Each thread that records gets its own slot of atomic counters the first
+ * time it touches a Metrics instance; afterwards recording is a few relaxed
+ * atomic stores into memory no other thread writes. snapshot() sums all
+ * slots without stopping the recorders, so a snapshot taken under load is
+ * consistent per counter but not across counters.
+ */
+class Metrics {
+public:
+    Metrics();
+    ~Metrics();
+
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    /**
+     * @brief Records one call that started at start and ends now.
+     */
+    void record(MetricOp op, chrono::steady_clock::time_point start, bool ok) {
+        uint64_t ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        recordLatency(op, ns, ok);
+    }
+
+    void recordLatency(MetricOp op, uint64_t ns, bool ok);
+    void recordBooking(BookingStatus status);
+
+    MetricsSnapshot snapshot() const;
+
+private:
+    struct Slot;
+
+    const uint64_t instanceId;                ///< Distinguishes instances in the thread-local cache
+    mutable mutex slotsMutex;                 ///< Guards slot registration and enumeration
+    vector<unique_ptr<Slot>> slots;
+    map<thread::id, Slot*> slotOfThread;
+
+    Slot& localSlot();
+    Slot& registerThread();
+};
+
+#endif // METRICS_H
@@ -0,0 +1,97 @@
+/**
+ * @file Money.h
+ * @brief Fixed-point amount of money in fen (1/100 yuan).
+ */
+
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <cctype>
+#include <ostream>
+
+using namespace std;
+
+/**
+ * @class Money
+ * @brief Exact integer amount; doubles only appear when converting at the boundary.
+ */
+class Money {
+public:
+    constexpr Money() : cents(0) {}
+    constexpr explicit Money(int64_t fen) : cents(fen) {}
+
+    /**
+     * @brief Rounds a yuan amount to the nearest fen.
+     */
+    static Money fromYuan(double yuan) { return Money(llround(yuan * 100)); }
+
+    /**
+     * @brief Reads an amount written by toString() ("123.45", "-7.5", "12")
+     * without going through a double.
+     * @return false unless the whole text is such an amount.
+     */
+    static bool parse(const string& text, Money& money) {
+        bool negative = !text.empty() && text[0] == '-';
+        size_t i = negative ? 1 : 0;
+        size_t wholeDigits = 0, decimals = 0;
+        int64_t whole = 0, frac = 0;
+        for (; i < text.size() && isdigit(static_cast<unsigned char>(text[i])); ++i, ++wholeDigits) {
+            if (whole > (INT64_MAX / 100 - 1) / 10) return false;
+            whole = whole * 10 + (text[i] - '0');
+        }
+        if (i < text.size() && text[i] == '.') {
+            for (++i; i < text.size() && decimals < 2 && isdigit(static_cast<unsigned char>(text[i])); ++i, ++decimals) {
+                frac = frac * 10 + (text[i] - '0');
+            }
+            if (decimals == 0) return false;
+        }
+        if (wholeDigits == 0 || i != text.size()) return false;
+        int64_t fen = whole * 100 + (decimals == 1 ? frac * 10 : frac);
+        money = Money(negative ? -fen : fen);
+        return true;
+    }
+
+    int64_t getCents() const { return cents; }
+    double toYuan() const { return cents / 100.0; }
+
+    /**
+     * @brief Amount multiplied by basisPoints / 10000, rounded half away from zero.
+     */
+    Money scaledBp(int64_t basisPoints) const {
+        int64_t product = cents * basisPoints;
+        return Money((product + (product >= 0 ? 5000 : -5000)) / 10000);
+    }
+
+    /**
+     * @brief "123.45" (always two decimals).
+     */
+    string toString() const {
+        int64_t whole = llabs(cents) / 100;
+        int64_t frac = llabs(cents) % 100;
+        return string(cents < 0 ? "-" : "") + to_string(whole) + (frac < 10 ? ".0" : ".") + to_string(frac);
+    }
+
+    Money operator+(Money other) const { return Money(cents + other.cents); }
+    Money operator-(Money other) const { return Money(cents - other.cents); }
+    Money operator*(int64_t factor) const { return Money(cents * factor); }
+    Money& operator+=(Money other) { cents += other.cents; return *this; }
+    Money& operator-=(Money other) { cents -= other.cents; return *this; }
+
+    bool operator==(Money other) const { return cents == other.cents; }
+    bool operator!=(Money other) const { return cents != other.cents; }
+    bool operator<(Money other) const { return cents < other.cents; }
+    bool operator<=(Money other) const { return cents <= other.cents; }
+    bool operator>(Money other) const { return cents > other.cents; }
+    bool operator>=(Money other) const { return cents >= other.cents; }
+
+    friend ostream& operator<<(ostream& os, Money money) { return os << money.toString(); }
+
+private:
+    int64_t cents;
+};
+
+#endif // MONEY_H
@@ -0,0 +1,86 @@
+/**
+ * @file NetworkGenerator.h
+ * @brief Deterministic synthetic railway networks for benchmarks and stress tests.
+ */
+
+#ifndef NETWORKGENERATOR_H
+#define NETWORKGENERATOR_H
+
+#include <string>
+#include <vector>
+#include <random>
+#include "Train.h"
+
+using namespace std;
+
+class SystemManager;
+
+/**
+ * @brief Size and shape of a generated network.
+ */
+struct NetworkConfig {
+    int stations = 200;         ///< Stations, arranged on a ring
+    int trains = 1000;          ///< Number of trains
+    int stopsPerTrain = 12;     ///< Stops per train (capped at the station count)
+    int daysOnSale = 30;        ///< Consecutive dates starting at firstDate
+    int seatsPerTrain = 1000;   ///< Capacity of every train
+    int sharedPatternPercent = 0; ///< Share of trains repeating an earlier train's stopping pattern at another hour
+    unsigned seed = 42;         ///< Same seed, same network
+    string firstDate = "2024-01-01";
+};
+
+/**
+ * @class NetworkGenerator
+ * @brief Builds the same network for the same config, on any machine.
+ *
+ * Each train starts at a random station and runs forward around the ring
+ * with strides of 1-3 stations, so routes overlap the way lines sharing
+ * trunk sections do, and most station pairs a few stops apart are served.
+ * With sharedPatternPercent set, that share of trains instead runs the
+ * route of a random earlier train, as a clock-face timetable would, and
+ * points at the same Route object.
+ */
+class NetworkGenerator {
+public:
+    /**
+     * @brief A valid journey on one train.
+     */
+    struct Trip {
+        size_t trainIndex;  ///< Position in getTrains()
+        string trainId;
+        string from;
+        string to;
+        string date;
+    };
+
+    explicit NetworkGenerator(const NetworkConfig& config);
+
+    const NetworkConfig& getConfig() const { return config; }
+    const vector<Train>& getTrains() const { return trains; }
+    const vector<string>& getDates() const { return dates; }
+
+    /**
+     * @brief Adds every generated train to a SystemManager.
+     */
+    void populate(SystemManager& system) const;
+
+    /**
+     * @brief Picks a random journey (train, boarding and alighting stop, date).
+     */
+    Trip randomTrip(mt19937& rng) const;
+
+    static string stationName(int index);
+    static string trainId(int index);
+
+    /**
+     * @brief Adds days to a YYYY-MM-DD date.
+     */
+    static string addDays(const string& date, int days);
+
+private:
+    NetworkConfig config;
+    vector<Train> trains;
+    vector<string> dates;
+};
+
+#endif // NETWORKGENERATOR_H
@@ -0,0 +1,120 @@
+/**
+ * @file OccupancyDashboard.h
+ * @brief Admin occupancy table: per-train segment load heatmap for one date.
+ *
+ * The model loads one snapshot (SystemManager::getOccupancy) when the date
+ * is chosen and is kept current from inventory events afterwards. Events
+ * arrive on booking threads and are only queued there; the GUI thread
+ * applies everything queued once per frame and signals one dataChanged
+ * range, so the cost of an update depends on the bookings made, not on the
+ * number of trains.
+ */
+
+#ifndef OCCUPANCYDASHBOARD_H
+#define OCCUPANCYDASHBOARD_H
+
+#include <QAbstractTableModel>
+#include <QStyledItemDelegate>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include "SystemManager.h"
+
+using namespace std;
+
+/// Milliseconds between the first queued event and the model update
+const int OCCUPANCY_FRAME_MS = 16;
+
+/**
+ * @class OccupancyModel
+ * @brief One row per train with sold and remaining seats and per-segment free seats.
+ */
+class OccupancyModel : public QAbstractTableModel, public InventoryListener {
+    Q_OBJECT
+
+public:
+    enum Column { COL_TRAIN, COL_SOLD, COL_REMAINING, COL_LOAD, COL_HEATMAP, COLUMN_COUNT };
+
+    struct Row {
+        QString trainId;
+        int totalSeats;
+        vector<int> freeSeats;  ///< Per segment
+        uint64_t version;       ///< Last inventory version applied
+        int sold;               ///< Seats sold on the busiest segment
+        int remaining;          ///< Seats still sellable end to end
+    };
+
+    /**
+     * @brief Registers with the system as an inventory listener until destroyed.
+     */
+    OccupancyModel(SystemManager& system, QObject *parent = nullptr);
+    ~OccupancyModel();
+
+    /**
+     * @brief Shows another date: takes one snapshot, then follows events.
+     */
+    void setDate(const string& date);
+    const string& getDate() const { return date; }
+
+    /**
+     * @brief Adds an empty row for a train created after the snapshot.
+     */
+    void addTrain(const Train& train);
+
+    const Row& rowAt(int row) const { return rows[row]; }
+
+    /// Sum of Row::sold and of capacities over all trains
+    int getTotalSold() const { return totalSold; }
+    int getTotalCapacity() const { return totalCapacity; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    /**
+     * @brief Queues the event; runs on booking threads.
+     */
+    void onInventoryChange(const InventoryEvent& event) override;
+
+signals:
+    /**
+     * @brief Emitted after each frame's update.
+     */
+    void totalsChanged(int sold, int capacity);
+
+private:
+    SystemManager& system;
+    string date;                              ///< Date shown (GUI thread)
+    vector<Row> rows;
+    unordered_map<string, int> rowOfTrain;
+    int totalSold = 0;
+    int totalCapacity = 0;
+
+    mutex pendingMutex;                       ///< Guards the three members below
+    string watchedDate;                       ///< Events for other dates are dropped
+    vector<InventoryEvent> pending;           ///< Events since the last frame
+    bool flushScheduled = false;
+
+    void flush();
+    int appendRow(const string& trainId, int totalSeats, vector<int> freeSeats, uint64_t version);
+    void summarize(Row& row);
+};
+
+/**
+ * @class HeatmapDelegate
+ * @brief Paints a row's segments as cells shaded from green (empty) to red (full).
+ */
+class HeatmapDelegate : public QStyledItemDelegate {
+    Q_OBJECT
+
+public:
+    explicit HeatmapDelegate(const OccupancyModel *model, QObject *parent = nullptr);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+private:
+    const OccupancyModel *model;
+};
+
+#endif // OCCUPANCYDASHBOARD_H
@@ -9,6 +9,8 @@
 #include <string>
 #include <iostream>
 #include <ctime>
+#include "Money.h"
+#include "SeatClass.h"
 
 using namespace std;
 
@@ -33,41 +35,82 @@ private:
     string trainId;       ///< Train ID
     string startStation;  ///< Departure Station
     string endStation;    ///< Arrival Station
-    string date;          ///< Travel Date
-    string departureTime; ///< Departure Time
-    double price;         ///< Total Price
+    string date;          ///< Travel Date (at the departure station)
+    int departureMinutes; ///< Departure time, in minutes after midnight of the train's service date
+    Money price;          ///< Total Price
     int ticketCount;      ///< Number of tickets
+    SeatClass seatClass;  ///< Class of the tickets
     OrderStatus status;   ///< Current status
     time_t createTime;    ///< Order creation timestamp
+    string journeyId;     ///< ID of the journey's first order; empty for standalone orders
+    int journeyLeg = 0;   ///< Position of this order in its journey
+    int journeyLegs = 1;  ///< Number of orders in the journey
 
 public:
     Order() = default;
 
     /**
-     * @brief Parameterized Constructor.
+     * @brief Parameterized Constructor. String arguments are moved into the order.
      */
-    Order(string uName, string tId, string start, string end, string d, string time, double p, int count);
-
-    // Getters
-    string getOrderId() const { return orderId; }
-    string getUsername() const { return username; }
-    string getTrainId() const { return trainId; }
-    string getStartStation() const { return startStation; }
-    string getEndStation() const { return endStation; }
-    string getDate() const { return date; }
-    double getPrice() const { return price; }
+    Order(string uName, string tId, string start, string end, string d, int departure, Money p, int count, SeatClass seat = SECOND_CLASS);
+
+    /**
+     * @brief Constructor with a caller-supplied ID and creation time.
+     * Used when timestamps come from an injected Clock.
+     */
+    Order(string uName, string tId, string start, string end, string d, int departure, Money p, int count, string id, time_t created,
+          SeatClass seat = SECOND_CLASS);
+
+    // Getters (references stay valid while the order is not modified or moved)
+    const string& getOrderId() const { return orderId; }
+    const string& getUsername() const { return username; }
+    const string& getTrainId() const { return trainId; }
+    const string& getStartStation() const { return startStation; }
+    const string& getEndStation() const { return endStation; }
+    const string& getDate() const { return date; }
+    int getDepartureMinutes() const { return departureMinutes; }
+    Money getPrice() const { return price; }
     OrderStatus getStatus() const { return status; }
     int getTicketCount() const { return ticketCount; }
+    SeatClass getSeatClass() const { return seatClass; }
+    time_t getCreateTime() const { return createTime; }
+    const string& getJourneyId() const { return journeyId; }
+    int getJourneyLeg() const { return journeyLeg; }
+    int getJourneyLegs() const { return journeyLegs; }
+    bool isJourneyLeg() const { return !journeyId.empty(); }
+
+    /**
+     * @brief Heap bytes owned by this order's strings.
+     */
+    size_t getHeapBytes() const;
 
     // Setters
     void setStatus(OrderStatus s) { status = s; }
 
+    /**
+     * @brief Links the order into a journey booked and refunded as a whole.
+     * @param id ID of the journey's first order
+     * @param leg Position of this order in the journey
+     * @param legs Number of orders in the journey
+     */
+    void setJourney(const string& id, int leg, int legs) {
+        journeyId = id;
+        journeyLeg = leg;
+        journeyLegs = legs;
+    }
+
     /**
      * @brief Generates a unique order ID based on time and counter.
      * @return Unique ID string
      */
     static string generateOrderId();
 
+    /**
+     * @brief Formats an order ID from a timestamp and a sequence number.
+     * Deterministic: the same inputs always give the same ID.
+     */
+    static string generateOrderId(time_t now, unsigned sequence);
+
     /**
      * @brief Overloaded output operator.
      */
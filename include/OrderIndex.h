@@ -0,0 +1,56 @@
+/**
+ * @file OrderIndex.h
+ * @brief Definition of the concurrent order index.
+ */
+
+#ifndef ORDERINDEX_H
+#define ORDERINDEX_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+using namespace std;
+
+/**
+ * @brief Where an order is stored.
+ */
+struct OrderLocation {
+    string username;  ///< Owner of the order
+    size_t position;  ///< Index in the owner's order history
+};
+
+/**
+ * @class OrderIndex
+ * @brief Sharded map from order ID to the order's location.
+ *
+ * Lets refunds find an order without scanning the owner's history, and is
+ * safe to use from many threads: each shard has its own lock.
+ */
+class OrderIndex {
+public:
+    explicit OrderIndex(size_t shardCount = 16);
+
+    void insert(const string& orderId, OrderLocation location);
+    bool find(const string& orderId, OrderLocation& location) const;
+    size_t size() const;
+
+    /**
+     * @brief Bytes used by the index (buckets, nodes and key strings).
+     */
+    size_t getMemoryBytes() const;
+
+private:
+    struct Shard {
+        mutable mutex mtx;
+        unordered_map<string, OrderLocation> orders;
+    };
+
+    vector<unique_ptr<Shard>> shards;
+
+    Shard& shardFor(const string& orderId) const;
+};
+
+#endif // ORDERINDEX_H
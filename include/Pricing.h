@@ -0,0 +1,80 @@
+/**
+ * @file Pricing.h
+ * @brief Dynamic fare policy: load-factor and days-to-departure multipliers.
+ *
+ * A segment's fare is its base fare (the difference of the route's
+ * priceFromStart values) times a multiplier of the segment's load factor.
+ * A journey's quote is the sum of its segment fares times a multiplier of
+ * the days left until departure. Trains keep a prefix sum of the segment
+ * fares per date, updated for the changed segments on every booking and
+ * refund, so a quote is two lookups and one multiplication.
+ */
+
+#ifndef PRICING_H
+#define PRICING_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include "Money.h"
+#include "Calendar.h"
+
+using namespace std;
+
+/// Basis points of a multiplier of 1.0
+const int PRICE_BP_ONE = 10000;
+/// Days to departure beyond which the days curve is flat
+const int PRICING_MAX_DAYS = 365;
+
+/**
+ * @brief Piecewise-linear curve of a multiplier in basis points.
+ * Knots are (x, basis points) with increasing x; values outside the first
+ * and last knot are clamped.
+ */
+struct PricingCurve {
+    vector<pair<int, int>> knots;
+
+    int at(int x) const;
+};
+
+/**
+ * @class PricingPolicy
+ * @brief Immutable fare curves, shared by every train that uses them.
+ * Both curves are sampled into lookup tables when the policy is built.
+ */
+class PricingPolicy {
+public:
+    /**
+     * @param loadCurve Multiplier by segment load in permille (0 = empty, 1000 = full)
+     * @param daysCurve Multiplier by whole days until departure (0 = travel day)
+     */
+    PricingPolicy(PricingCurve loadCurve, PricingCurve daysCurve);
+
+    /**
+     * @brief Cheap when empty, up to 1.6x when nearly full; early purchases
+     * get a discount, the last week a surcharge.
+     */
+    static PricingPolicy standard();
+
+    int loadMultiplier(int soldPermille) const {
+        return loadTable[soldPermille < 0 ? 0 : (soldPermille > 1000 ? 1000 : soldPermille)];
+    }
+
+    int daysMultiplier(int daysToDeparture) const {
+        return daysTable[daysToDeparture < 0 ? 0 : (daysToDeparture > PRICING_MAX_DAYS ? PRICING_MAX_DAYS : daysToDeparture)];
+    }
+
+    /**
+     * @brief Fare of a segment with the given base fare and seat counts.
+     */
+    Money segmentFare(Money base, int freeSeats, int totalSeats) const {
+        int permille = totalSeats > 0 ? static_cast<int>(1000LL * (totalSeats - freeSeats) / totalSeats) : 0;
+        return base.scaledBp(loadMultiplier(permille));
+    }
+
+private:
+    vector<int> loadTable;  ///< 1001 entries
+    vector<int> daysTable;  ///< PRICING_MAX_DAYS + 1 entries
+};
+
+#endif // PRICING_H
@@ -0,0 +1,150 @@
+/**
+ * @file Rcu.h
+ * @brief Epoch-based reclamation and an atomically swapped pointer to
+ * immutable versions (read-copy-update).
+ *
+ * Readers pin the domain, load the current version and read it without
+ * taking any lock; a pin is one CAS on a reader slot that is, in practice,
+ * never shared with another thread. A writer builds the next version off
+ * to the side, swaps it in with one atomic exchange and retires the old
+ * one, which is deleted once every reader that could still see it has
+ * unpinned.
+ */
+
+#ifndef RCU_H
+#define RCU_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * @class EpochDomain
+ * @brief Tracks which readers may still hold retired objects.
+ *
+ * Every retire advances the global epoch; an object retired at epoch r is
+ * reclaimed once no pinned reader announced an epoch older than r. A reader
+ * that announced r or later read the epoch after the object was unlinked,
+ * so it can only have loaded its successor.
+ */
+class EpochDomain {
+public:
+    /// Reader slots; more concurrent readers than this wait for a free one
+    static const size_t SLOT_COUNT = 128;
+
+    /**
+     * @class Guard
+     * @brief A pinned reader; objects it loads stay alive until it is destroyed.
+     */
+    class Guard {
+    public:
+        Guard(Guard&& other) noexcept : domain(other.domain), slot(other.slot) { other.domain = nullptr; }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        Guard& operator=(Guard&&) = delete;
+        ~Guard() {
+            if (domain) domain->unpin(slot);
+        }
+
+    private:
+        friend class EpochDomain;
+        Guard(EpochDomain* domain, size_t slot) : domain(domain), slot(slot) {}
+
+        EpochDomain* domain;
+        size_t slot;
+    };
+
+    EpochDomain() = default;
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    /**
+     * @brief Reclaims everything still retired; no reader may be pinned.
+     */
+    ~EpochDomain();
+
+    /**
+     * @brief Pins the calling reader until the guard is destroyed.
+     * Never blocks unless SLOT_COUNT readers are pinned at once.
+     */
+    Guard pin();
+
+    /**
+     * @brief Schedules reclaim to run once no reader can see the object,
+     * then reclaims whatever is safe.
+     */
+    void retire(function<void()> reclaim);
+
+    /**
+     * @brief Runs the reclaim functions no pinned reader can still need.
+     * @return Number of objects reclaimed.
+     */
+    size_t collect();
+
+    /// Objects retired but not yet reclaimed
+    size_t getPendingCount() const;
+
+    /// Retirements so far (the global epoch minus one)
+    uint64_t getEpoch() const { return globalEpoch.load(memory_order_relaxed) - 1; }
+
+private:
+    static const uint64_t IDLE = 0;
+
+    struct alignas(64) Slot {
+        atomic<uint64_t> epoch{IDLE};  ///< Epoch announced by the pinned reader, IDLE if free
+    };
+
+    atomic<uint64_t> globalEpoch{1};
+    Slot slots[SLOT_COUNT];
+    mutable mutex retiredMutex;  ///< Guards retired; writers only
+    vector<pair<uint64_t, function<void()>>> retired; ///< (epoch, reclaim), in epoch order
+
+    void unpin(size_t slot) { slots[slot].epoch.store(IDLE, memory_order_release); }
+};
+
+/**
+ * @class RcuPointer
+ * @brief The current immutable version of a T.
+ *
+ * Readers call load() while pinned; writers serialize among themselves and
+ * call publish() with the next version.
+ */
+template <class T>
+class RcuPointer {
+public:
+    RcuPointer(EpochDomain& domain, unique_ptr<const T> initial) : domain(domain), current(initial.release()) {}
+
+    RcuPointer(const RcuPointer&) = delete;
+    RcuPointer& operator=(const RcuPointer&) = delete;
+
+    /**
+     * @brief Deletes the current version; no reader may be pinned.
+     */
+    ~RcuPointer() { delete current.load(memory_order_relaxed); }
+
+    /**
+     * @brief The current version. Valid while the caller's guard lives, or
+     * until the caller (as the only writer) publishes the next one.
+     */
+    const T* load() const { return current.load(memory_order_seq_cst); }
+
+    /**
+     * @brief Makes next the current version and retires the old one.
+     */
+    void publish(unique_ptr<const T> next) {
+        const T* old = current.exchange(next.release(), memory_order_seq_cst);
+        domain.retire([old] { delete old; });
+    }
+
+private:
+    EpochDomain& domain;
+    atomic<const T*> current;
+};
+
+#endif // RCU_H
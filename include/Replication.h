@@ -0,0 +1,259 @@
+/**
+ * @file Replication.h
+ * @brief Log shipping from a primary SystemManager to hot-standby replicas.
+ *
+ * The primary appends every change of durable state (registrations, orders,
+ * order cancellations, trains added or removed) to a mutation log file.
+ * Each record is one TicketProtocol line: sequence number, wall-clock time
+ * in nanoseconds, operation name, then the operation's fields. A replica,
+ * usually in another process on the same machine, tails the file, applies
+ * each complete record to its own SystemManager and serves searches and
+ * order lookups. Sessions, metrics, admission state and the fare policy
+ * are local to each process and are not shipped.
+ *
+ * Records are appended in an order the replica can apply one by one: an
+ * order is logged after its seats are reserved and before it can be
+ * refunded, and a cancellation before its seats are released, so replaying
+ * the log in sequence never needs more seats than the primary had.
+ *
+ * Operations and their fields:
+ * - HEARTBEAT: none (written when the primary has been idle, so replicas can tell lag from silence)
+ * - REGISTER: user, password, name, idCard
+ * - ORDERS: order sequence, n, then n orders of ORDER_FIELDS fields (a journey is one record)
+ * - CANCEL: n, then n (user, orderId) pairs (all orders of a refunded journey)
+ * - ADD_TRAIN: n, then n trains (ID, type, class seats, stops, calendar)
+ * - DELETE_TRAIN: trainId (its orders' refunds follow as CANCEL records)
+ * - CANCEL_TRAIN: trainId, first and last service date (empty for an open
+ *   end); the refunds follow as CANCEL records
+ *
+ * Logs contain passwords; treat them as confidential.
+ */
+
+#ifndef REPLICATION_H
+#define REPLICATION_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+#include "Train.h"
+#include "Order.h"
+
+using namespace std;
+
+class SystemManager;
+
+/// Interval at which buffered records are written to the log file
+const int REPLICATION_FLUSH_MS = 2;
+/// Idle time after which the primary writes a heartbeat
+const int REPLICATION_HEARTBEAT_MS = 100;
+/// Interval at which a replica looks for new records when it has caught up
+const int REPLICATION_POLL_MS = 1;
+
+/**
+ * @enum MutationOp
+ * @brief The state change a log record describes.
+ */
+enum MutationOp {
+    MUTATION_HEARTBEAT = 1,
+    MUTATION_REGISTER,
+    MUTATION_ORDERS,
+    MUTATION_CANCEL,
+    MUTATION_ADD_TRAIN,
+    MUTATION_DELETE_TRAIN,
+    MUTATION_CANCEL_TRAIN
+};
+
+/**
+ * @brief Name of an operation as written in the log ("ORDERS", ...).
+ */
+const char* mutationOpName(MutationOp op);
+
+/**
+ * @brief Parses a name written by mutationOpName.
+ */
+bool parseMutationOp(const string& name, MutationOp& op);
+
+/**
+ * @class ReplicationLog
+ * @brief Appends mutation records to a log file on the primary. Thread-safe.
+ *
+ * Records are encoded into a memory buffer under a mutex; a background
+ * thread writes the buffer out every REPLICATION_FLUSH_MS (group commit)
+ * and adds a heartbeat when nothing was logged for REPLICATION_HEARTBEAT_MS.
+ */
+class ReplicationLog {
+public:
+    ReplicationLog() = default;
+    ~ReplicationLog();
+
+    ReplicationLog(const ReplicationLog&) = delete;
+    ReplicationLog& operator=(const ReplicationLog&) = delete;
+
+    /**
+     * @brief Creates (truncates) the log file and starts the flusher.
+     * @param firstSequence Sequence number of the first record (a promoted
+     * replica continues the numbering of the log it followed)
+     */
+    bool open(const string& path, uint64_t firstSequence = 1);
+
+    /**
+     * @brief Writes out buffered records and closes the file.
+     */
+    void close();
+
+    bool isOpen() const;
+
+    void logRegister(const string& username, const string& password, const string& name, const string& idCard);
+
+    /**
+     * @brief Logs the orders of one booking (several for a journey) as one record.
+     * @param orderSequence The primary's order sequence after the booking
+     */
+    void logOrders(const vector<Order>& orders, unsigned orderSequence);
+
+    /**
+     * @brief Logs the orders cancelled by one refund as one record.
+     */
+    void logCancels(const vector<Order>& cancelled);
+
+    void logTrains(const vector<const Train*>& trains);
+    void logDeleteTrain(const string& trainId);
+
+    /**
+     * @brief Logs that a train stops running on service days firstDay to
+     * lastDay (INT_MIN and INT_MAX for an open end).
+     */
+    void logCancelTrain(const string& trainId, int firstDay, int lastDay);
+
+    /**
+     * @brief Writes buffered records to the file.
+     */
+    void flush();
+
+    /// Sequence number of the last record appended (firstSequence - 1 before any)
+    uint64_t getSequence() const;
+    const string& getPath() const { return path; }
+
+private:
+    mutable mutex mtx;            ///< Guards buffer, sequence and the idle clock
+    mutex fileMutex;              ///< Orders writes to the file; taken before mtx
+    condition_variable wake;
+    ofstream file;
+    string path;
+    string buffer;                ///< Encoded records not yet written
+    uint64_t nextSequence = 1;
+    chrono::steady_clock::time_point lastAppend;
+    thread flusher;
+    bool stopping = false;
+
+    /**
+     * @brief Stamps and encodes one record (fields after the operation name).
+     */
+    void append(MutationOp op, const vector<string>& fields);
+    void flushLoop();
+};
+
+/**
+ * @brief Replication state of a replica.
+ */
+struct ReplicationStatus {
+    bool promoted = false;         ///< Serving writes; the log is no longer followed
+    uint64_t appliedSequence = 0;  ///< Sequence number of the last record applied
+    uint64_t appliedRecords = 0;   ///< Records applied so far
+    uint64_t pendingBytes = 0;     ///< Log bytes written by the primary and not yet applied
+    int64_t lagMs = -1;            ///< Age of the last record applied (-1 before the first)
+    uint64_t errors = 0;           ///< Records that could not be parsed or applied
+    string lastError;
+};
+
+/**
+ * @class Replica
+ * @brief Hot standby: follows a primary's mutation log into a SystemManager.
+ *
+ * The SystemManager must start in the state the primary's started in (e.g.
+ * both freshly constructed). It stays fully readable while the log is
+ * applied; callers should not write to it until the replica is promoted
+ * (TicketServer rejects writes on an unpromoted replica).
+ */
+class Replica {
+public:
+    Replica(SystemManager& system, string logPath);
+    ~Replica();
+
+    Replica(const Replica&) = delete;
+    Replica& operator=(const Replica&) = delete;
+
+    /**
+     * @brief Starts following the log on a background thread. The log
+     * file need not exist yet.
+     */
+    void start();
+
+    /**
+     * @brief Stops the background thread; records already applied stay.
+     */
+    void stop();
+
+    /**
+     * @brief Applies every complete record written so far.
+     * @return Number of records applied.
+     */
+    size_t poll();
+
+    /**
+     * @brief Waits until the record with this sequence number is applied.
+     * @return false on timeout.
+     */
+    bool waitForSequence(uint64_t sequence, chrono::milliseconds timeout);
+
+    ReplicationStatus getStatus() const;
+
+    /**
+     * @brief Once promoted, the SystemManager logs its own changes to path,
+     * numbered after the last record applied, for replicas of the new primary.
+     */
+    void setPromotionLog(const string& path) { promotionLogPath = path; }
+
+    /**
+     * @brief Stops following the log, applies what the old primary wrote
+     * and turns this replica into a primary.
+     * @return Sequence number of the last record applied.
+     */
+    uint64_t promote();
+
+    bool isPromoted() const { return promoted.load(); }
+
+private:
+    SystemManager& system;
+    string logPath;
+    string promotionLogPath;
+    unique_ptr<ReplicationLog> promotionLog;
+
+    mutable mutex pollMutex;     ///< One poll at a time; guards the reader state and status
+    ifstream in;
+    uint64_t readOffset = 0;     ///< Log bytes read, including the partial record
+    string partial;              ///< Incomplete last line
+    ReplicationStatus status;
+    int64_t lastAppliedNs = 0;   ///< Primary wall-clock time of the last record applied
+
+    thread follower;
+    atomic<bool> running{false};
+    atomic<bool> promoted{false};
+    condition_variable applied;  ///< Signalled after each poll that applied records
+
+    /**
+     * @brief Applies one decoded record.
+     * @return false with error set if it cannot be applied.
+     */
+    bool apply(const vector<string>& fields, string& error);
+    void followLoop();
+};
+
+#endif // REPLICATION_H
@@ -0,0 +1,133 @@
+/**
+ * @file Route.h
+ * @brief Immutable stopping patterns shared by trains.
+ *
+ * A route is the sequence of stops of a service with times relative to its
+ * first departure, so every train running the same pattern at a different
+ * hour points at the same Route and only keeps its own departure time.
+ * Routes never change once built; trains extend theirs by building a new
+ * one, and RouteTable interns equal routes so copies of a pattern built
+ * independently end up sharing one object.
+ */
+
+#ifndef ROUTE_H
+#define ROUTE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "Money.h"
+#include "SeatClass.h"
+
+using namespace std;
+
+/**
+ * @brief Represents a single stop on a train's route.
+ */
+struct Stop {
+    string stationName;   ///< Name of the station
+    int arrivalMinutes;   ///< Arrival, in minutes after midnight of the service date (1530 = 01:30 next day)
+    int departureMinutes; ///< Departure, on the same scale as arrivalMinutes
+    double priceFromStart; ///< Cumulative second-class price from the starting station
+    int distance;         ///< Distance from the starting station in km
+    double firstPriceFromStart = 0.0;    ///< Cumulative first-class price (unused without first-class seats)
+    double businessPriceFromStart = 0.0; ///< Cumulative business-class price (unused without business seats)
+
+    /**
+     * @brief The price column of a class.
+     */
+    double classPrice(SeatClass seatClass) const {
+        return seatClass == FIRST_CLASS ? firstPriceFromStart
+             : (seatClass == BUSINESS_CLASS ? businessPriceFromStart : priceFromStart);
+    }
+
+    bool operator==(const Stop& other) const {
+        return stationName == other.stationName && arrivalMinutes == other.arrivalMinutes &&
+               departureMinutes == other.departureMinutes && priceFromStart == other.priceFromStart &&
+               distance == other.distance && firstPriceFromStart == other.firstPriceFromStart &&
+               businessPriceFromStart == other.businessPriceFromStart;
+    }
+};
+
+/**
+ * @class Route
+ * @brief An immutable stopping pattern with its base fares.
+ */
+class Route {
+public:
+    /**
+     * @param stops Stops whose times are relative to the pattern's first
+     * departure (the train adds its own departure time)
+     */
+    explicit Route(vector<Stop> stops);
+
+    /**
+     * @brief The route without stops, shared by every train that has none yet.
+     */
+    static const shared_ptr<const Route>& empty();
+
+    /**
+     * @brief A new route with one more stop (times relative, like the others).
+     */
+    shared_ptr<const Route> withStop(const Stop& stop) const;
+
+    const vector<Stop>& getStops() const { return stops; }
+    size_t size() const { return stops.size(); }
+    bool isEmpty() const { return stops.empty(); }
+    const Stop& operator[](size_t i) const { return stops[i]; }
+
+    /**
+     * @brief First position of a station on the route, or -1.
+     */
+    int findStation(const string& stationName) const;
+
+    /**
+     * @brief Base fare of one seat of a class from the first stop to stop i.
+     */
+    Money baseFare(size_t i, SeatClass seatClass) const { return basePrefix[i * SEAT_CLASS_COUNT + seatClass]; }
+
+    /**
+     * @brief Hash of the stops, for interning.
+     */
+    size_t getHash() const { return hash; }
+
+    bool operator==(const Route& other) const { return hash == other.hash && stops == other.stops; }
+
+    /**
+     * @brief Bytes of the object, its stops and station names, and its fare table.
+     */
+    size_t getMemoryBytes() const;
+
+private:
+    vector<Stop> stops;
+    vector<Money> basePrefix; ///< Stop-major: entry stop * SEAT_CLASS_COUNT + class
+    size_t hash = 0;
+};
+
+/**
+ * @class RouteTable
+ * @brief Interns routes so equal patterns share one object.
+ *
+ * Holds routes weakly: a route is freed with the last train using it, and
+ * its slot is reused on the next intern() of the same hash. Thread-safe.
+ */
+class RouteTable {
+public:
+    /**
+     * @brief The shared route equal to route, which becomes the shared one if none is live.
+     */
+    shared_ptr<const Route> intern(const shared_ptr<const Route>& route);
+
+    /**
+     * @brief Number of live interned routes.
+     */
+    size_t size() const;
+
+private:
+    mutable mutex mtx;
+    unordered_map<size_t, vector<weak_ptr<const Route>>> routes; ///< By Route::getHash()
+};
+
+#endif // ROUTE_H
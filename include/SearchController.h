@@ -0,0 +1,75 @@
+/**
+ * @file SearchController.h
+ * @brief Runs train searches on a background thread and streams them into a TrainResultModel.
+ */
+
+#ifndef SEARCHCONTROLLER_H
+#define SEARCHCONTROLLER_H
+
+#include <QObject>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include "SystemManager.h"
+#include "TableModels.h"
+
+/**
+ * @class SearchController
+ * @brief Owns one worker thread that serves the most recent search request.
+ *
+ * search() returns immediately. A new request cancels the one in progress
+ * (through SystemManager::searchTrainsStreaming's cancel flag) and replaces
+ * any request still waiting, so typing quickly only runs the last query.
+ * Batches are converted to rows on the worker and appended to the model on
+ * the GUI thread; batches of a superseded search are dropped by comparing
+ * generation numbers.
+ */
+class SearchController : public QObject {
+    Q_OBJECT
+
+public:
+    SearchController(SystemManager& system, TrainResultModel *model, QObject *parent = nullptr);
+    ~SearchController();
+
+    /**
+     * @brief Clears the model and starts searching in the background.
+     */
+    void search(const string& start, const string& end, const string& date);
+
+    /**
+     * @brief Cancels the current search, if any.
+     */
+    void cancel();
+
+signals:
+    /**
+     * @brief Emitted on the GUI thread when the latest search has delivered all its results.
+     */
+    void finished(int resultCount);
+
+private:
+    struct Request {
+        uint64_t generation;
+        string start;
+        string end;
+        string date;
+    };
+
+    SystemManager& system;
+    TrainResultModel *model;
+    uint64_t generation = 0;        ///< Latest request (GUI thread only)
+    int delivered = 0;              ///< Rows of the latest request appended so far (GUI thread only)
+
+    mutex mtx;
+    condition_variable cv;
+    unique_ptr<Request> pending;    ///< Waiting request, replaced by newer ones
+    shared_ptr<atomic<bool>> running; ///< Cancel flag of the search in progress
+    bool stopping = false;
+    thread worker;
+
+    void run();
+};
+
+#endif // SEARCHCONTROLLER_H
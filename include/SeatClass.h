@@ -0,0 +1,52 @@
+/**
+ * @file SeatClass.h
+ * @brief Seat classes sold on a train.
+ */
+
+#ifndef SEATCLASS_H
+#define SEATCLASS_H
+
+#include <string>
+
+using namespace std;
+
+/**
+ * @enum SeatClass
+ * @brief Seat classes, cheapest first. Values index per-class arrays.
+ */
+enum SeatClass {
+    SECOND_CLASS,   ///< Standard seats (the only class of single-class trains)
+    FIRST_CLASS,    ///< First class
+    BUSINESS_CLASS  ///< Business class
+};
+
+/// Number of SeatClass values (for per-class arrays)
+const int SEAT_CLASS_COUNT = BUSINESS_CLASS + 1;
+
+/**
+ * @brief Name of a seat class, as accepted by parseSeatClass.
+ */
+inline const char* seatClassName(SeatClass seatClass) {
+    switch (seatClass) {
+        case SECOND_CLASS: return "second";
+        case FIRST_CLASS: return "first";
+        case BUSINESS_CLASS: return "business";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief Parses a name printed by seatClassName.
+ * @return False if the name is not a seat class.
+ */
+inline bool parseSeatClass(const string& name, SeatClass& seatClass) {
+    for (int c = 0; c < SEAT_CLASS_COUNT; ++c) {
+        if (name == seatClassName(static_cast<SeatClass>(c))) {
+            seatClass = static_cast<SeatClass>(c);
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif // SEATCLASS_H
@@ -0,0 +1,118 @@
+/**
+ * @file ServiceCalendar.h
+ * @brief Days on which a train runs.
+ *
+ * A calendar is a weekday pattern limited to a validity range, with
+ * individual dates added or removed as exceptions ("weekdays except public
+ * holidays"). Exceptions are kept as a bitmap over the span of days they
+ * cover, so runsOn() is a range check, a weekday bit and at most one
+ * exception bit, whatever the number of exceptions.
+ */
+
+#ifndef SERVICECALENDAR_H
+#define SERVICECALENDAR_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <climits>
+#include "Calendar.h"
+
+using namespace std;
+
+/// Weekday bits, Monday first (bit Calendar::weekday(day))
+const uint8_t MONDAY = 1 << 0;
+const uint8_t TUESDAY = 1 << 1;
+const uint8_t WEDNESDAY = 1 << 2;
+const uint8_t THURSDAY = 1 << 3;
+const uint8_t FRIDAY = 1 << 4;
+const uint8_t SATURDAY = 1 << 5;
+const uint8_t SUNDAY = 1 << 6;
+const uint8_t WEEKDAYS = MONDAY | TUESDAY | WEDNESDAY | THURSDAY | FRIDAY;
+const uint8_t WEEKENDS = SATURDAY | SUNDAY;
+const uint8_t EVERY_DAY = WEEKDAYS | WEEKENDS;
+
+/**
+ * @class ServiceCalendar
+ * @brief Weekday bitmask, validity range and exception dates of a service.
+ *
+ * Calendars are shared between trains through shared_ptr<const
+ * ServiceCalendar>; build one completely before handing it out.
+ */
+class ServiceCalendar {
+public:
+    /**
+     * @brief A calendar that runs every day.
+     */
+    ServiceCalendar() = default;
+
+    /**
+     * @param weekdays Days of the week the service runs (MONDAY | ...)
+     * @param firstDate First date of the validity range (empty for no start)
+     * @param lastDate Last date of the validity range (empty for no end)
+     */
+    explicit ServiceCalendar(uint8_t weekdays, const string& firstDate = "", const string& lastDate = "");
+
+    /**
+     * @brief Makes the service run (runs = true) or not run on one date,
+     * overriding the weekday pattern and validity range.
+     */
+    void addException(const string& date, bool runs);
+
+    /**
+     * @brief Whether the service runs on a day number (Calendar::dayNumber).
+     */
+    bool runsOn(int day) const {
+        bool runs = day >= firstDay && day <= lastDay && (weekdays >> Calendar::weekday(day) & 1);
+        int64_t offset = static_cast<int64_t>(day) - exceptionBase;
+        if (offset >= 0 && offset < static_cast<int64_t>(exceptions.size()) * 64 &&
+            (exceptions[offset / 64] >> (offset % 64) & 1)) {
+            runs = !runs;
+        }
+        return runs;
+    }
+
+    bool runsOn(const string& date) const { return runsOn(Calendar::dayNumber(date)); }
+
+    uint8_t getWeekdays() const { return weekdays; }
+
+    /// First date of the validity range, empty if it has no start
+    string getFirstDate() const { return firstDay == INT_MIN ? "" : Calendar::formatDate(firstDay); }
+    /// Last date of the validity range, empty if it has no end
+    string getLastDate() const { return lastDay == INT_MAX ? "" : Calendar::formatDate(lastDay); }
+
+    /**
+     * @brief Day numbers of the exceptions, ascending. Rebuilding the
+     * calendar with addException(date, runsOn(day)) for each gives an
+     * equal one.
+     */
+    vector<int> getExceptionDays() const;
+
+    /**
+     * @brief This calendar with no service from firstDay to lastDay (day
+     * numbers; INT_MIN and INT_MAX for an open end). A cancellation at
+     * either end of the validity range shrinks the range; one inside it
+     * adds an exception per cancelled running day. Days outside the
+     * validity range only lose their exceptions.
+     */
+    ServiceCalendar withoutDays(int firstDay, int lastDay) const;
+
+    /**
+     * @brief Number of dates whose service differs from the weekday pattern and range.
+     */
+    size_t getExceptionCount() const;
+
+    /**
+     * @brief Heap bytes of the exception bitmap.
+     */
+    size_t getHeapBytes() const { return exceptions.capacity() * sizeof(uint64_t); }
+
+private:
+    uint8_t weekdays = EVERY_DAY;
+    int firstDay = INT_MIN;
+    int lastDay = INT_MAX;
+    int exceptionBase = 0;       ///< Day of bit 0 of exceptions (a multiple of 64)
+    vector<uint64_t> exceptions; ///< Set bits flip the pattern's answer for that day
+};
+
+#endif // SERVICECALENDAR_H
@@ -0,0 +1,101 @@
+/**
+ * @file SessionManager.h
+ * @brief Definition of the SessionManager class.
+ *
+ * The session table maps opaque session tokens to logged-in users.
+ * It replaces the single "current user" slot so that many clients can
+ * be logged in to one SystemManager at the same time.
+ */
+
+#ifndef SESSIONMANAGER_H
+#define SESSIONMANAGER_H
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <unordered_map>
+#include "User.h"
+
+using namespace std;
+
+/**
+ * @class SessionManager
+ * @brief Sharded, thread-safe table of active sessions.
+ *
+ * Tokens are spread over a fixed number of shards by hash, and every shard
+ * has its own lock, so lookups for different sessions rarely contend.
+ * A session expires once it has been idle for longer than the idle timeout;
+ * expired sessions are rejected on lookup and removed by purgeExpired().
+ */
+class SessionManager {
+public:
+    using Clock = chrono::steady_clock;
+
+    /**
+     * @brief Constructor.
+     * @param shardCount Number of independently locked shards
+     * @param idleTimeout Idle time after which a session expires
+     */
+    explicit SessionManager(size_t shardCount = 16,
+                            Clock::duration idleTimeout = chrono::minutes(30));
+
+    /**
+     * @brief Opens a new session for a user.
+     * @return The new session token.
+     */
+    string createSession(const shared_ptr<User>& user);
+
+    /**
+     * @brief Resolves a token and refreshes its idle timer.
+     * @return The session's user, or nullptr if unknown or expired.
+     */
+    shared_ptr<User> getUser(const string& token);
+
+    /**
+     * @brief Closes a session.
+     * @return true if the session existed.
+     */
+    bool closeSession(const string& token);
+
+    /**
+     * @brief Removes every session that has been idle too long.
+     * @return Number of sessions removed.
+     */
+    size_t purgeExpired();
+
+    /**
+     * @brief Number of sessions currently in the table (including expired
+     * sessions that have not been purged yet).
+     */
+    size_t size() const;
+
+    /**
+     * @brief Bytes used by the session table (users themselves not included).
+     */
+    size_t getMemoryBytes() const;
+
+    void setIdleTimeout(Clock::duration timeout) { idleTimeout = timeout.count(); }
+    Clock::duration getIdleTimeout() const { return Clock::duration(idleTimeout.load()); }
+
+private:
+    struct Session {
+        shared_ptr<User> user;
+        Clock::time_point lastActive;
+    };
+
+    struct Shard {
+        mutable mutex mtx;
+        unordered_map<string, Session> sessions;
+    };
+
+    vector<unique_ptr<Shard>> shards;
+    atomic<Clock::rep> idleTimeout; ///< Idle timeout in clock ticks
+
+    Shard& shardFor(const string& token) const;
+    static string generateToken();
+};
+
+#endif // SESSIONMANAGER_H
@@ -0,0 +1,73 @@
+/**
+ * @file StationIndex.h
+ * @brief Definition of the station-to-trains search index.
+ */
+
+#ifndef STATIONINDEX_H
+#define STATIONINDEX_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include "Train.h"
+
+using namespace std;
+
+/**
+ * @class StationIndex
+ * @brief For every station, the trains that stop there.
+ *
+ * Each entry keeps what a search needs to rule a train out without
+ * touching it: the stop's position on the route, the days after the
+ * service date on which the train leaves it, and the train's calendar.
+ * A search merges the entries of its two stations (both kept in train ID
+ * order) and keeps the trains that call at them in the right order and
+ * run on the service that departs the first one on the travel date.
+ *
+ * Not synchronized: an index is built by one writer and then only read,
+ * as part of a published Timetable. Copies share each station's entries;
+ * add and remove copy only the stations they touch.
+ */
+class StationIndex {
+public:
+    /**
+     * @brief Indexes a train's route, replacing what was indexed for its ID before.
+     */
+    void add(const Train& train);
+
+    /**
+     * @brief Drops a train from the index.
+     */
+    void remove(const string& trainId);
+
+    /**
+     * @brief IDs of the trains that may serve a journey, in ID order.
+     * @param travelDay Calendar::dayNumber of the travel date at startStation
+     */
+    vector<string> candidates(const string& startStation, const string& endStation, int travelDay) const;
+
+    /**
+     * @brief Bytes used by the index (nodes, keys and entries).
+     */
+    size_t getMemoryBytes() const;
+
+private:
+    struct Entry {
+        int stopIndex;   ///< First position of the station on the route
+        int dayOffset;   ///< Train::getDayOffset of that stop
+        shared_ptr<const ServiceCalendar> calendar; ///< Null for a daily service
+    };
+
+    using Entries = map<string, Entry>;
+
+    map<string, shared_ptr<Entries>> stations;   ///< Station -> train ID -> entry (shared between copies)
+    map<string, vector<string>> trainStations;   ///< Train ID -> stations indexed for it
+
+    /**
+     * @brief A station's entries, owned by this copy alone.
+     */
+    Entries& entriesFor(const string& station);
+};
+
+#endif // STATIONINDEX_H
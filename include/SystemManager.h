@@ -12,15 +12,287 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <shared_mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include "User.h"
 #include "Train.h"
 #include "Order.h"
+#include "Booking.h"
+#include "SessionManager.h"
+#include "OrderIndex.h"
+#include "TrainOrderIndex.h"
+#include "Timetable.h"
+#include "TrainShards.h"
+#include "AdmissionController.h"
+#include "CallTrace.h"
+#include "Clock.h"
+#include "Metrics.h"
+#include "MemoryUsage.h"
+#include "ChangeFeed.h"
+#include "Replication.h"
 
+/// Trains scanned per read-lock hold by streamed searches (direct mode)
+const size_t SEARCH_CHUNK_TRAINS = 256;
+
+/// Receives one batch of a streamed search; may move the trains out
+using SearchBatchSink = function<void(vector<Train>& batch)>;
+
+/// Orders refunded per batch of a train cancellation
+const size_t CANCELLATION_BATCH_ORDERS = 4096;
+
+/// Receives the progress of a train cancellation after each batch (one call at a time)
+using CancellationProgress = function<void(const TrainCancellation& progress)>;
+
+/**
+ * @class SystemManager
+ * @brief Central controller; safe to call from many threads.
+ *
+ * Trains are served in one of two execution modes:
+ * - Direct (default): trains live in one map behind a reader/writer lock.
+ *   Searches share the lock, and bookings and refunds take it exclusively,
+ *   so all booking traffic is serialized.
+ * - Sharded (setShardCount(n) with n > 0): trains are partitioned by ID hash
+ *   across n single-threaded shards (see TrainShardPool). Bookings on trains
+ *   in different shards run in parallel, with no lock shared between them.
+ * Users, sessions and the order index have their own concurrent structures
+ * in both modes.
+ *
+ * In both modes the schedule (train set, routes, calendars and station
+ * index) is also published as immutable Timetable versions. Searches pick
+ * their candidates from the current version without taking any lock;
+ * addTrain and deleteTrain build the next version off to the side and swap
+ * it in, and old versions are reclaimed once no reader is pinned to them.
+ * Only the final seat check of a search goes to the trains' owner.
+ */
 class SystemManager {
 private:
     map<string, shared_ptr<User>> users; ///< Map of username to User object
-    map<string, Train> trains;           ///< Map of trainId to Train object
-    shared_ptr<User> currentUser;        ///< Pointer to the currently logged-in user
+    mutable shared_mutex usersMutex;     ///< Guards users (many logins, few registrations)
+    InventoryEventHub inventoryEvents;   ///< Listener installed on every train; outlives them
+    ChangeFeed changeFeed{inventoryEvents}; ///< Change-feed subscriptions
+    map<string, Train> trains;           ///< Map of trainId to Train object (direct mode)
+    mutable shared_mutex trainsMutex;    ///< Guards trains (direct mode)
+    unique_ptr<TrainShardPool> shardPool; ///< Owns the trains in sharded mode
+    SessionManager sessions;             ///< Session token to logged-in user
+    OrderIndex orderIndex;               ///< Order ID to owner and history position
+    TrainOrderIndex trainOrders;         ///< Train ID to the orders booked on it
+    mutable EpochDomain epochs;          ///< Reclaims timetable versions no reader still sees
+    RcuPointer<Timetable> timetable{epochs, make_unique<const Timetable>()}; ///< Current schedule version (both modes)
+    mutex timetableMutex;                ///< Serializes timetable writers
+    RouteTable routeTable;               ///< Interned routes, shared by trains with the same pattern
+    unique_ptr<AdmissionController> admission; ///< Flash-sale admission control (optional)
+    Metrics metrics;                     ///< Latency histograms and outcome counters
+    TraceRecorder* recorder = nullptr;   ///< Receives a record per public call (optional, not owned)
+    shared_ptr<const Clock> clock;       ///< Source of order timestamps
+    shared_ptr<const PricingPolicy> pricing; ///< Fare policy installed on every train (null for static fares)
+    atomic<unsigned> orderSequence{0};   ///< Per-instance order ID counter
+    atomic<ReplicationLog*> replicationLog{nullptr}; ///< Receives every durable change (optional, not owned)
+
+    /**
+     * @brief Runs fn(Train*) with exclusive access to one train.
+     * Direct mode takes the write lock; sharded mode runs fn on the train's
+     * shard. fn receives nullptr if the train does not exist.
+     */
+    template <class F>
+    auto withTrain(const string& trainId, F fn) -> decltype(fn(static_cast<Train*>(nullptr))) {
+        if (shardPool) {
+            return shardPool->call(shardPool->shardOf(trainId), [&trainId, &fn](TrainShardPool::TrainMap& shard) {
+                auto it = shard.find(trainId);
+                return fn(it == shard.end() ? nullptr : &it->second);
+            });
+        }
+        unique_lock<shared_mutex> lock(trainsMutex);
+        auto it = trains.find(trainId);
+        return fn(it == trains.end() ? nullptr : &it->second);
+    }
+
+    /**
+     * @brief Builds the next timetable version with change(next) applied
+     * and publishes it.
+     */
+    template <class F>
+    void updateTimetable(F change) {
+        lock_guard<mutex> lock(timetableMutex);
+        unique_ptr<Timetable> next = timetable.load()->next();
+        change(*next);
+        timetable.publish(move(next));
+    }
+
+    /**
+     * @brief Installs the shared route, listener and fare policy on a train about to be stored.
+     */
+    void prepareTrain(Train& train);
+
+    /**
+     * @brief Stores a prepared train with the owner of the current execution mode.
+     */
+    void storeTrain(Train&& train);
+
+    /**
+     * @brief Removes a train and publishes the timetable without it.
+     */
+    bool eraseTrain(const string& trainId);
+
+    /**
+     * @brief Stops a train running on service days firstDay to lastDay and
+     * drops their inventory; publishes the changed calendar.
+     * @param droppedDates Receives the number of dates whose inventory was dropped
+     * @return false if there is no such train.
+     */
+    bool closeService(const string& trainId, int firstDay, int lastDay, size_t& droppedDates);
+
+    /**
+     * @brief Cancels the PAID orders indexed for a train's service days
+     * firstDay to lastDay, with the rest of their journeys, in parallel
+     * batches. Seats are returned for legs outside those runs.
+     * @param result Receives the counts; also passed to progress after each batch
+     */
+    void refundTrainOrders(const string& trainId, int firstDay, int lastDay, TrainCancellation& result,
+                           const CancellationProgress& progress);
+
+    /**
+     * @brief Search candidates from the current timetable, read without locks.
+     */
+    vector<string> searchCandidates(const string& startStation, const string& endStation, const string& date,
+                                    const TimeWindow& window) const;
+
+    /**
+     * @brief Reserves seats on one leg.
+     * @param price Receives the total price of the leg, quoted before the seats are taken
+     * @param departureMinutes Receives the departure time at the boarding station
+     */
+    BookingStatus reserveSeats(const TripLeg& leg, int count, Money& price, int& departureMinutes);
+
+    /**
+     * @brief Passes a booking through admission control, if enabled: waits
+     * for a token, or with waitForToken off asks once without waiting.
+     * Unknown trains are turned away first, so that they never get an
+     * admission entry; callers have already checked the date.
+     * @return BOOKED if admitted, otherwise why not (UNKNOWN_TRAIN, SOLD_OUT,
+     * REJECTED_BUSY or RETRY_LATER).
+     */
+    BookingStatus admitBooking(const string& trainId, const string& date, const string& username);
+
+    /**
+     * @brief Admits every leg of a multi-leg booking in order; if one is
+     * refused, the tokens of the legs before it are given back.
+     * @return BOOKED if all were admitted, otherwise the refused leg's status.
+     */
+    BookingStatus admitLegs(const vector<TripLeg>& legs, const string& username);
+
+    /**
+     * @brief Records a finished single-leg booking: latency and outcome
+     * metrics, and the BOOK trace record. Shared by placeBooking and
+     * BookingPipeline so both report the same way.
+     * @param started When the caller asked to book
+     */
+    void reportBooking(const string& session, const TripLeg& leg, int count, chrono::steady_clock::time_point started,
+                       const BookingResult& result);
+
+    /**
+     * @brief Reserves seats on one leg of a train the caller already holds.
+     * @param today Day number used for the days-to-departure fare multiplier
+     */
+    BookingStatus reserveLeg(Train* train, const TripLeg& leg, int count, int today, Money& price, int& departureMinutes);
+
+    /**
+     * @brief Returns seats on one leg of a train the caller already holds.
+     */
+    void releaseLeg(Train* train, const TripLeg& leg, int count);
+
+    /**
+     * @brief Reserves every leg or none; see bookJourney for the protocol.
+     * @param prices Receives the price of each leg, in the order given
+     * @param departureTimes Receives the departure time of each leg, in the order given
+     */
+    BookingStatus reserveAll(const vector<TripLeg>& legs, int count, vector<Money>& prices, vector<int>& departureTimes);
+
+    /**
+     * @brief Reserves a batch of seat requests.
+     * Requests are grouped by train and date, and each group is applied in
+     * one pass over its inventory: direct mode takes the write lock once for
+     * the whole batch, sharded mode sends one message per shard. Requests for
+     * the same train and date are served in the order given.
+     */
+    void reserveSeatsBatch(vector<SeatRequest*>& requests);
+
+    /**
+     * @brief Applies the requests of one train (already grouped by date).
+     */
+    void reserveOnTrain(Train* train, SeatRequest** begin, SeatRequest** end);
+
+    /**
+     * @brief Sets the admission sold-out flag once a service has no seat left.
+     */
+    void markIfSoldOut(const Train& train, const string& serviceDate);
+
+    /**
+     * @brief Returns seats reserved by reserveSeats or by a cancelled order.
+     */
+    void releaseSeats(const TripLeg& leg, int count);
+
+    /**
+     * @brief Creates the order for reserved seats and indexes it.
+     * @return The order ID, or empty if the user keeps no order history.
+     */
+    string recordOrder(const shared_ptr<User>& user, const TripLeg& leg, int departureMinutes, Money price, int count);
+
+    /**
+     * @brief Creates the linked orders of a journey whose legs are all reserved.
+     * @param orderIds Receives one order ID per leg, in travel order
+     */
+    void recordJourney(const shared_ptr<User>& user, const vector<TripLeg>& legs, const vector<int>& departureTimes,
+                       const vector<Money>& prices, int count, vector<string>& orderIds);
+
+    /**
+     * @brief Whether a train serves a search: it departs startStation on
+     * date inside the window, with a seat in some class to endStation.
+     * Does not check the calendar; searches only test trains the station
+     * index found running.
+     */
+    bool matchesSearch(const Train& train, const string& startStation, const string& endStation, const string& date,
+                       const TimeWindow& window) const;
+
+    /**
+     * @brief Search candidates from the station index, grouped by owning shard (sharded mode).
+     */
+    vector<vector<string>> splitByShard(const vector<string>& trainIds) const;
+
+    friend class BookingPipeline;
+    friend class Replica;
+
+    // Application of records from a primary's mutation log (see Replica)
+
+    /**
+     * @brief Reserves the seats of orders the primary booked and adds the
+     * orders to their owner's history, a journey's legs next to each other.
+     * @param sequence The primary's order sequence after the booking
+     * @return false if the owner, a train or the seats are missing.
+     */
+    bool applyOrders(vector<Order>&& orders, unsigned sequence);
+
+    /**
+     * @brief Cancels one PAID order the primary refunded and returns its seats.
+     */
+    bool applyCancel(const string& username, const string& orderId);
+
+    // Uninstrumented implementations of the public calls
+    bool doRegisterUser(const string& username, const string& password, const string& name, const string& id);
+    string doLogin(const string& username, const string& password);
+    vector<Train> doSearchTrains(const string& startStation, const string& endStation, const string& date, const TimeWindow& window);
+    BookingResult doPlaceBooking(const string& session, const string& trainId, const string& start, const string& end, const string& date, int count,
+                                 SeatClass seatClass);
+    BookingStatus doBookTransfer(const string& session, const TripLeg& first, const TripLeg& second, int count, vector<string>& orderIds);
+    BookingStatus doBookJourney(const string& session, const vector<TripLeg>& legs, int count, vector<string>& orderIds);
+    bool doRefundTicket(const string& session, const string& orderId);
+
+    /**
+     * @brief Resolves a session to a Passenger.
+     * @return nullptr if the session is invalid or does not belong to a passenger.
+     */
+    Passenger* getSessionPassenger(const string& session, shared_ptr<User>& holder);
 
     // Helper functions for persistence (placeholders)
     void loadData();
@@ -39,62 +311,299 @@ public:
     bool registerUser(const string& username, const string& password, const string& name, const string& id);
     
     /**
-     * @brief Authenticates a user.
-     * @return Pointer to User if successful, nullptr otherwise.
+     * @brief Authenticates a user and opens a session.
+     * @return Session token if successful, empty string otherwise.
      */
-    shared_ptr<User> login(const string& username, const string& password);
+    string login(const string& username, const string& password);
     
     /**
-     * @brief Logs out the current user.
+     * @brief Closes a session.
      */
-    void logout();
+    void logout(const string& session);
     
     /**
-     * @brief Gets the current logged-in user.
+     * @brief Gets the user behind a session.
+     * @return nullptr if the session is unknown or has expired.
+     */
+    shared_ptr<User> getSessionUser(const string& session);
+
+    /**
+     * @brief Access to the session table (expiry settings, purging).
      */
-    shared_ptr<User> getCurrentUser() const { return currentUser; }
+    SessionManager& getSessions() { return sessions; }
 
     // Train Management (Admin)
     
     /**
-     * @brief Adds a new train to the system.
+     * @brief Adds a new train to the system, or replaces the one with its ID.
+     * The train is indexed by station, with its service calendar, and its
+     * route is shared with every stored train that has the same pattern.
+     * Publishes a new timetable version.
      */
     void addTrain(const Train& train);
+    void addTrain(Train&& train);
+
+    /**
+     * @brief Adds many trains, publishing one timetable version for all of
+     * them (each version copies the train table, so bulk loads use this).
+     */
+    void addTrains(vector<Train>&& batch);
+
+    /**
+     * @brief Constructs a train from Train constructor arguments and adds
+     * it without copying, e.g. emplaceTrain(id, type, seats, route, departure).
+     */
+    template <class... Args>
+    void emplaceTrain(Args&&... args) {
+        addTrain(Train(forward<Args>(args)...));
+    }
     
     /**
-     * @brief Removes a train from the system.
+     * @brief Removes a train from the system; publishes a new timetable
+     * version. Orders still PAID on the train are refunded as by cancelTrain.
      */
     bool deleteTrain(const string& trainId);
+
+    /**
+     * @brief Cancels a train's service dates firstDate to lastDate (empty
+     * for an open end; both empty cancels every date) and refunds their
+     * orders. The train stops running on those dates and their inventory
+     * is dropped, then the PAID orders found through the train's order
+     * index are cancelled in parallel batches of CANCELLATION_BATCH_ORDERS,
+     * together with the other legs of their journeys, whose seats are
+     * returned. Orders recorded while the cancellation runs are picked up
+     * by a second pass.
+     * @param progress Called after each batch (optional)
+     * @return found is false if there is no such train or the range is empty.
+     */
+    TrainCancellation cancelTrain(const string& trainId, const string& firstDate = "", const string& lastDate = "",
+                                  const CancellationProgress& progress = nullptr);
     
     /**
      * @brief Retrieves a train by ID.
+     * Direct mode only, and not synchronized: returns nullptr in sharded mode.
+     * Route and calendar changes made through the pointer are not seen by
+     * searches; pass the changed train to addTrain instead.
      */
     Train* getTrain(const string& trainId);
     
     /**
      * @brief Searches for trains between two stations on a given date.
-     * @return Vector of trains that have availability.
+     * @param date Travel date at startStation; an overnight train matches
+     * through the service that reaches startStation on that date
+     * (Train::getServiceDate). Trains whose calendar has no such service
+     * are pruned by the station index before their inventory is looked at.
+     * Candidates come from one timetable version, read without locks; only
+     * their seats are checked with the trains' owner.
+     * @param window Departure time of day at startStation
+     * @return Vector of trains that have availability, ordered by train ID.
+     */
+    vector<Train> searchTrains(const string& startStation, const string& endStation, const string& date,
+                               const TimeWindow& window = TimeWindow());
+
+    /**
+     * @brief Searches like searchTrains(), delivering results in batches as they are found.
+     *
+     * Direct mode scans SEARCH_CHUNK_TRAINS trains per read-lock hold and
+     * calls the sink with the lock released, so bookings (including ones
+     * made from the sink) interleave with a long scan; batches arrive in
+     * train ID order. Sharded mode delivers one batch per shard. The sink
+     * always runs on the calling thread. Setting *cancel stops the scan at
+     * the next chunk boundary.
+     * @param cancel Optional cancellation flag, polled between chunks
+     * @return False if the search was cancelled before completing.
      */
-    vector<Train> searchTrains(const string& startStation, const string& endStation, const string& date);
+    bool searchTrainsStreaming(const string& startStation, const string& endStation, const string& date,
+                               const SearchBatchSink& sink, const atomic<bool>* cancel = nullptr,
+                               const TimeWindow& window = TimeWindow());
     
     /**
-     * @brief Returns all trains (for admin view).
+     * @brief The current timetable version, pinned until the snapshot is
+     * destroyed. Reading it takes no lock and never waits for writers.
      */
-    const map<string, Train>& getAllTrains() const { return trains; }
+    TimetableSnapshot getTimetable() const {
+        EpochDomain::Guard guard = epochs.pin();
+        // Loaded only once pinned
+        return TimetableSnapshot(move(guard), timetable.load());
+    }
+
+    /**
+     * @brief Returns a copy of all trains (for admin view).
+     */
+    map<string, Train> getAllTrains() const;
+
+    // Execution Mode
+
+    /**
+     * @brief Switches between direct (0) and sharded (n > 0) execution.
+     * Trains and their inventory move to the new owner. Must not be called
+     * while other threads are using the SystemManager.
+     */
+    void setShardCount(size_t shardCount);
+
+    /**
+     * @brief Number of train shards (0 in direct mode).
+     */
+    size_t getShardCount() const { return shardPool ? shardPool->getShardCount() : 0; }
+
+    /**
+     * @brief Turns on admission control for bookings and the sold-out
+     * shortcut for searches. Callers that must not block (an event loop)
+     * turn off config.waitForToken and get RETRY_LATER instead of waiting.
+     * Must not be called while other threads are using the SystemManager.
+     */
+    void enableAdmissionControl(const AdmissionConfig& config = AdmissionConfig());
+
+    /**
+     * @brief The admission controller (counters), or nullptr if disabled.
+     */
+    const AdmissionController* getAdmissionController() const { return admission.get(); }
+
+    // Observability
+
+    /**
+     * @brief Latency and outcome totals of search, book, refund, login and
+     * register calls so far. Safe to call while other threads are working.
+     */
+    MetricsSnapshot getMetricsSnapshot() const { return metrics.snapshot(); }
+
+    /**
+     * @brief Bytes used by routes, inventory, users, orders, indexes and
+     * sessions, with a per-train breakdown. Walks every structure, so it
+     * costs about as much as a full search; safe to call concurrently.
+     */
+    MemoryReport getMemoryReport() const;
+
+    /**
+     * @brief Records every register, login, logout, search, book, transfer,
+     * journey and refund call into recorder (nullptr stops recording). The
+     * recorder must outlive its use. Must not be called while other threads are using the SystemManager.
+     */
+    void setTraceRecorder(TraceRecorder* traceRecorder) { recorder = traceRecorder; }
+
+    /**
+     * @brief Appends every registration, order, refund and train change to
+     * log (nullptr stops logging), for replicas to follow (see Replication.h).
+     * The log must outlive its use.
+     */
+    void setReplicationLog(ReplicationLog* log) { replicationLog = log; }
+    ReplicationLog* getReplicationLog() const { return replicationLog; }
+
+    /**
+     * @brief Replaces the clock that stamps new orders (creation time and ID).
+     * Must not be called while other threads are using the SystemManager.
+     */
+    void setClock(shared_ptr<const Clock> newClock) { clock = move(newClock); }
+    shared_ptr<const Clock> getClock() const { return clock; }
+
+    // Pricing
+
+    /**
+     * @brief Switches every train, and trains added later, to dynamic fares
+     * under policy (nullptr restores static fares). Bookings are charged the
+     * fare quoted just before their seats are taken. Must not be called
+     * while other threads are using the SystemManager.
+     */
+    void setPricingPolicy(shared_ptr<const PricingPolicy> policy);
+    shared_ptr<const PricingPolicy> getPricingPolicy() const { return pricing; }
+
+    /**
+     * @brief Calendar day of the clock, the "today" passed to Train::quote().
+     */
+    int getCurrentDay() const { return Calendar::dayNumber(clock->now()); }
+
+    // Inventory Events
+
+    /**
+     * @brief Delivers every seat inventory change to listener (see InventoryEvents.h).
+     * The listener runs on booking threads and must be fast and thread-safe.
+     */
+    void addInventoryListener(InventoryListener* listener) { inventoryEvents.addListener(listener); }
+
+    /**
+     * @brief Stops delivery; no event is in flight to listener once this returns.
+     */
+    bool removeInventoryListener(InventoryListener* listener) { return inventoryEvents.removeListener(listener); }
+
+    /**
+     * @brief Free seats of every train on a date, ordered by train ID.
+     * Each entry carries the train's inventory version, so a listener
+     * registered before the call can skip events already included.
+     */
+    vector<TrainOccupancy> getOccupancy(const string& date) const;
+
+    /**
+     * @brief Subscribes to seat changes matching filter (see ChangeFeed.h).
+     * Events are queued without blocking bookings; drain them with
+     * FeedSubscription::poll(). Changes that do not fit in the queue are
+     * dropped and counted.
+     * @param capacity Queue size, rounded up to a power of two
+     */
+    shared_ptr<FeedSubscription> subscribeChanges(FeedFilter filter = FeedFilter(), size_t capacity = FEED_DEFAULT_CAPACITY) {
+        return changeFeed.subscribe(move(filter), capacity);
+    }
+
+    /**
+     * @brief Ends a subscription; events already queued can still be polled.
+     */
+    bool unsubscribeChanges(const shared_ptr<FeedSubscription>& subscription) { return changeFeed.unsubscribe(subscription); }
 
     // Order Management
     
     /**
-     * @brief Books a ticket for the current user.
+     * @brief Books a ticket for the user of a session.
      * @return true if successful.
      */
-    bool bookTicket(const string& trainId, const string& start, const string& end, const string& date, int count = 1);
-    
+    bool bookTicket(const string& session, const string& trainId, const string& start, const string& end, const string& date, int count = 1,
+                    SeatClass seatClass = SECOND_CLASS);
+
     /**
-     * @brief Refunds a ticket for the current user.
+     * @brief Books a ticket and reports why a booking failed.
+     */
+    BookingResult placeBooking(const string& session, const string& trainId, const string& start, const string& end, const string& date, int count = 1,
+                               SeatClass seatClass = SECOND_CLASS);
+
+    /**
+     * @brief Books both legs of a transfer, or neither.
+     *
+     * Seats are reserved as by bookJourney; if a leg fails, no order is
+     * created. Unlike a journey, the two orders are not linked and are
+     * refunded separately.
+     * @param orderIds Receives one order ID per leg on success
+     */
+    BookingStatus bookTransfer(const string& session, const TripLeg& first, const TripLeg& second, int count, vector<string>& orderIds);
+
+    /**
+     * @brief Books a journey of any number of legs as one transaction.
+     *
+     * Either every leg is reserved or none is. Direct mode reserves all legs
+     * under one hold of the write lock, so no other call sees a partial
+     * journey. Sharded mode visits the legs in ascending (shard, train ID)
+     * order, reserving all legs of a shard in one atomic message; if a shard
+     * fails, its own legs are rolled back in the same message and the
+     * shards already visited are compensated. The fixed order means two
+     * journeys over the same trains always contend in the same sequence.
+     *
+     * The orders of a journey of two or more legs are linked: they share a
+     * journey ID (the first leg's order ID), and refunding any of them with
+     * refundTicket refunds the whole journey.
+     * @param legs Legs in travel order
+     * @param orderIds Receives one order ID per leg, in travel order, on success
+     */
+    BookingStatus bookJourney(const string& session, const vector<TripLeg>& legs, int count, vector<string>& orderIds);
+
+    /**
+     * @brief Refunds a ticket for the user of a session.
+     * Refunding any order of a linked journey refunds every order of it.
      * @return true if successful.
      */
-    bool refundTicket(const string& orderId);
+    bool refundTicket(const string& session, const string& orderId);
+
+    /**
+     * @brief Lists the orders of the user of a session.
+     * @return Copy of the order history (empty for admins or invalid sessions).
+     */
+    vector<Order> getOrders(const string& session);
 
     /**
      * @brief Initializes test data for demonstration.
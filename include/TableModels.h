@@ -0,0 +1,165 @@
+/**
+ * @file TableModels.h
+ * @brief Qt table models for the passenger's search results and order history.
+ *
+ * Both models keep one flat row struct per entry and hand rows to the view
+ * in batches through canFetchMore()/fetchMore(), so long lists cost only
+ * the rows that have been scrolled into view. The last column is an action
+ * column painted by ActionDelegate: its display text is the button label,
+ * or empty when the row has no action.
+ */
+
+#ifndef TABLEMODELS_H
+#define TABLEMODELS_H
+
+#include <QAbstractTableModel>
+#include <vector>
+#include <string>
+#include <array>
+#include "Train.h"
+#include "Order.h"
+
+using namespace std;
+
+/// Rows handed to the view per fetchMore() call
+const int TABLE_FETCH_BATCH = 256;
+
+/**
+ * @class TrainResultModel
+ * @brief Search results for one station pair and date.
+ */
+class TrainResultModel : public QAbstractTableModel {
+    Q_OBJECT
+
+public:
+    enum Column { COL_ID, COL_TYPE, COL_DEPARTURE, COL_ARRIVAL, COL_SEATS, COL_PRICE, COL_ACTION, COLUMN_COUNT };
+
+    /**
+     * @brief One search result, with the times of the searched segment and
+     * the free seats and quoted fare of every class.
+     */
+    struct Row {
+        QString trainId;
+        QString type;
+        QString departure;
+        QString arrival;
+        array<int, SEAT_CLASS_COUNT> freeSeats;  ///< -1 for classes the train does not sell
+        array<Money, SEAT_CLASS_COUNT> prices;
+    };
+
+    explicit TrainResultModel(QObject *parent = nullptr);
+
+    /**
+     * @brief Replaces the results with a new search.
+     * @param today Calendar day the fares are quoted on (SystemManager::getCurrentDay())
+     */
+    void setResults(vector<Train>& trains, const string& start, const string& end, const string& date, int today);
+
+    /**
+     * @brief Empties the model for a search whose results will be streamed in.
+     */
+    void beginSearch(const string& start, const string& end, const string& date);
+
+    /**
+     * @brief Appends a batch of the current search.
+     */
+    void appendRows(vector<Row>&& batch);
+
+    /**
+     * @brief Converts trains to rows for the given segment, quoting each fare.
+     * Safe to call off the GUI thread.
+     */
+    static vector<Row> makeRows(vector<Train>& trains, const string& start, const string& end, const string& date,
+                                int today);
+
+    const Row& rowAt(int row) const { return rows[row]; }
+    const string& getStart() const { return start; }
+    const string& getEnd() const { return end; }
+    const string& getDate() const { return date; }
+
+    /**
+     * @brief Shows the seats and fares of another class; rows are not rebuilt.
+     */
+    void setSeatClass(SeatClass shown);
+    SeatClass getSeatClass() const { return seatClass; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+private:
+    vector<Row> rows;   ///< All results
+    int loaded = 0;     ///< Rows exposed to the view so far
+    string start;
+    string end;
+    string date;
+    SeatClass seatClass = SECOND_CLASS; ///< Class shown in the seats and price columns
+};
+
+/**
+ * @class OrderHistoryModel
+ * @brief The logged-in passenger's orders, oldest first.
+ */
+class OrderHistoryModel : public QAbstractTableModel {
+    Q_OBJECT
+
+public:
+    enum Column { COL_ID, COL_TRAIN, COL_ROUTE, COL_DATE, COL_SEATS, COL_STATUS, COL_ACTION, COLUMN_COUNT };
+
+    /**
+     * @brief One order as shown in the table.
+     */
+    struct Row {
+        string orderId;
+        QString trainId;
+        QString route;
+        QString date;
+        int seats;
+        SeatClass seatClass;
+        OrderStatus status;
+    };
+
+    explicit OrderHistoryModel(QObject *parent = nullptr);
+
+    /**
+     * @brief Brings the model in line with a fresh copy of the history.
+     *
+     * Order histories only grow, so when the known rows are a prefix of
+     * the new list only the rows whose status changed are signalled and
+     * the new orders are appended. Any other difference (e.g. another
+     * user logged in) resets the model.
+     */
+    void syncOrders(const vector<Order>& orders);
+
+    /**
+     * @brief Updates one order's status in place.
+     * @return False if the order is not in the model.
+     */
+    bool setOrderStatus(const string& orderId, OrderStatus status);
+
+    /**
+     * @brief Removes all rows (on logout).
+     */
+    void clear();
+
+    const Row& rowAt(int row) const { return rows[row]; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+private:
+    vector<Row> rows;   ///< All orders
+    int loaded = 0;     ///< Rows exposed to the view so far
+
+    static Row makeRow(const Order& order);
+    void emitRowChanged(int row);
+};
+
+#endif // TABLEMODELS_H
@@ -0,0 +1,93 @@
+/**
+ * @file TicketClient.h
+ * @brief Client library for the headless ticketing server.
+ *
+ * TicketClient speaks the line protocol from TicketProtocol.h and does not
+ * depend on SystemManager, so load generators and other processes can link
+ * it on its own.
+ */
+
+#ifndef TICKETCLIENT_H
+#define TICKETCLIENT_H
+
+#include <string>
+#include <vector>
+#include "TicketProtocol.h"
+
+using namespace std;
+
+/**
+ * @class TicketClient
+ * @brief Blocking connection to a TicketServer.
+ *
+ * The typed calls (login, search, book, ...) send one request and wait for
+ * its response. For pipelining, queue several requests with send(), push
+ * them out with flush(), then collect the responses in order with receive().
+ */
+class TicketClient {
+public:
+    TicketClient() = default;
+    ~TicketClient();
+
+    TicketClient(const TicketClient&) = delete;
+    TicketClient& operator=(const TicketClient&) = delete;
+
+    /**
+     * @brief Connects to the server's Unix socket.
+     * @return false on failure; getLastError() explains why.
+     */
+    bool connect(const string& socketPath);
+    void close();
+    bool isConnected() const { return fd != -1; }
+
+    // Typed requests
+
+    /**
+     * @brief Logs in.
+     * @return Session token, or empty string on failure.
+     */
+    string login(const string& username, const string& password);
+    bool logout(const string& session);
+    bool registerUser(const string& username, const string& password, const string& name, const string& id);
+    bool search(const string& from, const string& to, const string& date, vector<TrainSummary>& result);
+    /**
+     * @brief Books tickets.
+     * @param orderId Receives the new order's ID if not null
+     */
+    bool book(const string& session, const string& trainId, const string& from, const string& to, const string& date, int count = 1, string* orderId = nullptr);
+    bool refund(const string& session, const string& orderId);
+    bool listOrders(const string& session, vector<OrderSummary>& result);
+
+    // Pipelining
+
+    /**
+     * @brief Queues a request without sending it.
+     */
+    void send(const vector<string>& request);
+
+    /**
+     * @brief Writes all queued requests to the socket.
+     */
+    bool flush();
+
+    /**
+     * @brief Waits for the next response.
+     * @return false if the connection failed.
+     */
+    bool receive(vector<string>& response);
+
+    /**
+     * @brief Error text of the last failed call (server reason or socket error).
+     */
+    const string& getLastError() const { return lastError; }
+
+private:
+    int fd = -1;
+    string readBuffer;
+    string writeBuffer;
+    string lastError;
+
+    bool call(const vector<string>& request, vector<string>& response);
+};
+
+#endif // TICKETCLIENT_H
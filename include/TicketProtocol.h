@@ -0,0 +1,140 @@
+/**
+ * @file TicketProtocol.h
+ * @brief Line protocol shared by TicketServer and TicketClient.
+ *
+ * Every request and every response is a single line of tab-separated fields
+ * terminated by '\n'. The first field of a request is the command name; the
+ * first field of a response is "OK" or "ERR". List responses carry a record
+ * count followed by that many fixed-width records, flattened into the same line.
+ * An ERR response carries a human-readable reason as its second field.
+ *
+ *   LOGIN    <user> <password>                            -> OK <token>
+ *   LOGOUT   <token>                                      -> OK
+ *   REGISTER <user> <password> <name> <idCard>            -> OK
+ *   SEARCH   <from> <to> <date> [<earliest> <latest>]      -> OK <n> {trainId type dep arr price}*n
+ *   BOOK     <token> <trainId> <from> <to> <date> <count> [class] -> OK <orderId>
+ *   REFUND   <token> <orderId>                            -> OK
+ *   ORDERS   <token>                                      -> OK <n> {orderId trainId from to date count class price status}*n
+ *   CANCELTRAIN <token> <trainId> [<firstDate> <lastDate>] -> OK <jobId>
+ *   CANCELSTATUS <token> <jobId>                          -> OK <state> <affected> <processed> <refunded> <amount>
+ *   ADMISSION                                             -> OK <admitted> <queued> <soldOut> <queueFull> <timeout> <deferred>
+ *   STATS                                                 -> OK <metrics JSON>
+ *   MEMORY                                                -> OK <memory report JSON>
+ *   REPLICA                                               -> OK <role> <sequence> <pendingBytes> <lagMs> <errors>
+ *   PROMOTE  <token>                                      -> OK <sequence>
+ *   PING                                                  -> OK
+ *
+ * Dates are YYYY-MM-DD; one that does not exist ("2023-02-31") is answered
+ * with "ERR invalid date".
+ * Prices and amounts are yuan with exactly two decimals ("553.00", as
+ * written by Money::toString); clients read them back with Money::parse.
+ *
+ * SEARCH and BOOK dates are travel dates at <from>; the optional SEARCH
+ * bounds (HH:MM) filter departures from <from> by time of day. Under
+ * admission control, a BOOK that finds no token free is answered at once
+ * with "ERR queued, retry shortly"; the client should retry after a short
+ * back-off.
+ *
+ * REPLICA reports "primary" with the last sequence number logged (0 if not
+ * logging), or "replica" with the last applied and the lag behind the
+ * primary's log. A replica answers ERR to REGISTER, BOOK, REFUND and
+ * CANCELTRAIN until PROMOTE, which needs an admin's token, turns it into a
+ * primary.
+ *
+ * CANCELTRAIN and CANCELSTATUS need an admin's token. CANCELTRAIN dates are
+ * service dates (departure from the origin); without them every date is
+ * cancelled. It answers at once with a job ID; the server refunds the
+ * affected orders in the background, one cancellation at a time, and
+ * CANCELSTATUS reports the job's state (queued, running, done, or failed
+ * for an unknown train or empty range) and its progress so far.
+ *
+ * Clients may pipeline: send any number of requests without waiting, and
+ * responses come back in request order.
+ */
+
+#ifndef TICKETPROTOCOL_H
+#define TICKETPROTOCOL_H
+
+#include <string>
+#include <vector>
+#include "Money.h"
+#include "SeatClass.h"
+
+using namespace std;
+
+namespace TicketProtocol {
+
+const char FIELD_SEPARATOR = '\t';
+const char LINE_TERMINATOR = '\n';
+
+/// Number of fields per record in a SEARCH response
+const size_t TRAIN_RECORD_FIELDS = 5;
+/// Number of fields per record in an ORDERS response
+const size_t ORDER_RECORD_FIELDS = 9;
+
+/// Longest request line a server accepts before dropping the connection
+const size_t MAX_LINE_LENGTH = 64 * 1024;
+
+/**
+ * @brief Joins fields into one protocol line (including the terminator).
+ * Separator and terminator characters inside fields are replaced by spaces.
+ */
+inline string encodeLine(const vector<string>& fields) {
+    string line;
+    for (size_t i = 0; i < fields.size(); ++i) {
+        if (i > 0) line += FIELD_SEPARATOR;
+        for (char c : fields[i]) {
+            line += (c == FIELD_SEPARATOR || c == LINE_TERMINATOR || c == '\r') ? ' ' : c;
+        }
+    }
+    line += LINE_TERMINATOR;
+    return line;
+}
+
+/**
+ * @brief Splits one protocol line (without terminator) into fields.
+ */
+inline vector<string> decodeLine(const string& line) {
+    vector<string> fields;
+    size_t start = 0;
+    for (;;) {
+        size_t pos = line.find(FIELD_SEPARATOR, start);
+        if (pos == string::npos) {
+            fields.push_back(line.substr(start));
+            break;
+        }
+        fields.push_back(line.substr(start, pos - start));
+        start = pos + 1;
+    }
+    return fields;
+}
+
+} // namespace TicketProtocol
+
+/**
+ * @brief One train in a SEARCH response.
+ */
+struct TrainSummary {
+    string trainId;
+    string type;
+    string departureTime;
+    string arrivalTime;
+    Money price;
+};
+
+/**
+ * @brief One order in an ORDERS response.
+ */
+struct OrderSummary {
+    string orderId;
+    string trainId;
+    string startStation;
+    string endStation;
+    string date;
+    int ticketCount;
+    SeatClass seatClass;
+    Money price;
+    string status;
+};
+
+#endif // TICKETPROTOCOL_H
@@ -0,0 +1,132 @@
+/**
+ * @file TicketServer.h
+ * @brief Definition of the headless ticketing server.
+ *
+ * TicketServer exposes a SystemManager over a Unix domain socket using the
+ * line protocol described in TicketProtocol.h. It runs a single-threaded
+ * epoll event loop; the only work it hands off is train cancellations,
+ * which run on a worker thread so that their refunds do not stall other
+ * clients.
+ */
+
+#ifndef TICKETSERVER_H
+#define TICKETSERVER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "SystemManager.h"
+
+using namespace std;
+
+/**
+ * @class TicketServer
+ * @brief epoll-based Unix socket front-end for SystemManager.
+ *
+ * Each connection has an input and an output buffer. All complete request
+ * lines in the input buffer are executed in order and their responses are
+ * appended to the output buffer, so pipelined clients get one write per
+ * batch. When a client stops reading and its output grows past a limit,
+ * the server stops reading from it until the backlog drains.
+ */
+class TicketServer {
+public:
+    /**
+     * @brief Constructor.
+     * @param system Backend that serves the requests
+     * @param socketPath Filesystem path of the Unix socket to listen on
+     */
+    TicketServer(SystemManager& system, const string& socketPath);
+    ~TicketServer();
+
+    TicketServer(const TicketServer&) = delete;
+    TicketServer& operator=(const TicketServer&) = delete;
+
+    /**
+     * @brief Creates the listening socket and the epoll instance.
+     * @return false on failure; getLastError() explains why.
+     */
+    bool start();
+
+    /**
+     * @brief Runs the event loop until stop() is called. Returns once the
+     * cancellation that is running, if any, has finished; queued ones are
+     * dropped.
+     */
+    void run();
+
+    /**
+     * @brief Asks the event loop to exit. Safe to call from any thread.
+     */
+    void stop();
+
+    /**
+     * @brief Executes one decoded request and returns the response fields.
+     */
+    vector<string> handleRequest(const vector<string>& request);
+
+    /**
+     * @brief Serves as a replica: REGISTER, BOOK, REFUND and CANCELTRAIN are refused
+     * until the replica is promoted (by an admin's PROMOTE command or otherwise).
+     * The replica must outlive the server.
+     */
+    void setReplica(Replica* follower) { replica = follower; }
+
+    const string& getLastError() const { return lastError; }
+    size_t getConnectionCount() const { return connections.size(); }
+
+private:
+    /**
+     * @brief A CANCELTRAIN request and its progress.
+     */
+    struct CancellationJob {
+        string trainId;
+        string firstDate;
+        string lastDate;
+        string state = "queued"; ///< queued, running, done or failed (unknown train or empty range)
+        TrainCancellation progress;
+    };
+
+    struct Connection {
+        string in;          ///< Bytes received but not yet executed
+        string out;         ///< Encoded responses not yet written
+        size_t outPos = 0;  ///< Bytes of out already written
+        bool peerClosed = false; ///< Client shut down its sending side
+    };
+
+    SystemManager& system;
+    Replica* replica = nullptr; ///< Set when serving as a replica (not owned)
+    string socketPath;
+    string lastError;
+    int listenFd = -1;
+    int epollFd = -1;
+    int wakeFd = -1;     ///< eventfd used by stop() to wake the loop
+    map<int, Connection> connections;
+
+    mutex jobsMutex;                ///< Guards the members below
+    condition_variable jobsReady;
+    map<uint64_t, CancellationJob> jobs; ///< By job ID; finished ones are pruned oldest first
+    deque<uint64_t> pendingJobs;
+    uint64_t nextJobId = 1;
+    bool stopping = false;
+    thread worker;                  ///< Runs cancellations; started by the first one
+
+    void acceptConnections();
+    bool readFrom(int fd, Connection& conn);
+    bool writeTo(int fd, Connection& conn);
+    void processInput(Connection& conn);
+    void updateInterest(int fd, const Connection& conn);
+    static bool isBacklogged(const Connection& conn);
+    void closeConnection(int fd);
+    bool isAdmin(const string& token);
+    uint64_t submitCancellation(const string& trainId, const string& firstDate, const string& lastDate);
+    void runCancellations();
+    void stopWorker();
+    void setError(const string& what);
+};
+
+#endif // TICKETSERVER_H
@@ -0,0 +1,105 @@
+/**
+ * @file Timetable.h
+ * @brief Immutable versions of the train set and its search index.
+ */
+
+#ifndef TIMETABLE_H
+#define TIMETABLE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <cstdint>
+#include "Train.h"
+#include "StationIndex.h"
+#include "Rcu.h"
+
+using namespace std;
+
+/**
+ * @class Timetable
+ * @brief One version of the schedule: every train's timetable (route,
+ * times, calendar, capacity) and the station index over them.
+ *
+ * Versions are never modified once published. A writer derives the next
+ * version with next(), which shares every train and station entry list
+ * with this one, applies its changes and publishes it; readers keep
+ * whichever version they loaded for as long as they stay pinned. Seat
+ * inventory is not part of a version: it changes on every booking and
+ * stays with the trains' owner (see SystemManager).
+ */
+class Timetable {
+public:
+    Timetable() = default;
+
+    /**
+     * @brief A copy to modify and publish as the following version.
+     */
+    unique_ptr<Timetable> next() const { return unique_ptr<Timetable>(new Timetable(*this, version + 1)); }
+
+    /**
+     * @brief Adds a train's schedule, replacing the one with the same ID.
+     */
+    void put(const Train& train);
+
+    /**
+     * @return False if there was no train with the ID.
+     */
+    bool erase(const string& trainId);
+
+    /// 0 for the empty timetable; each published version counts up by one
+    uint64_t getVersion() const { return version; }
+    size_t size() const { return trains.size(); }
+
+    /**
+     * @brief The schedule of a train (without inventory), or nullptr.
+     */
+    const Train* find(const string& trainId) const;
+
+    const map<string, shared_ptr<const Train>>& getTrains() const { return trains; }
+    const StationIndex& getIndex() const { return index; }
+
+    /**
+     * @brief IDs of the trains that call at both stations in order, run on
+     * the date and leave startStation inside the window, in ID order.
+     * Seat availability is not checked.
+     */
+    vector<string> candidates(const string& startStation, const string& endStation, const string& date,
+                              const TimeWindow& window) const;
+
+    /**
+     * @brief Bytes of the train table and the timetable copies; routes
+     * are shared with the live trains and not counted.
+     */
+    size_t getMemoryBytes() const;
+
+private:
+    Timetable(const Timetable& previous, uint64_t version)
+        : version(version), trains(previous.trains), index(previous.index) {}
+
+    uint64_t version = 0;
+    map<string, shared_ptr<const Train>> trains; ///< Schedules, shared between versions
+    StationIndex index;
+};
+
+/**
+ * @class TimetableSnapshot
+ * @brief A pinned timetable version, readable without locks.
+ * Holding a snapshot delays the reclamation of older versions, so keep it
+ * for the duration of one read.
+ */
+class TimetableSnapshot {
+public:
+    TimetableSnapshot(EpochDomain::Guard guard, const Timetable* timetable)
+        : guard(move(guard)), timetable(timetable) {}
+
+    const Timetable& operator*() const { return *timetable; }
+    const Timetable* operator->() const { return timetable; }
+
+private:
+    EpochDomain::Guard guard;
+    const Timetable* timetable;
+};
+
+#endif // TIMETABLE_H
@@ -0,0 +1,87 @@
+/**
+ * @file TraceReplay.h
+ * @brief Replays recorded call traces against a SystemManager.
+ */
+
+#ifndef TRACEREPLAY_H
+#define TRACEREPLAY_H
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include "CallTrace.h"
+#include "SystemManager.h"
+
+using namespace std;
+
+/**
+ * @brief Replay options.
+ */
+struct ReplayConfig {
+    double speed = 1.0;   ///< Time compression (2 = twice as fast as recorded); 0 = as fast as possible
+    size_t threads = 4;   ///< Number of client threads
+};
+
+/**
+ * @brief Latency distribution of one operation.
+ * buckets[i] counts calls that took [2^i, 2^(i+1)) nanoseconds.
+ */
+struct LatencySummary {
+    uint64_t count = 0;
+    int64_t p50Ns = 0;
+    int64_t p90Ns = 0;
+    int64_t p99Ns = 0;
+    int64_t maxNs = 0;
+    vector<uint64_t> buckets;
+};
+
+/**
+ * @brief Outcome of a replay.
+ */
+struct ReplayReport {
+    uint64_t replayed = 0;              ///< Calls executed
+    uint64_t divergences = 0;           ///< Calls whose outcome differed from the recording
+    vector<string> divergenceSamples;   ///< Descriptions of the first few divergences
+    LatencySummary latency[TRACE_OP_LIMIT]; ///< Indexed by TraceOp
+    double elapsedSeconds = 0.0;
+
+    /**
+     * @brief Prints totals, per-operation percentiles and log2 histograms.
+     */
+    void print(ostream& os) const;
+};
+
+/**
+ * @class TraceReplayer
+ * @brief Drives a SystemManager with the calls of a trace.
+ *
+ * Records are assigned to client threads by user, so every user's calls
+ * run in their recorded order on one thread while different users run
+ * concurrently; searches are spread round-robin. Each thread waits until
+ * a record's start time (scaled by the speed factor) before issuing it.
+ *
+ * Session tokens and order IDs differ between runs, so the replayer maps
+ * the recorded ones to the ones the replay produced before using them in
+ * later calls. While running, the SystemManager's clock reports the
+ * recording's wall-clock time at the start of the call being replayed,
+ * which makes order timestamps independent of replay speed.
+ *
+ * The SystemManager should start in the state the recorded one started
+ * in (e.g. both freshly constructed); otherwise outcomes may diverge.
+ */
+class TraceReplayer {
+public:
+    explicit TraceReplayer(SystemManager& system, const ReplayConfig& config = ReplayConfig());
+
+    /**
+     * @brief Replays records (in any order; they are sorted by start time).
+     * @param recordingStart Wall-clock start of the recording (TraceReader::getStartTime())
+     */
+    ReplayReport run(const vector<TraceRecord>& records, time_t recordingStart);
+
+private:
+    SystemManager& system;
+    ReplayConfig config;
+};
+
+#endif // TRACEREPLAY_H
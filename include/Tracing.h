@@ -0,0 +1,118 @@
+/**
+ * @file Tracing.h
+ * @brief Scoped tracing spans exported in Chrome trace format.
+ *
+ * TRACE_SPAN("name") measures the enclosing scope and stores it in the
+ * calling thread's ring buffer. Spans are compiled in only when the build
+ * defines RAILWAY_TRACING (CMake option ENABLE_TRACING); otherwise the
+ * macro expands to nothing. The collected spans can be written as Chrome
+ * trace JSON and opened in chrome://tracing or ui.perfetto.dev.
+ *
+ * Span names must be string literals (only the pointer is stored).
+ */
+
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+using namespace std;
+
+#ifdef RAILWAY_TRACING
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SPAN(name) SpanScope TRACE_CONCAT(traceSpan, __LINE__)(name)
+#else
+#define TRACE_SPAN(name) ((void)0)
+#endif
+
+/// Spans kept per thread; older ones are overwritten
+const size_t SPAN_RING_CAPACITY = 1 << 16;
+
+/**
+ * @class SpanTracer
+ * @brief Process-wide collector of the per-thread span rings.
+ *
+ * Each thread writes only to its own ring (three relaxed stores and one
+ * release store per span), so recording never contends. Export may run
+ * while threads are recording; spans overwritten during the export are
+ * skipped. When a thread exits its ring goes on a free list and the next
+ * new thread takes it over, spans included, so memory is bounded by the
+ * peak number of live recording threads rather than by every thread ever
+ * started.
+ */
+class SpanTracer {
+public:
+    static SpanTracer& instance();
+
+    /**
+     * @brief Monotonic timestamp in nanoseconds.
+     */
+    static uint64_t nowNs();
+
+    /**
+     * @brief Appends a finished span to the calling thread's ring.
+     */
+    void record(const char* name, uint64_t startNs, uint64_t endNs);
+
+    /**
+     * @brief All retained spans as a Chrome trace JSON document.
+     */
+    string exportChromeJson() const;
+
+    /**
+     * @brief Writes exportChromeJson() to a file.
+     */
+    bool writeChromeJson(const string& path) const;
+
+    /**
+     * @brief Number of spans currently retained across all threads.
+     */
+    size_t getSpanCount() const;
+
+    /**
+     * @brief Number of rings allocated so far.
+     */
+    size_t getRingCount() const;
+
+    /**
+     * @brief Drops all retained spans. Threads must not be recording.
+     */
+    void clear();
+
+private:
+    struct Ring;
+    struct RingLease;
+
+    mutable mutex ringsMutex;           ///< Guards rings and freeRings
+    vector<shared_ptr<Ring>> rings;     ///< Kept after their thread exits
+    vector<Ring*> freeRings;            ///< Rings of exited threads, reused first
+
+    SpanTracer() = default;
+    Ring& localRing();
+    void releaseRing(Ring* ring);
+};
+
+/**
+ * @class SpanScope
+ * @brief Records the lifetime of a scope as a span. Use through TRACE_SPAN.
+ */
+class SpanScope {
+public:
+    explicit SpanScope(const char* spanName) : name(spanName), start(SpanTracer::nowNs()) {}
+    ~SpanScope() { SpanTracer::instance().record(name, start, SpanTracer::nowNs()); }
+
+    SpanScope(const SpanScope&) = delete;
+    SpanScope& operator=(const SpanScope&) = delete;
+
+private:
+    const char* name;
+    uint64_t start;
+};
+
+#endif // TRACING_H
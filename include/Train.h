@@ -2,7 +2,7 @@
  * @file Train.h
  * @brief Definition of Train class and Stop structure.
  * 
- * This file contains the data structures representing a train and its route information.
+ * This file contains the data structures representing a train and its schedule.
  * It handles ticket availability, pricing, and schedule management.
  */
 
@@ -13,18 +13,27 @@
 #include <vector>
 #include <map>
 #include <iostream>
+#include <cstdint>
+#include <memory>
+#include <array>
+#include "InventoryEvents.h"
+#include "SeatClass.h"
+#include "Calendar.h"
+#include "ServiceCalendar.h"
+#include "Pricing.h"
+#include "Route.h"
 
 using namespace std;
 
 /**
- * @brief Represents a single stop on a train's route.
+ * @brief One request in a batch applied by Train::bookSegments.
  */
-struct Stop {
-    string stationName;   ///< Name of the station
-    string arrivalTime;   ///< Arrival time in HH:MM format
-    string departureTime; ///< Departure time in HH:MM format
-    double priceFromStart; ///< Cumulative price from the starting station
-    int distance;         ///< Distance from the starting station in km
+struct SegmentRequest {
+    int startIndex;  ///< Index of the boarding stop
+    int endIndex;    ///< Index of the alighting stop
+    int count;       ///< Number of seats
+    SeatClass seatClass; ///< Class of the seats
+    bool granted;    ///< Set by bookSegments
 };
 
 /**
@@ -34,21 +43,107 @@ struct Stop {
  * The Train class manages the train's basic information (ID, type, capacity),
  * its route (sequence of stops), and the seat inventory for different dates.
  * It provides methods to check ticket availability and book/release tickets.
+ *
+ * Every date taken by the inventory and fare methods is a service date: the
+ * date the train leaves its origin. Stops reached after midnight are on a
+ * later calendar date; getServiceDate() maps a passenger's travel date at
+ * a stop back to the service it belongs to.
+ *
+ * A train runs on the service dates of its ServiceCalendar (every day if it
+ * has none). Bookings on other dates are refused without allocating
+ * inventory; availability queries do not consult the calendar, so callers
+ * check runsOn() first.
+ *
+ * The stopping pattern is a shared, immutable Route whose times are
+ * relative to the first departure; the train adds its own departure time
+ * (getTimeOffset()), so copying a train never copies its stops. The
+ * per-date inventory and fare tables are shared the same way until one
+ * of the copies changes them, so copying a train (every search result
+ * is a copy) costs no allocation.
  */
 class Train {
 private:
     string trainId;      ///< Unique identifier for the train (e.g., G101)
     string type;         ///< Type of the train (e.g., High-Speed, Normal)
-    int totalSeats;      ///< Total number of seats available per segment
-    vector<Stop> route;  ///< Ordered list of stops
+    int totalSeats;      ///< Total number of seats available per segment (all classes)
+    array<int, SEAT_CLASS_COUNT> classSeats{}; ///< Seats per segment of each class
+    shared_ptr<const Route> route = Route::empty(); ///< Shared stopping pattern, times relative to timeOffset
+    int timeOffset = 0;  ///< First departure, in minutes after midnight of the service date
+    shared_ptr<const ServiceCalendar> serviceCalendar; ///< Null for a daily service
     
     /**
-     * @brief Seat inventory management.
-     * Map Key: Date string (YYYY-MM-DD)
-     * Map Value: Vector of integers representing available seats for each segment.
-     * Segment i corresponds to the path between stop[i] and stop[i+1].
+     * @brief Seats and fares of one service date.
      */
-    map<string, vector<int>> seatInventory; 
+    struct DailyInventory {
+        /**
+         * Available seats, segment-major: entry segment * SEAT_CLASS_COUNT +
+         * class, so every class of a segment shares a cache line and a
+         * journey's availability in all classes is one scan. Segment i
+         * corresponds to the path between stop[i] and stop[i+1].
+         */
+        vector<int> seats;
+        /**
+         * Dynamic fare from the origin to each stop, stop-major like the
+         * seats. Only kept while a pricing policy is set; empty until the
+         * date's first change, while the empty-train table applies.
+         */
+        vector<Money> farePrefix;
+    };
+
+    using InventoryMap = map<string, shared_ptr<DailyInventory>>;
+
+    /**
+     * @brief Inventory by service date (YYYY-MM-DD); null until the first booking.
+     * Copies of the train share the map and its dates. Shared parts are
+     * never changed: inventoryFor() and mutableInventory() copy the map,
+     * then the date, while another train still holds them.
+     */
+    shared_ptr<InventoryMap> inventory;
+
+    uint64_t inventoryVersion = 0;                 ///< Incremented on every inventory change
+    InventoryListener* inventoryListener = nullptr; ///< Not owned; copies of the train share it
+
+    shared_ptr<const PricingPolicy> pricing; ///< Null for static fares
+    /// Dynamic fare from the origin to each stop with every seat free (null without a policy)
+    shared_ptr<const vector<Money>> emptyFarePrefix;
+
+    /**
+     * @brief The date's inventory, or nullptr if nothing was booked on it.
+     */
+    const DailyInventory* findDay(const string& date) const;
+
+    /**
+     * @brief The inventory map, unshared (and created) for writing.
+     */
+    InventoryMap& mutableInventory();
+
+    /**
+     * @brief The date's inventory, unshared for writing; created with
+     * every seat free on first use.
+     */
+    DailyInventory& inventoryFor(const string& date);
+
+    /**
+     * @brief Reports a change of one class on segments [startIndex, endIndex) of a date to the listener.
+     */
+    void notifyInventory(const string& date, DailyInventory& day, int startIndex, int endIndex, int delta,
+                         SeatClass seatClass);
+
+    /**
+     * @brief Recomputes one class's fares of segments [startIndex, endIndex) on a
+     * date and shifts the prefix sums of the later stops by the difference.
+     */
+    void repriceSegments(DailyInventory& day, int startIndex, int endIndex, SeatClass seatClass);
+
+    /**
+     * @brief Builds the empty-train fare table for the current route and policy.
+     */
+    void buildEmptyFarePrefix();
+
+    /**
+     * @brief Fills a prefix table from one date's free seats.
+     */
+    void buildFarePrefix(const vector<int>& dailySeats, vector<Money>& prefix) const;
 
 public:
     /**
@@ -60,31 +155,218 @@ public:
      * @brief Parameterized constructor.
      * @param id Train ID
      * @param t Train Type
-     * @param seats Total capacity
+     * @param seats Total capacity, all in second class
      */
     Train(string id, string t, int seats);
 
+    /**
+     * @brief Constructor for a multi-class train.
+     * @param seats Capacity of each class, indexed by SeatClass
+     */
+    Train(string id, string t, const array<int, SEAT_CLASS_COUNT>& seats);
+
+    /**
+     * @brief Constructor for a train running a shared route (see setRoute).
+     * @param firstDeparture Departure from the first stop, in minutes after midnight
+     */
+    Train(string id, string t, const array<int, SEAT_CLASS_COUNT>& seats, shared_ptr<const Route> sharedRoute,
+          int firstDeparture);
+
     // Getters
-    string getId() const { return trainId; }
-    string getType() const { return type; }
+    const string& getId() const { return trainId; }
+    const string& getType() const { return type; }
     int getTotalSeats() const { return totalSeats; }
-    const vector<Stop>& getRoute() const { return route; }
+    int getClassSeats(SeatClass seatClass) const { return classSeats[seatClass]; }
+
+    /**
+     * @brief Stops of the route. Their times are relative to the first
+     * departure; use getDepartureMinutes()/getArrivalMinutes() for the
+     * train's own times.
+     */
+    const vector<Stop>& getRoute() const { return route->getStops(); }
+
+    const shared_ptr<const Route>& getSharedRoute() const { return route; }
+
+    /**
+     * @brief First departure, in minutes after midnight of the service date.
+     */
+    int getTimeOffset() const { return timeOffset; }
+
+    /**
+     * @brief Departure from a stop, in minutes after midnight of the service date.
+     */
+    int getDepartureMinutes(int stopIndex) const { return timeOffset + (*route)[stopIndex].departureMinutes; }
+
+    /**
+     * @brief Arrival at a stop, in minutes after midnight of the service date.
+     */
+    int getArrivalMinutes(int stopIndex) const { return timeOffset + (*route)[stopIndex].arrivalMinutes; }
+
+    /**
+     * @brief Runs the train on a shared route, leaving its origin at firstDeparture.
+     * Replaces the stops; call before any booking.
+     */
+    void setRoute(shared_ptr<const Route> sharedRoute, int firstDeparture);
+
+    /**
+     * @brief A copy with the schedule only: ID, type, capacity, route and
+     * calendar, without inventory, fares or listener.
+     */
+    Train getTimetable() const;
+
+    /**
+     * @brief Swaps the route for the equal one interned in table, if any.
+     */
+    void internRoute(RouteTable& table) { route = table.intern(route); }
+
+    /**
+     * @brief Heap bytes owned by the ID and type strings.
+     */
+    size_t getHeapBytes() const;
+
+    /**
+     * @brief Bytes of the route (stops and station names), which other
+     * trains may share.
+     */
+    size_t getRouteBytes() const;
+
+    /**
+     * @brief Heap bytes of the seat inventory across all dates.
+     */
+    size_t getInventoryBytes() const;
+
+    /**
+     * @brief Days after the service date on which a stop departs (0 for same-day stops).
+     */
+    int getDayOffset(int stopIndex) const { return getDepartureMinutes(stopIndex) / MINUTES_PER_DAY; }
+
+    /**
+     * @brief The service date of a train that departs a stop on travelDate.
+     */
+    string getServiceDate(const string& travelDate, int stopIndex) const {
+        return Calendar::addDays(travelDate, -getDayOffset(stopIndex));
+    }
+
+    /**
+     * @brief Calendar date on which the train of a service date arrives at a stop.
+     */
+    string getArrivalDate(const string& serviceDate, int stopIndex) const {
+        return Calendar::addDays(serviceDate, getArrivalMinutes(stopIndex) / MINUTES_PER_DAY);
+    }
+
+    /**
+     * @brief Minutes from departing one stop to arriving at a later one.
+     */
+    int getTravelMinutes(int startIndex, int endIndex) const {
+        return (*route)[endIndex].arrivalMinutes - (*route)[startIndex].departureMinutes;
+    }
+
+    /**
+     * @brief True if passengers can board after the service date, i.e. the
+     * travel date of some journeys differs from the service date.
+     */
+    bool hasOvernightBoarding() const {
+        return route->size() > 1 && getDayOffset(static_cast<int>(route->size()) - 2) > 0;
+    }
+
+    /**
+     * @brief Restricts the train to the days of a calendar (nullptr for every day).
+     */
+    void setServiceCalendar(shared_ptr<const ServiceCalendar> calendar) { serviceCalendar = move(calendar); }
+
+    const shared_ptr<const ServiceCalendar>& getServiceCalendar() const { return serviceCalendar; }
+
+    /**
+     * @brief Whether the train runs on a service date, given as a day number.
+     */
+    bool runsOn(int serviceDay) const { return !serviceCalendar || serviceCalendar->runsOn(serviceDay); }
+
+    /**
+     * @brief Same, for a "YYYY-MM-DD" service date; false for a date that
+     * does not exist, so inventory is only ever keyed by canonical dates.
+     */
+    bool runsOn(const string& serviceDate) const {
+        int day;
+        return Calendar::parseDate(serviceDate, day) && runsOn(day);
+    }
+
+    /**
+     * @brief Stops running on the service days firstDay to lastDay
+     * (INT_MIN and INT_MAX for an open end) and drops their inventory;
+     * the calendar is replaced, not changed, so trains sharing it are not
+     * affected.
+     * @return Number of dates whose inventory was dropped.
+     */
+    size_t cancelService(int firstDay, int lastDay);
+
+    /**
+     * @brief Number of dates that have inventory allocated.
+     */
+    size_t getInventoryDateCount() const { return inventory ? inventory->size() : 0; }
+
+    /**
+     * @brief Number of inventory changes so far.
+     */
+    uint64_t getInventoryVersion() const { return inventoryVersion; }
+
+    /**
+     * @brief Sets the listener told about every booking and release (nullptr for none).
+     */
+    void setInventoryListener(InventoryListener* listener) { inventoryListener = listener; }
+
+    /**
+     * @brief Switches to dynamic fares under a policy (nullptr for static fares).
+     * Rebuilds the fare tables of every date with inventory.
+     */
+    void setPricingPolicy(shared_ptr<const PricingPolicy> policy);
+
+    const shared_ptr<const PricingPolicy>& getPricingPolicy() const { return pricing; }
 
     /**
      * @brief Adds a stop to the train's route.
-     * @param stop The Stop object to add.
+     * The first stop's departure becomes the train's time offset. The
+     * route is rebuilt rather than changed, so trains sharing it are not
+     * affected.
+     * @param stop The Stop object to add, with the train's own times.
      */
     void addStop(const Stop& stop);
     
+    /**
+     * @brief Resolves the stop indices of a journey on this train.
+     * @param startIndex Receives the index of the boarding stop
+     * @param endIndex Receives the index of the alighting stop
+     * @return false if a station is not on the route or the order is wrong.
+     */
+    bool findSegment(const string& startStation, const string& endStation, int& startIndex, int& endIndex) const;
+
     /**
      * @brief Checks if there are enough tickets for a given segment.
      * @param date Travel date
      * @param startStation Name of starting station
      * @param endStation Name of destination station
      * @param count Number of tickets needed
-     * @return true if tickets are available, false otherwise
+     * @param seatClass Class of the seats
+     * @return true if tickets are available, false otherwise (also on days
+     * the train does not run)
+     * Does not modify the inventory, so searches can share a read lock.
+     */
+    bool hasTickets(const string& date, const string& startStation, const string& endStation, int count = 1,
+                    SeatClass seatClass = SECOND_CLASS) const;
+
+    /**
+     * @brief Checks whether any class has a seat free on the whole journey.
+     * @param startIndex Index of the boarding stop (from findSegment)
+     * @param endIndex Index of the alighting stop
      */
-    bool hasTickets(const string& date, const string& startStation, const string& endStation, int count = 1);
+    bool hasSeats(const string& date, int startIndex, int endIndex) const;
+
+    /**
+     * @brief Free seats of every class on a journey (the fewest over its
+     * segments), in one pass over the date's inventory.
+     * @param startIndex Index of the boarding stop (from findSegment)
+     * @param endIndex Index of the alighting stop
+     */
+    array<int, SEAT_CLASS_COUNT> getClassAvailability(const string& date, int startIndex, int endIndex) const;
     
     /**
      * @brief Books tickets for a given segment.
@@ -93,9 +375,33 @@ public:
      * @param startStation Name of starting station
      * @param endStation Name of destination station
      * @param count Number of tickets to book
-     * @return true if booking successful, false if not enough tickets
+     * @param seatClass Class of the seats
+     * @return true if booking successful, false if not enough tickets or
+     * the train does not run on the date
+     */
+    bool bookTickets(const string& date, const string& startStation, const string& endStation, int count = 1,
+                     SeatClass seatClass = SECOND_CLASS);
+    
+    /**
+     * @brief Free seats per segment on a date, summed over the classes
+     * (totalSeats everywhere if nothing has been booked that day).
+     */
+    vector<int> getAvailableSeats(const string& date) const;
+
+    /**
+     * @brief Checks whether every class of every segment is fully booked on a date.
+     */
+    bool isSoldOut(const string& date) const;
+
+    /**
+     * @brief Books a batch of requests for one date in a single pass.
+     * The date's inventory is looked up once; requests are granted in order
+     * while seats last; none is granted if the train does not run on the
+     * date. Indices must come from findSegment.
+     * @param date Travel date
+     * @param requests Requests to apply; granted is set on each
      */
-    bool bookTickets(const string& date, const string& startStation, const string& endStation, int count = 1);
+    void bookSegments(const string& date, vector<SegmentRequest>& requests);
     
     /**
      * @brief Releases tickets (used for refunds).
@@ -104,30 +410,50 @@ public:
      * @param startStation Name of starting station
      * @param endStation Name of destination station
      * @param count Number of tickets to release
+     * @param seatClass Class of the seats
      */
-    void releaseTickets(const string& date, const string& startStation, const string& endStation, int count = 1);
+    void releaseTickets(const string& date, const string& startStation, const string& endStation, int count = 1,
+                        SeatClass seatClass = SECOND_CLASS);
 
     /**
      * @brief Calculates the price between two stations.
      * @param startStation Name of starting station
      * @param endStation Name of destination station
+     * @param seatClass Class whose price column is used
      * @return The price difference between the two stations
      */
-    double getPrice(const string& startStation, const string& endStation);
+    double getPrice(const string& startStation, const string& endStation, SeatClass seatClass = SECOND_CLASS);
+
+    /**
+     * @brief Current fare of one seat between two stops, in O(1).
+     * Without a pricing policy this is the static base fare.
+     * @param startIndex Index of the boarding stop (from findSegment)
+     * @param endIndex Index of the alighting stop
+     * @param date Travel date
+     * @param today Calendar::dayNumber of the purchase date
+     * @param seatClass Class of the seat
+     */
+    Money quote(int startIndex, int endIndex, const string& date, int today, SeatClass seatClass = SECOND_CLASS) const;
+
+    /**
+     * @brief Same as above by station name; zero if the journey is not on the route.
+     */
+    Money quote(const string& startStation, const string& endStation, const string& date, int today,
+                SeatClass seatClass = SECOND_CLASS) const;
 
     /**
-     * @brief Gets the departure time for a specific station.
+     * @brief Gets the departure time for a specific station, for display.
      * @param station Station name
-     * @return Time string (HH:MM)
+     * @return Time of day (HH:MM), or empty if the station is not on the route
      */
-    string getDepartureTime(const string& station);
+    string getDepartureTime(const string& station) const;
 
     /**
-     * @brief Gets the arrival time for a specific station.
+     * @brief Gets the arrival time for a specific station, for display.
      * @param station Station name
-     * @return Time string (HH:MM)
+     * @return Time of day (HH:MM), or empty if the station is not on the route
      */
-    string getArrivalTime(const string& station);
+    string getArrivalTime(const string& station) const;
 
     /**
      * @brief Overloaded output stream operator for printing Train info.
@@ -0,0 +1,69 @@
+/**
+ * @file TrainOrderIndex.h
+ * @brief Definition of the index from trains to their orders.
+ */
+
+#ifndef TRAINORDERINDEX_H
+#define TRAINORDERINDEX_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "User.h"
+
+using namespace std;
+
+/**
+ * @brief An order on a train, by owner and history position.
+ */
+struct TrainOrderEntry {
+    shared_ptr<User> user;  ///< Owner of the order (a Passenger)
+    size_t position;        ///< Index in the owner's order history
+    int serviceDay;         ///< Service date of the order's train run (Calendar day number)
+};
+
+/**
+ * @class TrainOrderIndex
+ * @brief Sharded map from train ID to the orders booked on it.
+ *
+ * Lets a train cancellation reach every order on the train without
+ * scanning users. Entries are not removed when an order is refunded;
+ * whoever takes them checks the order's status. Safe to use from many
+ * threads: each shard has its own lock.
+ */
+class TrainOrderIndex {
+public:
+    explicit TrainOrderIndex(size_t shardCount = 16);
+
+    void add(const string& trainId, TrainOrderEntry entry);
+
+    /**
+     * @brief Removes and returns a train's entries with a service day from
+     * firstDay to lastDay, in the order they were added.
+     */
+    vector<TrainOrderEntry> take(const string& trainId, int firstDay, int lastDay);
+
+    /**
+     * @brief Number of entries, including those of refunded orders.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Bytes used by the index (buckets, nodes, keys and entry buffers).
+     */
+    size_t getMemoryBytes() const;
+
+private:
+    struct Shard {
+        mutable mutex mtx;
+        unordered_map<string, vector<TrainOrderEntry>> trains;
+    };
+
+    vector<unique_ptr<Shard>> shards;
+
+    Shard& shardFor(const string& trainId) const;
+};
+
+#endif // TRAINORDERINDEX_H
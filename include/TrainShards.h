@@ -0,0 +1,96 @@
+/**
+ * @file TrainShards.h
+ * @brief Definition of the train-sharded actor pool.
+ *
+ * Trains are partitioned by a hash of their ID across N shards. Each shard
+ * owns its Train objects (and therefore their seat inventory) and is driven
+ * by one worker thread that processes a message queue, so inventory is
+ * never touched by two threads at once and needs no locks of its own.
+ */
+
+#ifndef TRAINSHARDS_H
+#define TRAINSHARDS_H
+
+#include <string>
+#include <map>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <functional>
+#include <condition_variable>
+#include "Train.h"
+
+using namespace std;
+
+/**
+ * @class TrainShardPool
+ * @brief N single-threaded shards, each owning a subset of the trains.
+ *
+ * Work is sent to a shard as a message (a callable taking the shard's train
+ * map) and the caller receives a future for the result. Messages to one
+ * shard run in FIFO order; different shards run in parallel.
+ */
+class TrainShardPool {
+public:
+    using TrainMap = map<string, Train>;
+
+    explicit TrainShardPool(size_t shardCount);
+    ~TrainShardPool();
+
+    TrainShardPool(const TrainShardPool&) = delete;
+    TrainShardPool& operator=(const TrainShardPool&) = delete;
+
+    size_t getShardCount() const { return shards.size(); }
+
+    /**
+     * @brief Shard that owns a train.
+     */
+    size_t shardOf(const string& trainId) const;
+
+    /**
+     * @brief Posts a message to a shard.
+     * @param shard Shard index
+     * @param fn Callable invoked on the shard's thread with its TrainMap
+     * @return Future for fn's result.
+     */
+    template <class F>
+    auto submit(size_t shard, F fn) -> future<decltype(fn(declval<TrainMap&>()))> {
+        using R = decltype(fn(declval<TrainMap&>()));
+        Shard& s = *shards[shard];
+        auto task = make_shared<packaged_task<R()>>([&s, fn]() mutable { return fn(s.trains); });
+        future<R> result = task->get_future();
+        {
+            lock_guard<mutex> lock(s.mtx);
+            s.queue.push_back([task]() { (*task)(); });
+        }
+        s.cv.notify_one();
+        return result;
+    }
+
+    /**
+     * @brief Posts a message to a shard and waits for its result.
+     */
+    template <class F>
+    auto call(size_t shard, F fn) -> decltype(fn(declval<TrainMap&>())) {
+        return submit(shard, move(fn)).get();
+    }
+
+private:
+    struct Shard {
+        mutex mtx;
+        condition_variable cv;
+        deque<function<void()>> queue;
+        bool stopping = false;
+        TrainMap trains;   ///< Only touched from the worker thread
+        thread worker;
+    };
+
+    vector<unique_ptr<Shard>> shards;
+
+    static void workerLoop(Shard& shard);
+};
+
+#endif // TRAINSHARDS_H
@@ -9,7 +9,9 @@
 #include <string>
 #include <iostream>
 #include <vector>
+#include <mutex>
 #include "Order.h"
+#include "Tracing.h"
 
 using namespace std;
 
@@ -28,12 +30,12 @@ protected:
     string idCard;
 
 public:
-    User(string u, string p, string name, string id) 
-        : username(u), password(p), realName(name), idCard(id) {}
+    User(string u, string p, string name, string id)
+        : username(move(u)), password(move(p)), realName(move(name)), idCard(move(id)) {}
     virtual ~User() {}
 
-    string getUsername() const { return username; }
-    string getRealName() const { return realName; }
+    const string& getUsername() const { return username; }
+    const string& getRealName() const { return realName; }
     
     /**
      * @brief Verifies password.
@@ -44,6 +46,11 @@ public:
         return password == inputPwd;
     }
 
+    /**
+     * @brief Bytes used by this user object and its strings (order history not included).
+     */
+    virtual size_t getMemoryBytes() const;
+
     // Pure virtual function - Polymorphism
     virtual string getRole() const = 0;
     virtual void displayMenu() const = 0;
@@ -57,16 +64,94 @@ public:
 class Passenger : public User {
 private:
     vector<Order> orderHistory;
+    mutable mutex ordersMutex; ///< Guards orderHistory when several sessions share this user
+
+    /**
+     * @brief Cancels the PAID orders of the journey of a PAID order; ordersMutex must be held.
+     */
+    void cancelJourneyLocked(size_t position, vector<Order>& cancelled);
 
 public:
-    Passenger(string u, string p, string name, string id) 
-        : User(u, p, name, id) {}
+    Passenger(string u, string p, string name, string id)
+        : User(move(u), move(p), move(name), move(id)) {}
 
     string getRole() const override { return "Passenger"; }
     void displayMenu() const override;
 
-    void addOrder(const Order& order);
+    /**
+     * @brief Appends an order to the history.
+     * @return Position of the order in the history (stable for its lifetime).
+     */
+    size_t addOrder(const Order& order);
+    size_t addOrder(Order&& order);
+
+    /**
+     * @brief Constructs an order in place at the end of the history.
+     * @param args Order constructor arguments
+     * @return Position of the order in the history.
+     */
+    template <class... Args>
+    size_t emplaceOrder(Args&&... args) {
+        TRACE_SPAN("Passenger::emplaceOrder");
+        lock_guard<mutex> lock(ordersMutex);
+        orderHistory.emplace_back(forward<Args>(args)...);
+        return orderHistory.size() - 1;
+    }
     void cancelOrder(const string& orderId);
+
+    /**
+     * @brief Atomically moves a PAID order to CANCELLED.
+     * @param orderId Order to cancel
+     * @param cancelled Receives a copy of the cancelled order
+     * @return true if a PAID order with this ID was found.
+     */
+    bool cancelPaidOrder(const string& orderId, Order& cancelled);
+
+    /**
+     * @brief Same as cancelPaidOrder, for an order whose position is known
+     * (e.g. from the OrderIndex). No scan of the history is needed.
+     */
+    bool cancelPaidOrderAt(size_t position, const string& orderId, Order& cancelled);
+
+    /**
+     * @brief Appends the orders of a journey next to each other.
+     * @return Position of the first order.
+     */
+    size_t addOrderGroup(vector<Order>&& orders);
+
+    /**
+     * @brief Cancels a PAID order at a known position and, if it is part of
+     * a journey, every other order of the journey, under one lock.
+     * @param cancelled Receives copies of the orders cancelled
+     * @return true if the order was found and PAID.
+     */
+    bool cancelPaidJourneyAt(size_t position, const string& orderId, vector<Order>& cancelled);
+
+    /**
+     * @brief Cancels the PAID orders at several positions, with the rest
+     * of their journeys, under one lock. Orders no longer PAID are skipped.
+     * @param cancelled Receives copies of the orders cancelled
+     * @return Number of orders cancelled.
+     */
+    size_t cancelPaidAt(const vector<size_t>& positions, vector<Order>& cancelled);
+
+    /**
+     * @brief Returns a copy of the order history, safe to use while
+     * other sessions of the same user keep booking.
+     */
+    vector<Order> getOrdersSnapshot() const;
+
+    size_t getMemoryBytes() const override { return sizeof(Passenger) - sizeof(User) + User::getMemoryBytes(); }
+
+    /**
+     * @brief Bytes used by the order history.
+     * @param orderCount Receives the number of orders if not null
+     */
+    size_t getOrderHistoryBytes(size_t* orderCount = nullptr) const;
+
+    /**
+     * @brief Direct access to the order history (single-threaded use only).
+     */
     vector<Order>& getOrders() { return orderHistory; }
 };
 
@@ -77,8 +162,8 @@ public:
  */
 class Admin : public User {
 public:
-    Admin(string u, string p, string name, string id) 
-        : User(u, p, name, id) {}
+    Admin(string u, string p, string name, string id)
+        : User(move(u), move(p), move(name), move(id)) {}
 
     string getRole() const override { return "Admin"; }
     void displayMenu() const override;
@@ -0,0 +1,73 @@
+/**
+ * @file ActionDelegate.cpp
+ * @brief Implementation of the action column delegate.
+ */
+
+#include "ActionDelegate.h"
+#include <QApplication>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QStyle>
+#include <QStyleOptionButton>
+
+namespace {
+
+/// Button rectangle inside a cell
+QRect buttonRect(const QStyleOptionViewItem &option) {
+    return option.rect.adjusted(4, 2, -4, -2);
+}
+
+} // namespace
+
+ActionDelegate::ActionDelegate(QObject *parent) : QStyledItemDelegate(parent) {}
+
+void ActionDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const {
+    QString label = index.data(Qt::DisplayRole).toString();
+    if (label.isEmpty()) {
+        painter->drawText(option.rect, Qt::AlignCenter, "-");
+        return;
+    }
+
+    QStyleOptionButton button;
+    button.rect = buttonRect(option);
+    button.text = label;
+    button.state = QStyle::State_Enabled;
+    if (pressed.isValid() && pressed == index) button.state |= QStyle::State_Sunken;
+    else button.state |= QStyle::State_Raised;
+    if (option.state & QStyle::State_MouseOver) button.state |= QStyle::State_MouseOver;
+
+    QStyle *style = option.widget ? option.widget->style() : QApplication::style();
+    style->drawControl(QStyle::CE_PushButton, &button, painter, option.widget);
+}
+
+QSize ActionDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const {
+    QSize size = QStyledItemDelegate::sizeHint(option, index);
+    return size.expandedTo(QSize(80, 28));
+}
+
+/**
+ * @brief A click is a press and a release on the same cell's button.
+ */
+bool ActionDelegate::editorEvent(QEvent *event, QAbstractItemModel *model, const QStyleOptionViewItem &option,
+                                 const QModelIndex &index) {
+    if (index.data(Qt::DisplayRole).toString().isEmpty()) {
+        return QStyledItemDelegate::editorEvent(event, model, option, index);
+    }
+
+    if (event->type() == QEvent::MouseButtonPress) {
+        QMouseEvent *mouse = static_cast<QMouseEvent*>(event);
+        if (mouse->button() == Qt::LeftButton && buttonRect(option).contains(mouse->pos())) {
+            pressed = index;
+            return true;
+        }
+    } else if (event->type() == QEvent::MouseButtonRelease) {
+        QMouseEvent *mouse = static_cast<QMouseEvent*>(event);
+        bool wasPressed = pressed.isValid() && pressed == index;
+        pressed = QPersistentModelIndex();
+        if (wasPressed && mouse->button() == Qt::LeftButton && buttonRect(option).contains(mouse->pos())) {
+            emit clicked(index);
+            return true;
+        }
+    }
+    return QStyledItemDelegate::editorEvent(event, model, option, index);
+}
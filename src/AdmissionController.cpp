@@ -0,0 +1,220 @@
+/**
+ * @file AdmissionController.cpp
+ * @brief Implementation of token buckets and fair queueing.
+ */
+
+#include "AdmissionController.h"
+#include "Tracing.h"
+#include <algorithm>
+#include <functional>
+
+namespace {
+const size_t SHARD_COUNT = 16;
+}
+
+AdmissionController::AdmissionController(const AdmissionConfig& cfg) : config(cfg) {
+    for (size_t i = 0; i < SHARD_COUNT; ++i) {
+        shards.push_back(make_unique<Shard>());
+    }
+}
+
+AdmissionController::TrainDate* AdmissionController::find(const string& key) const {
+    Shard& shard = *shards[hash<string>()(key) % shards.size()];
+    shared_lock<shared_mutex> lock(shard.mtx);
+    auto it = shard.entries.find(key);
+    return it == shard.entries.end() ? nullptr : it->second.get();
+}
+
+/**
+ * @brief Looks up a train-date, creating it with a full bucket.
+ * Entries are never removed, so returned references stay valid.
+ */
+AdmissionController::TrainDate& AdmissionController::findOrCreate(const string& key) {
+    if (TrainDate* td = find(key)) return *td;
+
+    Shard& shard = *shards[hash<string>()(key) % shards.size()];
+    unique_lock<shared_mutex> lock(shard.mtx);
+    unique_ptr<TrainDate>& slot = shard.entries[key];
+    if (!slot) {
+        slot = make_unique<TrainDate>();
+        slot->tokens = config.burst;
+        slot->lastRefill = Clock::now();
+    }
+    return *slot;
+}
+
+void AdmissionController::refill(TrainDate& td, Clock::time_point now) const {
+    double elapsed = chrono::duration<double>(now - td.lastRefill).count();
+    td.tokens = min(config.burst, td.tokens + elapsed * config.tokensPerSecond);
+    td.lastRefill = now;
+}
+
+/**
+ * @brief Takes a token if one is free and nobody is waiting for it.
+ * Caller holds td.mtx.
+ */
+bool AdmissionController::takeFreeToken(TrainDate& td, Clock::time_point now) {
+    refill(td, now);
+    if (td.queued != 0 || td.tokens < 1.0) return false;
+    td.tokens -= 1.0;
+    admittedCount.fetch_add(1, memory_order_relaxed);
+    return true;
+}
+
+/**
+ * @brief Hands available tokens to waiters, one user at a time in rotation.
+ * Caller holds td.mtx.
+ */
+void AdmissionController::dispatch(TrainDate& td, Clock::time_point now) {
+    refill(td, now);
+    bool grantedAny = false;
+    while (td.tokens >= 1.0 && !td.rotation.empty()) {
+        string user = move(td.rotation.front());
+        td.rotation.pop_front();
+
+        auto it = td.queues.find(user);
+        deque<Waiter*>& queue = it->second;
+        queue.front()->granted = true;
+        queue.pop_front();
+        --td.queued;
+        td.tokens -= 1.0;
+        grantedAny = true;
+
+        if (queue.empty()) {
+            td.queues.erase(it);
+        } else {
+            td.rotation.push_back(move(user));
+        }
+    }
+    if (grantedAny) td.cv.notify_all();
+}
+
+void AdmissionController::removeWaiter(TrainDate& td, const string& username, Waiter* waiter) {
+    auto it = td.queues.find(username);
+    if (it == td.queues.end()) return;
+    deque<Waiter*>& queue = it->second;
+    queue.erase(remove(queue.begin(), queue.end(), waiter), queue.end());
+    --td.queued;
+    if (queue.empty()) {
+        td.queues.erase(it);
+        td.rotation.erase(remove(td.rotation.begin(), td.rotation.end(), username), td.rotation.end());
+    }
+}
+
+AdmissionDecision AdmissionController::admit(const string& trainId, const string& date, const string& username) {
+    TRACE_SPAN("AdmissionController::admit");
+    TrainDate& td = findOrCreate(makeKey(trainId, date));
+    if (td.soldOut.load(memory_order_acquire)) {
+        soldOutCount.fetch_add(1, memory_order_relaxed);
+        return REJECTED_SOLD_OUT;
+    }
+
+    unique_lock<mutex> lock(td.mtx);
+    Clock::time_point now = Clock::now();
+
+    // Fast path: a token is free and nobody is ahead of us
+    if (takeFreeToken(td, now)) return ADMITTED;
+
+    deque<Waiter*>& queue = td.queues[username];
+    if (queue.size() >= config.maxQueuedPerUser || td.queued >= config.maxQueued) {
+        if (queue.empty()) td.queues.erase(username);
+        queueFullCount.fetch_add(1, memory_order_relaxed);
+        return REJECTED_QUEUE_FULL;
+    }
+
+    Waiter waiter;
+    if (queue.empty()) td.rotation.push_back(username);
+    queue.push_back(&waiter);
+    ++td.queued;
+    queuedCount.fetch_add(1, memory_order_relaxed);
+
+    Clock::time_point deadline = now + config.maxWait;
+    for (;;) {
+        dispatch(td, now);
+        if (waiter.granted) {
+            admittedCount.fetch_add(1, memory_order_relaxed);
+            return ADMITTED;
+        }
+        if (td.soldOut.load(memory_order_acquire)) {
+            removeWaiter(td, username, &waiter);
+            soldOutCount.fetch_add(1, memory_order_relaxed);
+            return REJECTED_SOLD_OUT;
+        }
+        if (now >= deadline) {
+            removeWaiter(td, username, &waiter);
+            timeoutCount.fetch_add(1, memory_order_relaxed);
+            return REJECTED_TIMEOUT;
+        }
+
+        // Sleep until the next token is due, or until someone hands us one
+        Clock::time_point wakeAt = deadline;
+        if (config.tokensPerSecond > 0.0) {
+            double missing = max(0.0, 1.0 - td.tokens);
+            wakeAt = min(deadline, now + chrono::duration_cast<Clock::duration>(
+                                       chrono::duration<double>(missing / config.tokensPerSecond)));
+        }
+        td.cv.wait_until(lock, wakeAt);
+        now = Clock::now();
+    }
+}
+
+AdmissionDecision AdmissionController::tryAdmit(const string& trainId, const string& date) {
+    TRACE_SPAN("AdmissionController::tryAdmit");
+    TrainDate& td = findOrCreate(makeKey(trainId, date));
+    if (td.soldOut.load(memory_order_acquire)) {
+        soldOutCount.fetch_add(1, memory_order_relaxed);
+        return REJECTED_SOLD_OUT;
+    }
+    lock_guard<mutex> lock(td.mtx);
+    if (takeFreeToken(td, Clock::now())) return ADMITTED;
+    deferredCount.fetch_add(1, memory_order_relaxed);
+    return DEFERRED;
+}
+
+void AdmissionController::release(const string& trainId, const string& date) {
+    TrainDate* td = find(makeKey(trainId, date));
+    if (!td) return;
+    lock_guard<mutex> lock(td->mtx);
+    refill(*td, Clock::now());
+    td->tokens = min(config.burst, td->tokens + 1.0);
+    admittedCount.fetch_sub(1, memory_order_relaxed);
+    td->cv.notify_all();
+}
+
+bool AdmissionController::isSoldOut(const string& trainId, const string& date) const {
+    TrainDate* td = find(makeKey(trainId, date));
+    return td && td->soldOut.load(memory_order_acquire);
+}
+
+void AdmissionController::setSoldOut(const string& trainId, const string& date, bool soldOut) {
+    if (!soldOut) {
+        // Nothing to clear for a train-date nobody has asked about
+        TrainDate* td = find(makeKey(trainId, date));
+        if (td) td->soldOut.store(false, memory_order_release);
+        return;
+    }
+    TrainDate& td = findOrCreate(makeKey(trainId, date));
+    td.soldOut.store(true, memory_order_release);
+    lock_guard<mutex> lock(td.mtx);
+    td.cv.notify_all();
+}
+
+AdmissionCounters AdmissionController::getCounters() const {
+    AdmissionCounters c;
+    c.admitted = admittedCount.load();
+    c.queued = queuedCount.load();
+    c.rejectedSoldOut = soldOutCount.load();
+    c.rejectedQueueFull = queueFullCount.load();
+    c.rejectedTimeout = timeoutCount.load();
+    c.deferred = deferredCount.load();
+    return c;
+}
+
+size_t AdmissionController::getEntryCount() const {
+    size_t count = 0;
+    for (const auto& shard : shards) {
+        shared_lock<shared_mutex> lock(shard->mtx);
+        count += shard->entries.size();
+    }
+    return count;
+}
@@ -0,0 +1,192 @@
+/**
+ * @file BookingPipeline.cpp
+ * @brief Implementation of the ring buffer and its two stages.
+ */
+
+#include "BookingPipeline.h"
+
+namespace {
+
+/// Busy polls before a stage parks on the condition variable
+const int SPIN_LIMIT = 200;
+
+size_t roundUpToPowerOfTwo(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+} // namespace
+
+BookingPipeline::BookingPipeline(SystemManager& sys, size_t capacity, size_t batch)
+    : system(sys), ring(roundUpToPowerOfTwo(capacity < 2 ? 2 : capacity)),
+      mask(static_cast<int64_t>(ring.size()) - 1), maxBatch(batch == 0 ? 1 : batch) {
+    inventoryThread = thread([this]() { inventoryStage(); });
+    orderThread = thread([this]() { orderStage(); });
+}
+
+BookingPipeline::~BookingPipeline() {
+    running.store(false);
+    wakeStages();
+    inventoryThread.join();
+    orderThread.join();
+}
+
+future<BookingResult> BookingPipeline::submit(const string& session, const string& trainId, const string& start,
+                                              const string& end, const string& date, int count, SeatClass seatClass) {
+    auto promised = make_shared<promise<BookingResult>>();
+    future<BookingResult> result = promised->get_future();
+    submit(session, trainId, start, end, date, count, seatClass,
+           [promised](const BookingResult& r) { promised->set_value(r); });
+    return result;
+}
+
+/**
+ * @brief Validates the session and passes admission control on the
+ * caller's thread, then enters the ring.
+ */
+void BookingPipeline::submit(const string& session, const string& trainId, const string& start,
+                             const string& end, const string& date, int count, SeatClass seatClass, Callback done) {
+    auto started = chrono::steady_clock::now();
+    TripLeg leg{trainId, start, end, date, seatClass};
+    shared_ptr<User> user = system.getSessionUser(session);
+    BookingResult rejected;
+    if (!user) {
+        rejected.status = NOT_LOGGED_IN;
+    } else if (count <= 0) {
+        rejected.status = INVALID_COUNT;
+    } else if (!Calendar::isValidDate(date)) {
+        rejected.status = INVALID_DATE;
+    } else {
+        rejected.status = system.admitBooking(trainId, date, user->getUsername());
+    }
+    if (rejected.status != BOOKED) {
+        system.reportBooking(session, leg, count, started, rejected);
+        done(rejected);
+        return;
+    }
+    publish(move(user), session, started, leg, count, move(done));
+}
+
+/**
+ * @brief Claims a slot, fills it and publishes it.
+ */
+void BookingPipeline::publish(shared_ptr<User> user, const string& session, chrono::steady_clock::time_point started,
+                              const TripLeg& leg, int count, Callback done) {
+    int64_t seq = claimSequence.fetch_add(1);
+
+    // Wait until stage 2 has released the slot from the previous lap
+    int64_t wrapPoint = seq - static_cast<int64_t>(ring.size());
+    while (completedSequence.value.load(memory_order_acquire) < wrapPoint) {
+        this_thread::yield();
+    }
+
+    Slot& slot = ring[seq & mask];
+    slot.user = move(user);
+    slot.session = session;
+    slot.started = started;
+    slot.request.leg = leg;
+    slot.request.count = count;
+    slot.request.status = BOOKED;
+    slot.request.price = Money();
+    slot.request.departureMinutes = -1;
+    slot.done = move(done);
+    slot.sequence.store(seq, memory_order_release);
+
+    if (sleepers.load() > 0) wakeStages();
+}
+
+void BookingPipeline::wakeStages() {
+    lock_guard<mutex> lock(waitMutex);
+    waitCv.notify_all();
+}
+
+/**
+ * @brief Parks an idle stage. The timeout bounds the cost of a missed wake-up.
+ */
+void BookingPipeline::waitForWork() {
+    sleepers.fetch_add(1);
+    {
+        unique_lock<mutex> lock(waitMutex);
+        waitCv.wait_for(lock, chrono::milliseconds(1));
+    }
+    sleepers.fetch_sub(1);
+}
+
+/**
+ * @brief Stage 1: batch everything published so far and reserve seats.
+ */
+void BookingPipeline::inventoryStage() {
+    int64_t next = 0;
+    vector<SeatRequest*> batch;
+    batch.reserve(maxBatch);
+    int idle = 0;
+
+    for (;;) {
+        batch.clear();
+        int64_t seq = next;
+        while (batch.size() < maxBatch && ring[seq & mask].sequence.load(memory_order_acquire) == seq) {
+            batch.push_back(&ring[seq & mask].request);
+            ++seq;
+        }
+
+        if (batch.empty()) {
+            if (!running.load() && claimSequence.load() == next) return;
+            if (++idle < SPIN_LIMIT) {
+                this_thread::yield();
+            } else {
+                waitForWork();
+            }
+            continue;
+        }
+        idle = 0;
+
+        system.reserveSeatsBatch(batch);
+        batchCount.fetch_add(1, memory_order_relaxed);
+        next = seq;
+        inventorySequence.value.store(next - 1, memory_order_release);
+        if (sleepers.load() > 0) wakeStages();
+    }
+}
+
+/**
+ * @brief Stage 2: write orders and complete the callers.
+ */
+void BookingPipeline::orderStage() {
+    int64_t next = 0;
+    int idle = 0;
+
+    for (;;) {
+        int64_t available = inventorySequence.value.load(memory_order_acquire);
+        if (available < next) {
+            if (!running.load() && claimSequence.load() == next) return;
+            if (++idle < SPIN_LIMIT) {
+                this_thread::yield();
+            } else {
+                waitForWork();
+            }
+            continue;
+        }
+        idle = 0;
+
+        for (; next <= available; ++next) {
+            Slot& slot = ring[next & mask];
+            SeatRequest& req = slot.request;
+
+            BookingResult result;
+            result.status = req.status;
+            if (req.status == BOOKED) {
+                result.price = req.price;
+                result.orderId = system.recordOrder(slot.user, req.leg, req.departureMinutes, req.price, req.count);
+            }
+            system.reportBooking(slot.session, req.leg, req.count, slot.started, result);
+            Callback done = move(slot.done);
+            slot.user.reset();
+            slot.done = nullptr;
+
+            done(result);
+        }
+        processedCount.fetch_add(available - completedSequence.value.load(memory_order_relaxed), memory_order_relaxed);
+        completedSequence.value.store(available, memory_order_release);
+    }
+}
@@ -0,0 +1,93 @@
+/**
+ * @file Calendar.cpp
+ * @brief Implementation of the date and clock helpers.
+ */
+
+#include "Calendar.h"
+#include <cstdio>
+
+namespace {
+
+/**
+ * @brief Parses a fixed-width run of digits (-1 if any is not a digit).
+ */
+int parseDigits(const string& text, size_t pos, size_t len) {
+    int value = 0;
+    for (size_t i = pos; i < pos + len; ++i) {
+        if (text[i] < '0' || text[i] > '9') return -1;
+        value = value * 10 + (text[i] - '0');
+    }
+    return value;
+}
+
+int daysInMonth(int year, int month) {
+    static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+    return month == 2 && leap ? 29 : days[month - 1];
+}
+
+} // namespace
+
+/**
+ * @brief Days-from-civil (H. Hinnant's algorithm).
+ */
+bool Calendar::parseDate(const string& date, int& day) {
+    if (date.size() != 10 || date[4] != '-' || date[7] != '-') return false;
+    int y = parseDigits(date, 0, 4);
+    int m = parseDigits(date, 5, 2);
+    int d = parseDigits(date, 8, 2);
+    if (y < 0 || m < 1 || m > 12 || d < 1 || d > daysInMonth(y, m)) return false;
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    day = era * 146097 + doe - 719468;
+    return true;
+}
+
+int Calendar::dayNumber(const string& date) {
+    int day;
+    return parseDate(date, day) ? day : 0;
+}
+
+/**
+ * @brief Civil-from-days, the inverse of dayNumber.
+ */
+string Calendar::formatDate(int day) {
+    long z = day + 719468L;
+    long era = (z >= 0 ? z : z - 146096) / 146097;
+    long doe = z - era * 146097;
+    long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    long mp = (5 * doy + 2) / 153;
+    int d = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+    int m = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    int y = static_cast<int>(yoe + era * 400 + (m <= 2));
+    char buf[48]; // room for any int fields, so the output is never truncated
+    snprintf(buf, sizeof(buf), "%04d-%02d-%02d", y, m, d);
+    return buf;
+}
+
+string Calendar::addDays(const string& date, int days) {
+    return days == 0 ? date : formatDate(dayNumber(date) + days);
+}
+
+int Calendar::parseClock(const string& clock) {
+    size_t colon = clock.find(':');
+    if (colon == string::npos || colon == 0 || colon > 3 || clock.size() != colon + 3) return -1;
+    int hours = parseDigits(clock, 0, colon);
+    int minutes = parseDigits(clock, colon + 1, 2);
+    if (hours < 0 || minutes < 0 || minutes > 59) return -1;
+    return hours * 60 + minutes;
+}
+
+/**
+ * @brief Negative minute counts wrap back into the previous day.
+ */
+string Calendar::formatClock(int minutes) {
+    int timeOfDay = (minutes % MINUTES_PER_DAY + MINUTES_PER_DAY) % MINUTES_PER_DAY;
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%02d:%02d", timeOfDay / 60, timeOfDay % 60);
+    return buf;
+}
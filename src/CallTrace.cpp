@@ -0,0 +1,236 @@
+/**
+ * @file CallTrace.cpp
+ * @brief Implementation of the trace file encoder and decoder.
+ */
+
+#include "CallTrace.h"
+#include <sstream>
+
+namespace {
+
+const char TRACE_MAGIC[4] = {'R', 'T', 'R', 'C'};
+const uint64_t TRACE_VERSION = 1;
+
+/// Write the buffer out once it holds this many bytes
+const size_t FLUSH_THRESHOLD = 64 * 1024;
+
+/// Journeys take TRACE_LEG_ARGS per leg; a count beyond 200 legs means a corrupt record
+const uint64_t MAX_ARGS = 2 + 200 * TRACE_LEG_ARGS;
+
+/// The string table stops growing here; later new strings are always written in full
+const size_t MAX_INTERNED_STRINGS = 1 << 20;
+
+void appendVarint(string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+} // namespace
+
+const char* traceOpName(TraceOp op) {
+    switch (op) {
+        case TRACE_REGISTER: return "register";
+        case TRACE_LOGIN: return "login";
+        case TRACE_LOGOUT: return "logout";
+        case TRACE_SEARCH: return "search";
+        case TRACE_BOOK: return "book";
+        case TRACE_REFUND: return "refund";
+        case TRACE_TRANSFER: return "transfer";
+        case TRACE_JOURNEY: return "journey";
+    }
+    return "unknown";
+}
+
+// TraceRecorder
+
+TraceRecorder::~TraceRecorder() {
+    close();
+}
+
+bool TraceRecorder::open(const string& path) {
+    lock_guard<mutex> lock(mtx);
+    if (file.is_open()) file.close();
+    file.open(path, ios::binary | ios::trunc);
+    if (!file) return false;
+
+    buffer.assign(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    appendVarint(buffer, TRACE_VERSION);
+    appendVarint(buffer, static_cast<uint64_t>(time(nullptr)));
+    strings.clear();
+    origin = chrono::steady_clock::now();
+    lastStartNs = 0;
+    recordCount = 0;
+    return true;
+}
+
+void TraceRecorder::close() {
+    lock_guard<mutex> lock(mtx);
+    if (!file.is_open()) return;
+    flushLocked();
+    file.close();
+}
+
+bool TraceRecorder::isOpen() const {
+    lock_guard<mutex> lock(mtx);
+    return file.is_open();
+}
+
+uint64_t TraceRecorder::getRecordCount() const {
+    lock_guard<mutex> lock(mtx);
+    return recordCount;
+}
+
+void TraceRecorder::flush() {
+    lock_guard<mutex> lock(mtx);
+    flushLocked();
+}
+
+void TraceRecorder::flushLocked() {
+    if (!file.is_open() || buffer.empty()) return;
+    file.write(buffer.data(), buffer.size());
+    file.flush();
+    buffer.clear();
+}
+
+/**
+ * @brief Encodes a string: 2*index+1 for a known string, 2*length then the bytes otherwise.
+ */
+void TraceRecorder::writeString(const string& s) {
+    auto it = strings.find(s);
+    if (it != strings.end()) {
+        appendVarint(buffer, 2 * static_cast<uint64_t>(it->second) + 1);
+        return;
+    }
+    appendVarint(buffer, 2 * static_cast<uint64_t>(s.size()));
+    buffer += s;
+    if (strings.size() < MAX_INTERNED_STRINGS) {
+        uint32_t index = static_cast<uint32_t>(strings.size());
+        strings.emplace(s, index);
+    }
+}
+
+/**
+ * @brief Encodes one record.
+ * Records are appended in completion order, so start times may go
+ * backwards between neighbours; the delta is therefore signed.
+ */
+void TraceRecorder::record(TraceOp op, chrono::steady_clock::time_point start, const vector<string>& args,
+                           int64_t result, const string& output) {
+    auto end = chrono::steady_clock::now();
+    lock_guard<mutex> lock(mtx);
+    if (!file.is_open()) return;
+
+    int64_t startNs = chrono::duration_cast<chrono::nanoseconds>(start - origin).count();
+    int64_t durationNs = chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+
+    buffer += static_cast<char>(op);
+    appendVarint(buffer, zigzag(startNs - lastStartNs));
+    appendVarint(buffer, static_cast<uint64_t>(durationNs));
+    appendVarint(buffer, args.size());
+    for (const string& arg : args) writeString(arg);
+    appendVarint(buffer, zigzag(result));
+    writeString(output);
+
+    lastStartNs = startNs;
+    ++recordCount;
+    if (buffer.size() >= FLUSH_THRESHOLD) flushLocked();
+}
+
+// TraceReader
+
+bool TraceReader::open(const string& path) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        lastError = "cannot open " + path;
+        return false;
+    }
+    stringstream ss;
+    ss << in.rdbuf();
+    data = ss.str();
+    pos = 0;
+    lastStartNs = 0;
+    strings.clear();
+
+    uint64_t version, start;
+    if (data.compare(0, sizeof(TRACE_MAGIC), string(TRACE_MAGIC, sizeof(TRACE_MAGIC))) != 0) {
+        lastError = "not a trace file";
+        return false;
+    }
+    pos = sizeof(TRACE_MAGIC);
+    if (!readVarint(version) || version != TRACE_VERSION || !readVarint(start)) {
+        lastError = "unsupported trace version";
+        return false;
+    }
+    startTime = static_cast<time_t>(start);
+    lastError.clear();
+    return true;
+}
+
+bool TraceReader::readVarint(uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= data.size()) return false;
+        uint8_t byte = static_cast<uint8_t>(data[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+bool TraceReader::readString(string& s) {
+    uint64_t tag;
+    if (!readVarint(tag)) return false;
+    if (tag & 1) {
+        uint64_t index = tag >> 1;
+        if (index >= strings.size()) return false;
+        s = strings[index];
+        return true;
+    }
+    uint64_t length = tag >> 1;
+    if (length > data.size() - pos) return false;
+    s.assign(data, pos, length);
+    pos += length;
+    if (strings.size() < MAX_INTERNED_STRINGS) strings.push_back(s);
+    return true;
+}
+
+bool TraceReader::next(TraceRecord& record) {
+    if (pos >= data.size()) return false;
+
+    int op = static_cast<uint8_t>(data[pos++]);
+    uint64_t delta, duration, argc, result;
+    if (op < TRACE_REGISTER || op >= TRACE_OP_LIMIT ||
+        !readVarint(delta) || !readVarint(duration) || !readVarint(argc) || argc > MAX_ARGS) {
+        lastError = "corrupt record";
+        return false;
+    }
+    record.op = static_cast<TraceOp>(op);
+    lastStartNs += unzigzag(delta);
+    record.startNs = lastStartNs;
+    record.durationNs = static_cast<int64_t>(duration);
+
+    record.args.resize(argc);
+    for (string& arg : record.args) {
+        if (!readString(arg)) {
+            lastError = "corrupt record";
+            return false;
+        }
+    }
+    if (!readVarint(result) || !readString(record.output)) {
+        lastError = "corrupt record";
+        return false;
+    }
+    record.result = unzigzag(result);
+    return true;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file ChangeFeed.cpp
+ * @brief Implementation of inventory change subscriptions.
+ */
+
+#include "ChangeFeed.h"
+#include <algorithm>
+#include <mutex>
+
+// ---------------- FeedSubscription ----------------
+
+FeedSubscription::FeedSubscription(FeedFilter f, size_t capacity) : filter(move(f)), queue(capacity) {}
+
+void FeedSubscription::offer(const InventoryEvent& event) {
+    if (queue.tryPush(event)) {
+        published.fetch_add(1, memory_order_relaxed);
+    } else {
+        dropped.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+size_t FeedSubscription::poll(vector<InventoryEvent>& batch, size_t maxEvents) {
+    size_t taken = 0;
+    InventoryEvent event;
+    while (taken < maxEvents && queue.tryPop(event)) {
+        batch.push_back(move(event));
+        ++taken;
+    }
+    return taken;
+}
+
+// ---------------- ChangeFeed ----------------
+
+/**
+ * @brief Registration with the hub happens with mtx released: delivery holds the
+ * hub's lock while taking mtx, so the opposite order could deadlock.
+ */
+ChangeFeed::~ChangeFeed() {
+    lock_guard<mutex> registration(registrationMutex);
+    if (getSubscriberCount() > 0) hub.removeListener(this);
+}
+
+shared_ptr<FeedSubscription> ChangeFeed::subscribe(FeedFilter filter, size_t capacity) {
+    auto subscription = make_shared<FeedSubscription>(move(filter), capacity);
+    lock_guard<mutex> registration(registrationMutex);
+    bool first;
+    {
+        unique_lock<shared_mutex> lock(mtx);
+        subscriptions.push_back(subscription);
+        first = subscriptions.size() == 1;
+    }
+    if (first) hub.addListener(this);
+    return subscription;
+}
+
+bool ChangeFeed::unsubscribe(const shared_ptr<FeedSubscription>& subscription) {
+    lock_guard<mutex> registration(registrationMutex);
+    bool last;
+    {
+        unique_lock<shared_mutex> lock(mtx);
+        auto it = find(subscriptions.begin(), subscriptions.end(), subscription);
+        if (it == subscriptions.end()) return false;
+        subscriptions.erase(it);
+        last = subscriptions.empty();
+    }
+    if (last) hub.removeListener(this);
+    return true;
+}
+
+size_t ChangeFeed::getSubscriberCount() const {
+    shared_lock<shared_mutex> lock(mtx);
+    return subscriptions.size();
+}
+
+void ChangeFeed::onInventoryChange(const InventoryEvent& event) {
+    shared_lock<shared_mutex> lock(mtx);
+    for (const auto& subscription : subscriptions) {
+        if (subscription->filter.matches(event)) subscription->offer(event);
+    }
+}
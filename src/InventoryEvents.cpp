@@ -0,0 +1,28 @@
+/**
+ * @file InventoryEvents.cpp
+ * @brief Implementation of the inventory event hub.
+ */
+
+#include "InventoryEvents.h"
+#include <algorithm>
+#include <mutex>
+
+void InventoryEventHub::addListener(InventoryListener* listener) {
+    unique_lock<shared_mutex> lock(mtx);
+    listeners.push_back(listener);
+    active.store(true, memory_order_release);
+}
+
+bool InventoryEventHub::removeListener(InventoryListener* listener) {
+    unique_lock<shared_mutex> lock(mtx);
+    auto it = find(listeners.begin(), listeners.end(), listener);
+    if (it == listeners.end()) return false;
+    listeners.erase(it);
+    active.store(!listeners.empty(), memory_order_release);
+    return true;
+}
+
+void InventoryEventHub::onInventoryChange(const InventoryEvent& event) {
+    shared_lock<shared_mutex> lock(mtx);
+    for (InventoryListener* listener : listeners) listener->onInventoryChange(event);
+}
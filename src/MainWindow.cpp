@@ -33,6 +33,9 @@ MainWindow::MainWindow(QWidget *parent)
 }
 
 MainWindow::~MainWindow() {
+    // The search worker and the inventory listener must stop before systemManager is destroyed
+    delete searchController;
+    delete occupancyModel;
 }
 
 /**
@@ -152,7 +155,15 @@ void MainWindow::createPassengerPage() {
     searchDateInput = new QDateEdit(QDate::currentDate());
     searchDateInput->setDisplayFormat("yyyy-MM-dd");
     
+    seatClassInput = new QComboBox();
+    for (int c = 0; c < SEAT_CLASS_COUNT; ++c) {
+        QString name = seatClassName(static_cast<SeatClass>(c));
+        seatClassInput->addItem(name.left(1).toUpper() + name.mid(1));
+    }
+
     QPushButton *searchBtn = new QPushButton("Search");
+    liveSearchCheck = new QCheckBox("Live");
+    liveSearchCheck->setToolTip("Search while typing");
     
     searchLayout->addWidget(new QLabel("From:"));
     searchLayout->addWidget(searchStartInput);
@@ -160,27 +171,55 @@ void MainWindow::createPassengerPage() {
     searchLayout->addWidget(searchEndInput);
     searchLayout->addWidget(new QLabel("Date:"));
     searchLayout->addWidget(searchDateInput);
+    searchLayout->addWidget(new QLabel("Class:"));
+    searchLayout->addWidget(seatClassInput);
     searchLayout->addWidget(searchBtn);
+    searchLayout->addWidget(liveSearchCheck);
     
     mainLayout->addWidget(searchGroup);
 
     connect(searchBtn, &QPushButton::clicked, this, &MainWindow::handleSearch);
 
+    liveSearchTimer = new QTimer(this);
+    liveSearchTimer->setSingleShot(true);
+    liveSearchTimer->setInterval(300);
+    connect(liveSearchTimer, &QTimer::timeout, this, &MainWindow::runLiveSearch);
+    connect(searchStartInput, &QLineEdit::textEdited, this, &MainWindow::scheduleLiveSearch);
+    connect(searchEndInput, &QLineEdit::textEdited, this, &MainWindow::scheduleLiveSearch);
+    connect(searchDateInput, &QDateEdit::dateChanged, this, &MainWindow::scheduleLiveSearch);
+
     // Results Table
-    trainResultTable = new QTableWidget();
-    trainResultTable->setColumnCount(6);
-    trainResultTable->setHorizontalHeaderLabels({"Train ID", "Type", "Start Time", "End Time", "Price", "Action"});
+    trainResultModel = new TrainResultModel(this);
+    trainResultTable = new QTableView();
+    trainResultTable->setModel(trainResultModel);
+    trainResultTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    trainResultTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    trainResultTable->verticalHeader()->setDefaultSectionSize(30);
     trainResultTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    ActionDelegate *bookDelegate = new ActionDelegate(trainResultTable);
+    trainResultTable->setItemDelegateForColumn(TrainResultModel::COL_ACTION, bookDelegate);
+    connect(bookDelegate, &ActionDelegate::clicked, this, &MainWindow::bookResult);
+    connect(seatClassInput, QOverload<int>::of(&QComboBox::currentIndexChanged), [=](int index) {
+        trainResultModel->setSeatClass(static_cast<SeatClass>(index));
+    });
+    searchController = new SearchController(systemManager, trainResultModel);
+    connect(searchController, &SearchController::finished, this, &MainWindow::searchFinished);
     mainLayout->addWidget(trainResultTable);
 
     // Order History
     QGroupBox *historyGroup = new QGroupBox("My Orders");
     QVBoxLayout *historyLayout = new QVBoxLayout(historyGroup);
     
-    orderHistoryTable = new QTableWidget();
-    orderHistoryTable->setColumnCount(7);
-    orderHistoryTable->setHorizontalHeaderLabels({"Order ID", "Train", "Route", "Date", "Seats", "Status", "Action"});
+    orderHistoryModel = new OrderHistoryModel(this);
+    orderHistoryTable = new QTableView();
+    orderHistoryTable->setModel(orderHistoryModel);
+    orderHistoryTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    orderHistoryTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    orderHistoryTable->verticalHeader()->setDefaultSectionSize(30);
     orderHistoryTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    ActionDelegate *refundDelegate = new ActionDelegate(orderHistoryTable);
+    orderHistoryTable->setItemDelegateForColumn(OrderHistoryModel::COL_ACTION, refundDelegate);
+    connect(refundDelegate, &ActionDelegate::clicked, this, &MainWindow::refundOrder);
     
     historyLayout->addWidget(orderHistoryTable);
     mainLayout->addWidget(historyGroup);
@@ -199,10 +238,17 @@ void MainWindow::createAdminPage() {
     QHBoxLayout *topBar = new QHBoxLayout();
     topBar->addWidget(new QLabel("Admin Dashboard"));
     topBar->addStretch();
+    QPushButton *metricsBtn = new QPushButton("Metrics");
+    topBar->addWidget(metricsBtn);
+    QPushButton *memoryBtn = new QPushButton("Memory");
+    topBar->addWidget(memoryBtn);
     QPushButton *logoutBtn = new QPushButton("Logout");
     topBar->addWidget(logoutBtn);
     mainLayout->addLayout(topBar);
 
+    connect(metricsBtn, &QPushButton::clicked, this, &MainWindow::showMetrics);
+    connect(memoryBtn, &QPushButton::clicked, this, &MainWindow::showMemoryReport);
+
     connect(logoutBtn, &QPushButton::clicked, this, &MainWindow::handleLogout);
 
     // Train Management
@@ -250,6 +296,34 @@ void MainWindow::createAdminPage() {
     
     connect(addBtn, &QPushButton::clicked, this, &MainWindow::handleAddTrain);
 
+    // Occupancy Dashboard (updated from inventory events)
+    QGroupBox *occupancyGroup = new QGroupBox("Occupancy");
+    QVBoxLayout *occupancyLayout = new QVBoxLayout(occupancyGroup);
+    QHBoxLayout *occupancyBar = new QHBoxLayout();
+    occupancyDateInput = new QDateEdit(QDate::currentDate());
+    occupancyDateInput->setDisplayFormat("yyyy-MM-dd");
+    occupancyTotalsLabel = new QLabel();
+    occupancyBar->addWidget(new QLabel("Date:"));
+    occupancyBar->addWidget(occupancyDateInput);
+    occupancyBar->addStretch();
+    occupancyBar->addWidget(occupancyTotalsLabel);
+    occupancyLayout->addLayout(occupancyBar);
+
+    occupancyModel = new OccupancyModel(systemManager);
+    occupancyTable = new QTableView();
+    occupancyTable->setModel(occupancyModel);
+    occupancyTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    occupancyTable->verticalHeader()->setDefaultSectionSize(22);
+    occupancyTable->verticalHeader()->hide();
+    occupancyTable->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    occupancyTable->horizontalHeader()->setSectionResizeMode(OccupancyModel::COL_HEATMAP, QHeaderView::Stretch);
+    occupancyTable->setItemDelegateForColumn(OccupancyModel::COL_HEATMAP, new HeatmapDelegate(occupancyModel, occupancyTable));
+    occupancyLayout->addWidget(occupancyTable);
+    mainLayout->addWidget(occupancyGroup);
+
+    connect(occupancyDateInput, &QDateEdit::dateChanged, this, &MainWindow::showOccupancyDate);
+    connect(occupancyModel, &OccupancyModel::totalsChanged, this, &MainWindow::updateOccupancyTotals);
+
     stackedWidget->addWidget(adminPage);
 }
 
@@ -267,7 +341,8 @@ void MainWindow::handleLogin() {
     QString username = loginUsernameInput->text();
     QString password = loginPasswordInput->text();
 
-    auto user = systemManager.login(username.toStdString(), password.toStdString());
+    sessionToken = systemManager.login(username.toStdString(), password.toStdString());
+    auto user = systemManager.getSessionUser(sessionToken);
     if (user) {
         if (user->getRole() == "Admin") {
             updateAdminView();
@@ -285,7 +360,11 @@ void MainWindow::handleLogin() {
 }
 
 void MainWindow::handleLogout() {
-    systemManager.logout();
+    systemManager.logout(sessionToken);
+    sessionToken.clear();
+    liveSearchTimer->stop();
+    searchController->cancel();
+    orderHistoryModel->clear();
     showLoginPage();
 }
 
@@ -318,73 +397,69 @@ void MainWindow::handleSearch() {
         return;
     }
 
-    vector<Train> results = systemManager.searchTrains(start.toStdString(), end.toStdString(), date.toStdString());
+    liveSearchTimer->stop();
+    reportEmptySearch = true;
+    searchController->search(start.toStdString(), end.toStdString(), date.toStdString());
+}
 
-    trainResultTable->setRowCount(0);
-    for (auto& train : results) {
-        int row = trainResultTable->rowCount();
-        trainResultTable->insertRow(row);
-        
-        trainResultTable->setItem(row, 0, new QTableWidgetItem(QString::fromStdString(train.getId())));
-        trainResultTable->setItem(row, 1, new QTableWidgetItem(QString::fromStdString(train.getType())));
-        trainResultTable->setItem(row, 2, new QTableWidgetItem(QString::fromStdString(train.getDepartureTime(start.toStdString()))));
-        trainResultTable->setItem(row, 3, new QTableWidgetItem(QString::fromStdString(train.getArrivalTime(end.toStdString()))));
-        
-        double price = train.getPrice(start.toStdString(), end.toStdString());
-        trainResultTable->setItem(row, 4, new QTableWidgetItem(QString::number(price)));
-
-        QPushButton *bookBtn = new QPushButton("Book");
-        connect(bookBtn, &QPushButton::clicked, [=]() {
-            if (systemManager.bookTicket(train.getId(), start.toStdString(), end.toStdString(), date.toStdString())) {
-                QMessageBox::information(this, "Success", "Ticket Booked Successfully!");
-                refreshOrderTable();
-            } else {
-                QMessageBox::warning(this, "Failed", "Booking Failed (No seats or error)");
-            }
-        });
-        trainResultTable->setCellWidget(row, 5, bookBtn);
+/**
+ * @brief Restarts the debounce timer; the search runs once typing pauses.
+ */
+void MainWindow::scheduleLiveSearch() {
+    if (liveSearchCheck->isChecked()) liveSearchTimer->start();
+}
+
+void MainWindow::runLiveSearch() {
+    QString start = searchStartInput->text().trimmed();
+    QString end = searchEndInput->text().trimmed();
+    if (start.isEmpty() || end.isEmpty()) {
+        searchController->cancel();
+        return;
     }
-    
-    if (results.empty()) {
+    reportEmptySearch = false;
+    searchController->search(start.toStdString(), end.toStdString(),
+                             searchDateInput->date().toString("yyyy-MM-dd").toStdString());
+}
+
+void MainWindow::searchFinished(int resultCount) {
+    if (resultCount == 0 && reportEmptySearch) {
         QMessageBox::information(this, "No Results", "No trains found for this route.");
     }
+    reportEmptySearch = false;
 }
 
+/**
+ * @brief Syncs the order history model; only changed and new rows reach the view.
+ */
 void MainWindow::refreshOrderTable() {
-    auto user = systemManager.getCurrentUser();
-    if (!user || user->getRole() != "Passenger") return;
-
-    Passenger* p = dynamic_cast<Passenger*>(user.get());
-    vector<Order>& orders = p->getOrders();
-
-    orderHistoryTable->setRowCount(0);
-    for (auto& order : orders) {
-        int row = orderHistoryTable->rowCount();
-        orderHistoryTable->insertRow(row);
-
-        orderHistoryTable->setItem(row, 0, new QTableWidgetItem(QString::fromStdString(order.getOrderId())));
-        orderHistoryTable->setItem(row, 1, new QTableWidgetItem(QString::fromStdString(order.getTrainId())));
-        orderHistoryTable->setItem(row, 2, new QTableWidgetItem(QString::fromStdString(order.getStartStation() + "->" + order.getEndStation())));
-        orderHistoryTable->setItem(row, 3, new QTableWidgetItem(QString::fromStdString(order.getDate())));
-        orderHistoryTable->setItem(row, 4, new QTableWidgetItem(QString::number(order.getTicketCount())));
-        
-        QString statusStr = (order.getStatus() == PAID) ? "Paid" : (order.getStatus() == CANCELLED ? "Cancelled" : "Completed");
-        orderHistoryTable->setItem(row, 5, new QTableWidgetItem(statusStr));
-
-        if (order.getStatus() == PAID) {
-            QPushButton *refundBtn = new QPushButton("Refund");
-            connect(refundBtn, &QPushButton::clicked, [=]() {
-                if (systemManager.refundTicket(order.getOrderId())) {
-                    QMessageBox::information(this, "Success", "Refund Successful");
-                    refreshOrderTable();
-                } else {
-                    QMessageBox::warning(this, "Error", "Refund Failed");
-                }
-            });
-            orderHistoryTable->setCellWidget(row, 6, refundBtn);
-        } else {
-             orderHistoryTable->setItem(row, 6, new QTableWidgetItem("-"));
-        }
+    auto user = systemManager.getSessionUser(sessionToken);
+    if (!user || user->getRole() != "Passenger") {
+        orderHistoryModel->clear();
+        return;
+    }
+
+    orderHistoryModel->syncOrders(systemManager.getOrders(sessionToken));
+}
+
+void MainWindow::bookResult(const QModelIndex &index) {
+    const TrainResultModel::Row& row = trainResultModel->rowAt(index.row());
+    if (systemManager.bookTicket(sessionToken, row.trainId.toStdString(), trainResultModel->getStart(),
+                                 trainResultModel->getEnd(), trainResultModel->getDate(), 1,
+                                 trainResultModel->getSeatClass())) {
+        QMessageBox::information(this, "Success", "Ticket Booked Successfully!");
+        refreshOrderTable();
+    } else {
+        QMessageBox::warning(this, "Failed", "Booking Failed (No seats or error)");
+    }
+}
+
+void MainWindow::refundOrder(const QModelIndex &index) {
+    string orderId = orderHistoryModel->rowAt(index.row()).orderId;
+    if (systemManager.refundTicket(sessionToken, orderId)) {
+        orderHistoryModel->setOrderStatus(orderId, CANCELLED);
+        QMessageBox::information(this, "Success", "Refund Successful");
+    } else {
+        QMessageBox::warning(this, "Error", "Refund Failed");
     }
 }
 
@@ -399,8 +474,8 @@ void MainWindow::handleAddTrain() {
     Train t(id.toStdString(), type.toStdString(), seats);
     
     if (mode == 0) { // Default
-        t.addStop({"Beijing", "08:00", "08:00", 0.0, 0});
-        t.addStop({"Shanghai", "13:00", "13:00", 500.0, 1300});
+        t.addStop({"Beijing", 8 * 60, 8 * 60, 0.0, 0});
+        t.addStop({"Shanghai", 13 * 60, 13 * 60, 500.0, 1300});
     } 
     else if (mode == 1) { // Random
         vector<string> cities = {"Beijing", "Shanghai", "Guangzhou", "Shenzhen", "Chengdu", "Xian", "Wuhan", "Nanjing", "Hangzhou", "Tianjin"};
@@ -411,17 +486,15 @@ void MainWindow::handleAddTrain() {
         
         int numStops = 2 + (rd() % 4); // 2 to 5 stops
         
-        int currentHour = 8;
+        int currentMinutes = 8 * 60; // Later stops may run past midnight
         int currentDist = 0;
         double currentPrice = 0.0;
         
         for (int i = 0; i < numStops; ++i) {
-            string arrTime = (currentHour < 10 ? "0" : "") + std::to_string(currentHour) + ":00";
-            string depTime = arrTime; // Simplified: arrive and depart same time
+            // Simplified: arrive and depart same time
+            t.addStop({cities[i], currentMinutes, currentMinutes, currentPrice, currentDist});
             
-            t.addStop({cities[i], arrTime, depTime, currentPrice, currentDist});
-            
-            currentHour += 2 + (rd() % 3); // +2 to 4 hours
+            currentMinutes += (2 + (rd() % 3)) * 60; // +2 to 4 hours
             currentDist += 300 + (rd() % 500);
             currentPrice += 100.0 + (rd() % 200);
         }
@@ -441,24 +514,22 @@ void MainWindow::handleAddTrain() {
             return;
         }
         
-        int currentHour = 8;
+        int currentMinutes = 8 * 60;
         int currentDist = 0;
         double currentPrice = 0.0;
         
         for (int i = 0; i < stations.size(); ++i) {
-            string arrTime = (currentHour < 10 ? "0" : "") + std::to_string(currentHour) + ":00";
-            string depTime = arrTime;
-            
-            t.addStop({stations[i].toStdString(), arrTime, depTime, currentPrice, currentDist});
+            t.addStop({stations[i].toStdString(), currentMinutes, currentMinutes, currentPrice, currentDist});
             
-            currentHour += 3; // Fixed 3 hours between stations
+            currentMinutes += 3 * 60; // Fixed 3 hours between stations
             currentDist += 400;
             currentPrice += 150.0;
         }
     }
     
     systemManager.addTrain(t);
-    refreshTrainTable();
+    appendTrainRow(t);
+    occupancyModel->addTrain(t);
     QMessageBox::information(this, "Success", "Train Added Successfully");
 }
 
@@ -466,24 +537,58 @@ void MainWindow::refreshTrainTable() {
     const auto& trains = systemManager.getAllTrains();
     allTrainsTable->setRowCount(0);
     for (const auto& pair : trains) {
-        const Train& t = pair.second;
-        int row = allTrainsTable->rowCount();
-        allTrainsTable->insertRow(row);
-        
-        allTrainsTable->setItem(row, 0, new QTableWidgetItem(QString::fromStdString(t.getId())));
-        allTrainsTable->setItem(row, 1, new QTableWidgetItem(QString::fromStdString(t.getType())));
-        allTrainsTable->setItem(row, 2, new QTableWidgetItem(QString::number(t.getTotalSeats())));
-        
-        QString routeStr;
-        const auto& route = t.getRoute();
-        for (size_t i = 0; i < route.size(); ++i) {
-            routeStr += QString::fromStdString(route[i].stationName);
-            if (i < route.size() - 1) {
-                routeStr += "->";
-            }
+        appendTrainRow(pair.second);
+    }
+}
+
+void MainWindow::appendTrainRow(const Train& t) {
+    int row = allTrainsTable->rowCount();
+    allTrainsTable->insertRow(row);
+    
+    allTrainsTable->setItem(row, 0, new QTableWidgetItem(QString::fromStdString(t.getId())));
+    allTrainsTable->setItem(row, 1, new QTableWidgetItem(QString::fromStdString(t.getType())));
+    allTrainsTable->setItem(row, 2, new QTableWidgetItem(QString::number(t.getTotalSeats())));
+    
+    QString routeStr;
+    const auto& route = t.getRoute();
+    for (size_t i = 0; i < route.size(); ++i) {
+        routeStr += QString::fromStdString(route[i].stationName);
+        if (i < route.size() - 1) {
+            routeStr += "->";
         }
-        allTrainsTable->setItem(row, 3, new QTableWidgetItem(routeStr));
     }
+    allTrainsTable->setItem(row, 3, new QTableWidgetItem(routeStr));
+}
+
+/**
+ * @brief Takes one occupancy snapshot for the chosen date; events keep it current.
+ */
+void MainWindow::showOccupancyDate() {
+    occupancyModel->setDate(occupancyDateInput->date().toString("yyyy-MM-dd").toStdString());
+}
+
+void MainWindow::updateOccupancyTotals(int sold, int capacity) {
+    occupancyTotalsLabel->setText(QString("Sold %1 of %2 seats (busiest segment per train)").arg(sold).arg(capacity));
+}
+
+/**
+ * @brief Shows call latencies and booking outcomes in a dialog.
+ */
+void MainWindow::showMetrics() {
+    QMessageBox box(this);
+    box.setWindowTitle("Metrics");
+    box.setText("<pre>" + QString::fromStdString(systemManager.getMetricsSnapshot().toText()).toHtmlEscaped() + "</pre>");
+    box.exec();
+}
+
+/**
+ * @brief Shows memory used per subsystem and by the largest trains.
+ */
+void MainWindow::showMemoryReport() {
+    QMessageBox box(this);
+    box.setWindowTitle("Memory");
+    box.setText("<pre>" + QString::fromStdString(systemManager.getMemoryReport().toText()).toHtmlEscaped() + "</pre>");
+    box.exec();
 }
 
 void MainWindow::updatePassengerView() {
@@ -492,4 +597,5 @@ void MainWindow::updatePassengerView() {
 
 void MainWindow::updateAdminView() {
     refreshTrainTable();
+    showOccupancyDate();
 }
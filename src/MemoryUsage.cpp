@@ -0,0 +1,87 @@
+/**
+ * @file MemoryUsage.cpp
+ * @brief Formatting of memory reports.
+ */
+
+#include "MemoryUsage.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+string formatBytes(size_t bytes) {
+    const char* units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    double value = static_cast<double>(bytes);
+    int unit = 0;
+    while (value >= 1024 && unit < 4) {
+        value /= 1024;
+        ++unit;
+    }
+    stringstream ss;
+    ss << fixed << setprecision(unit == 0 ? 0 : 1) << value << " " << units[unit];
+    return ss.str();
+}
+
+} // namespace
+
+string MemoryReport::toText(size_t topTrains) const {
+    stringstream ss;
+    ss << left;
+    auto line = [&ss](const string& name, size_t bytes) {
+        ss << "  " << setw(14) << name << right << setw(12) << formatBytes(bytes) << left << "\n";
+    };
+    ss << "Memory by subsystem:\n";
+    line("trains", trains);
+    line("routes", routes);
+    line("inventory", inventory);
+    line("users", users);
+    line("orders", orders);
+    line("order indexes", orderIndex);
+    line("station index", stationIndex);
+    line("timetable", timetable);
+    line("sessions", sessions);
+    line("total", total());
+    ss << "  (" << perTrain.size() << " trains, " << orderCount << " orders)\n";
+    ss << "  (" << routeCount << " distinct routes; " << formatBytes(unsharedRoutes) << " without sharing)\n";
+
+    size_t shown = min(topTrains, perTrain.size());
+    if (shown > 0) {
+        ss << "Largest trains:\n";
+        for (size_t i = 0; i < shown; ++i) {
+            const TrainMemory& t = perTrain[i];
+            ss << "  " << setw(10) << t.trainId << " route " << setw(10) << formatBytes(t.routeBytes)
+               << " inventory " << setw(10) << formatBytes(t.inventoryBytes)
+               << " (" << t.inventoryDates << " dates)\n";
+        }
+    }
+    return ss.str();
+}
+
+string MemoryReport::toJson(size_t topTrains) const {
+    stringstream ss;
+    ss << "{\"trains\":" << trains
+       << ",\"routes\":" << routes
+       << ",\"inventory\":" << inventory
+       << ",\"users\":" << users
+       << ",\"orders\":" << orders
+       << ",\"order_index\":" << orderIndex
+       << ",\"station_index\":" << stationIndex
+       << ",\"timetable\":" << timetable
+       << ",\"sessions\":" << sessions
+       << ",\"total\":" << total()
+       << ",\"train_count\":" << perTrain.size()
+       << ",\"order_count\":" << orderCount
+       << ",\"route_count\":" << routeCount
+       << ",\"routes_unshared\":" << unsharedRoutes
+       << ",\"largest_trains\":[";
+    size_t shown = min(topTrains, perTrain.size());
+    for (size_t i = 0; i < shown; ++i) {
+        const TrainMemory& t = perTrain[i];
+        if (i > 0) ss << ",";
+        ss << "{\"train\":\"" << t.trainId << "\",\"route\":" << t.routeBytes
+           << ",\"inventory\":" << t.inventoryBytes << ",\"dates\":" << t.inventoryDates << "}";
+    }
+    ss << "]}";
+    return ss.str();
+}
@@ -0,0 +1,253 @@
+/**
+ * @file Metrics.cpp
+ * @brief Implementation of latency histograms and per-thread metric slots.
+ */
+
+#include "Metrics.h"
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+/// Source of Metrics::instanceId
+atomic<uint64_t> nextInstanceId{1};
+
+/// The slot this thread used last, and the instance it belongs to
+struct CachedSlot {
+    uint64_t instanceId = 0;
+    void* slot = nullptr;
+};
+thread_local CachedSlot cachedSlot;
+
+/**
+ * @brief Increments a counter that only the calling thread writes.
+ * A load and a store are enough; no read-modify-write instruction needed.
+ */
+inline void bump(atomic<uint64_t>& counter, uint64_t by = 1) {
+    counter.store(counter.load(memory_order_relaxed) + by, memory_order_relaxed);
+}
+
+/// JSON key for a booking status
+const char* bookingStatusKey(int status) {
+    switch (status) {
+        case BOOKED: return "booked";
+        case NOT_LOGGED_IN: return "not_logged_in";
+        case UNKNOWN_TRAIN: return "unknown_train";
+        case INVALID_STATIONS: return "invalid_stations";
+        case SOLD_OUT: return "sold_out";
+        case INVALID_COUNT: return "invalid_count";
+        case REJECTED_BUSY: return "rejected_busy";
+        case NOT_RUNNING: return "not_running";
+        case RETRY_LATER: return "retry_later";
+        case INVALID_DATE: return "invalid_date";
+    }
+    return "unknown";
+}
+
+/// Position of the highest set bit (ns != 0)
+inline int highestBit(uint64_t ns) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(ns);
+#else
+    int bit = 0;
+    while (ns >>= 1) ++bit;
+    return bit;
+#endif
+}
+
+string formatMicros(uint64_t ns) {
+    stringstream ss;
+    ss << fixed << setprecision(1) << ns / 1000.0;
+    return ss.str();
+}
+
+} // namespace
+
+const char* metricOpName(MetricOp op) {
+    switch (op) {
+        case METRIC_SEARCH: return "search";
+        case METRIC_BOOK: return "book";
+        case METRIC_REFUND: return "refund";
+        case METRIC_LOGIN: return "login";
+        case METRIC_REGISTER: return "register";
+        case METRIC_OP_COUNT: break;
+    }
+    return "unknown";
+}
+
+// LatencyHistogram
+
+size_t LatencyHistogram::bucketIndex(uint64_t ns) {
+    if (ns < static_cast<uint64_t>(SUB_BUCKETS)) return static_cast<size_t>(ns);
+    int magnitude = highestBit(ns);
+    if (magnitude > MAX_MAGNITUDE) return BUCKET_COUNT - 1;
+    int shift = magnitude - SUB_BUCKET_BITS;
+    size_t sub = static_cast<size_t>(ns >> shift) & (SUB_BUCKETS - 1);
+    return static_cast<size_t>(magnitude - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::bucketLowerBound(size_t index) {
+    if (index < static_cast<size_t>(SUB_BUCKETS)) return index;
+    size_t group = index / SUB_BUCKETS;
+    uint64_t sub = index % SUB_BUCKETS;
+    return (SUB_BUCKETS + sub) << (group - 1);
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+    ++counts[bucketIndex(ns)];
+    ++total;
+    sum += ns;
+    if (ns > maxValue) maxValue = ns;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < counts.size(); ++i) counts[i] += other.counts[i];
+    total += other.total;
+    sum += other.sum;
+    if (other.maxValue > maxValue) maxValue = other.maxValue;
+}
+
+uint64_t LatencyHistogram::percentile(double q) const {
+    if (total == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(q * (total - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) return bucketLowerBound(i);
+    }
+    return maxValue;
+}
+
+// MetricsSnapshot
+
+string MetricsSnapshot::toText() const {
+    stringstream ss;
+    ss << left << setw(10) << "operation" << right << setw(10) << "count" << setw(10) << "failed"
+       << setw(11) << "mean(us)" << setw(10) << "p50(us)" << setw(10) << "p99(us)"
+       << setw(11) << "p999(us)" << setw(10) << "max(us)" << "\n";
+    for (int op = 0; op < METRIC_OP_COUNT; ++op) {
+        const LatencyHistogram& h = latency[op];
+        ss << left << setw(10) << metricOpName(static_cast<MetricOp>(op)) << right
+           << setw(10) << h.getCount() << setw(10) << failures[op]
+           << setw(11) << formatMicros(static_cast<uint64_t>(h.getMean()))
+           << setw(10) << formatMicros(h.percentile(0.50))
+           << setw(10) << formatMicros(h.percentile(0.99))
+           << setw(11) << formatMicros(h.percentile(0.999))
+           << setw(10) << formatMicros(h.getMax()) << "\n";
+    }
+    ss << "booking outcomes:";
+    for (int s = 0; s < BOOKING_STATUS_COUNT; ++s) {
+        ss << " " << bookingStatusKey(s) << "=" << bookingOutcomes[s];
+    }
+    ss << "\n";
+    return ss.str();
+}
+
+string MetricsSnapshot::toJson() const {
+    stringstream ss;
+    ss << fixed << setprecision(1) << "{\"operations\":{";
+    for (int op = 0; op < METRIC_OP_COUNT; ++op) {
+        const LatencyHistogram& h = latency[op];
+        if (op > 0) ss << ",";
+        ss << "\"" << metricOpName(static_cast<MetricOp>(op)) << "\":{"
+           << "\"count\":" << h.getCount()
+           << ",\"failed\":" << failures[op]
+           << ",\"mean_ns\":" << h.getMean()
+           << ",\"p50_ns\":" << h.percentile(0.50)
+           << ",\"p90_ns\":" << h.percentile(0.90)
+           << ",\"p99_ns\":" << h.percentile(0.99)
+           << ",\"p999_ns\":" << h.percentile(0.999)
+           << ",\"max_ns\":" << h.getMax() << "}";
+    }
+    ss << "},\"booking_outcomes\":{";
+    for (int s = 0; s < BOOKING_STATUS_COUNT; ++s) {
+        if (s > 0) ss << ",";
+        ss << "\"" << bookingStatusKey(s) << "\":" << bookingOutcomes[s];
+    }
+    ss << "}}";
+    return ss.str();
+}
+
+// Metrics
+
+/**
+ * @brief One thread's counters. Written by its thread only, read by snapshot().
+ */
+struct alignas(64) Metrics::Slot {
+    atomic<uint64_t> buckets[METRIC_OP_COUNT][LatencyHistogram::BUCKET_COUNT];
+    atomic<uint64_t> sum[METRIC_OP_COUNT];
+    atomic<uint64_t> maxValue[METRIC_OP_COUNT];
+    atomic<uint64_t> failures[METRIC_OP_COUNT];
+    atomic<uint64_t> bookings[BOOKING_STATUS_COUNT];
+
+    Slot() {
+        for (auto& row : buckets) {
+            for (auto& b : row) b.store(0, memory_order_relaxed);
+        }
+        for (int op = 0; op < METRIC_OP_COUNT; ++op) {
+            sum[op].store(0, memory_order_relaxed);
+            maxValue[op].store(0, memory_order_relaxed);
+            failures[op].store(0, memory_order_relaxed);
+        }
+        for (auto& b : bookings) b.store(0, memory_order_relaxed);
+    }
+};
+
+Metrics::Metrics() : instanceId(nextInstanceId.fetch_add(1)) {}
+
+Metrics::~Metrics() = default;
+
+Metrics::Slot& Metrics::localSlot() {
+    if (cachedSlot.instanceId == instanceId) return *static_cast<Slot*>(cachedSlot.slot);
+    return registerThread();
+}
+
+/**
+ * @brief Finds or creates the calling thread's slot and caches it.
+ * Runs once per thread, plus whenever a thread alternates between instances.
+ */
+Metrics::Slot& Metrics::registerThread() {
+    lock_guard<mutex> lock(slotsMutex);
+    Slot*& slot = slotOfThread[this_thread::get_id()];
+    if (!slot) {
+        slots.push_back(make_unique<Slot>());
+        slot = slots.back().get();
+    }
+    cachedSlot.instanceId = instanceId;
+    cachedSlot.slot = slot;
+    return *slot;
+}
+
+void Metrics::recordLatency(MetricOp op, uint64_t ns, bool ok) {
+    Slot& slot = localSlot();
+    bump(slot.buckets[op][LatencyHistogram::bucketIndex(ns)]);
+    bump(slot.sum[op], ns);
+    if (ns > slot.maxValue[op].load(memory_order_relaxed)) slot.maxValue[op].store(ns, memory_order_relaxed);
+    if (!ok) bump(slot.failures[op]);
+}
+
+void Metrics::recordBooking(BookingStatus status) {
+    bump(localSlot().bookings[status]);
+}
+
+MetricsSnapshot Metrics::snapshot() const {
+    MetricsSnapshot snap;
+    lock_guard<mutex> lock(slotsMutex);
+    for (const auto& slot : slots) {
+        for (int op = 0; op < METRIC_OP_COUNT; ++op) {
+            LatencyHistogram& h = snap.latency[op];
+            for (size_t i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i) {
+                uint64_t n = slot->buckets[op][i].load(memory_order_relaxed);
+                h.counts[i] += n;
+                h.total += n;
+            }
+            h.sum += slot->sum[op].load(memory_order_relaxed);
+            h.maxValue = max(h.maxValue, slot->maxValue[op].load(memory_order_relaxed));
+            snap.failures[op] += slot->failures[op].load(memory_order_relaxed);
+        }
+        for (int s = 0; s < BOOKING_STATUS_COUNT; ++s) {
+            snap.bookingOutcomes[s] += slot->bookings[s].load(memory_order_relaxed);
+        }
+    }
+    return snap;
+}
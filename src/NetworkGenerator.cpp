@@ -0,0 +1,83 @@
+/**
+ * @file NetworkGenerator.cpp
+ * @brief Implementation of the synthetic network generator.
+ */
+
+#include "NetworkGenerator.h"
+#include "SystemManager.h"
+#include "Calendar.h"
+#include <cstdio>
+#include <algorithm>
+
+string NetworkGenerator::stationName(int index) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "ST%05d", index);
+    return buf;
+}
+
+string NetworkGenerator::trainId(int index) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "T%06d", index);
+    return buf;
+}
+
+string NetworkGenerator::addDays(const string& date, int days) {
+    return Calendar::addDays(date, days);
+}
+
+NetworkGenerator::NetworkGenerator(const NetworkConfig& cfg) : config(cfg) {
+    config.stations = max(2, config.stations);
+    config.stopsPerTrain = max(2, min(config.stopsPerTrain, config.stations));
+    config.daysOnSale = max(1, config.daysOnSale);
+
+    for (int i = 0; i < config.daysOnSale; ++i) {
+        dates.push_back(addDays(config.firstDate, i));
+    }
+
+    mt19937 rng(config.seed);
+    const char* types[] = {"High-Speed", "Express", "Normal"};
+    trains.reserve(config.trains);
+    for (int i = 0; i < config.trains; ++i) {
+        Train t(trainId(i), types[rng() % 3], config.seatsPerTrain);
+
+        // Drawn only when enabled, so networks without sharing stay the same for a seed
+        if (config.sharedPatternPercent > 0 && i > 0 && static_cast<int>(rng() % 100) < config.sharedPatternPercent) {
+            const Train& pattern = trains[rng() % i];
+            t.setRoute(pattern.getSharedRoute(), (5 + rng() % 16) * 60);
+            trains.push_back(t);
+            continue;
+        }
+
+        int station = rng() % config.stations;
+        int minutes = (5 + rng() % 16) * 60;   // first departure between 05:00 and 20:00
+        double price = 0.0;
+        int distance = 0;
+        // Strides are capped so a route never laps the ring and revisits a station
+        int maxStride = max(1, min(3, (config.stations - 1) / (config.stopsPerTrain - 1)));
+        for (int s = 0; s < config.stopsPerTrain; ++s) {
+            int dwell = (s == 0 || s == config.stopsPerTrain - 1) ? 0 : 2 + rng() % 4;
+            t.addStop({stationName(station), minutes, minutes + dwell, price, distance});
+
+            int stride = 1 + rng() % maxStride;
+            int hopKm = 40 + rng() % 160;
+            station = (station + stride) % config.stations;
+            minutes += dwell + hopKm / 3 + 5;
+            distance += hopKm;
+            price += hopKm * 0.45;
+        }
+        trains.push_back(t);
+    }
+}
+
+void NetworkGenerator::populate(SystemManager& system) const {
+    system.addTrains(vector<Train>(trains));
+}
+
+NetworkGenerator::Trip NetworkGenerator::randomTrip(mt19937& rng) const {
+    size_t index = rng() % trains.size();
+    const Train& t = trains[index];
+    const vector<Stop>& route = t.getRoute();
+    int from = rng() % (route.size() - 1);
+    int to = from + 1 + rng() % (route.size() - 1 - from);
+    return {index, t.getId(), route[from].stationName, route[to].stationName, dates[rng() % dates.size()]};
+}
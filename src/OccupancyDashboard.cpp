@@ -0,0 +1,189 @@
+/**
+ * @file OccupancyDashboard.cpp
+ * @brief Implementation of the occupancy model and heatmap delegate.
+ */
+
+#include "OccupancyDashboard.h"
+#include <QMetaObject>
+#include <QPainter>
+#include <QTimer>
+#include <algorithm>
+#include <unordered_set>
+
+// ---------------- OccupancyModel ----------------
+
+OccupancyModel::OccupancyModel(SystemManager& sys, QObject *parent)
+    : QAbstractTableModel(parent), system(sys) {
+    system.addInventoryListener(this);
+}
+
+OccupancyModel::~OccupancyModel() {
+    system.removeInventoryListener(this);
+}
+
+/**
+ * @brief Events queued before the snapshot are filtered by version in flush().
+ */
+void OccupancyModel::setDate(const string& newDate) {
+    {
+        lock_guard<mutex> lock(pendingMutex);
+        watchedDate = newDate;
+        pending.clear();
+    }
+    vector<TrainOccupancy> snapshot = system.getOccupancy(newDate);
+
+    beginResetModel();
+    date = newDate;
+    rows.clear();
+    rowOfTrain.clear();
+    totalSold = totalCapacity = 0;
+    rows.reserve(snapshot.size());
+    for (TrainOccupancy& t : snapshot) {
+        appendRow(t.trainId, t.totalSeats, move(t.freeSeats), t.version);
+    }
+    endResetModel();
+    emit totalsChanged(totalSold, totalCapacity);
+}
+
+void OccupancyModel::addTrain(const Train& train) {
+    if (rowOfTrain.count(train.getId())) return;
+    int segments = train.getRoute().empty() ? 0 : static_cast<int>(train.getRoute().size()) - 1;
+    int row = static_cast<int>(rows.size());
+    beginInsertRows(QModelIndex(), row, row);
+    appendRow(train.getId(), train.getTotalSeats(), vector<int>(segments, train.getTotalSeats()),
+              train.getInventoryVersion());
+    endInsertRows();
+    emit totalsChanged(totalSold, totalCapacity);
+}
+
+int OccupancyModel::appendRow(const string& trainId, int totalSeats, vector<int> freeSeats, uint64_t version) {
+    int row = static_cast<int>(rows.size());
+    rows.push_back({QString::fromStdString(trainId), totalSeats, move(freeSeats), version, 0, 0});
+    summarize(rows.back());
+    rowOfTrain[trainId] = row;
+    totalSold += rows.back().sold;
+    totalCapacity += totalSeats;
+    return row;
+}
+
+void OccupancyModel::summarize(Row& row) {
+    int minFree = row.totalSeats;
+    for (int free : row.freeSeats) minFree = min(minFree, free);
+    row.remaining = row.freeSeats.empty() ? 0 : minFree;
+    row.sold = row.freeSeats.empty() ? 0 : row.totalSeats - minFree;
+}
+
+void OccupancyModel::onInventoryChange(const InventoryEvent& event) {
+    lock_guard<mutex> lock(pendingMutex);
+    if (event.date != watchedDate) return;
+    pending.push_back(event);
+    if (flushScheduled) return;
+    flushScheduled = true;
+    // Timers can only be started from the GUI thread
+    QMetaObject::invokeMethod(this, [this] {
+        QTimer::singleShot(OCCUPANCY_FRAME_MS, this, &OccupancyModel::flush);
+    }, Qt::QueuedConnection);
+}
+
+/**
+ * @brief Applies one frame's events and signals the smallest row range covering them.
+ */
+void OccupancyModel::flush() {
+    vector<InventoryEvent> events;
+    {
+        lock_guard<mutex> lock(pendingMutex);
+        events.swap(pending);
+        flushScheduled = false;
+    }
+
+    // Trains added after the snapshot get a row first; their inventory started full
+    vector<const InventoryEvent*> newTrains;
+    unordered_set<string> seen;
+    for (const InventoryEvent& e : events) {
+        if (e.date == date && !rowOfTrain.count(e.trainId) && seen.insert(e.trainId).second) {
+            newTrains.push_back(&e);
+        }
+    }
+    if (!newTrains.empty()) {
+        int first = static_cast<int>(rows.size());
+        beginInsertRows(QModelIndex(), first, first + static_cast<int>(newTrains.size()) - 1);
+        for (const InventoryEvent* e : newTrains) {
+            appendRow(e->trainId, e->totalSeats, vector<int>(e->segmentCount, e->totalSeats), 0);
+        }
+        endInsertRows();
+    }
+
+    int firstChanged = static_cast<int>(rows.size());
+    int lastChanged = -1;
+    for (const InventoryEvent& e : events) {
+        if (e.date != date) continue;
+        int row = rowOfTrain[e.trainId];
+        Row& r = rows[row];
+        if (e.version <= r.version) continue;
+        r.version = e.version;
+        for (int i = e.startSegment; i < e.endSegment && i < static_cast<int>(r.freeSeats.size()); ++i) {
+            r.freeSeats[i] = max(0, min(r.totalSeats, r.freeSeats[i] + e.delta));
+        }
+        int oldSold = r.sold;
+        summarize(r);
+        totalSold += r.sold - oldSold;
+        firstChanged = min(firstChanged, row);
+        lastChanged = max(lastChanged, row);
+    }
+
+    if (lastChanged >= 0) {
+        emit dataChanged(index(firstChanged, 0), index(lastChanged, COLUMN_COUNT - 1));
+    }
+    emit totalsChanged(totalSold, totalCapacity);
+}
+
+int OccupancyModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : static_cast<int>(rows.size());
+}
+
+int OccupancyModel::columnCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : COLUMN_COUNT;
+}
+
+QVariant OccupancyModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= static_cast<int>(rows.size())) return QVariant();
+    const Row& r = rows[index.row()];
+    if (role == Qt::TextAlignmentRole && index.column() != COL_TRAIN) return int(Qt::AlignCenter);
+    if (role != Qt::DisplayRole) return QVariant();
+    switch (index.column()) {
+        case COL_TRAIN: return r.trainId;
+        case COL_SOLD: return r.sold;
+        case COL_REMAINING: return r.remaining;
+        case COL_LOAD: return r.totalSeats > 0 ? QString("%1%").arg(100 * r.sold / r.totalSeats) : QString("-");
+        default: return QVariant();
+    }
+}
+
+QVariant OccupancyModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) return QVariant();
+    static const char* labels[COLUMN_COUNT] = {"Train ID", "Sold", "Remaining", "Peak Load", "Segment Load"};
+    return section >= 0 && section < COLUMN_COUNT ? QString(labels[section]) : QVariant();
+}
+
+// ---------------- HeatmapDelegate ----------------
+
+HeatmapDelegate::HeatmapDelegate(const OccupancyModel *occupancy, QObject *parent)
+    : QStyledItemDelegate(parent), model(occupancy) {}
+
+void HeatmapDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const {
+    const OccupancyModel::Row& row = model->rowAt(index.row());
+    int segments = static_cast<int>(row.freeSeats.size());
+    if (segments == 0 || row.totalSeats <= 0) return;
+
+    QRect area = option.rect.adjusted(2, 3, -2, -3);
+    painter->save();
+    for (int i = 0; i < segments; ++i) {
+        int left = area.left() + area.width() * i / segments;
+        int right = area.left() + area.width() * (i + 1) / segments;
+        double load = 1.0 - static_cast<double>(row.freeSeats[i]) / row.totalSeats;
+        // Hue 120 (green) when empty down to 0 (red) when full
+        QColor color = QColor::fromHsv(static_cast<int>(120 * (1.0 - load)), 200, 230);
+        painter->fillRect(QRect(left, area.top(), max(1, right - left - 1), area.height()), color);
+    }
+    painter->restore();
+}
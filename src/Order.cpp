@@ -4,40 +4,61 @@
  */
 
 #include "Order.h"
-#include <sstream>
-#include <iomanip>
+#include "MemoryUsage.h"
+#include "Calendar.h"
+#include "Tracing.h"
+#include <cstdio>
+#include <atomic>
 
 /**
  * @brief Constructor.
  * Initializes order details and generates a unique ID.
  */
-Order::Order(string uName, string tId, string start, string end, string d, string time, double p, int count)
-    : username(uName), trainId(tId), startStation(start), endStation(end), 
-      date(d), departureTime(time), price(p), ticketCount(count), status(PAID) {
+Order::Order(string uName, string tId, string start, string end, string d, int departure, Money p, int count, SeatClass seat)
+    : username(move(uName)), trainId(move(tId)), startStation(move(start)), endStation(move(end)),
+      date(move(d)), departureMinutes(departure), price(p), ticketCount(count), seatClass(seat), status(PAID) {
     orderId = generateOrderId();
     createTime = std::time(nullptr);
 }
 
+Order::Order(string uName, string tId, string start, string end, string d, int departure, Money p, int count, string id, time_t created,
+             SeatClass seat)
+    : orderId(move(id)), username(move(uName)), trainId(move(tId)), startStation(move(start)), endStation(move(end)),
+      date(move(d)), departureMinutes(departure), price(p), ticketCount(count), seatClass(seat), status(PAID), createTime(created) {}
+
 /**
  * @brief Generates a unique order ID.
  * Format: YYYYMMDDHHMMSS + 4-digit counter.
  * @return String ID.
  */
 string Order::generateOrderId() {
-    static int counter = 0;
-    time_t now = time(nullptr);
-    tm* ltm = localtime(&now);
-    
-    stringstream ss;
-    ss << (1900 + ltm->tm_year) 
-       << setfill('0') << setw(2) << (1 + ltm->tm_mon)
-       << setw(2) << ltm->tm_mday
-       << setw(2) << ltm->tm_hour
-       << setw(2) << ltm->tm_min
-       << setw(2) << ltm->tm_sec
-       << setw(4) << (++counter);
-    
-    return ss.str();
+    // Orders may be created from several sessions at once
+    static atomic<unsigned> counter{0};
+    return generateOrderId(time(nullptr), ++counter);
+}
+
+/**
+ * @brief Formatted into a stack buffer: the returned string is the only allocation.
+ */
+string Order::generateOrderId(time_t now, unsigned sequence) {
+    TRACE_SPAN("Order::generateOrderId");
+    tm ltm;
+#ifdef _WIN32
+    localtime_s(&ltm, &now);
+#else
+    localtime_r(&now, &ltm);
+#endif
+
+    char buf[40];
+    int len = snprintf(buf, sizeof(buf), "%04d%02d%02d%02d%02d%02d%04u", 1900 + ltm.tm_year, 1 + ltm.tm_mon,
+                       ltm.tm_mday, ltm.tm_hour, ltm.tm_min, ltm.tm_sec, sequence);
+    return string(buf, len);
+}
+
+size_t Order::getHeapBytes() const {
+    using MemoryUsage::heapBytes;
+    return heapBytes(orderId) + heapBytes(username) + heapBytes(trainId) + heapBytes(startStation) +
+           heapBytes(endStation) + heapBytes(date) + heapBytes(journeyId);
 }
 
 /**
@@ -48,9 +69,11 @@ ostream& operator<<(ostream& os, const Order& order) {
     os << "Order ID: " << order.orderId << "\n"
        << "Train: " << order.trainId << "\n"
        << "Route: " << order.startStation << " -> " << order.endStation << "\n"
-       << "Time: " << order.date << " " << order.departureTime << "\n"
-       << "Tickets: " << order.ticketCount << "\n"
+       << "Time: " << order.date << " " << Calendar::formatClock(order.departureMinutes) << "\n"
+       << "Tickets: " << order.ticketCount << " (" << seatClassName(order.seatClass) << " class)\n"
        << "Price: " << order.price << "\n"
+       << (order.journeyId.empty() ? "" : "Journey: " + order.journeyId + " (leg " + to_string(order.journeyLeg + 1) +
+                                              " of " + to_string(order.journeyLegs) + ")\n")
        << "Status: " << (order.status == PAID ? "Paid" : (order.status == CANCELLED ? "Cancelled" : "Completed")) << endl;
     return os;
 }
@@ -0,0 +1,58 @@
+/**
+ * @file OrderIndex.cpp
+ * @brief Implementation of the concurrent order index.
+ */
+
+#include "OrderIndex.h"
+#include "MemoryUsage.h"
+#include "Tracing.h"
+#include <functional>
+
+OrderIndex::OrderIndex(size_t shardCount) {
+    if (shardCount == 0) shardCount = 1;
+    shards.reserve(shardCount);
+    for (size_t i = 0; i < shardCount; ++i) {
+        shards.push_back(make_unique<Shard>());
+    }
+}
+
+OrderIndex::Shard& OrderIndex::shardFor(const string& orderId) const {
+    return *shards[hash<string>()(orderId) % shards.size()];
+}
+
+void OrderIndex::insert(const string& orderId, OrderLocation location) {
+    TRACE_SPAN("OrderIndex::insert");
+    Shard& shard = shardFor(orderId);
+    lock_guard<mutex> lock(shard.mtx);
+    shard.orders.insert_or_assign(orderId, move(location));
+}
+
+bool OrderIndex::find(const string& orderId, OrderLocation& location) const {
+    Shard& shard = shardFor(orderId);
+    lock_guard<mutex> lock(shard.mtx);
+    auto it = shard.orders.find(orderId);
+    if (it == shard.orders.end()) return false;
+    location = it->second;
+    return true;
+}
+
+size_t OrderIndex::size() const {
+    size_t total = 0;
+    for (const auto& shard : shards) {
+        lock_guard<mutex> lock(shard->mtx);
+        total += shard->orders.size();
+    }
+    return total;
+}
+
+size_t OrderIndex::getMemoryBytes() const {
+    size_t total = sizeof(*this) + MemoryUsage::bufferBytes(shards);
+    for (const auto& shard : shards) {
+        lock_guard<mutex> lock(shard->mtx);
+        total += sizeof(Shard) + MemoryUsage::nodeBytes(shard->orders);
+        for (const auto& pair : shard->orders) {
+            total += MemoryUsage::heapBytes(pair.first) + MemoryUsage::heapBytes(pair.second.username);
+        }
+    }
+    return total;
+}
@@ -0,0 +1,32 @@
+/**
+ * @file Pricing.cpp
+ * @brief Implementation of the fare curves.
+ */
+
+#include "Pricing.h"
+
+int PricingCurve::at(int x) const {
+    if (knots.empty()) return PRICE_BP_ONE;
+    if (x <= knots.front().first) return knots.front().second;
+    if (x >= knots.back().first) return knots.back().second;
+    for (size_t i = 1; i < knots.size(); ++i) {
+        const auto& lo = knots[i - 1];
+        const auto& hi = knots[i];
+        if (x > hi.first) continue;
+        if (hi.first == lo.first) return hi.second;
+        return lo.second + static_cast<int>(static_cast<long long>(hi.second - lo.second) * (x - lo.first) / (hi.first - lo.first));
+    }
+    return knots.back().second;
+}
+
+PricingPolicy::PricingPolicy(PricingCurve loadCurve, PricingCurve daysCurve)
+    : loadTable(1001), daysTable(PRICING_MAX_DAYS + 1) {
+    for (int i = 0; i <= 1000; ++i) loadTable[i] = loadCurve.at(i);
+    for (int i = 0; i <= PRICING_MAX_DAYS; ++i) daysTable[i] = daysCurve.at(i);
+}
+
+PricingPolicy PricingPolicy::standard() {
+    PricingCurve load{{{0, 9000}, {500, 10000}, {800, 12000}, {1000, 16000}}};
+    PricingCurve days{{{0, 12500}, {7, 10000}, {30, 10000}, {60, 9000}}};
+    return PricingPolicy(load, days);
+}
@@ -0,0 +1,70 @@
+/**
+ * @file Rcu.cpp
+ * @brief Implementation of epoch-based reclamation.
+ */
+
+#include "Rcu.h"
+#include <thread>
+
+EpochDomain::~EpochDomain() {
+    for (auto& entry : retired) entry.second();
+}
+
+/**
+ * @brief Claims a free slot, starting from one picked by thread ID so
+ * concurrent readers rarely touch the same cache line.
+ *
+ * The epoch may be stale by the time the CAS succeeds; an older epoch only
+ * delays reclamation. If a writer scanned the slot while it was still
+ * free, the CAS comes after that scan, so the version loaded afterwards is
+ * the one the writer published.
+ */
+EpochDomain::Guard EpochDomain::pin() {
+    size_t start = hash<thread::id>()(this_thread::get_id()) % SLOT_COUNT;
+    for (size_t i = start;; i = (i + 1) % SLOT_COUNT) {
+        uint64_t expected = IDLE;
+        uint64_t epoch = globalEpoch.load(memory_order_seq_cst);
+        if (slots[i].epoch.load(memory_order_relaxed) == IDLE &&
+            slots[i].epoch.compare_exchange_strong(expected, epoch, memory_order_seq_cst)) {
+            return Guard(this, i);
+        }
+        if ((i + 1) % SLOT_COUNT == start) this_thread::yield();
+    }
+}
+
+void EpochDomain::retire(function<void()> reclaim) {
+    {
+        lock_guard<mutex> lock(retiredMutex);
+        // The epoch is advanced after the caller unlinked the object
+        uint64_t epoch = globalEpoch.fetch_add(1, memory_order_seq_cst) + 1;
+        retired.emplace_back(epoch, move(reclaim));
+    }
+    collect();
+}
+
+size_t EpochDomain::collect() {
+    vector<function<void()>> ready;
+    {
+        lock_guard<mutex> lock(retiredMutex);
+        if (retired.empty()) return 0;
+        uint64_t oldest = UINT64_MAX;
+        for (const Slot& slot : slots) {
+            uint64_t epoch = slot.epoch.load(memory_order_seq_cst);
+            if (epoch != IDLE && epoch < oldest) oldest = epoch;
+        }
+        size_t safe = 0;
+        while (safe < retired.size() && retired[safe].first <= oldest) {
+            ready.push_back(move(retired[safe].second));
+            ++safe;
+        }
+        retired.erase(retired.begin(), retired.begin() + safe);
+    }
+    // Reclaimed outside the lock: destructors may be slow
+    for (auto& reclaim : ready) reclaim();
+    return ready.size();
+}
+
+size_t EpochDomain::getPendingCount() const {
+    lock_guard<mutex> lock(retiredMutex);
+    return retired.size();
+}
@@ -0,0 +1,537 @@
+/**
+ * @file Replication.cpp
+ * @brief Implementation of the mutation log and the replica that follows it.
+ */
+
+#include "Replication.h"
+#include "SystemManager.h"
+#include "TicketProtocol.h"
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+
+namespace {
+
+/// Fields of one order in an ORDERS record
+const size_t ORDER_FIELDS = 13;
+
+const char* const MUTATION_NAMES[] = {"HEARTBEAT", "REGISTER", "ORDERS", "CANCEL", "ADD_TRAIN", "DELETE_TRAIN", "CANCEL_TRAIN"};
+
+int64_t wallClockNs() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Shortest text that parses back to the same double.
+ */
+string formatDouble(double value) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.17g", value);
+    return buf;
+}
+
+void appendOrder(vector<string>& fields, const Order& order) {
+    fields.push_back(order.getOrderId());
+    fields.push_back(order.getUsername());
+    fields.push_back(order.getTrainId());
+    fields.push_back(order.getStartStation());
+    fields.push_back(order.getEndStation());
+    fields.push_back(order.getDate());
+    fields.push_back(to_string(order.getDepartureMinutes()));
+    fields.push_back(to_string(order.getPrice().getCents()));
+    fields.push_back(to_string(order.getTicketCount()));
+    fields.push_back(seatClassName(order.getSeatClass()));
+    fields.push_back(to_string(static_cast<int64_t>(order.getCreateTime())));
+    fields.push_back(to_string(order.getJourneyLeg()));
+    fields.push_back(to_string(order.getJourneyLegs()));
+}
+
+/**
+ * @brief ID, type, class seats, stops (absolute times) and calendar ("-" for daily).
+ */
+void appendTrain(vector<string>& fields, const Train& train) {
+    fields.push_back(train.getId());
+    fields.push_back(train.getType());
+    for (int c = 0; c < SEAT_CLASS_COUNT; ++c) fields.push_back(to_string(train.getClassSeats(static_cast<SeatClass>(c))));
+    const vector<Stop>& stops = train.getRoute();
+    fields.push_back(to_string(stops.size()));
+    for (size_t i = 0; i < stops.size(); ++i) {
+        const Stop& stop = stops[i];
+        fields.push_back(stop.stationName);
+        fields.push_back(to_string(train.getArrivalMinutes(static_cast<int>(i))));
+        fields.push_back(to_string(train.getDepartureMinutes(static_cast<int>(i))));
+        fields.push_back(formatDouble(stop.priceFromStart));
+        fields.push_back(to_string(stop.distance));
+        fields.push_back(formatDouble(stop.firstPriceFromStart));
+        fields.push_back(formatDouble(stop.businessPriceFromStart));
+    }
+    const shared_ptr<const ServiceCalendar>& calendar = train.getServiceCalendar();
+    if (!calendar) {
+        fields.push_back("-");
+        return;
+    }
+    fields.push_back(to_string(calendar->getWeekdays()));
+    fields.push_back(calendar->getFirstDate());
+    fields.push_back(calendar->getLastDate());
+    vector<int> exceptions = calendar->getExceptionDays();
+    fields.push_back(to_string(exceptions.size()));
+    for (int day : exceptions) {
+        fields.push_back(Calendar::formatDate(day));
+        fields.push_back(calendar->runsOn(day) ? "1" : "0");
+    }
+}
+
+/**
+ * @brief Reads the fields of a record in order, failing once any is missing or malformed.
+ */
+class FieldReader {
+public:
+    FieldReader(const vector<string>& fields, size_t start) : fields(fields), pos(start) {}
+
+    bool ok() const { return good; }
+    bool atEnd() const { return pos == fields.size(); }
+
+    const string& text() {
+        static const string empty;
+        if (pos >= fields.size()) {
+            good = false;
+            return empty;
+        }
+        return fields[pos++];
+    }
+
+    int64_t integer() {
+        const string& s = text();
+        char* end = nullptr;
+        long long value = strtoll(s.c_str(), &end, 10);
+        if (s.empty() || *end != '\0') good = false;
+        return value;
+    }
+
+    double real() {
+        const string& s = text();
+        char* end = nullptr;
+        double value = strtod(s.c_str(), &end);
+        if (s.empty() || *end != '\0') good = false;
+        return value;
+    }
+
+    /**
+     * @brief A count of records of recordFields fields each that must fit in what is left.
+     */
+    size_t count(size_t recordFields) {
+        int64_t n = integer();
+        if (n < 0 || static_cast<size_t>(n) * recordFields > fields.size() - pos) good = false;
+        return good ? static_cast<size_t>(n) : 0;
+    }
+
+private:
+    const vector<string>& fields;
+    size_t pos;
+    bool good = true;
+};
+
+bool readOrder(FieldReader& r, Order& order) {
+    string orderId = r.text();
+    string username = r.text();
+    string trainId = r.text();
+    string start = r.text();
+    string end = r.text();
+    string date = r.text();
+    int departure = static_cast<int>(r.integer());
+    Money price(r.integer());
+    int count = static_cast<int>(r.integer());
+    SeatClass seatClass = SECOND_CLASS;
+    if (!parseSeatClass(r.text(), seatClass)) return false;
+    time_t created = static_cast<time_t>(r.integer());
+    int leg = static_cast<int>(r.integer());
+    int legs = static_cast<int>(r.integer());
+    if (!r.ok()) return false;
+    order = Order(move(username), move(trainId), move(start), move(end), move(date), departure, price, count, move(orderId),
+                  created, seatClass);
+    order.setJourney("", leg, legs);
+    return true;
+}
+
+bool readTrain(FieldReader& r, Train& train) {
+    string id = r.text();
+    string type = r.text();
+    array<int, SEAT_CLASS_COUNT> seats{};
+    for (int& n : seats) n = static_cast<int>(r.integer());
+    train = Train(move(id), move(type), seats);
+    size_t stops = r.count(7);
+    for (size_t i = 0; i < stops && r.ok(); ++i) {
+        Stop stop;
+        stop.stationName = r.text();
+        stop.arrivalMinutes = static_cast<int>(r.integer());
+        stop.departureMinutes = static_cast<int>(r.integer());
+        stop.priceFromStart = r.real();
+        stop.distance = static_cast<int>(r.integer());
+        stop.firstPriceFromStart = r.real();
+        stop.businessPriceFromStart = r.real();
+        train.addStop(stop);
+    }
+    const string& weekdays = r.text();
+    if (weekdays == "-" || !r.ok()) return r.ok();
+    char* end = nullptr;
+    long mask = strtol(weekdays.c_str(), &end, 10);
+    if (*end != '\0') return false;
+    string firstDate = r.text();
+    string lastDate = r.text();
+    auto calendar = make_shared<ServiceCalendar>(static_cast<uint8_t>(mask), firstDate, lastDate);
+    size_t exceptions = r.count(2);
+    for (size_t i = 0; i < exceptions && r.ok(); ++i) {
+        string date = r.text();
+        calendar->addException(date, r.text() == "1");
+    }
+    train.setServiceCalendar(move(calendar));
+    return r.ok();
+}
+
+} // namespace
+
+const char* mutationOpName(MutationOp op) {
+    if (op < MUTATION_HEARTBEAT || op > MUTATION_CANCEL_TRAIN) return "UNKNOWN";
+    return MUTATION_NAMES[op - MUTATION_HEARTBEAT];
+}
+
+bool parseMutationOp(const string& name, MutationOp& op) {
+    for (int i = MUTATION_HEARTBEAT; i <= MUTATION_CANCEL_TRAIN; ++i) {
+        if (name == MUTATION_NAMES[i - MUTATION_HEARTBEAT]) {
+            op = static_cast<MutationOp>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+ReplicationLog::~ReplicationLog() {
+    close();
+}
+
+bool ReplicationLog::open(const string& logPath, uint64_t firstSequence) {
+    close();
+    lock_guard<mutex> fileLock(fileMutex);
+    {
+        lock_guard<mutex> lock(mtx);
+        file.open(logPath, ios::binary | ios::trunc);
+        if (!file) return false;
+        path = logPath;
+        buffer.clear();
+        nextSequence = firstSequence;
+        lastAppend = chrono::steady_clock::now();
+        stopping = false;
+    }
+    flusher = thread(&ReplicationLog::flushLoop, this);
+    return true;
+}
+
+void ReplicationLog::close() {
+    {
+        lock_guard<mutex> lock(mtx);
+        if (!file.is_open()) return;
+        stopping = true;
+    }
+    wake.notify_all();
+    if (flusher.joinable()) flusher.join();
+    flush();
+    lock_guard<mutex> fileLock(fileMutex);
+    lock_guard<mutex> lock(mtx);
+    file.close();
+}
+
+bool ReplicationLog::isOpen() const {
+    lock_guard<mutex> lock(mtx);
+    return file.is_open();
+}
+
+uint64_t ReplicationLog::getSequence() const {
+    lock_guard<mutex> lock(mtx);
+    return nextSequence - 1;
+}
+
+void ReplicationLog::append(MutationOp op, const vector<string>& fields) {
+    vector<string> line;
+    line.reserve(fields.size() + 3);
+    int64_t now = wallClockNs();
+    lock_guard<mutex> lock(mtx);
+    if (!file.is_open()) return;
+    line.push_back(to_string(nextSequence++));
+    line.push_back(to_string(now));
+    line.push_back(mutationOpName(op));
+    line.insert(line.end(), fields.begin(), fields.end());
+    buffer += TicketProtocol::encodeLine(line);
+    lastAppend = chrono::steady_clock::now();
+}
+
+void ReplicationLog::logRegister(const string& username, const string& password, const string& name, const string& idCard) {
+    append(MUTATION_REGISTER, {username, password, name, idCard});
+}
+
+void ReplicationLog::logOrders(const vector<Order>& orders, unsigned orderSequence) {
+    vector<string> fields = {to_string(orderSequence), to_string(orders.size())};
+    fields.reserve(2 + orders.size() * ORDER_FIELDS);
+    for (const Order& order : orders) appendOrder(fields, order);
+    append(MUTATION_ORDERS, fields);
+}
+
+void ReplicationLog::logCancels(const vector<Order>& cancelled) {
+    vector<string> fields = {to_string(cancelled.size())};
+    for (const Order& order : cancelled) {
+        fields.push_back(order.getUsername());
+        fields.push_back(order.getOrderId());
+    }
+    append(MUTATION_CANCEL, fields);
+}
+
+void ReplicationLog::logTrains(const vector<const Train*>& trains) {
+    vector<string> fields = {to_string(trains.size())};
+    for (const Train* train : trains) appendTrain(fields, *train);
+    append(MUTATION_ADD_TRAIN, fields);
+}
+
+void ReplicationLog::logDeleteTrain(const string& trainId) {
+    append(MUTATION_DELETE_TRAIN, {trainId});
+}
+
+void ReplicationLog::logCancelTrain(const string& trainId, int firstDay, int lastDay) {
+    append(MUTATION_CANCEL_TRAIN, {trainId, firstDay == INT_MIN ? "" : Calendar::formatDate(firstDay),
+                                   lastDay == INT_MAX ? "" : Calendar::formatDate(lastDay)});
+}
+
+/**
+ * @brief The buffer is taken under the file lock, so concurrent flushes
+ * write their chunks in the order they were appended.
+ */
+void ReplicationLog::flush() {
+    lock_guard<mutex> fileLock(fileMutex);
+    string chunk;
+    {
+        lock_guard<mutex> lock(mtx);
+        chunk.swap(buffer);
+    }
+    if (chunk.empty() || !file.is_open()) return;
+    file.write(chunk.data(), static_cast<streamsize>(chunk.size()));
+    file.flush();
+}
+
+void ReplicationLog::flushLoop() {
+    for (;;) {
+        {
+            unique_lock<mutex> lock(mtx);
+            wake.wait_for(lock, chrono::milliseconds(REPLICATION_FLUSH_MS), [this] { return stopping; });
+            if (stopping) return;
+        }
+        bool idle;
+        {
+            lock_guard<mutex> lock(mtx);
+            idle = chrono::steady_clock::now() - lastAppend >= chrono::milliseconds(REPLICATION_HEARTBEAT_MS);
+        }
+        if (idle) append(MUTATION_HEARTBEAT, {});
+        flush();
+    }
+}
+
+Replica::Replica(SystemManager& system, string logPath) : system(system), logPath(move(logPath)) {}
+
+Replica::~Replica() {
+    stop();
+    // The promoted SystemManager may still point at the log
+    if (promotionLog) system.setReplicationLog(nullptr);
+}
+
+void Replica::start() {
+    if (running.exchange(true)) return;
+    follower = thread(&Replica::followLoop, this);
+}
+
+void Replica::stop() {
+    running = false;
+    if (follower.joinable()) follower.join();
+}
+
+void Replica::followLoop() {
+    while (running) {
+        if (poll() == 0) this_thread::sleep_for(chrono::milliseconds(REPLICATION_POLL_MS));
+    }
+}
+
+/**
+ * @brief Reads what the primary wrote since the last poll and applies the
+ * complete lines; a partial last line waits for the next poll.
+ */
+size_t Replica::poll() {
+    lock_guard<mutex> lock(pollMutex);
+    if (promoted) return 0;
+    if (!in.is_open()) {
+        in.open(logPath, ios::binary);
+        if (!in) {
+            in.close();
+            return 0;
+        }
+    }
+    in.clear();
+    in.seekg(static_cast<streamoff>(readOffset));
+    char chunk[64 * 1024];
+    for (;;) {
+        in.read(chunk, sizeof(chunk));
+        streamsize got = in.gcount();
+        if (got <= 0) break;
+        partial.append(chunk, static_cast<size_t>(got));
+        readOffset += static_cast<uint64_t>(got);
+    }
+
+    size_t count = 0;
+    size_t start = 0;
+    size_t end;
+    while ((end = partial.find(TicketProtocol::LINE_TERMINATOR, start)) != string::npos) {
+        vector<string> fields = TicketProtocol::decodeLine(partial.substr(start, end - start));
+        start = end + 1;
+        string error;
+        if (!apply(fields, error)) {
+            ++status.errors;
+            status.lastError = error;
+        }
+        ++count;
+    }
+    partial.erase(0, start);
+    if (count > 0) applied.notify_all();
+    return count;
+}
+
+/**
+ * @brief Checks the header (sequence, time, operation) and hands the
+ * fields to the SystemManager.
+ */
+bool Replica::apply(const vector<string>& fields, string& error) {
+    FieldReader r(fields, 0);
+    int64_t sequence = r.integer();
+    int64_t writtenNs = r.integer();
+    MutationOp op;
+    if (!r.ok() || !parseMutationOp(r.text(), op)) {
+        error = "malformed record header";
+        return false;
+    }
+    uint64_t expected = status.appliedSequence + 1;
+    // The first record may continue the numbering of an earlier log
+    bool inOrder = status.appliedRecords == 0 || static_cast<uint64_t>(sequence) == expected;
+    status.appliedSequence = static_cast<uint64_t>(sequence);
+    ++status.appliedRecords;
+    lastAppliedNs = writtenNs;
+    if (!inOrder) {
+        error = "expected record " + to_string(expected) + ", got " + to_string(sequence);
+        return false;
+    }
+
+    bool ok = r.ok();
+    switch (op) {
+        case MUTATION_HEARTBEAT:
+            break;
+        case MUTATION_REGISTER: {
+            string username = r.text();
+            string password = r.text();
+            string name = r.text();
+            string idCard = r.text();
+            ok = r.ok() && system.doRegisterUser(username, password, name, idCard);
+            break;
+        }
+        case MUTATION_ORDERS: {
+            unsigned orderSequence = static_cast<unsigned>(r.integer());
+            size_t n = r.count(ORDER_FIELDS);
+            vector<Order> orders(n);
+            for (size_t i = 0; i < n && ok; ++i) ok = readOrder(r, orders[i]);
+            if (ok && r.ok() && n > 0) {
+                // Journey legs are linked by the first leg's order ID
+                if (n > 1) {
+                    for (Order& order : orders) order.setJourney(orders[0].getOrderId(), order.getJourneyLeg(), order.getJourneyLegs());
+                }
+                ok = system.applyOrders(move(orders), orderSequence);
+            } else {
+                ok = false;
+            }
+            break;
+        }
+        case MUTATION_CANCEL: {
+            size_t n = r.count(2);
+            for (size_t i = 0; i < n && r.ok(); ++i) {
+                string username = r.text();
+                ok = system.applyCancel(username, r.text()) && ok;
+            }
+            ok = ok && r.ok();
+            break;
+        }
+        case MUTATION_ADD_TRAIN: {
+            size_t n = r.count(1);
+            vector<Train> trains(n);
+            for (size_t i = 0; i < n && ok; ++i) ok = readTrain(r, trains[i]);
+            if (ok) system.addTrains(move(trains));
+            break;
+        }
+        case MUTATION_DELETE_TRAIN: {
+            // Only the train: the primary's refunds of its orders follow in the log
+            const string& trainId = r.text();
+            ok = r.ok();
+            if (ok) system.eraseTrain(trainId);
+            break;
+        }
+        case MUTATION_CANCEL_TRAIN: {
+            string trainId = r.text();
+            string firstDate = r.text();
+            string lastDate = r.text();
+            size_t dropped;
+            ok = r.ok() && system.closeService(trainId, firstDate.empty() ? INT_MIN : Calendar::dayNumber(firstDate),
+                                               lastDate.empty() ? INT_MAX : Calendar::dayNumber(lastDate), dropped);
+            break;
+        }
+    }
+    if (!ok) error = string("cannot apply ") + mutationOpName(op) + " record " + to_string(sequence);
+    return ok;
+}
+
+bool Replica::waitForSequence(uint64_t sequence, chrono::milliseconds timeout) {
+    unique_lock<mutex> lock(pollMutex);
+    return applied.wait_for(lock, timeout, [&] { return status.appliedSequence >= sequence; });
+}
+
+/**
+ * @brief Lag is the age of the last record applied: the primary writes a
+ * heartbeat when idle, so a healthy replica stays within about
+ * REPLICATION_HEARTBEAT_MS even when nothing changes.
+ */
+ReplicationStatus Replica::getStatus() const {
+    ReplicationStatus result;
+    uint64_t offset;
+    {
+        lock_guard<mutex> lock(pollMutex);
+        result = status;
+        offset = readOffset - partial.size();
+        if (status.appliedRecords > 0) result.lagMs = (wallClockNs() - lastAppliedNs) / 1000000;
+    }
+    result.promoted = promoted;
+    ifstream log(logPath, ios::binary | ios::ate);
+    if (log) {
+        uint64_t size = static_cast<uint64_t>(log.tellg());
+        result.pendingBytes = size > offset ? size - offset : 0;
+    }
+    return result;
+}
+
+uint64_t Replica::promote() {
+    stop();
+    poll();
+    lock_guard<mutex> lock(pollMutex);
+    uint64_t last = status.appliedSequence;
+    if (promoted) return last;
+    in.close();
+    // The log is installed before writes are accepted, so it misses none of them
+    if (!promotionLogPath.empty()) {
+        promotionLog = make_unique<ReplicationLog>();
+        if (promotionLog->open(promotionLogPath, last + 1)) {
+            system.setReplicationLog(promotionLog.get());
+        } else {
+            promotionLog.reset();
+        }
+    }
+    promoted = true;
+    return last;
+}
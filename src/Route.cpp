@@ -0,0 +1,89 @@
+/**
+ * @file Route.cpp
+ * @brief Implementation of shared routes and the route table.
+ */
+
+#include "Route.h"
+#include "MemoryUsage.h"
+#include <functional>
+#include <algorithm>
+
+namespace {
+
+void combine(size_t& seed, size_t value) {
+    seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+}
+
+} // namespace
+
+Route::Route(vector<Stop> routeStops) : stops(move(routeStops)) {
+    basePrefix.reserve(stops.size() * SEAT_CLASS_COUNT);
+    for (const Stop& stop : stops) {
+        for (int c = 0; c < SEAT_CLASS_COUNT; ++c) {
+            SeatClass seatClass = static_cast<SeatClass>(c);
+            basePrefix.push_back(Money::fromYuan(stop.classPrice(seatClass)) - Money::fromYuan(stops.front().classPrice(seatClass)));
+        }
+        combine(hash, std::hash<string>()(stop.stationName));
+        combine(hash, std::hash<int>()(stop.arrivalMinutes));
+        combine(hash, std::hash<int>()(stop.departureMinutes));
+        combine(hash, std::hash<double>()(stop.priceFromStart));
+        combine(hash, std::hash<int>()(stop.distance));
+        combine(hash, std::hash<double>()(stop.firstPriceFromStart));
+        combine(hash, std::hash<double>()(stop.businessPriceFromStart));
+    }
+}
+
+const shared_ptr<const Route>& Route::empty() {
+    static const shared_ptr<const Route> none = make_shared<const Route>(vector<Stop>());
+    return none;
+}
+
+shared_ptr<const Route> Route::withStop(const Stop& stop) const {
+    vector<Stop> extended;
+    extended.reserve(stops.size() + 1);
+    extended = stops;
+    extended.push_back(stop);
+    return make_shared<const Route>(move(extended));
+}
+
+int Route::findStation(const string& stationName) const {
+    for (size_t i = 0; i < stops.size(); ++i) {
+        if (stops[i].stationName == stationName) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+size_t Route::getMemoryBytes() const {
+    // make_shared: object plus control block in one allocation
+    size_t total = sizeof(Route) + 2 * sizeof(long) + sizeof(void*);
+    total += MemoryUsage::bufferBytes(stops) + MemoryUsage::bufferBytes(basePrefix);
+    for (const Stop& stop : stops) total += MemoryUsage::heapBytes(stop.stationName);
+    return total;
+}
+
+/**
+ * @brief Expired entries of the bucket are dropped while it is searched.
+ */
+shared_ptr<const Route> RouteTable::intern(const shared_ptr<const Route>& route) {
+    lock_guard<mutex> lock(mtx);
+    vector<weak_ptr<const Route>>& bucket = routes[route->getHash()];
+    bucket.erase(remove_if(bucket.begin(), bucket.end(), [](const weak_ptr<const Route>& w) { return w.expired(); }),
+                 bucket.end());
+    for (const weak_ptr<const Route>& entry : bucket) {
+        shared_ptr<const Route> existing = entry.lock();
+        if (existing && *existing == *route) return existing;
+    }
+    bucket.push_back(route);
+    return route;
+}
+
+size_t RouteTable::size() const {
+    lock_guard<mutex> lock(mtx);
+    size_t live = 0;
+    for (const auto& bucket : routes) {
+        for (const auto& entry : bucket.second) live += !entry.expired();
+    }
+    return live;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file SearchController.cpp
+ * @brief Implementation of the background search worker.
+ */
+
+#include "SearchController.h"
+#include <QMetaObject>
+
+SearchController::SearchController(SystemManager& sys, TrainResultModel *resultModel, QObject *parent)
+    : QObject(parent), system(sys), model(resultModel) {
+    worker = thread(&SearchController::run, this);
+}
+
+SearchController::~SearchController() {
+    {
+        lock_guard<mutex> lock(mtx);
+        stopping = true;
+        pending.reset();
+        if (running) running->store(true);
+    }
+    cv.notify_all();
+    worker.join();
+}
+
+void SearchController::search(const string& start, const string& end, const string& date) {
+    ++generation;
+    delivered = 0;
+    model->beginSearch(start, end, date);
+    {
+        lock_guard<mutex> lock(mtx);
+        pending.reset(new Request{generation, start, end, date});
+        if (running) running->store(true);
+    }
+    cv.notify_one();
+}
+
+void SearchController::cancel() {
+    ++generation; // Drops batches already queued for the GUI thread
+    lock_guard<mutex> lock(mtx);
+    pending.reset();
+    if (running) running->store(true);
+}
+
+/**
+ * @brief Worker loop. Results are posted to the GUI thread as queued calls on this object.
+ */
+void SearchController::run() {
+    for (;;) {
+        unique_ptr<Request> request;
+        shared_ptr<atomic<bool>> cancelFlag = make_shared<atomic<bool>>(false);
+        {
+            unique_lock<mutex> lock(mtx);
+            cv.wait(lock, [this] { return stopping || pending; });
+            if (stopping) return;
+            request = move(pending);
+            running = cancelFlag;
+        }
+
+        uint64_t gen = request->generation;
+        int today = system.getCurrentDay();
+        bool completed = system.searchTrainsStreaming(request->start, request->end, request->date,
+            [&](vector<Train>& batch) {
+                auto rows = make_shared<vector<TrainResultModel::Row>>(
+                    TrainResultModel::makeRows(batch, request->start, request->end, request->date, today));
+                QMetaObject::invokeMethod(this, [this, gen, rows] {
+                    if (gen != generation) return;
+                    delivered += static_cast<int>(rows->size());
+                    model->appendRows(move(*rows));
+                }, Qt::QueuedConnection);
+            }, cancelFlag.get());
+
+        if (completed) {
+            QMetaObject::invokeMethod(this, [this, gen] {
+                if (gen == generation) emit finished(delivered);
+            }, Qt::QueuedConnection);
+        }
+
+        lock_guard<mutex> lock(mtx);
+        running.reset();
+    }
+}
@@ -0,0 +1,82 @@
+/**
+ * @file ServiceCalendar.cpp
+ * @brief Implementation of the service calendar.
+ */
+
+#include "ServiceCalendar.h"
+#include <bitset>
+
+ServiceCalendar::ServiceCalendar(uint8_t weekdays, const string& firstDate, const string& lastDate)
+    : weekdays(weekdays & EVERY_DAY),
+      firstDay(firstDate.empty() ? INT_MIN : Calendar::dayNumber(firstDate)),
+      lastDay(lastDate.empty() ? INT_MAX : Calendar::dayNumber(lastDate)) {}
+
+/**
+ * @brief Grows the bitmap to cover the date, then sets its bit if the
+ * requested answer differs from the pattern's.
+ */
+void ServiceCalendar::addException(const string& date, bool runs) {
+    int day = Calendar::dayNumber(date);
+    int base = day >= 0 ? day / 64 * 64 : -((63 - day) / 64 * 64);
+    if (exceptions.empty()) {
+        exceptionBase = base;
+    } else if (base < exceptionBase) {
+        exceptions.insert(exceptions.begin(), (exceptionBase - base) / 64, 0);
+        exceptionBase = base;
+    }
+    size_t offset = static_cast<size_t>(day - exceptionBase);
+    if (offset / 64 >= exceptions.size()) exceptions.resize(offset / 64 + 1, 0);
+
+    uint64_t bit = uint64_t(1) << (offset % 64);
+    exceptions[offset / 64] &= ~bit;
+    if (runsOn(day) != runs) exceptions[offset / 64] |= bit;
+}
+
+vector<int> ServiceCalendar::getExceptionDays() const {
+    vector<int> days;
+    for (size_t word = 0; word < exceptions.size(); ++word) {
+        for (int bit = 0; bit < 64; ++bit) {
+            if (exceptions[word] >> bit & 1) days.push_back(exceptionBase + static_cast<int>(word * 64) + bit);
+        }
+    }
+    return days;
+}
+
+/**
+ * @brief Exceptions flip the pattern's answer, so changing the pattern
+ * changes their meaning: the result is rebuilt from the new pattern and
+ * the old answers on the exception days left. The pattern only changes
+ * where the cancelled days meet the validity range; outside it, only
+ * running exceptions can be cancelled.
+ */
+ServiceCalendar ServiceCalendar::withoutDays(int first, int last) const {
+    if (first > last) return *this;
+    ServiceCalendar result = *this;
+    result.exceptions.clear();
+    result.exceptionBase = 0;
+    bool overlaps = first <= lastDay && last >= firstDay;
+    bool coversStart = overlaps && first <= firstDay;
+    bool coversEnd = overlaps && last >= lastDay;
+    if (coversStart && coversEnd) {
+        result.weekdays = 0;
+    } else if (coversStart) {
+        result.firstDay = last + 1;
+    } else if (coversEnd) {
+        result.lastDay = first - 1;
+    }
+    for (int day : getExceptionDays()) {
+        if (day < first || day > last) result.addException(Calendar::formatDate(day), runsOn(day));
+    }
+    if (overlaps && !coversStart && !coversEnd) {
+        for (int day = first; day <= last; ++day) {
+            if (runsOn(day)) result.addException(Calendar::formatDate(day), false);
+        }
+    }
+    return result;
+}
+
+size_t ServiceCalendar::getExceptionCount() const {
+    size_t count = 0;
+    for (uint64_t word : exceptions) count += bitset<64>(word).count();
+    return count;
+}
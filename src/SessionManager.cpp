@@ -0,0 +1,117 @@
+/**
+ * @file SessionManager.cpp
+ * @brief Implementation of the sharded session table.
+ */
+
+#include "SessionManager.h"
+#include "MemoryUsage.h"
+#include "Tracing.h"
+#include <random>
+#include <sstream>
+#include <iomanip>
+#include <functional>
+
+SessionManager::SessionManager(size_t shardCount, Clock::duration timeout)
+    : idleTimeout(timeout.count()) {
+    if (shardCount == 0) shardCount = 1;
+    shards.reserve(shardCount);
+    for (size_t i = 0; i < shardCount; ++i) {
+        shards.push_back(make_unique<Shard>());
+    }
+}
+
+/**
+ * @brief Picks the shard responsible for a token.
+ */
+SessionManager::Shard& SessionManager::shardFor(const string& token) const {
+    return *shards[hash<string>()(token) % shards.size()];
+}
+
+/**
+ * @brief Generates a random 128-bit token as 32 hex digits.
+ * Each thread owns its own generator, so no locking is needed.
+ */
+string SessionManager::generateToken() {
+    thread_local mt19937_64 rng(random_device{}());
+    stringstream ss;
+    ss << hex << setfill('0') << setw(16) << rng() << setw(16) << rng();
+    return ss.str();
+}
+
+string SessionManager::createSession(const shared_ptr<User>& user) {
+    for (;;) {
+        string token = generateToken();
+        Shard& shard = shardFor(token);
+        lock_guard<mutex> lock(shard.mtx);
+        // Collisions are practically impossible, but never hand out a live token twice
+        if (shard.sessions.emplace(token, Session{user, Clock::now()}).second) {
+            return token;
+        }
+    }
+}
+
+shared_ptr<User> SessionManager::getUser(const string& token) {
+    TRACE_SPAN("SessionManager::getUser");
+    if (token.empty()) return nullptr;
+
+    Shard& shard = shardFor(token);
+    lock_guard<mutex> lock(shard.mtx);
+    auto it = shard.sessions.find(token);
+    if (it == shard.sessions.end()) return nullptr;
+
+    Clock::time_point now = Clock::now();
+    if (now - it->second.lastActive > getIdleTimeout()) {
+        shard.sessions.erase(it);
+        return nullptr;
+    }
+    it->second.lastActive = now;
+    return it->second.user;
+}
+
+bool SessionManager::closeSession(const string& token) {
+    Shard& shard = shardFor(token);
+    lock_guard<mutex> lock(shard.mtx);
+    return shard.sessions.erase(token) > 0;
+}
+
+/**
+ * @brief Sweeps all shards, one lock at a time.
+ */
+size_t SessionManager::purgeExpired() {
+    size_t removed = 0;
+    Clock::time_point now = Clock::now();
+    Clock::duration timeout = getIdleTimeout();
+    for (auto& shard : shards) {
+        lock_guard<mutex> lock(shard->mtx);
+        for (auto it = shard->sessions.begin(); it != shard->sessions.end();) {
+            if (now - it->second.lastActive > timeout) {
+                it = shard->sessions.erase(it);
+                ++removed;
+            } else {
+                ++it;
+            }
+        }
+    }
+    return removed;
+}
+
+size_t SessionManager::size() const {
+    size_t total = 0;
+    for (const auto& shard : shards) {
+        lock_guard<mutex> lock(shard->mtx);
+        total += shard->sessions.size();
+    }
+    return total;
+}
+
+size_t SessionManager::getMemoryBytes() const {
+    size_t total = MemoryUsage::bufferBytes(shards);
+    for (const auto& shard : shards) {
+        lock_guard<mutex> lock(shard->mtx);
+        total += sizeof(Shard) + MemoryUsage::nodeBytes(shard->sessions);
+        for (const auto& pair : shard->sessions) {
+            total += MemoryUsage::heapBytes(pair.first);
+        }
+    }
+    return total;
+}
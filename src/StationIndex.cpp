@@ -0,0 +1,91 @@
+/**
+ * @file StationIndex.cpp
+ * @brief Implementation of the station-to-trains search index.
+ */
+
+#include "StationIndex.h"
+#include "MemoryUsage.h"
+
+/**
+ * @brief Entries shared with another copy are copied before they change;
+ * a count of one cannot be stale, since other copies only ever let go.
+ */
+StationIndex::Entries& StationIndex::entriesFor(const string& station) {
+    shared_ptr<Entries>& entries = stations[station];
+    if (!entries) {
+        entries = make_shared<Entries>();
+    } else if (entries.use_count() > 1) {
+        entries = make_shared<Entries>(*entries);
+    }
+    return *entries;
+}
+
+void StationIndex::add(const Train& train) {
+    const vector<Stop>& route = train.getRoute();
+    remove(train.getId());
+    vector<string>& indexed = trainStations[train.getId()];
+    for (size_t i = 0; i < route.size(); ++i) {
+        // A station visited twice is indexed at its first stop, like findSegment resolves it
+        Entry entry{static_cast<int>(i), train.getDayOffset(static_cast<int>(i)), train.getServiceCalendar()};
+        if (entriesFor(route[i].stationName).emplace(train.getId(), move(entry)).second) {
+            indexed.push_back(route[i].stationName);
+        }
+    }
+}
+
+void StationIndex::remove(const string& trainId) {
+    auto it = trainStations.find(trainId);
+    if (it == trainStations.end()) return;
+    for (const string& station : it->second) {
+        Entries& entries = entriesFor(station);
+        entries.erase(trainId);
+        if (entries.empty()) stations.erase(station);
+    }
+    trainStations.erase(it);
+}
+
+/**
+ * @brief Merge join of the two stations' entries; the calendar is tested
+ * last, on the service date of the boarding stop.
+ */
+vector<string> StationIndex::candidates(const string& startStation, const string& endStation, int travelDay) const {
+    vector<string> result;
+    auto from = stations.find(startStation);
+    auto to = stations.find(endStation);
+    if (from == stations.end() || to == stations.end()) return result;
+
+    const Entries& boarding = *from->second;
+    const Entries& alighting = *to->second;
+    auto a = boarding.begin();
+    auto b = alighting.begin();
+    while (a != boarding.end() && b != alighting.end()) {
+        if (a->first < b->first) {
+            ++a;
+        } else if (b->first < a->first) {
+            ++b;
+        } else {
+            const Entry& board = a->second;
+            if (board.stopIndex < b->second.stopIndex &&
+                (!board.calendar || board.calendar->runsOn(travelDay - board.dayOffset))) {
+                result.push_back(a->first);
+            }
+            ++a;
+            ++b;
+        }
+    }
+    return result;
+}
+
+size_t StationIndex::getMemoryBytes() const {
+    using MemoryUsage::heapBytes;
+    size_t total = MemoryUsage::nodeBytes(stations) + MemoryUsage::nodeBytes(trainStations);
+    for (const auto& station : stations) {
+        total += heapBytes(station.first) + sizeof(Entries) + MemoryUsage::nodeBytes(*station.second);
+        for (const auto& entry : *station.second) total += heapBytes(entry.first);
+    }
+    for (const auto& train : trainStations) {
+        total += heapBytes(train.first) + MemoryUsage::bufferBytes(train.second);
+        for (const string& station : train.second) total += heapBytes(station);
+    }
+    return total;
+}
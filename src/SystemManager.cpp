@@ -4,9 +4,61 @@
  */
 
 #include "SystemManager.h"
+#include "Tracing.h"
 #include <iostream>
+#include <algorithm>
+#include <future>
+#include <set>
+#include <tuple>
+#include <thread>
+#include <climits>
 
-SystemManager::SystemManager() {
+namespace {
+
+/**
+ * @brief Search arguments as recorded in call traces. The window is only
+ * recorded when it filters, so all-day searches keep the three-argument form.
+ */
+vector<string> searchTraceArgs(const string& startStation, const string& endStation, const string& date,
+                               const TimeWindow& window) {
+    if (window.isAllDay()) return {startStation, endStation, date};
+    return {startStation, endStation, date, Calendar::formatClock(window.earliest), Calendar::formatClock(window.latest)};
+}
+
+/**
+ * @brief Multi-leg booking arguments as recorded in call traces.
+ */
+vector<string> legTraceArgs(const string& session, const vector<TripLeg>& legs, int count) {
+    vector<string> args = {session, to_string(count)};
+    for (const TripLeg& leg : legs) {
+        args.insert(args.end(), {leg.trainId, leg.startStation, leg.endStation, leg.date, seatClassName(leg.seatClass)});
+    }
+    return args;
+}
+
+/**
+ * @brief The order IDs of a multi-leg booking as one trace output.
+ */
+string joinOrderIds(const vector<string>& orderIds) {
+    string joined;
+    for (const string& id : orderIds) {
+        if (!joined.empty()) joined += ' ';
+        joined += id;
+    }
+    return joined;
+}
+
+/**
+ * @brief Service date (day number) of an order's train run: the departure
+ * time counts from midnight of the service date.
+ */
+int serviceDayOf(const string& travelDate, int departureMinutes) {
+    return Calendar::dayNumber(travelDate) - departureMinutes / MINUTES_PER_DAY;
+}
+
+} // namespace
+
+SystemManager::SystemManager() : clock(make_shared<SystemClock>()) {
     initTestData();
 }
 
@@ -27,64 +79,277 @@ void SystemManager::initTestData() {
 
     // Add Train G101: Beijing -> Shanghai
     Train t1("G101", "High-Speed", 100);
-    t1.addStop({"Beijing", "08:00", "08:00", 0.0, 0});
-    t1.addStop({"Jinan", "09:30", "09:35", 150.0, 400});
-    t1.addStop({"Nanjing", "11:30", "11:35", 350.0, 1000});
-    t1.addStop({"Shanghai", "13:00", "13:00", 553.0, 1318});
+    t1.addStop({"Beijing", 8 * 60, 8 * 60, 0.0, 0});
+    t1.addStop({"Jinan", 9 * 60 + 30, 9 * 60 + 35, 150.0, 400});
+    t1.addStop({"Nanjing", 11 * 60 + 30, 11 * 60 + 35, 350.0, 1000});
+    t1.addStop({"Shanghai", 13 * 60, 13 * 60, 553.0, 1318});
     addTrain(t1);
 
     // Add Train K505: Beijing -> Xi'an
     Train t2("K505", "Normal", 200);
-    t2.addStop({"Beijing", "07:00", "07:00", 0.0, 0});
-    t2.addStop({"Shijiazhuang", "10:00", "10:15", 50.0, 300});
-    t2.addStop({"Zhengzhou", "13:00", "13:20", 120.0, 700});
-    t2.addStop({"Xi'an", "18:00", "18:00", 200.0, 1200});
+    t2.addStop({"Beijing", 7 * 60, 7 * 60, 0.0, 0});
+    t2.addStop({"Shijiazhuang", 10 * 60, 10 * 60 + 15, 50.0, 300});
+    t2.addStop({"Zhengzhou", 13 * 60, 13 * 60 + 20, 120.0, 700});
+    t2.addStop({"Xi'an", 18 * 60, 18 * 60, 200.0, 1200});
     addTrain(t2);
 }
 
+bool SystemManager::registerUser(const string& username, const string& password, const string& name, const string& id) {
+    TRACE_SPAN("SystemManager::registerUser");
+    auto start = chrono::steady_clock::now();
+    bool ok = doRegisterUser(username, password, name, id);
+    metrics.record(METRIC_REGISTER, start, ok);
+    if (recorder) recorder->record(TRACE_REGISTER, start, {username, password, name, id}, ok);
+    return ok;
+}
+
 /**
  * @brief Registers a new user.
  * Checks for duplicate usernames.
  */
-bool SystemManager::registerUser(const string& username, const string& password, const string& name, const string& id) {
+bool SystemManager::doRegisterUser(const string& username, const string& password, const string& name, const string& id) {
+    unique_lock<shared_mutex> lock(usersMutex);
     if (users.find(username) != users.end()) {
         return false;
     }
-    users[username] = make_shared<Passenger>(username, password, name, id);
+    users.emplace(username, make_shared<Passenger>(username, password, name, id));
+    // Logged under the lock, so the user's later orders come after it in the log
+    if (ReplicationLog* log = replicationLog.load()) log->logRegister(username, password, name, id);
     return true;
 }
 
+string SystemManager::login(const string& username, const string& password) {
+    TRACE_SPAN("SystemManager::login");
+    auto start = chrono::steady_clock::now();
+    string token = doLogin(username, password);
+    metrics.record(METRIC_LOGIN, start, !token.empty());
+    if (recorder) recorder->record(TRACE_LOGIN, start, {username, password}, !token.empty(), token);
+    return token;
+}
+
 /**
  * @brief Logs in a user.
- * Verifies credentials and sets current user.
+ * Verifies credentials and opens a new session for the user.
  */
-shared_ptr<User> SystemManager::login(const string& username, const string& password) {
-    auto it = users.find(username);
-    if (it != users.end() && it->second->checkPassword(password)) {
-        currentUser = it->second;
-        return currentUser;
+string SystemManager::doLogin(const string& username, const string& password) {
+    shared_ptr<User> user;
+    {
+        shared_lock<shared_mutex> lock(usersMutex);
+        auto it = users.find(username);
+        if (it == users.end() || !it->second->checkPassword(password)) {
+            return "";
+        }
+        user = it->second;
     }
-    return nullptr;
+    return sessions.createSession(user);
+}
+
+void SystemManager::logout(const string& session) {
+    auto start = chrono::steady_clock::now();
+    sessions.closeSession(session);
+    if (recorder) recorder->record(TRACE_LOGOUT, start, {session}, 1);
 }
 
-void SystemManager::logout() {
-    currentUser = nullptr;
+shared_ptr<User> SystemManager::getSessionUser(const string& session) {
+    return sessions.getUser(session);
 }
 
+/**
+ * @brief Resolves a session to a passenger.
+ * The shared_ptr is handed back through holder so the passenger stays alive
+ * for the duration of the call even if the session is closed concurrently.
+ */
+Passenger* SystemManager::getSessionPassenger(const string& session, shared_ptr<User>& holder) {
+    holder = sessions.getUser(session);
+    return dynamic_cast<Passenger*>(holder.get());
+}
+
+/**
+ * @brief Shares the train's route with equal ones already stored, publishes
+ * its schedule, then stores it; the timetable is never updated while the
+ * train table is locked. The train is logged before anyone can book on it.
+ */
 void SystemManager::addTrain(const Train& train) {
-    trains[train.getId()] = train;
+    addTrain(Train(train));
 }
 
+void SystemManager::addTrain(Train&& train) {
+    prepareTrain(train);
+    updateTimetable([&train](Timetable& next) { next.put(train); });
+    if (ReplicationLog* log = replicationLog.load()) log->logTrains({&train});
+    storeTrain(move(train));
+}
+
+void SystemManager::addTrains(vector<Train>&& batch) {
+    for (Train& train : batch) prepareTrain(train);
+    updateTimetable([&batch](Timetable& next) {
+        for (const Train& train : batch) next.put(train);
+    });
+    if (ReplicationLog* log = replicationLog.load()) {
+        vector<const Train*> logged;
+        for (const Train& train : batch) logged.push_back(&train);
+        log->logTrains(logged);
+    }
+    for (Train& train : batch) storeTrain(move(train));
+}
+
+void SystemManager::prepareTrain(Train& train) {
+    train.internRoute(routeTable);
+    train.setInventoryListener(&inventoryEvents);
+    if (pricing) train.setPricingPolicy(pricing);
+}
+
+void SystemManager::storeTrain(Train&& train) {
+    string id = train.getId();
+    if (shardPool) {
+        shardPool->call(shardPool->shardOf(id), [&id, &train](TrainShardPool::TrainMap& shard) {
+            shard.insert_or_assign(move(id), move(train));
+        });
+        return;
+    }
+    unique_lock<shared_mutex> lock(trainsMutex);
+    trains.insert_or_assign(move(id), move(train));
+}
+
+/**
+ * @brief The train's orders are refunded after it is gone, so no booking
+ * can slip in between.
+ */
 bool SystemManager::deleteTrain(const string& trainId) {
-    auto it = trains.find(trainId);
-    if (it != trains.end()) {
-        trains.erase(it);
+    TRACE_SPAN("SystemManager::deleteTrain");
+    if (!eraseTrain(trainId)) return false;
+    TrainCancellation refunds;
+    refunds.found = true;
+    refundTrainOrders(trainId, INT_MIN, INT_MAX, refunds, nullptr);
+    return true;
+}
+
+bool SystemManager::eraseTrain(const string& trainId) {
+    bool erased;
+    if (shardPool) {
+        erased = shardPool->call(shardPool->shardOf(trainId), [&trainId](TrainShardPool::TrainMap& shard) {
+            return shard.erase(trainId) > 0;
+        });
+    } else {
+        unique_lock<shared_mutex> lock(trainsMutex);
+        erased = trains.erase(trainId) > 0;
+    }
+    if (!erased) return false;
+    updateTimetable([&trainId](Timetable& next) { next.erase(trainId); });
+    if (ReplicationLog* log = replicationLog.load()) log->logDeleteTrain(trainId);
+    return true;
+}
+
+TrainCancellation SystemManager::cancelTrain(const string& trainId, const string& firstDate, const string& lastDate,
+                                             const CancellationProgress& progress) {
+    TRACE_SPAN("SystemManager::cancelTrain");
+    int firstDay = INT_MIN, lastDay = INT_MAX;
+    TrainCancellation result;
+    if (!firstDate.empty() && !Calendar::parseDate(firstDate, firstDay)) return result;
+    if (!lastDate.empty() && !Calendar::parseDate(lastDate, lastDay)) return result;
+    if (firstDay > lastDay || !closeService(trainId, firstDay, lastDay, result.droppedDates)) return result;
+    result.found = true;
+    refundTrainOrders(trainId, firstDay, lastDay, result, progress);
+    return result;
+}
+
+/**
+ * @brief Bookings check the calendar while holding the train, so none
+ * reserves seats on a cancelled run once this returns.
+ */
+bool SystemManager::closeService(const string& trainId, int firstDay, int lastDay, size_t& droppedDates) {
+    Train schedule;
+    bool found = withTrain(trainId, [&](Train* t) {
+        if (!t) return false;
+        droppedDates = t->cancelService(firstDay, lastDay);
+        schedule = t->getTimetable();
         return true;
+    });
+    if (!found) return false;
+    updateTimetable([&schedule](Timetable& next) { next.put(schedule); });
+    if (ReplicationLog* log = replicationLog.load()) log->logCancelTrain(trainId, firstDay, lastDay);
+    return true;
+}
+
+/**
+ * @brief Batches are handed out from a shared counter to up to one worker
+ * per core. Each batch is sorted by owner so every history is locked once
+ * per batch, and is logged as one CANCEL record.
+ */
+void SystemManager::refundTrainOrders(const string& trainId, int firstDay, int lastDay, TrainCancellation& result,
+                                      const CancellationProgress& progress) {
+    TRACE_SPAN("SystemManager::refundTrainOrders");
+    atomic<size_t> processed{0};
+    atomic<size_t> refunded{0};
+    atomic<int64_t> refundedCents{0};
+    mutex progressMutex;
+
+    // The second pass picks up orders recorded while the first ran
+    for (int pass = 0; pass < 2; ++pass) {
+        vector<TrainOrderEntry> entries = trainOrders.take(trainId, firstDay, lastDay);
+        if (entries.empty()) continue;
+        result.affectedOrders += entries.size();
+        size_t batches = (entries.size() + CANCELLATION_BATCH_ORDERS - 1) / CANCELLATION_BATCH_ORDERS;
+        atomic<size_t> nextBatch{0};
+
+        auto work = [&]() {
+            vector<Order> cancelled;
+            vector<size_t> positions;
+            for (size_t batch; (batch = nextBatch++) < batches;) {
+                auto begin = entries.begin() + batch * CANCELLATION_BATCH_ORDERS;
+                auto end = entries.begin() + min(entries.size(), (batch + 1) * CANCELLATION_BATCH_ORDERS);
+                sort(begin, end, [](const TrainOrderEntry& a, const TrainOrderEntry& b) {
+                    return tie(a.user, a.position) < tie(b.user, b.position);
+                });
+                cancelled.clear();
+                for (auto group = begin; group != end;) {
+                    positions.clear();
+                    auto next = group;
+                    for (; next != end && next->user == group->user; ++next) positions.push_back(next->position);
+                    if (Passenger* p = dynamic_cast<Passenger*>(group->user.get())) p->cancelPaidAt(positions, cancelled);
+                    group = next;
+                }
+                if (ReplicationLog* log = replicationLog.load()) {
+                    if (!cancelled.empty()) log->logCancels(cancelled);
+                }
+
+                int64_t cents = 0;
+                for (const Order& order : cancelled) {
+                    cents += order.getPrice().getCents();
+                    // The cancelled runs' seats went with their inventory
+                    int day = serviceDayOf(order.getDate(), order.getDepartureMinutes());
+                    if (order.getTrainId() == trainId && day >= firstDay && day <= lastDay) continue;
+                    releaseSeats({order.getTrainId(), order.getStartStation(), order.getEndStation(), order.getDate(),
+                                  order.getSeatClass()},
+                                 order.getTicketCount());
+                }
+                processed += static_cast<size_t>(end - begin);
+                refunded += cancelled.size();
+                refundedCents += cents;
+
+                if (progress) {
+                    lock_guard<mutex> lock(progressMutex);
+                    TrainCancellation snapshot = result;
+                    snapshot.processedOrders = processed;
+                    snapshot.refundedOrders = refunded;
+                    snapshot.refundedAmount = Money(refundedCents);
+                    progress(snapshot);
+                }
+            }
+        };
+        size_t workers = min<size_t>(batches, max(1u, thread::hardware_concurrency()));
+        vector<thread> threads;
+        for (size_t i = 1; i < workers; ++i) threads.emplace_back(work);
+        work();
+        for (thread& t : threads) t.join();
     }
-    return false;
+    result.processedOrders = processed;
+    result.refundedOrders = refunded;
+    result.refundedAmount = Money(refundedCents);
 }
 
 Train* SystemManager::getTrain(const string& trainId) {
+    if (shardPool) return nullptr;
     auto it = trains.find(trainId);
     if (it != trains.end()) {
         return &(it->second);
@@ -92,66 +357,895 @@ Train* SystemManager::getTrain(const string& trainId) {
     return nullptr;
 }
 
+map<string, Train> SystemManager::getAllTrains() const {
+    if (shardPool) {
+        map<string, Train> all;
+        for (size_t i = 0; i < shardPool->getShardCount(); ++i) {
+            TrainShardPool::TrainMap part = shardPool->call(i, [](TrainShardPool::TrainMap& shard) { return shard; });
+            all.insert(part.begin(), part.end());
+        }
+        return all;
+    }
+    shared_lock<shared_mutex> lock(trainsMutex);
+    return trains;
+}
+
+/**
+ * @brief Copies only seat counts, not whole trains; sharded mode asks every shard.
+ */
+vector<TrainOccupancy> SystemManager::getOccupancy(const string& date) const {
+    auto collect = [&date](const map<string, Train>& table, vector<TrainOccupancy>& out) {
+        for (const auto& pair : table) {
+            const Train& t = pair.second;
+            out.push_back({pair.first, t.getTotalSeats(), t.getAvailableSeats(date), t.getInventoryVersion()});
+        }
+    };
+    vector<TrainOccupancy> result;
+    if (shardPool) {
+        for (size_t i = 0; i < shardPool->getShardCount(); ++i) {
+            vector<TrainOccupancy> part = shardPool->call(i, [&collect](TrainShardPool::TrainMap& shard) {
+                vector<TrainOccupancy> found;
+                collect(shard, found);
+                return found;
+            });
+            result.insert(result.end(), make_move_iterator(part.begin()), make_move_iterator(part.end()));
+        }
+        sort(result.begin(), result.end(),
+             [](const TrainOccupancy& a, const TrainOccupancy& b) { return a.trainId < b.trainId; });
+        return result;
+    }
+    shared_lock<shared_mutex> lock(trainsMutex);
+    result.reserve(trains.size());
+    collect(trains, result);
+    return result;
+}
+
+void SystemManager::setPricingPolicy(shared_ptr<const PricingPolicy> policy) {
+    pricing = move(policy);
+    auto apply = [this](map<string, Train>& table) {
+        for (auto& pair : table) pair.second.setPricingPolicy(pricing);
+    };
+    if (shardPool) {
+        for (size_t i = 0; i < shardPool->getShardCount(); ++i) {
+            shardPool->call(i, [&apply](TrainShardPool::TrainMap& shard) { apply(shard); });
+        }
+        return;
+    }
+    unique_lock<shared_mutex> lock(trainsMutex);
+    apply(trains);
+}
+
+void SystemManager::enableAdmissionControl(const AdmissionConfig& config) {
+    admission = make_unique<AdmissionController>(config);
+}
+
+/**
+ * @brief Moves every train to the owner of the new execution mode.
+ */
+void SystemManager::setShardCount(size_t shardCount) {
+    map<string, Train> all;
+    if (shardPool) {
+        for (size_t i = 0; i < shardPool->getShardCount(); ++i) {
+            TrainShardPool::TrainMap part = shardPool->call(i, [](TrainShardPool::TrainMap& shard) { return move(shard); });
+            all.insert(make_move_iterator(part.begin()), make_move_iterator(part.end()));
+        }
+        shardPool.reset();
+    } else {
+        all.swap(trains);
+    }
+
+    if (shardCount == 0) {
+        trains.swap(all);
+        return;
+    }
+
+    shardPool = make_unique<TrainShardPool>(shardCount);
+    vector<TrainShardPool::TrainMap> parts(shardCount);
+    for (auto& pair : all) {
+        parts[shardPool->shardOf(pair.first)].insert(move(pair));
+    }
+    for (size_t i = 0; i < shardCount; ++i) {
+        TrainShardPool::TrainMap& part = parts[i];
+        shardPool->call(i, [&part](TrainShardPool::TrainMap& shard) { shard.swap(part); });
+    }
+}
+
+vector<Train> SystemManager::searchTrains(const string& startStation, const string& endStation, const string& date,
+                                          const TimeWindow& window) {
+    TRACE_SPAN("SystemManager::searchTrains");
+    auto start = chrono::steady_clock::now();
+    vector<Train> result = doSearchTrains(startStation, endStation, date, window);
+    metrics.record(METRIC_SEARCH, start, Calendar::isValidDate(date));
+    if (recorder) recorder->record(TRACE_SEARCH, start, searchTraceArgs(startStation, endStation, date, window),
+                                   static_cast<int64_t>(result.size()));
+    return result;
+}
+
+/**
+ * @brief The sold-out flag is only ever set for trains without overnight
+ * boarding, so it is checked before the route is looked at.
+ */
+bool SystemManager::matchesSearch(const Train& train, const string& startStation, const string& endStation,
+                                  const string& date, const TimeWindow& window) const {
+    if (admission && admission->isSoldOut(train.getId(), date)) return false;
+    int startIndex, endIndex;
+    if (!train.findSegment(startStation, endStation, startIndex, endIndex)) return false;
+    if (!window.contains(train.getDepartureMinutes(startIndex))) return false;
+    if (train.getDayOffset(startIndex) == 0) return train.hasSeats(date, startIndex, endIndex);
+    return train.hasSeats(train.getServiceDate(date, startIndex), startIndex, endIndex);
+}
+
+/**
+ * @brief The reader stays pinned only while the candidates are copied out.
+ * A date that does not exist has no candidates.
+ */
+vector<string> SystemManager::searchCandidates(const string& startStation, const string& endStation, const string& date,
+                                               const TimeWindow& window) const {
+    if (!Calendar::isValidDate(date)) return {};
+    TimetableSnapshot snapshot = getTimetable();
+    return snapshot->candidates(startStation, endStation, date, window);
+}
+
+vector<vector<string>> SystemManager::splitByShard(const vector<string>& trainIds) const {
+    vector<vector<string>> perShard(shardPool->getShardCount());
+    for (const string& id : trainIds) perShard[shardPool->shardOf(id)].push_back(id);
+    return perShard;
+}
+
 /**
  * @brief Searches for trains.
  * Returns a list of trains that have availability between start and end stations.
+ * Only the candidates of the current timetable version (route, calendar
+ * and window checked without locks) are looked up; in sharded mode every
+ * shard checks its own candidates in parallel.
  */
-vector<Train> SystemManager::searchTrains(const string& startStation, const string& endStation, const string& date) {
+vector<Train> SystemManager::doSearchTrains(const string& startStation, const string& endStation, const string& date,
+                                            const TimeWindow& window) {
     vector<Train> result;
-    for (auto& pair : trains) {
-        Train& t = pair.second;
-        if (t.hasTickets(date, startStation, endStation)) {
-            result.push_back(t);
+    vector<string> candidates = searchCandidates(startStation, endStation, date, window);
+    if (candidates.empty()) return result;
+    if (shardPool) {
+        vector<vector<string>> perShard = splitByShard(candidates);
+        vector<future<vector<Train>>> parts;
+        for (size_t i = 0; i < perShard.size(); ++i) {
+            if (perShard[i].empty()) continue;
+            const vector<string>& ids = perShard[i];
+            parts.push_back(shardPool->submit(i, [&](TrainShardPool::TrainMap& shard) {
+                vector<Train> found;
+                for (const string& id : ids) {
+                    auto it = shard.find(id);
+                    if (it != shard.end() && matchesSearch(it->second, startStation, endStation, date, window)) {
+                        found.push_back(it->second);
+                    }
+                }
+                return found;
+            }));
+        }
+        for (auto& part : parts) {
+            vector<Train> found = part.get();
+            result.insert(result.end(), make_move_iterator(found.begin()), make_move_iterator(found.end()));
+        }
+        sort(result.begin(), result.end(), [](const Train& a, const Train& b) { return a.getId() < b.getId(); });
+        return result;
+    }
+
+    shared_lock<shared_mutex> lock(trainsMutex);
+    for (const string& id : candidates) {
+        auto it = trains.find(id);
+        if (it != trains.end() && matchesSearch(it->second, startStation, endStation, date, window)) {
+            result.push_back(it->second);
         }
     }
     return result;
 }
 
 /**
- * @brief Books a ticket.
- * Reduces inventory and creates an order for the current user.
+ * @brief Chunked search: the read lock (or shard) is never held while the sink runs.
  */
-bool SystemManager::bookTicket(const string& trainId, const string& start, const string& end, const string& date, int count) {
-    if (!currentUser) return false;
-    
-    Train* t = getTrain(trainId);
-    if (!t) return false;
-
-    if (t->bookTickets(date, start, end, count)) {
-        double price = t->getPrice(start, end) * count;
-        string time = t->getDepartureTime(start);
-        Order order(currentUser->getUsername(), trainId, start, end, date, time, price, count);
-        
-        // If current user is passenger, add to history
-        Passenger* p = dynamic_cast<Passenger*>(currentUser.get());
-        if (p) {
-            p->addOrder(order);
+bool SystemManager::searchTrainsStreaming(const string& startStation, const string& endStation, const string& date,
+                                          const SearchBatchSink& sink, const atomic<bool>* cancel,
+                                          const TimeWindow& window) {
+    TRACE_SPAN("SystemManager::searchTrainsStreaming");
+    auto start = chrono::steady_clock::now();
+    auto cancelled = [cancel] { return cancel && cancel->load(memory_order_relaxed); };
+    int64_t total = 0;
+    bool completed;
+    vector<string> candidates = searchCandidates(startStation, endStation, date, window);
+
+    if (shardPool) {
+        vector<vector<string>> perShard = splitByShard(candidates);
+        vector<future<vector<Train>>> parts;
+        for (size_t i = 0; i < perShard.size(); ++i) {
+            if (perShard[i].empty()) continue;
+            const vector<string>& ids = perShard[i];
+            parts.push_back(shardPool->submit(i, [&](TrainShardPool::TrainMap& shard) {
+                vector<Train> found;
+                size_t scanned = 0;
+                for (const string& id : ids) {
+                    if (++scanned % SEARCH_CHUNK_TRAINS == 0 && cancelled()) break;
+                    auto it = shard.find(id);
+                    if (it != shard.end() && matchesSearch(it->second, startStation, endStation, date, window)) {
+                        found.push_back(it->second);
+                    }
+                }
+                return found;
+            }));
         }
-        return true;
+        // Every part is waited for: the shard lambdas reference this frame
+        for (auto& part : parts) {
+            vector<Train> found = part.get();
+            if (cancelled() || found.empty()) continue;
+            sort(found.begin(), found.end(), [](const Train& a, const Train& b) { return a.getId() < b.getId(); });
+            total += static_cast<int64_t>(found.size());
+            sink(found);
+        }
+        completed = !cancelled();
+    } else {
+        // Candidates are in ID order, so chunks are too
+        size_t next = 0;
+        bool done = candidates.empty();
+        while (!done && !cancelled()) {
+            vector<Train> found;
+            {
+                shared_lock<shared_mutex> lock(trainsMutex);
+                size_t chunkEnd = min(next + SEARCH_CHUNK_TRAINS, candidates.size());
+                for (; next < chunkEnd; ++next) {
+                    auto it = trains.find(candidates[next]);
+                    if (it != trains.end() && matchesSearch(it->second, startStation, endStation, date, window)) {
+                        found.push_back(it->second);
+                    }
+                }
+                done = next == candidates.size();
+            }
+            if (!found.empty()) {
+                total += static_cast<int64_t>(found.size());
+                sink(found);
+            }
+        }
+        completed = done;
     }
-    return false;
+
+    // Cancelled searches are neither failures nor replayable calls
+    if (completed) {
+        metrics.record(METRIC_SEARCH, start, true);
+        if (recorder) recorder->record(TRACE_SEARCH, start, searchTraceArgs(startStation, endStation, date, window), total);
+    }
+    return completed;
 }
 
 /**
- * @brief Refunds a ticket.
- * Cancels the order and releases the inventory.
+ * @brief Reserves seats on one train, on whichever thread owns it.
+ */
+BookingStatus SystemManager::reserveSeats(const TripLeg& leg, int count, Money& price, int& departureMinutes) {
+    TRACE_SPAN("SystemManager::reserveSeats");
+    int today = getCurrentDay();
+    return withTrain(leg.trainId, [&](Train* t) { return reserveLeg(t, leg, count, today, price, departureMinutes); });
+}
+
+BookingStatus SystemManager::reserveLeg(Train* train, const TripLeg& leg, int count, int today, Money& price, int& departureMinutes) {
+    if (!train) return UNKNOWN_TRAIN;
+    int startIndex, endIndex;
+    bool validStations;
+    {
+        TRACE_SPAN("station lookup");
+        validStations = train->findSegment(leg.startStation, leg.endStation, startIndex, endIndex);
+    }
+    if (!validStations) return INVALID_STATIONS;
+    string serviceDate = train->getServiceDate(leg.date, startIndex);
+    if (!train->runsOn(serviceDate)) return NOT_RUNNING;
+    Money fare = train->quote(startIndex, endIndex, serviceDate, today, leg.seatClass);
+    if (!train->bookTickets(serviceDate, leg.startStation, leg.endStation, count, leg.seatClass)) return SOLD_OUT;
+    // Flag updates happen while the train is held, so they are ordered with refunds
+    markIfSoldOut(*train, serviceDate);
+    price = fare * count;
+    departureMinutes = train->getDepartureMinutes(startIndex);
+    return BOOKED;
+}
+
+/**
+ * @brief All-or-nothing reservation of several legs.
+ * See SystemManager::bookJourney for the locking protocol.
+ */
+BookingStatus SystemManager::reserveAll(const vector<TripLeg>& legs, int count, vector<Money>& prices, vector<int>& departureTimes) {
+    TRACE_SPAN("SystemManager::reserveAll");
+    int today = getCurrentDay();
+    prices.assign(legs.size(), Money());
+    departureTimes.assign(legs.size(), -1);
+
+    if (!shardPool) {
+        unique_lock<shared_mutex> lock(trainsMutex);
+        for (size_t i = 0; i < legs.size(); ++i) {
+            auto it = trains.find(legs[i].trainId);
+            Train* train = it == trains.end() ? nullptr : &it->second;
+            BookingStatus status = reserveLeg(train, legs[i], count, today, prices[i], departureTimes[i]);
+            if (status == BOOKED) continue;
+            // Rolled back before the lock is released, so nobody sees the partial journey
+            while (i-- > 0) {
+                releaseLeg(&trains.find(legs[i].trainId)->second, legs[i], count);
+            }
+            return status;
+        }
+        return BOOKED;
+    }
+
+    // Deterministic reservation order across shards; legs of one train keep travel order
+    vector<size_t> order(legs.size());
+    vector<size_t> shards(legs.size());
+    for (size_t i = 0; i < legs.size(); ++i) {
+        order[i] = i;
+        shards[i] = shardPool->shardOf(legs[i].trainId);
+    }
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return tie(shards[a], legs[a].trainId, a) < tie(shards[b], legs[b].trainId, b);
+    });
+
+    size_t begin = 0;
+    while (begin < order.size()) {
+        size_t end = begin;
+        while (end < order.size() && shards[order[end]] == shards[order[begin]]) ++end;
+        // Every leg on this shard is reserved, or rolled back, in one message
+        BookingStatus status = shardPool->call(shards[order[begin]], [&](TrainShardPool::TrainMap& shard) {
+            for (size_t k = begin; k < end; ++k) {
+                size_t i = order[k];
+                auto it = shard.find(legs[i].trainId);
+                BookingStatus legStatus = reserveLeg(it == shard.end() ? nullptr : &it->second, legs[i], count, today,
+                                                     prices[i], departureTimes[i]);
+                if (legStatus == BOOKED) continue;
+                while (k-- > begin) {
+                    releaseLeg(&shard.find(legs[order[k]].trainId)->second, legs[order[k]], count);
+                }
+                return legStatus;
+            }
+            return BOOKED;
+        });
+        if (status != BOOKED) {
+            // Compensate the shards already visited
+            while (begin-- > 0) {
+                releaseSeats(legs[order[begin]], count);
+            }
+            return status;
+        }
+        begin = end;
+    }
+    return BOOKED;
+}
+
+/**
+ * @brief Groups the batch by train and date and applies each group in one pass.
+ */
+void SystemManager::reserveSeatsBatch(vector<SeatRequest*>& requests) {
+    TRACE_SPAN("SystemManager::reserveSeatsBatch");
+    // Stable: requests for one train and date keep their arrival order
+    stable_sort(requests.begin(), requests.end(), [](const SeatRequest* a, const SeatRequest* b) {
+        if (a->leg.trainId != b->leg.trainId) return a->leg.trainId < b->leg.trainId;
+        return a->leg.date < b->leg.date;
+    });
+
+    if (shardPool) {
+        // One message per shard holding all of that shard's trains in the batch
+        size_t shardCount = shardPool->getShardCount();
+        vector<vector<SeatRequest*>> perShard(shardCount);
+        for (SeatRequest* req : requests) {
+            perShard[shardPool->shardOf(req->leg.trainId)].push_back(req);
+        }
+        vector<future<void>> done;
+        for (size_t i = 0; i < shardCount; ++i) {
+            if (perShard[i].empty()) continue;
+            vector<SeatRequest*>& part = perShard[i];
+            done.push_back(shardPool->submit(i, [this, &part](TrainShardPool::TrainMap& shard) {
+                size_t begin = 0;
+                while (begin < part.size()) {
+                    size_t end = begin;
+                    while (end < part.size() && part[end]->leg.trainId == part[begin]->leg.trainId) ++end;
+                    auto it = shard.find(part[begin]->leg.trainId);
+                    reserveOnTrain(it == shard.end() ? nullptr : &it->second, &part[begin], &part[0] + end);
+                    begin = end;
+                }
+            }));
+        }
+        for (auto& f : done) f.get();
+        return;
+    }
+
+    unique_lock<shared_mutex> lock(trainsMutex);
+    size_t begin = 0;
+    while (begin < requests.size()) {
+        size_t end = begin;
+        while (end < requests.size() && requests[end]->leg.trainId == requests[begin]->leg.trainId) ++end;
+        auto it = trains.find(requests[begin]->leg.trainId);
+        reserveOnTrain(it == trains.end() ? nullptr : &it->second, &requests[begin], &requests[0] + end);
+        begin = end;
+    }
+}
+
+/**
+ * @brief Resolves stations and books each date group with Train::bookSegments.
  */
-bool SystemManager::refundTicket(const string& orderId) {
-    if (!currentUser) return false;
+void SystemManager::reserveOnTrain(Train* train, SeatRequest** begin, SeatRequest** end) {
+    if (!train) {
+        for (SeatRequest** r = begin; r != end; ++r) (*r)->status = UNKNOWN_TRAIN;
+        return;
+    }
+
+    int today = getCurrentDay();
+    vector<SegmentRequest> segments;
+    vector<SeatRequest*> pending;
+    vector<string> serviceDates;
+    vector<SegmentRequest> service;
+    vector<size_t> members;
+    while (begin != end) {
+        SeatRequest** groupEnd = begin;
+        while (groupEnd != end && (*groupEnd)->leg.date == (*begin)->leg.date) ++groupEnd;
+
+        segments.clear();
+        pending.clear();
+        serviceDates.clear();
+        for (SeatRequest** r = begin; r != groupEnd; ++r) {
+            SeatRequest& req = **r;
+            int startIndex, endIndex;
+            if (req.count <= 0) {
+                req.status = INVALID_COUNT;
+            } else if (!Calendar::isValidDate(req.leg.date)) {
+                req.status = INVALID_DATE;
+            } else if (!train->findSegment(req.leg.startStation, req.leg.endStation, startIndex, endIndex)) {
+                req.status = INVALID_STATIONS;
+            } else if (!train->runsOn(train->getServiceDate(req.leg.date, startIndex))) {
+                req.status = NOT_RUNNING;
+            } else {
+                segments.push_back({startIndex, endIndex, req.count, req.leg.seatClass, false});
+                pending.push_back(&req);
+                serviceDates.push_back(train->getServiceDate(req.leg.date, startIndex));
+            }
+        }
+
+        // Requests travelling on one date can board different services of an
+        // overnight train; each service is booked in one pass, in arrival order
+        vector<bool> done(segments.size(), false);
+        for (size_t first = 0; first < segments.size(); ++first) {
+            if (done[first]) continue;
+            const string& serviceDate = serviceDates[first];
+            service.clear();
+            members.clear();
+            for (size_t i = first; i < segments.size(); ++i) {
+                if (done[i] || serviceDates[i] != serviceDate) continue;
+                done[i] = true;
+                members.push_back(i);
+                service.push_back(segments[i]);
+                // Quoted before the batch takes any seats
+                pending[i]->price = train->quote(segments[i].startIndex, segments[i].endIndex, serviceDate, today,
+                                                 segments[i].seatClass) * segments[i].count;
+            }
 
-    Passenger* p = dynamic_cast<Passenger*>(currentUser.get());
+            train->bookSegments(serviceDate, service);
+            markIfSoldOut(*train, serviceDate);
+            for (size_t j = 0; j < members.size(); ++j) {
+                SeatRequest& req = *pending[members[j]];
+                if (!service[j].granted) {
+                    req.status = SOLD_OUT;
+                    req.price = Money();
+                    continue;
+                }
+                req.status = BOOKED;
+                req.departureMinutes = train->getDepartureMinutes(service[j].startIndex);
+            }
+        }
+        begin = groupEnd;
+    }
+}
+
+/**
+ * @brief Sold-out flags are keyed by travel date, which only matches the
+ * service date on trains without overnight boarding; other trains go
+ * without the shortcut.
+ */
+void SystemManager::markIfSoldOut(const Train& train, const string& serviceDate) {
+    if (admission && !train.hasOvernightBoarding() && train.isSoldOut(serviceDate)) {
+        admission->setSoldOut(train.getId(), serviceDate, true);
+    }
+}
+
+void SystemManager::releaseSeats(const TripLeg& leg, int count) {
+    TRACE_SPAN("SystemManager::releaseSeats");
+    withTrain(leg.trainId, [&](Train* t) { releaseLeg(t, leg, count); });
+}
+
+void SystemManager::releaseLeg(Train* train, const TripLeg& leg, int count) {
+    int startIndex, endIndex;
+    if (!train || !train->findSegment(leg.startStation, leg.endStation, startIndex, endIndex)) return;
+    string serviceDate = train->getServiceDate(leg.date, startIndex);
+    train->releaseTickets(serviceDate, leg.startStation, leg.endStation, count, leg.seatClass);
+    if (admission) admission->setSoldOut(leg.trainId, serviceDate, false);
+}
+
+/**
+ * @brief Creates and indexes the order for seats that are already reserved.
+ * The order is built in place in the history; its ID is formatted once
+ * and copied only into the order and the index.
+ */
+string SystemManager::recordOrder(const shared_ptr<User>& user, const TripLeg& leg, int departureMinutes, Money price, int count) {
+    TRACE_SPAN("SystemManager::recordOrder");
+    time_t now = clock->now();
+    // Admin bookings use up a sequence number too, so IDs do not depend on who books
+    unsigned sequence = ++orderSequence;
+
+    // If the user is a passenger, add to history
+    Passenger* p = dynamic_cast<Passenger*>(user.get());
+    if (!p) return "";
+    string orderId = Order::generateOrderId(now, sequence);
+    size_t position = p->emplaceOrder(user->getUsername(), leg.trainId, leg.startStation, leg.endStation, leg.date,
+                                      departureMinutes, price, count, orderId, now, leg.seatClass);
+    // Logged before the index makes the order refundable
+    if (ReplicationLog* log = replicationLog.load()) {
+        log->logOrders({Order(user->getUsername(), leg.trainId, leg.startStation, leg.endStation, leg.date, departureMinutes, price,
+                              count, orderId, now, leg.seatClass)},
+                       sequence);
+    }
+    orderIndex.insert(orderId, {user->getUsername(), position});
+    trainOrders.add(leg.trainId, {user, position, serviceDayOf(leg.date, departureMinutes)});
+    return orderId;
+}
+
+/**
+ * @brief Creates the orders of a journey next to each other in the
+ * history, linked by the first leg's order ID.
+ */
+void SystemManager::recordJourney(const shared_ptr<User>& user, const vector<TripLeg>& legs, const vector<int>& departureTimes,
+                                  const vector<Money>& prices, int count, vector<string>& orderIds) {
+    TRACE_SPAN("SystemManager::recordJourney");
+    if (legs.size() == 1) {
+        orderIds.push_back(recordOrder(user, legs[0], departureTimes[0], prices[0], count));
+        return;
+    }
+    time_t now = clock->now();
+    vector<unsigned> sequences(legs.size());
+    for (unsigned& sequence : sequences) sequence = ++orderSequence;
+
+    Passenger* p = dynamic_cast<Passenger*>(user.get());
+    if (!p) {
+        orderIds.assign(legs.size(), "");
+        return;
+    }
+    vector<Order> orders;
+    orders.reserve(legs.size());
+    for (size_t i = 0; i < legs.size(); ++i) {
+        const TripLeg& leg = legs[i];
+        orders.emplace_back(user->getUsername(), leg.trainId, leg.startStation, leg.endStation, leg.date, departureTimes[i], prices[i],
+                            count, Order::generateOrderId(now, sequences[i]), now, leg.seatClass);
+        orders.back().setJourney(orders.front().getOrderId(), static_cast<int>(i), static_cast<int>(legs.size()));
+        orderIds.push_back(orders.back().getOrderId());
+    }
+    if (ReplicationLog* log = replicationLog.load()) log->logOrders(orders, sequences.back());
+    size_t first = p->addOrderGroup(move(orders));
+    for (size_t i = 0; i < orderIds.size(); ++i) {
+        orderIndex.insert(orderIds[i], {user->getUsername(), first + i});
+        trainOrders.add(legs[i].trainId, {user, first + i, serviceDayOf(legs[i].date, departureTimes[i])});
+    }
+}
+
+/**
+ * @brief Seats are taken without a fare quote or admission check: the
+ * primary already charged the order and the log is applied in the order
+ * the primary reserved and released.
+ */
+bool SystemManager::applyOrders(vector<Order>&& orders, unsigned sequence) {
+    unsigned current = orderSequence.load();
+    while (current < sequence && !orderSequence.compare_exchange_weak(current, sequence)) {
+    }
+
+    shared_ptr<User> user;
+    {
+        shared_lock<shared_mutex> lock(usersMutex);
+        auto it = users.find(orders.front().getUsername());
+        if (it != users.end()) user = it->second;
+    }
+    Passenger* p = dynamic_cast<Passenger*>(user.get());
     if (!p) return false;
 
-    vector<Order>& orders = p->getOrders();
-    for (auto& order : orders) {
-        if (order.getOrderId() == orderId && order.getStatus() == PAID) {
-            order.setStatus(CANCELLED);
-            Train* t = getTrain(order.getTrainId());
-            if (t) {
-                t->releaseTickets(order.getDate(), order.getStartStation(), order.getEndStation(), order.getTicketCount());
+    for (size_t i = 0; i < orders.size(); ++i) {
+        const Order& order = orders[i];
+        bool reserved = withTrain(order.getTrainId(), [&](Train* t) {
+            int startIndex, endIndex;
+            if (!t || !t->findSegment(order.getStartStation(), order.getEndStation(), startIndex, endIndex)) return false;
+            string serviceDate = t->getServiceDate(order.getDate(), startIndex);
+            // Booked just before the run was cancelled: the primary's seats went with the inventory
+            if (!t->runsOn(serviceDate)) return true;
+            if (!t->bookTickets(serviceDate, order.getStartStation(), order.getEndStation(), order.getTicketCount(),
+                                order.getSeatClass())) {
+                return false;
             }
+            markIfSoldOut(*t, serviceDate);
             return true;
+        });
+        if (reserved) continue;
+        while (i-- > 0) {
+            releaseSeats({orders[i].getTrainId(), orders[i].getStartStation(), orders[i].getEndStation(), orders[i].getDate(),
+                          orders[i].getSeatClass()},
+                         orders[i].getTicketCount());
         }
+        return false;
+    }
+
+    vector<string> orderIds;
+    vector<string> trainIds;
+    vector<int> serviceDays;
+    for (const Order& order : orders) {
+        orderIds.push_back(order.getOrderId());
+        trainIds.push_back(order.getTrainId());
+        serviceDays.push_back(serviceDayOf(order.getDate(), order.getDepartureMinutes()));
+    }
+    size_t first = orders.size() == 1 ? p->addOrder(move(orders.front())) : p->addOrderGroup(move(orders));
+    for (size_t i = 0; i < orderIds.size(); ++i) {
+        orderIndex.insert(orderIds[i], {user->getUsername(), first + i});
+        trainOrders.add(trainIds[i], {user, first + i, serviceDays[i]});
+    }
+    return true;
+}
+
+bool SystemManager::applyCancel(const string& username, const string& orderId) {
+    OrderLocation location;
+    if (!orderIndex.find(orderId, location) || location.username != username) return false;
+    shared_ptr<User> user;
+    {
+        shared_lock<shared_mutex> lock(usersMutex);
+        auto it = users.find(username);
+        if (it != users.end()) user = it->second;
+    }
+    Passenger* p = dynamic_cast<Passenger*>(user.get());
+    Order cancelled;
+    if (!p || !p->cancelPaidOrderAt(location.position, orderId, cancelled)) return false;
+    releaseSeats({cancelled.getTrainId(), cancelled.getStartStation(), cancelled.getEndStation(), cancelled.getDate(),
+                  cancelled.getSeatClass()},
+                 cancelled.getTicketCount());
+    return true;
+}
+
+/**
+ * @brief Books a ticket.
+ * Reduces inventory and creates an order for the session's user.
+ */
+bool SystemManager::bookTicket(const string& session, const string& trainId, const string& start, const string& end, const string& date, int count,
+                               SeatClass seatClass) {
+    return placeBooking(session, trainId, start, end, date, count, seatClass).status == BOOKED;
+}
+
+BookingResult SystemManager::placeBooking(const string& session, const string& trainId, const string& start, const string& end, const string& date, int count,
+                                          SeatClass seatClass) {
+    TRACE_SPAN("SystemManager::placeBooking");
+    auto started = chrono::steady_clock::now();
+    BookingResult result = doPlaceBooking(session, trainId, start, end, date, count, seatClass);
+    reportBooking(session, {trainId, start, end, date, seatClass}, count, started, result);
+    return result;
+}
+
+void SystemManager::reportBooking(const string& session, const TripLeg& leg, int count, chrono::steady_clock::time_point started,
+                                  const BookingResult& result) {
+    metrics.record(METRIC_BOOK, started, result.status == BOOKED);
+    metrics.recordBooking(result.status);
+    if (recorder) {
+        recorder->record(TRACE_BOOK, started,
+                         {session, leg.trainId, leg.startStation, leg.endStation, leg.date, to_string(count), seatClassName(leg.seatClass)},
+                         result.status, result.orderId);
+    }
+}
+
+BookingResult SystemManager::doPlaceBooking(const string& session, const string& trainId, const string& start, const string& end, const string& date, int count,
+                                            SeatClass seatClass) {
+    BookingResult result;
+    shared_ptr<User> user = sessions.getUser(session);
+    if (!user) return result;
+    if (count <= 0) {
+        result.status = INVALID_COUNT;
+        return result;
+    }
+    // Checked before admission so no admission entry is made for it
+    if (!Calendar::isValidDate(date)) {
+        result.status = INVALID_DATE;
+        return result;
+    }
+
+    result.status = admitBooking(trainId, date, user->getUsername());
+    if (result.status != BOOKED) return result;
+
+    TripLeg leg{trainId, start, end, date, seatClass};
+    int departureMinutes;
+    result.status = reserveSeats(leg, count, result.price, departureMinutes);
+    if (result.status == BOOKED) {
+        result.orderId = recordOrder(user, leg, departureMinutes, result.price, count);
+    }
+    return result;
+}
+
+BookingStatus SystemManager::admitBooking(const string& trainId, const string& date, const string& username) {
+    if (!admission) return BOOKED;
+    if (!getTimetable()->find(trainId)) return UNKNOWN_TRAIN;
+    AdmissionDecision decision = admission->getConfig().waitForToken ? admission->admit(trainId, date, username)
+                                                                     : admission->tryAdmit(trainId, date);
+    switch (decision) {
+        case ADMITTED: return BOOKED;
+        case REJECTED_SOLD_OUT: return SOLD_OUT;
+        case DEFERRED: return RETRY_LATER;
+        default: return REJECTED_BUSY;
+    }
+}
+
+BookingStatus SystemManager::admitLegs(const vector<TripLeg>& legs, const string& username) {
+    if (!admission) return BOOKED;
+    for (size_t i = 0; i < legs.size(); ++i) {
+        BookingStatus status = admitBooking(legs[i].trainId, legs[i].date, username);
+        if (status == BOOKED) continue;
+        for (size_t j = 0; j < i; ++j) admission->release(legs[j].trainId, legs[j].date);
+        return status;
+    }
+    return BOOKED;
+}
+
+BookingStatus SystemManager::bookTransfer(const string& session, const TripLeg& first, const TripLeg& second, int count, vector<string>& orderIds) {
+    TRACE_SPAN("SystemManager::bookTransfer");
+    auto start = chrono::steady_clock::now();
+    BookingStatus status = doBookTransfer(session, first, second, count, orderIds);
+    metrics.record(METRIC_BOOK, start, status == BOOKED);
+    metrics.recordBooking(status);
+    if (recorder) recorder->record(TRACE_TRANSFER, start, legTraceArgs(session, {first, second}, count), status, joinOrderIds(orderIds));
+    return status;
+}
+
+/**
+ * @brief Books a two-train transfer all-or-nothing.
+ * See the header for the reserve/compensate protocol.
+ */
+BookingStatus SystemManager::doBookTransfer(const string& session, const TripLeg& first, const TripLeg& second, int count, vector<string>& orderIds) {
+    orderIds.clear();
+    shared_ptr<User> user = sessions.getUser(session);
+    if (!user) return NOT_LOGGED_IN;
+    if (count <= 0) return INVALID_COUNT;
+    if (!Calendar::isValidDate(first.date) || !Calendar::isValidDate(second.date)) return INVALID_DATE;
+
+    vector<TripLeg> legs = {first, second};
+    BookingStatus status = admitLegs(legs, user->getUsername());
+    if (status != BOOKED) return status;
+    vector<Money> prices;
+    vector<int> departureTimes;
+    status = reserveAll(legs, count, prices, departureTimes);
+    if (status != BOOKED) return status;
+
+    // Transfers stay two independent orders, each refundable on its own
+    orderIds.push_back(recordOrder(user, first, departureTimes[0], prices[0], count));
+    orderIds.push_back(recordOrder(user, second, departureTimes[1], prices[1], count));
+    return BOOKED;
+}
+
+BookingStatus SystemManager::bookJourney(const string& session, const vector<TripLeg>& legs, int count, vector<string>& orderIds) {
+    TRACE_SPAN("SystemManager::bookJourney");
+    auto start = chrono::steady_clock::now();
+    BookingStatus status = doBookJourney(session, legs, count, orderIds);
+    metrics.record(METRIC_BOOK, start, status == BOOKED);
+    metrics.recordBooking(status);
+    if (recorder) recorder->record(TRACE_JOURNEY, start, legTraceArgs(session, legs, count), status, joinOrderIds(orderIds));
+    return status;
+}
+
+BookingStatus SystemManager::doBookJourney(const string& session, const vector<TripLeg>& legs, int count, vector<string>& orderIds) {
+    orderIds.clear();
+    shared_ptr<User> user = sessions.getUser(session);
+    if (!user) return NOT_LOGGED_IN;
+    if (count <= 0) return INVALID_COUNT;
+    if (legs.empty()) return INVALID_STATIONS;
+    for (const TripLeg& leg : legs) {
+        if (!Calendar::isValidDate(leg.date)) return INVALID_DATE;
+    }
+
+    BookingStatus status = admitLegs(legs, user->getUsername());
+    if (status != BOOKED) return status;
+    vector<Money> prices;
+    vector<int> departureTimes;
+    status = reserveAll(legs, count, prices, departureTimes);
+    if (status != BOOKED) return status;
+    recordJourney(user, legs, departureTimes, prices, count, orderIds);
+    return BOOKED;
+}
+
+bool SystemManager::refundTicket(const string& session, const string& orderId) {
+    TRACE_SPAN("SystemManager::refundTicket");
+    auto start = chrono::steady_clock::now();
+    bool ok = doRefundTicket(session, orderId);
+    metrics.record(METRIC_REFUND, start, ok);
+    if (recorder) recorder->record(TRACE_REFUND, start, {session, orderId}, ok);
+    return ok;
+}
+
+/**
+ * @brief Refunds a ticket.
+ * Cancels the order and releases the inventory.
+ */
+bool SystemManager::doRefundTicket(const string& session, const string& orderId) {
+    shared_ptr<User> holder;
+    Passenger* p = getSessionPassenger(session, holder);
+    if (!p) return false;
+
+    OrderLocation location;
+    if (!orderIndex.find(orderId, location) || location.username != p->getUsername()) return false;
+
+    // A journey's orders are cancelled together, then each leg's seats are returned
+    vector<Order> cancelled;
+    if (!p->cancelPaidJourneyAt(location.position, orderId, cancelled)) return false;
+    // Logged before the seats are returned, so replicas never hold fewer seats than the primary
+    if (ReplicationLog* log = replicationLog.load()) log->logCancels(cancelled);
+
+    for (const Order& order : cancelled) {
+        releaseSeats({order.getTrainId(), order.getStartStation(), order.getEndStation(), order.getDate(), order.getSeatClass()},
+                     order.getTicketCount());
+    }
+    return true;
+}
+
+/**
+ * @brief Lists orders for a session.
+ */
+vector<Order> SystemManager::getOrders(const string& session) {
+    shared_ptr<User> holder;
+    Passenger* p = getSessionPassenger(session, holder);
+    if (!p) return {};
+    return p->getOrdersSnapshot();
+}
+
+/**
+ * @brief Walks trains (per shard in sharded mode), users and indexes.
+ */
+MemoryReport SystemManager::getMemoryReport() const {
+    MemoryReport report;
+    // Shared routes are charged once, to whichever train is walked first
+    set<const Route*> seenRoutes;
+    auto addTrains = [&report, &seenRoutes](const map<string, Train>& table) {
+        report.trains += MemoryUsage::nodeBytes(table);
+        for (const auto& pair : table) {
+            const Train& t = pair.second;
+            TrainMemory train;
+            train.trainId = pair.first;
+            train.routeBytes = t.getRouteBytes();
+            train.inventoryBytes = t.getInventoryBytes();
+            train.inventoryDates = t.getInventoryDateCount();
+            report.trains += MemoryUsage::heapBytes(pair.first) + t.getHeapBytes();
+            if (seenRoutes.insert(t.getSharedRoute().get()).second) {
+                report.routes += train.routeBytes;
+                ++report.routeCount;
+            }
+            report.unsharedRoutes += train.routeBytes;
+            report.inventory += train.inventoryBytes;
+            report.perTrain.push_back(move(train));
+        }
+    };
+    if (shardPool) {
+        for (size_t i = 0; i < shardPool->getShardCount(); ++i) {
+            shardPool->call(i, [&addTrains](TrainShardPool::TrainMap& shard) { addTrains(shard); });
+        }
+    } else {
+        shared_lock<shared_mutex> lock(trainsMutex);
+        addTrains(trains);
+    }
+    sort(report.perTrain.begin(), report.perTrain.end(), [](const TrainMemory& a, const TrainMemory& b) {
+        return a.routeBytes + a.inventoryBytes > b.routeBytes + b.inventoryBytes;
+    });
+
+    {
+        // Users are allocated by make_shared: object plus control block in one block
+        const size_t controlBlock = 2 * sizeof(long) + sizeof(void*);
+        shared_lock<shared_mutex> lock(usersMutex);
+        report.users += MemoryUsage::nodeBytes(users);
+        for (const auto& pair : users) {
+            report.users += MemoryUsage::heapBytes(pair.first) + pair.second->getMemoryBytes() + controlBlock;
+            if (const Passenger* p = dynamic_cast<const Passenger*>(pair.second.get())) {
+                size_t count = 0;
+                report.orders += p->getOrderHistoryBytes(&count);
+                report.orderCount += count;
+            }
+        }
+    }
+    report.orderIndex = orderIndex.getMemoryBytes() + trainOrders.getMemoryBytes();
+    {
+        TimetableSnapshot snapshot = getTimetable();
+        report.timetable = snapshot->getMemoryBytes();
+        report.stationIndex = snapshot->getIndex().getMemoryBytes();
     }
-    return false;
+    report.sessions = sessions.getMemoryBytes();
+    return report;
 }
@@ -0,0 +1,242 @@
+/**
+ * @file TableModels.cpp
+ * @brief Implementation of the search result and order history models.
+ */
+
+#include "TableModels.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+QString statusText(OrderStatus status) {
+    switch (status) {
+        case PAID: return "Paid";
+        case CANCELLED: return "Cancelled";
+        default: return "Completed";
+    }
+}
+
+} // namespace
+
+// ---------------- TrainResultModel ----------------
+
+TrainResultModel::TrainResultModel(QObject *parent) : QAbstractTableModel(parent) {}
+
+vector<TrainResultModel::Row> TrainResultModel::makeRows(vector<Train>& trains, const string& startStation,
+                                                       const string& endStation, const string& travelDate,
+                                                       int today) {
+    vector<Row> result;
+    result.reserve(trains.size());
+    for (Train& t : trains) {
+        int startIndex, endIndex;
+        if (!t.findSegment(startStation, endStation, startIndex, endIndex)) continue;
+        string serviceDate = t.getServiceDate(travelDate, startIndex);
+        QString arrival = QString::fromStdString(Calendar::formatClock(t.getArrivalMinutes(endIndex)));
+        int daysLater = t.getArrivalMinutes(endIndex) / MINUTES_PER_DAY - t.getDayOffset(startIndex);
+        if (daysLater > 0) arrival += QString(" (+%1)").arg(daysLater);
+        Row row{QString::fromStdString(t.getId()), QString::fromStdString(t.getType()),
+                QString::fromStdString(Calendar::formatClock(t.getDepartureMinutes(startIndex))), arrival,
+                t.getClassAvailability(serviceDate, startIndex, endIndex), {}};
+        for (int c = 0; c < SEAT_CLASS_COUNT; ++c) {
+            SeatClass seatClass = static_cast<SeatClass>(c);
+            if (t.getClassSeats(seatClass) == 0) row.freeSeats[c] = -1;
+            row.prices[c] = t.quote(startIndex, endIndex, serviceDate, today, seatClass);
+        }
+        result.push_back(move(row));
+    }
+    return result;
+}
+
+void TrainResultModel::setResults(vector<Train>& trains, const string& startStation, const string& endStation,
+                                  const string& travelDate, int today) {
+    beginSearch(startStation, endStation, travelDate);
+    appendRows(makeRows(trains, startStation, endStation, travelDate, today));
+}
+
+void TrainResultModel::beginSearch(const string& startStation, const string& endStation, const string& travelDate) {
+    beginResetModel();
+    rows.clear();
+    loaded = 0;
+    start = startStation;
+    end = endStation;
+    date = travelDate;
+    endResetModel();
+}
+
+/**
+ * @brief Rows past the loaded prefix wait for fetchMore(), as for the initial results.
+ */
+void TrainResultModel::appendRows(vector<Row>&& batch) {
+    bool fullyLoaded = loaded == static_cast<int>(rows.size());
+    size_t first = rows.size();
+    rows.insert(rows.end(), make_move_iterator(batch.begin()), make_move_iterator(batch.end()));
+    if (fullyLoaded && rows.size() > first) {
+        int last = loaded + min<int>(static_cast<int>(rows.size() - first), TABLE_FETCH_BATCH) - 1;
+        beginInsertRows(QModelIndex(), loaded, last);
+        loaded = last + 1;
+        endInsertRows();
+    }
+}
+
+void TrainResultModel::setSeatClass(SeatClass shown) {
+    if (shown == seatClass) return;
+    seatClass = shown;
+    if (loaded > 0) emit dataChanged(index(0, COL_SEATS), index(loaded - 1, COL_PRICE));
+}
+
+int TrainResultModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : loaded;
+}
+
+int TrainResultModel::columnCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : COLUMN_COUNT;
+}
+
+QVariant TrainResultModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= loaded || role != Qt::DisplayRole) return QVariant();
+    const Row& r = rows[index.row()];
+    switch (index.column()) {
+        case COL_ID: return r.trainId;
+        case COL_TYPE: return r.type;
+        case COL_DEPARTURE: return r.departure;
+        case COL_ARRIVAL: return r.arrival;
+        case COL_SEATS: return r.freeSeats[seatClass] < 0 ? QVariant(QString("-")) : QVariant(r.freeSeats[seatClass]);
+        case COL_PRICE:
+            return r.freeSeats[seatClass] < 0 ? QString("-") : QString::fromStdString(r.prices[seatClass].toString());
+        case COL_ACTION: return QString("Book");
+        default: return QVariant();
+    }
+}
+
+QVariant TrainResultModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) return QVariant();
+    static const char* labels[COLUMN_COUNT] = {"Train ID", "Type", "Start Time", "End Time", "Seats", "Price", "Action"};
+    return section >= 0 && section < COLUMN_COUNT ? QString(labels[section]) : QVariant();
+}
+
+bool TrainResultModel::canFetchMore(const QModelIndex &parent) const {
+    return !parent.isValid() && loaded < static_cast<int>(rows.size());
+}
+
+void TrainResultModel::fetchMore(const QModelIndex &parent) {
+    if (parent.isValid()) return;
+    int count = min<int>(static_cast<int>(rows.size()) - loaded, TABLE_FETCH_BATCH);
+    if (count <= 0) return;
+    beginInsertRows(QModelIndex(), loaded, loaded + count - 1);
+    loaded += count;
+    endInsertRows();
+}
+
+// ---------------- OrderHistoryModel ----------------
+
+OrderHistoryModel::OrderHistoryModel(QObject *parent) : QAbstractTableModel(parent) {}
+
+OrderHistoryModel::Row OrderHistoryModel::makeRow(const Order& order) {
+    return {order.getOrderId(), QString::fromStdString(order.getTrainId()),
+            QString::fromStdString(order.getStartStation() + "->" + order.getEndStation()),
+            QString::fromStdString(order.getDate()), order.getTicketCount(), order.getSeatClass(), order.getStatus()};
+}
+
+void OrderHistoryModel::syncOrders(const vector<Order>& orders) {
+    bool isPrefix = orders.size() >= rows.size();
+    for (size_t i = 0; isPrefix && i < rows.size(); ++i) {
+        isPrefix = rows[i].orderId == orders[i].getOrderId();
+    }
+
+    if (!isPrefix) {
+        beginResetModel();
+        rows.clear();
+        rows.reserve(orders.size());
+        for (const Order& order : orders) rows.push_back(makeRow(order));
+        loaded = min<int>(static_cast<int>(rows.size()), TABLE_FETCH_BATCH);
+        endResetModel();
+        return;
+    }
+
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (rows[i].status != orders[i].getStatus()) {
+            rows[i].status = orders[i].getStatus();
+            emitRowChanged(static_cast<int>(i));
+        }
+    }
+
+    // New orders: shown right away if the view has everything so far,
+    // otherwise they wait for fetchMore() like the rest of the tail
+    bool fullyLoaded = loaded == static_cast<int>(rows.size());
+    size_t first = rows.size();
+    for (size_t i = first; i < orders.size(); ++i) rows.push_back(makeRow(orders[i]));
+    if (fullyLoaded && rows.size() > first) {
+        int last = loaded + min<int>(static_cast<int>(rows.size() - first), TABLE_FETCH_BATCH) - 1;
+        beginInsertRows(QModelIndex(), loaded, last);
+        loaded = last + 1;
+        endInsertRows();
+    }
+}
+
+bool OrderHistoryModel::setOrderStatus(const string& orderId, OrderStatus status) {
+    // Recent orders are the likeliest to change, so search from the end
+    for (size_t i = rows.size(); i-- > 0;) {
+        if (rows[i].orderId != orderId) continue;
+        if (rows[i].status != status) {
+            rows[i].status = status;
+            emitRowChanged(static_cast<int>(i));
+        }
+        return true;
+    }
+    return false;
+}
+
+void OrderHistoryModel::clear() {
+    beginResetModel();
+    rows.clear();
+    loaded = 0;
+    endResetModel();
+}
+
+void OrderHistoryModel::emitRowChanged(int row) {
+    if (row >= loaded) return; // Not in the view yet
+    emit dataChanged(index(row, COL_STATUS), index(row, COL_ACTION));
+}
+
+int OrderHistoryModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : loaded;
+}
+
+int OrderHistoryModel::columnCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : COLUMN_COUNT;
+}
+
+QVariant OrderHistoryModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= loaded || role != Qt::DisplayRole) return QVariant();
+    const Row& r = rows[index.row()];
+    switch (index.column()) {
+        case COL_ID: return QString::fromStdString(r.orderId);
+        case COL_TRAIN: return r.trainId;
+        case COL_ROUTE: return r.route;
+        case COL_DATE: return r.date;
+        case COL_SEATS: return QString("%1 (%2)").arg(r.seats).arg(seatClassName(r.seatClass));
+        case COL_STATUS: return statusText(r.status);
+        case COL_ACTION: return r.status == PAID ? QString("Refund") : QString();
+        default: return QVariant();
+    }
+}
+
+QVariant OrderHistoryModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) return QVariant();
+    static const char* labels[COLUMN_COUNT] = {"Order ID", "Train", "Route", "Date", "Seats", "Status", "Action"};
+    return section >= 0 && section < COLUMN_COUNT ? QString(labels[section]) : QVariant();
+}
+
+bool OrderHistoryModel::canFetchMore(const QModelIndex &parent) const {
+    return !parent.isValid() && loaded < static_cast<int>(rows.size());
+}
+
+void OrderHistoryModel::fetchMore(const QModelIndex &parent) {
+    if (parent.isValid()) return;
+    int count = min<int>(static_cast<int>(rows.size()) - loaded, TABLE_FETCH_BATCH);
+    if (count <= 0) return;
+    beginInsertRows(QModelIndex(), loaded, loaded + count - 1);
+    loaded += count;
+    endInsertRows();
+}
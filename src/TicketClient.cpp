@@ -0,0 +1,186 @@
+/**
+ * @file TicketClient.cpp
+ * @brief Implementation of the ticketing client library.
+ */
+
+#include "TicketClient.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+
+using namespace TicketProtocol;
+
+TicketClient::~TicketClient() {
+    close();
+}
+
+bool TicketClient::connect(const string& socketPath) {
+    close();
+
+    sockaddr_un addr{};
+    if (socketPath.size() >= sizeof(addr.sun_path)) {
+        lastError = "socket path too long";
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        lastError = string("socket: ") + strerror(errno);
+        return false;
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+        lastError = string("connect: ") + strerror(errno);
+        close();
+        return false;
+    }
+    return true;
+}
+
+void TicketClient::close() {
+    if (fd != -1) {
+        ::close(fd);
+        fd = -1;
+    }
+    readBuffer.clear();
+    writeBuffer.clear();
+}
+
+void TicketClient::send(const vector<string>& request) {
+    writeBuffer += encodeLine(request);
+}
+
+bool TicketClient::flush() {
+    size_t pos = 0;
+    while (pos < writeBuffer.size()) {
+        ssize_t n = ::send(fd, writeBuffer.data() + pos, writeBuffer.size() - pos, MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            lastError = string("send: ") + strerror(errno);
+            return false;
+        }
+        pos += n;
+    }
+    writeBuffer.clear();
+    return true;
+}
+
+bool TicketClient::receive(vector<string>& response) {
+    for (;;) {
+        size_t end = readBuffer.find(LINE_TERMINATOR);
+        if (end != string::npos) {
+            response = decodeLine(readBuffer.substr(0, end));
+            readBuffer.erase(0, end + 1);
+            return true;
+        }
+
+        char buf[16 * 1024];
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n > 0) {
+            readBuffer.append(buf, n);
+        } else if (n == 0) {
+            lastError = "connection closed by server";
+            return false;
+        } else if (errno != EINTR) {
+            lastError = string("read: ") + strerror(errno);
+            return false;
+        }
+    }
+}
+
+/**
+ * @brief Sends one request and waits for its response.
+ * @return true if the server answered OK.
+ */
+bool TicketClient::call(const vector<string>& request, vector<string>& response) {
+    if (fd == -1) {
+        lastError = "not connected";
+        return false;
+    }
+    send(request);
+    if (!flush() || !receive(response)) return false;
+    if (response.empty() || response[0] != "OK") {
+        lastError = response.size() > 1 ? response[1] : "malformed response";
+        return false;
+    }
+    return true;
+}
+
+string TicketClient::login(const string& username, const string& password) {
+    vector<string> resp;
+    if (!call({"LOGIN", username, password}, resp) || resp.size() < 2) return "";
+    return resp[1];
+}
+
+bool TicketClient::logout(const string& session) {
+    vector<string> resp;
+    return call({"LOGOUT", session}, resp);
+}
+
+bool TicketClient::registerUser(const string& username, const string& password, const string& name, const string& id) {
+    vector<string> resp;
+    return call({"REGISTER", username, password, name, id}, resp);
+}
+
+bool TicketClient::search(const string& from, const string& to, const string& date, vector<TrainSummary>& result) {
+    vector<string> resp;
+    result.clear();
+    if (!call({"SEARCH", from, to, date}, resp) || resp.size() < 2) return false;
+
+    size_t count = strtoul(resp[1].c_str(), nullptr, 10);
+    if (resp.size() != 2 + count * TRAIN_RECORD_FIELDS) {
+        lastError = "malformed response";
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const string* f = &resp[2 + i * TRAIN_RECORD_FIELDS];
+        Money price;
+        if (!Money::parse(f[4], price)) {
+            lastError = "malformed response";
+            result.clear();
+            return false;
+        }
+        result.push_back({f[0], f[1], f[2], f[3], price});
+    }
+    return true;
+}
+
+bool TicketClient::book(const string& session, const string& trainId, const string& from, const string& to, const string& date, int count, string* orderId) {
+    vector<string> resp;
+    if (!call({"BOOK", session, trainId, from, to, date, to_string(count)}, resp)) return false;
+    if (orderId) *orderId = resp.size() > 1 ? resp[1] : "";
+    return true;
+}
+
+bool TicketClient::refund(const string& session, const string& orderId) {
+    vector<string> resp;
+    return call({"REFUND", session, orderId}, resp);
+}
+
+bool TicketClient::listOrders(const string& session, vector<OrderSummary>& result) {
+    vector<string> resp;
+    result.clear();
+    if (!call({"ORDERS", session}, resp) || resp.size() < 2) return false;
+
+    size_t count = strtoul(resp[1].c_str(), nullptr, 10);
+    if (resp.size() != 2 + count * ORDER_RECORD_FIELDS) {
+        lastError = "malformed response";
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const string* f = &resp[2 + i * ORDER_RECORD_FIELDS];
+        SeatClass seatClass;
+        Money price;
+        if (!parseSeatClass(f[6], seatClass) || !Money::parse(f[7], price)) {
+            lastError = "malformed response";
+            result.clear();
+            return false;
+        }
+        result.push_back({f[0], f[1], f[2], f[3], f[4], atoi(f[5].c_str()), seatClass, price, f[8]});
+    }
+    return true;
+}
@@ -0,0 +1,459 @@
+/**
+ * @file TicketServer.cpp
+ * @brief Implementation of the epoll event loop and request dispatch.
+ */
+
+#include "TicketServer.h"
+#include "TicketProtocol.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+using namespace TicketProtocol;
+
+namespace {
+
+/// Stop reading from a client once this many response bytes are pending
+const size_t MAX_PENDING_OUTPUT = 4 * 1024 * 1024;
+const int MAX_EVENTS = 64;
+/// Finished cancellations kept for CANCELSTATUS
+const size_t MAX_FINISHED_JOBS = 256;
+
+string statusName(OrderStatus status) {
+    return status == PAID ? "Paid" : (status == CANCELLED ? "Cancelled" : "Completed");
+}
+
+vector<string> ok() { return {"OK"}; }
+vector<string> error(const string& reason) { return {"ERR", reason}; }
+
+} // namespace
+
+TicketServer::TicketServer(SystemManager& sys, const string& path)
+    : system(sys), socketPath(path) {}
+
+TicketServer::~TicketServer() {
+    stopWorker();
+    for (auto& pair : connections) {
+        ::close(pair.first);
+    }
+    if (listenFd != -1) {
+        ::close(listenFd);
+        ::unlink(socketPath.c_str());
+    }
+    if (wakeFd != -1) ::close(wakeFd);
+    if (epollFd != -1) ::close(epollFd);
+}
+
+void TicketServer::setError(const string& what) {
+    lastError = what + ": " + strerror(errno);
+}
+
+/**
+ * @brief Binds the Unix socket and registers it with epoll.
+ * A stale socket file left behind by a previous run is removed first.
+ */
+bool TicketServer::start() {
+    sockaddr_un addr{};
+    if (socketPath.size() >= sizeof(addr.sun_path)) {
+        lastError = "socket path too long";
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd == -1) { setError("socket"); return false; }
+
+    ::unlink(socketPath.c_str());
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+        setError("bind");
+        return false;
+    }
+    if (listen(listenFd, SOMAXCONN) == -1) { setError("listen"); return false; }
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd == -1) { setError("epoll_create1"); return false; }
+
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd == -1) { setError("eventfd"); return false; }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = listenFd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev) == -1) { setError("epoll_ctl"); return false; }
+    ev.data.fd = wakeFd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev) == -1) { setError("epoll_ctl"); return false; }
+    return true;
+}
+
+void TicketServer::stop() {
+    uint64_t one = 1;
+    if (wakeFd != -1) {
+        ssize_t n = ::write(wakeFd, &one, sizeof(one));
+        (void)n;
+    }
+}
+
+/**
+ * @brief Event loop.
+ * Readable connections are drained and executed, writable ones flushed.
+ */
+void TicketServer::run() {
+    epoll_event events[MAX_EVENTS];
+    for (;;) {
+        int n = epoll_wait(epollFd, events, MAX_EVENTS, -1);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            setError("epoll_wait");
+            stopWorker();
+            return;
+        }
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wakeFd) {
+                stopWorker();
+                return;
+            }
+            if (fd == listenFd) {
+                acceptConnections();
+                continue;
+            }
+
+            auto it = connections.find(fd);
+            if (it == connections.end()) continue;
+            Connection& conn = it->second;
+
+            bool alive = true;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                alive = readFrom(fd, conn);
+            }
+            // Execute and flush; keep going while the socket swallows whole batches
+            while (alive) {
+                processInput(conn);
+                alive = writeTo(fd, conn);
+                if (!conn.out.empty() || conn.in.find(LINE_TERMINATOR) == string::npos) break;
+            }
+            bool drained = conn.outPos == conn.out.size() && conn.in.find(LINE_TERMINATOR) == string::npos;
+            if (!alive || (conn.peerClosed && drained)) {
+                closeConnection(fd);
+            } else {
+                updateInterest(fd, conn);
+            }
+        }
+    }
+}
+
+void TicketServer::acceptConnections() {
+    for (;;) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) return; // EAGAIN, or a transient error; try again on the next event
+
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            ::close(fd);
+            continue;
+        }
+        connections[fd] = Connection();
+    }
+}
+
+/**
+ * @brief Reads everything currently available on a connection.
+ * @return false on a socket error or an oversized request line.
+ */
+bool TicketServer::readFrom(int fd, Connection& conn) {
+    if (isBacklogged(conn) || conn.peerClosed) return true;
+
+    char buf[16 * 1024];
+    for (;;) {
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n > 0) {
+            conn.in.append(buf, n);
+            if (conn.in.size() > MAX_LINE_LENGTH && conn.in.find(LINE_TERMINATOR) == string::npos) {
+                return false;
+            }
+            continue;
+        }
+        if (n == 0) {
+            // Half-close: answer what was already sent, then hang up
+            conn.peerClosed = true;
+            return true;
+        }
+        if (errno == EINTR) continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+}
+
+/**
+ * @brief Flushes as much pending output as the socket accepts.
+ */
+bool TicketServer::writeTo(int fd, Connection& conn) {
+    while (conn.outPos < conn.out.size()) {
+        ssize_t n = ::send(fd, conn.out.data() + conn.outPos, conn.out.size() - conn.outPos, MSG_NOSIGNAL);
+        if (n > 0) {
+            conn.outPos += n;
+            continue;
+        }
+        if (n == -1 && errno == EINTR) continue;
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        return false;
+    }
+    if (conn.outPos == conn.out.size()) {
+        conn.out.clear();
+        conn.outPos = 0;
+    }
+    return true;
+}
+
+/**
+ * @brief Executes every complete request line in the input buffer.
+ * Stops early when the output backlog is too large; the rest is picked
+ * up once the client has read its responses.
+ */
+void TicketServer::processInput(Connection& conn) {
+    size_t start = 0;
+    while (!isBacklogged(conn)) {
+        size_t end = conn.in.find(LINE_TERMINATOR, start);
+        if (end == string::npos) break;
+
+        string line = conn.in.substr(start, end - start);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        start = end + 1;
+        if (line.empty()) continue;
+
+        conn.out += encodeLine(handleRequest(decodeLine(line)));
+    }
+    conn.in.erase(0, start);
+}
+
+bool TicketServer::isBacklogged(const Connection& conn) {
+    return conn.out.size() - conn.outPos > MAX_PENDING_OUTPUT;
+}
+
+bool TicketServer::isAdmin(const string& token) {
+    shared_ptr<User> user = system.getSessionUser(token);
+    return user && user->getRole() == "Admin";
+}
+
+/**
+ * @brief Queues a cancellation for the worker, starting it on first use.
+ */
+uint64_t TicketServer::submitCancellation(const string& trainId, const string& firstDate, const string& lastDate) {
+    lock_guard<mutex> lock(jobsMutex);
+    uint64_t id = nextJobId++;
+    CancellationJob& job = jobs[id];
+    job.trainId = trainId;
+    job.firstDate = firstDate;
+    job.lastDate = lastDate;
+    pendingJobs.push_back(id);
+    if (!worker.joinable()) worker = thread(&TicketServer::runCancellations, this);
+    jobsReady.notify_one();
+    return id;
+}
+
+/**
+ * @brief Worker loop: runs queued cancellations one at a time, publishing
+ * their progress after each batch, and prunes old finished jobs.
+ */
+void TicketServer::runCancellations() {
+    unique_lock<mutex> lock(jobsMutex);
+    for (;;) {
+        jobsReady.wait(lock, [this]() { return stopping || !pendingJobs.empty(); });
+        if (stopping) return;
+        uint64_t id = pendingJobs.front();
+        pendingJobs.pop_front();
+        CancellationJob& job = jobs[id];
+        job.state = "running";
+        string trainId = job.trainId, firstDate = job.firstDate, lastDate = job.lastDate;
+        lock.unlock();
+
+        TrainCancellation result = system.cancelTrain(trainId, firstDate, lastDate, [this, id](const TrainCancellation& progress) {
+            lock_guard<mutex> progressLock(jobsMutex);
+            jobs[id].progress = progress;
+        });
+
+        lock.lock();
+        jobs[id].progress = result;
+        jobs[id].state = result.found ? "done" : "failed";
+        size_t finished = jobs.size() - pendingJobs.size();
+        for (auto it = jobs.begin(); finished > MAX_FINISHED_JOBS && it != jobs.end();) {
+            if (it->second.state == "done" || it->second.state == "failed") {
+                it = jobs.erase(it);
+                --finished;
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+void TicketServer::stopWorker() {
+    {
+        lock_guard<mutex> lock(jobsMutex);
+        stopping = true;
+    }
+    jobsReady.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+/**
+ * @brief Re-arms epoll: read while not backlogged, write while output is pending.
+ */
+void TicketServer::updateInterest(int fd, const Connection& conn) {
+    epoll_event ev{};
+    ev.events = 0;
+    if (!isBacklogged(conn) && !conn.peerClosed) ev.events |= EPOLLIN | EPOLLRDHUP;
+    if (conn.outPos < conn.out.size()) ev.events |= EPOLLOUT;
+    ev.data.fd = fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+void TicketServer::closeConnection(int fd) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    connections.erase(fd);
+}
+
+/**
+ * @brief Dispatches one request to the SystemManager.
+ */
+vector<string> TicketServer::handleRequest(const vector<string>& req) {
+    const string& cmd = req[0];
+    size_t argc = req.size() - 1;
+
+    if (cmd == "PING") {
+        return ok();
+    }
+    if (cmd == "LOGIN") {
+        if (argc != 2) return error("usage: LOGIN user password");
+        string token = system.login(req[1], req[2]);
+        if (token.empty()) return error("invalid username or password");
+        return {"OK", token};
+    }
+    if (cmd == "LOGOUT") {
+        if (argc != 1) return error("usage: LOGOUT token");
+        system.logout(req[1]);
+        return ok();
+    }
+    // A replica only changes state through its primary's log
+    if ((cmd == "REGISTER" || cmd == "BOOK" || cmd == "REFUND" || cmd == "CANCELTRAIN") && replica && !replica->isPromoted()) {
+        return error("read-only replica");
+    }
+    if (cmd == "REGISTER") {
+        if (argc != 4) return error("usage: REGISTER user password name idCard");
+        if (req[1].empty() || req[2].empty()) return error("username and password required");
+        if (!system.registerUser(req[1], req[2], req[3], req[4])) return error("username already exists");
+        return ok();
+    }
+    if (cmd == "SEARCH") {
+        if (argc != 3 && argc != 5) return error("usage: SEARCH from to date [earliest latest]");
+        if (!Calendar::isValidDate(req[3])) return error("invalid date");
+        TimeWindow window;
+        if (argc == 5) {
+            window.earliest = Calendar::parseClock(req[4]);
+            window.latest = Calendar::parseClock(req[5]);
+            if (window.earliest < 0 || window.latest < 0) return error("times must be HH:MM");
+        }
+        vector<Train> trains = system.searchTrains(req[1], req[2], req[3], window);
+        int today = system.getCurrentDay();
+        vector<string> resp = {"OK", to_string(trains.size())};
+        resp.reserve(2 + trains.size() * TRAIN_RECORD_FIELDS);
+        for (auto& t : trains) {
+            resp.push_back(t.getId());
+            resp.push_back(t.getType());
+            resp.push_back(t.getDepartureTime(req[1]));
+            resp.push_back(t.getArrivalTime(req[2]));
+            int startIndex, endIndex;
+            t.findSegment(req[1], req[2], startIndex, endIndex);
+            resp.push_back(t.quote(startIndex, endIndex, t.getServiceDate(req[3], startIndex), today).toString());
+        }
+        return resp;
+    }
+    if (cmd == "BOOK") {
+        if (argc != 6 && argc != 7) return error("usage: BOOK token trainId from to date count [class]");
+        int count = atoi(req[6].c_str());
+        if (count <= 0) return error("invalid ticket count");
+        SeatClass seatClass = SECOND_CLASS;
+        if (argc == 7 && !parseSeatClass(req[7], seatClass)) return error("unknown seat class");
+        BookingResult result = system.placeBooking(req[1], req[2], req[3], req[4], req[5], count, seatClass);
+        if (result.status != BOOKED) return error(bookingStatusName(result.status));
+        return {"OK", result.orderId};
+    }
+    if (cmd == "REFUND") {
+        if (argc != 2) return error("usage: REFUND token orderId");
+        if (!system.getSessionUser(req[1])) return error("not logged in");
+        if (!system.refundTicket(req[1], req[2])) return error("refund failed");
+        return ok();
+    }
+    if (cmd == "CANCELTRAIN") {
+        if (argc != 2 && argc != 4) return error("usage: CANCELTRAIN token trainId [firstDate lastDate]");
+        if (!isAdmin(req[1])) return error("admin login required");
+        if (argc == 4 && (!Calendar::isValidDate(req[3]) || !Calendar::isValidDate(req[4]))) return error("invalid date");
+        uint64_t id = argc == 4 ? submitCancellation(req[2], req[3], req[4]) : submitCancellation(req[2], "", "");
+        return {"OK", to_string(id)};
+    }
+    if (cmd == "CANCELSTATUS") {
+        if (argc != 2) return error("usage: CANCELSTATUS token jobId");
+        if (!isAdmin(req[1])) return error("admin login required");
+        lock_guard<mutex> lock(jobsMutex);
+        auto it = jobs.find(strtoull(req[2].c_str(), nullptr, 10));
+        if (it == jobs.end()) return error("unknown cancellation");
+        const CancellationJob& job = it->second;
+        return {"OK", job.state, to_string(job.progress.affectedOrders), to_string(job.progress.processedOrders),
+                to_string(job.progress.refundedOrders), job.progress.refundedAmount.toString()};
+    }
+    if (cmd == "ORDERS") {
+        if (argc != 1) return error("usage: ORDERS token");
+        if (!system.getSessionUser(req[1])) return error("not logged in");
+        vector<Order> orders = system.getOrders(req[1]);
+        vector<string> resp = {"OK", to_string(orders.size())};
+        resp.reserve(2 + orders.size() * ORDER_RECORD_FIELDS);
+        for (auto& o : orders) {
+            resp.push_back(o.getOrderId());
+            resp.push_back(o.getTrainId());
+            resp.push_back(o.getStartStation());
+            resp.push_back(o.getEndStation());
+            resp.push_back(o.getDate());
+            resp.push_back(to_string(o.getTicketCount()));
+            resp.push_back(seatClassName(o.getSeatClass()));
+            resp.push_back(o.getPrice().toString());
+            resp.push_back(statusName(o.getStatus()));
+        }
+        return resp;
+    }
+    if (cmd == "ADMISSION") {
+        const AdmissionController* ac = system.getAdmissionController();
+        if (!ac) return error("admission control disabled");
+        AdmissionCounters c = ac->getCounters();
+        return {"OK", to_string(c.admitted), to_string(c.queued), to_string(c.rejectedSoldOut),
+                to_string(c.rejectedQueueFull), to_string(c.rejectedTimeout), to_string(c.deferred)};
+    }
+    if (cmd == "STATS") {
+        return {"OK", system.getMetricsSnapshot().toJson()};
+    }
+    if (cmd == "MEMORY") {
+        return {"OK", system.getMemoryReport().toJson()};
+    }
+    if (cmd == "REPLICA") {
+        if (!replica || replica->isPromoted()) {
+            const ReplicationLog* log = system.getReplicationLog();
+            return {"OK", "primary", to_string(log ? log->getSequence() : 0), "0", "0", "0"};
+        }
+        ReplicationStatus status = replica->getStatus();
+        return {"OK", "replica", to_string(status.appliedSequence), to_string(status.pendingBytes), to_string(status.lagMs),
+                to_string(status.errors)};
+    }
+    if (cmd == "PROMOTE") {
+        if (argc != 1) return error("usage: PROMOTE token");
+        if (!isAdmin(req[1])) return error("admin login required");
+        if (!replica) return error("not a replica");
+        return {"OK", to_string(replica->promote())};
+    }
+    return error("unknown command " + cmd);
+}
@@ -0,0 +1,55 @@
+/**
+ * @file Timetable.cpp
+ * @brief Implementation of the timetable versions.
+ */
+
+#include "Timetable.h"
+#include "MemoryUsage.h"
+
+void Timetable::put(const Train& train) {
+    trains[train.getId()] = make_shared<const Train>(train.getTimetable());
+    index.add(train);
+}
+
+bool Timetable::erase(const string& trainId) {
+    if (trains.erase(trainId) == 0) return false;
+    index.remove(trainId);
+    return true;
+}
+
+const Train* Timetable::find(const string& trainId) const {
+    auto it = trains.find(trainId);
+    return it == trains.end() ? nullptr : it->second.get();
+}
+
+/**
+ * @brief The station index rules out trains by route and calendar; the
+ * departure window is checked on the schedules of the ones left.
+ */
+vector<string> Timetable::candidates(const string& startStation, const string& endStation, const string& date,
+                                     const TimeWindow& window) const {
+    vector<string> result = index.candidates(startStation, endStation, Calendar::dayNumber(date));
+    if (window.isAllDay()) return result;
+    size_t kept = 0;
+    for (size_t i = 0; i < result.size(); ++i) {
+        const Train* train = find(result[i]);
+        int startIndex, endIndex;
+        if (train && train->findSegment(startStation, endStation, startIndex, endIndex) &&
+            window.contains(train->getDepartureMinutes(startIndex))) {
+            if (kept != i) result[kept] = move(result[i]);
+            ++kept;
+        }
+    }
+    result.resize(kept);
+    return result;
+}
+
+size_t Timetable::getMemoryBytes() const {
+    // Schedules are allocated by make_shared: object plus control block in one block
+    const size_t controlBlock = 2 * sizeof(long) + sizeof(void*);
+    size_t total = MemoryUsage::nodeBytes(trains);
+    for (const auto& pair : trains) {
+        total += MemoryUsage::heapBytes(pair.first) + sizeof(Train) + controlBlock + pair.second->getHeapBytes();
+    }
+    return total;
+}
@@ -0,0 +1,299 @@
+/**
+ * @file TraceReplay.cpp
+ * @brief Implementation of the trace replayer.
+ */
+
+#include "TraceReplay.h"
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+using ReplayTimer = chrono::steady_clock;
+
+/// Divergences described in the report; the rest are only counted
+const size_t MAX_DIVERGENCE_SAMPLES = 10;
+
+/// Trace offset of the call the current thread is replaying
+thread_local int64_t currentOffsetNs = 0;
+
+/**
+ * @brief Reports the recorded wall-clock time of the call being replayed.
+ */
+class ReplayClock : public Clock {
+public:
+    explicit ReplayClock(time_t start) : recordingStart(start) {}
+    time_t now() const override { return recordingStart + static_cast<time_t>(currentOffsetNs / 1000000000); }
+
+private:
+    time_t recordingStart;
+};
+
+/**
+ * @brief Recorded-to-replayed translation of tokens and order IDs.
+ */
+class IdMap {
+public:
+    void add(const string& recorded, const string& replayed) {
+        if (recorded.empty() || replayed.empty()) return;
+        lock_guard<mutex> lock(mtx);
+        ids[recorded] = replayed;
+    }
+    string translate(const string& recorded) const {
+        lock_guard<mutex> lock(mtx);
+        auto it = ids.find(recorded);
+        return it == ids.end() ? recorded : it->second;
+    }
+
+private:
+    mutable mutex mtx;
+    unordered_map<string, string> ids;
+};
+
+/**
+ * @brief Decodes the legs of a TRACE_TRANSFER or TRACE_JOURNEY record.
+ * @return false if the arguments do not form whole legs.
+ */
+bool parseTraceLegs(const vector<string>& args, vector<TripLeg>& legs) {
+    if (args.size() < 2 || (args.size() - 2) % TRACE_LEG_ARGS != 0) return false;
+    legs.clear();
+    for (size_t i = 2; i < args.size(); i += TRACE_LEG_ARGS) {
+        TripLeg leg{args[i], args[i + 1], args[i + 2], args[i + 3]};
+        if (!parseSeatClass(args[i + 4], leg.seatClass)) return false;
+        legs.push_back(move(leg));
+    }
+    return true;
+}
+
+/**
+ * @brief Maps each recorded order ID of a multi-leg booking to its replayed one.
+ */
+void addOrderIds(IdMap& ids, const string& recorded, const vector<string>& replayed) {
+    stringstream ss(recorded);
+    string id;
+    for (size_t i = 0; ss >> id && i < replayed.size(); ++i) ids.add(id, replayed[i]);
+}
+
+string describeResult(TraceOp op, int64_t result) {
+    switch (op) {
+        case TRACE_BOOK:
+        case TRACE_TRANSFER:
+        case TRACE_JOURNEY: return bookingStatusName(static_cast<BookingStatus>(result));
+        case TRACE_SEARCH: return to_string(result) + " trains";
+        default: return result ? "ok" : "failed";
+    }
+}
+
+LatencySummary summarize(vector<int64_t>& latencies) {
+    LatencySummary summary;
+    summary.count = latencies.size();
+    if (latencies.empty()) return summary;
+
+    sort(latencies.begin(), latencies.end());
+    auto at = [&](double q) { return latencies[static_cast<size_t>(q * (latencies.size() - 1))]; };
+    summary.p50Ns = at(0.50);
+    summary.p90Ns = at(0.90);
+    summary.p99Ns = at(0.99);
+    summary.maxNs = latencies.back();
+    for (int64_t ns : latencies) {
+        size_t bucket = 0;
+        while (bucket < 62 && (int64_t(1) << (bucket + 1)) <= ns) ++bucket;
+        if (summary.buckets.size() <= bucket) summary.buckets.resize(bucket + 1);
+        ++summary.buckets[bucket];
+    }
+    return summary;
+}
+
+string formatNanos(int64_t ns) {
+    stringstream ss;
+    ss << fixed << setprecision(1);
+    if (ns < 1000) ss << ns << "ns";
+    else if (ns < 1000000) ss << ns / 1e3 << "us";
+    else ss << ns / 1e6 << "ms";
+    return ss.str();
+}
+
+} // namespace
+
+void ReplayReport::print(ostream& os) const {
+    os << "Replayed " << replayed << " calls in " << fixed << setprecision(3) << elapsedSeconds << " s ("
+       << setprecision(0) << (elapsedSeconds > 0 ? replayed / elapsedSeconds : 0.0) << " calls/s), "
+       << divergences << " divergent" << endl;
+    for (const string& sample : divergenceSamples) {
+        os << "  divergence: " << sample << endl;
+    }
+    for (int op = TRACE_REGISTER; op < TRACE_OP_LIMIT; ++op) {
+        const LatencySummary& s = latency[op];
+        if (s.count == 0) continue;
+        os << traceOpName(static_cast<TraceOp>(op)) << ": n=" << s.count
+           << " p50=" << formatNanos(s.p50Ns) << " p90=" << formatNanos(s.p90Ns)
+           << " p99=" << formatNanos(s.p99Ns) << " max=" << formatNanos(s.maxNs) << endl;
+        for (size_t b = 0; b < s.buckets.size(); ++b) {
+            if (s.buckets[b] == 0) continue;
+            os << "  [" << setw(8) << formatNanos(int64_t(1) << b) << ", " << setw(8) << formatNanos(int64_t(1) << (b + 1))
+               << ") " << setw(8) << s.buckets[b] << " "
+               << string(static_cast<size_t>(50.0 * s.buckets[b] / s.count), '#') << endl;
+        }
+    }
+}
+
+TraceReplayer::TraceReplayer(SystemManager& sys, const ReplayConfig& cfg)
+    : system(sys), config(cfg) {
+    if (config.threads == 0) config.threads = 1;
+}
+
+ReplayReport TraceReplayer::run(const vector<TraceRecord>& input, time_t recordingStart) {
+    // Records are stored in completion order; issue them in start order
+    vector<const TraceRecord*> records;
+    records.reserve(input.size());
+    for (const TraceRecord& r : input) records.push_back(&r);
+    stable_sort(records.begin(), records.end(), [](const TraceRecord* a, const TraceRecord* b) {
+        return a->startNs < b->startNs;
+    });
+
+    // Partition by user: sessions are attributed through the login that created them
+    unordered_map<string, string> tokenOwner;
+    for (const TraceRecord* r : records) {
+        if (r->op == TRACE_LOGIN && !r->args.empty() && !r->output.empty()) tokenOwner[r->output] = r->args[0];
+    }
+    vector<vector<const TraceRecord*>> queues(config.threads);
+    size_t roundRobin = 0;
+    hash<string> hasher;
+    for (const TraceRecord* r : records) {
+        if (r->args.empty()) continue;
+        size_t thread;
+        if (r->op == TRACE_SEARCH) {
+            thread = roundRobin++ % config.threads;
+        } else if (r->op == TRACE_REGISTER || r->op == TRACE_LOGIN) {
+            thread = hasher(r->args[0]) % config.threads;
+        } else {
+            auto owner = tokenOwner.find(r->args[0]);
+            thread = hasher(owner == tokenOwner.end() ? r->args[0] : owner->second) % config.threads;
+        }
+        queues[thread].push_back(r);
+    }
+
+    shared_ptr<const Clock> previousClock = system.getClock();
+    system.setClock(make_shared<ReplayClock>(recordingStart));
+
+    IdMap sessionIds, orderIds;
+    mutex reportMutex;
+    ReplayReport report;
+    vector<vector<int64_t>> latencies(TRACE_OP_LIMIT);
+
+    ReplayTimer::time_point begin = ReplayTimer::now();
+    auto worker = [&](const vector<const TraceRecord*>& queue) {
+        vector<vector<int64_t>> local(TRACE_OP_LIMIT);
+        uint64_t divergent = 0;
+        vector<string> samples;
+
+        for (const TraceRecord* r : queue) {
+            if (config.speed > 0) {
+                this_thread::sleep_until(begin + chrono::nanoseconds(static_cast<int64_t>(r->startNs / config.speed)));
+            }
+            currentOffsetNs = r->startNs;
+            const vector<string>& a = r->args;
+            int64_t actual = 0;
+            bool wellFormed = true;
+
+            ReplayTimer::time_point t0 = ReplayTimer::now();
+            switch (r->op) {
+                case TRACE_REGISTER:
+                    if ((wellFormed = a.size() == 4)) actual = system.registerUser(a[0], a[1], a[2], a[3]);
+                    break;
+                case TRACE_LOGIN:
+                    if ((wellFormed = a.size() == 2)) {
+                        string token = system.login(a[0], a[1]);
+                        sessionIds.add(r->output, token);
+                        actual = !token.empty();
+                    }
+                    break;
+                case TRACE_LOGOUT:
+                    system.logout(sessionIds.translate(a[0]));
+                    actual = 1;
+                    break;
+                case TRACE_SEARCH: {
+                    // Searches with a departure window carry its bounds as two more arguments
+                    TimeWindow window;
+                    if (a.size() == 5) {
+                        window.earliest = Calendar::parseClock(a[3]);
+                        window.latest = Calendar::parseClock(a[4]);
+                    }
+                    if ((wellFormed = a.size() == 3 || (a.size() == 5 && window.earliest >= 0 && window.latest >= 0))) {
+                        actual = static_cast<int64_t>(system.searchTrains(a[0], a[1], a[2], window).size());
+                    }
+                    break;
+                }
+                case TRACE_BOOK: {
+                    // Traces recorded before seat classes have no class argument
+                    SeatClass seatClass = SECOND_CLASS;
+                    if ((wellFormed = a.size() == 6 || (a.size() == 7 && parseSeatClass(a[6], seatClass)))) {
+                        BookingResult result = system.placeBooking(sessionIds.translate(a[0]), a[1], a[2], a[3], a[4], atoi(a[5].c_str()),
+                                                                   seatClass);
+                        orderIds.add(r->output, result.orderId);
+                        actual = result.status;
+                    }
+                    break;
+                }
+                case TRACE_REFUND:
+                    if ((wellFormed = a.size() == 2)) actual = system.refundTicket(sessionIds.translate(a[0]), orderIds.translate(a[1]));
+                    break;
+                case TRACE_TRANSFER:
+                case TRACE_JOURNEY: {
+                    vector<TripLeg> legs;
+                    vector<string> booked;
+                    wellFormed = parseTraceLegs(a, legs) && (r->op == TRACE_JOURNEY || legs.size() == 2);
+                    if (!wellFormed) break;
+                    string session = sessionIds.translate(a[0]);
+                    int count = atoi(a[1].c_str());
+                    actual = r->op == TRACE_TRANSFER ? system.bookTransfer(session, legs[0], legs[1], count, booked)
+                                                     : system.bookJourney(session, legs, count, booked);
+                    addOrderIds(orderIds, r->output, booked);
+                    break;
+                }
+            }
+            local[r->op].push_back(chrono::duration_cast<chrono::nanoseconds>(ReplayTimer::now() - t0).count());
+
+            if (!wellFormed || actual != r->result) {
+                ++divergent;
+                if (samples.size() < MAX_DIVERGENCE_SAMPLES) {
+                    stringstream ss;
+                    ss << traceOpName(r->op) << " at " << formatNanos(r->startNs) << ": recorded "
+                       << describeResult(r->op, r->result) << ", replayed "
+                       << (wellFormed ? describeResult(r->op, actual) : "malformed record");
+                    samples.push_back(ss.str());
+                }
+            }
+        }
+
+        lock_guard<mutex> lock(reportMutex);
+        for (int op = 0; op < TRACE_OP_LIMIT; ++op) {
+            latencies[op].insert(latencies[op].end(), local[op].begin(), local[op].end());
+        }
+        report.divergences += divergent;
+        for (string& s : samples) {
+            if (report.divergenceSamples.size() < MAX_DIVERGENCE_SAMPLES) report.divergenceSamples.push_back(move(s));
+        }
+    };
+
+    vector<thread> threads;
+    for (size_t i = 1; i < queues.size(); ++i) threads.emplace_back(worker, cref(queues[i]));
+    worker(queues[0]);
+    for (auto& t : threads) t.join();
+    report.elapsedSeconds = chrono::duration<double>(ReplayTimer::now() - begin).count();
+    currentOffsetNs = 0;
+
+    system.setClock(previousClock);
+
+    for (int op = 0; op < TRACE_OP_LIMIT; ++op) {
+        report.replayed += latencies[op].size();
+        report.latency[op] = summarize(latencies[op]);
+    }
+    return report;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file Tracing.cpp
+ * @brief Implementation of the per-thread span rings and Chrome JSON export.
+ */
+
+#include "Tracing.h"
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+/**
+ * @brief One thread's spans.
+ * Slot i holds span number i modulo the capacity. Fields are atomics so the
+ * exporter can read them while the owner thread keeps writing.
+ */
+struct SpanTracer::Ring {
+    struct Slot {
+        atomic<const char*> name{nullptr};
+        atomic<uint64_t> startNs{0};
+        atomic<uint64_t> endNs{0};
+    };
+
+    uint32_t threadId;
+    atomic<uint64_t> head{0};   ///< Number of spans ever written
+    unique_ptr<Slot[]> slots;
+
+    explicit Ring(uint32_t id) : threadId(id), slots(new Slot[SPAN_RING_CAPACITY]) {}
+};
+
+SpanTracer& SpanTracer::instance() {
+    static SpanTracer tracer;
+    return tracer;
+}
+
+uint64_t SpanTracer::nowNs() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief A thread's claim on a ring, handed back when the thread exits.
+ */
+struct SpanTracer::RingLease {
+    Ring* ring = nullptr;
+
+    ~RingLease() {
+        if (ring) SpanTracer::instance().releaseRing(ring);
+    }
+};
+
+SpanTracer::Ring& SpanTracer::localRing() {
+    thread_local RingLease lease;
+    if (!lease.ring) {
+        lock_guard<mutex> lock(ringsMutex);
+        if (!freeRings.empty()) {
+            lease.ring = freeRings.back();
+            freeRings.pop_back();
+        } else {
+            rings.push_back(make_shared<Ring>(static_cast<uint32_t>(rings.size() + 1)));
+            lease.ring = rings.back().get();
+        }
+    }
+    return *lease.ring;
+}
+
+void SpanTracer::releaseRing(Ring* ring) {
+    lock_guard<mutex> lock(ringsMutex);
+    freeRings.push_back(ring);
+}
+
+void SpanTracer::record(const char* name, uint64_t startNs, uint64_t endNs) {
+    Ring& ring = localRing();
+    uint64_t index = ring.head.load(memory_order_relaxed);
+    Ring::Slot& slot = ring.slots[index % SPAN_RING_CAPACITY];
+    slot.name.store(name, memory_order_relaxed);
+    slot.startNs.store(startNs, memory_order_relaxed);
+    slot.endNs.store(endNs, memory_order_relaxed);
+    ring.head.store(index + 1, memory_order_release);
+}
+
+size_t SpanTracer::getSpanCount() const {
+    lock_guard<mutex> lock(ringsMutex);
+    size_t count = 0;
+    for (const auto& ring : rings) {
+        count += min<uint64_t>(ring->head.load(memory_order_acquire), SPAN_RING_CAPACITY);
+    }
+    return count;
+}
+
+size_t SpanTracer::getRingCount() const {
+    lock_guard<mutex> lock(ringsMutex);
+    return rings.size();
+}
+
+void SpanTracer::clear() {
+    lock_guard<mutex> lock(ringsMutex);
+    for (auto& ring : rings) ring->head.store(0, memory_order_relaxed);
+}
+
+/**
+ * @brief Emits one complete ("X") event per span, in microseconds.
+ * A ring's spans are copied first, then the head is re-read: anything the
+ * owner may have overwritten in the meantime is dropped.
+ */
+string SpanTracer::exportChromeJson() const {
+    struct Span {
+        const char* name;
+        uint64_t startNs;
+        uint64_t endNs;
+    };
+
+    stringstream ss;
+    ss << fixed << setprecision(3) << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+
+    lock_guard<mutex> lock(ringsMutex);
+    for (const auto& ring : rings) {
+        uint64_t head = ring->head.load(memory_order_acquire);
+        uint64_t begin = head > SPAN_RING_CAPACITY ? head - SPAN_RING_CAPACITY : 0;
+        vector<Span> spans;
+        spans.reserve(head - begin);
+        for (uint64_t i = begin; i < head; ++i) {
+            const Ring::Slot& slot = ring->slots[i % SPAN_RING_CAPACITY];
+            spans.push_back({slot.name.load(memory_order_relaxed), slot.startNs.load(memory_order_relaxed),
+                             slot.endNs.load(memory_order_relaxed)});
+        }
+        // Slots at or below headAfter - capacity may have been rewritten,
+        // including the one the owner may be writing right now
+        uint64_t headAfter = ring->head.load(memory_order_acquire);
+        uint64_t safeBegin = headAfter + 1 > SPAN_RING_CAPACITY ? headAfter + 1 - SPAN_RING_CAPACITY : 0;
+
+        if (!first) ss << ",";
+        first = false;
+        ss << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->threadId
+           << ",\"args\":{\"name\":\"thread " << ring->threadId << "\"}}";
+
+        for (uint64_t i = max(begin, safeBegin); i < head; ++i) {
+            const Span& s = spans[i - begin];
+            if (!s.name) continue;
+            ss << ",{\"name\":\"" << s.name << "\",\"cat\":\"railway\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->threadId
+               << ",\"ts\":" << s.startNs / 1000.0 << ",\"dur\":" << (s.endNs - s.startNs) / 1000.0 << "}";
+        }
+    }
+    ss << "]}";
+    return ss.str();
+}
+
+bool SpanTracer::writeChromeJson(const string& path) const {
+    ofstream out(path);
+    if (!out) return false;
+    out << exportChromeJson() << "\n";
+    return static_cast<bool>(out);
+}
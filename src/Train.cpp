@@ -4,138 +4,435 @@
  */
 
 #include "Train.h"
+#include "Tracing.h"
+#include "MemoryUsage.h"
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+/**
+ * @brief True if p has no other owner. The fence orders the caller's
+ * writes after the last reads of owners that have just let go.
+ */
+template <class T>
+bool isUnique(const shared_ptr<T>& p) {
+    if (p.use_count() != 1) return false;
+    atomic_thread_fence(memory_order_acquire);
+    return true;
+}
+
+} // namespace
 
 /**
  * @brief Constructor for Train.
  * Initializes the train with basic details.
  */
-Train::Train(string id, string t, int seats) 
-    : trainId(id), type(t), totalSeats(seats) {}
+Train::Train(string id, string t, int seats)
+    : trainId(move(id)), type(move(t)), totalSeats(seats), classSeats{{seats, 0, 0}} {}
+
+Train::Train(string id, string t, const array<int, SEAT_CLASS_COUNT>& seats)
+    : trainId(move(id)), type(move(t)), totalSeats(0), classSeats(seats) {
+    for (int n : classSeats) totalSeats += n;
+}
+
+Train::Train(string id, string t, const array<int, SEAT_CLASS_COUNT>& seats, shared_ptr<const Route> sharedRoute,
+             int firstDeparture)
+    : Train(move(id), move(t), seats) {
+    if (sharedRoute) route = move(sharedRoute);
+    timeOffset = firstDeparture;
+}
+
+Train Train::getTimetable() const {
+    Train timetable(trainId, type, classSeats, route, timeOffset);
+    timetable.serviceCalendar = serviceCalendar;
+    return timetable;
+}
+
+/**
+ * @brief Inventory keys are YYYY-MM-DD, so the dates of a range are
+ * adjacent in the map.
+ */
+size_t Train::cancelService(int firstDay, int lastDay) {
+    ServiceCalendar current = serviceCalendar ? *serviceCalendar : ServiceCalendar();
+    serviceCalendar = make_shared<const ServiceCalendar>(current.withoutDays(firstDay, lastDay));
+    if (!inventory) return 0;
+
+    auto begin = firstDay == INT_MIN ? inventory->begin() : inventory->lower_bound(Calendar::formatDate(firstDay));
+    auto end = lastDay == INT_MAX ? inventory->end() : inventory->upper_bound(Calendar::formatDate(lastDay));
+    size_t dropped = static_cast<size_t>(distance(begin, end));
+    if (dropped == 0) return 0;
+    InventoryMap& days = mutableInventory();
+    days.erase(firstDay == INT_MIN ? days.begin() : days.lower_bound(Calendar::formatDate(firstDay)),
+               lastDay == INT_MAX ? days.end() : days.upper_bound(Calendar::formatDate(lastDay)));
+    ++inventoryVersion;
+    return dropped;
+}
 
 /**
  * @brief Adds a stop to the route.
  * @param stop The Stop structure containing station details.
  */
 void Train::addStop(const Stop& stop) {
-    route.push_back(stop);
+    if (route->isEmpty()) timeOffset = stop.departureMinutes;
+    Stop relative = stop;
+    relative.arrivalMinutes -= timeOffset;
+    relative.departureMinutes -= timeOffset;
+    route = route->withStop(relative);
+    if (pricing) buildEmptyFarePrefix();
+}
+
+void Train::setRoute(shared_ptr<const Route> sharedRoute, int firstDeparture) {
+    route = sharedRoute ? move(sharedRoute) : Route::empty();
+    timeOffset = firstDeparture;
+    inventory.reset();
+    setPricingPolicy(pricing);
+}
+
+size_t Train::getHeapBytes() const {
+    return MemoryUsage::heapBytes(trainId) + MemoryUsage::heapBytes(type);
+}
+
+size_t Train::getRouteBytes() const {
+    return route->getMemoryBytes();
+}
+
+size_t Train::getInventoryBytes() const {
+    if (!inventory) return 0;
+    size_t total = sizeof(InventoryMap) + MemoryUsage::nodeBytes(*inventory);
+    for (const auto& day : *inventory) {
+        total += MemoryUsage::heapBytes(day.first) + sizeof(DailyInventory) + MemoryUsage::bufferBytes(day.second->seats) +
+                 MemoryUsage::bufferBytes(day.second->farePrefix);
+    }
+    return total;
 }
 
 /**
- * @brief Helper function to find the index of a station in the route.
- * @param route The vector of stops.
- * @param stationName The name of the station to find.
- * @return The index of the station, or -1 if not found.
+ * @brief Resolves and validates the stop indices of a journey.
  */
-int getStationIndex(const vector<Stop>& route, const string& stationName) {
-    for (size_t i = 0; i < route.size(); ++i) {
-        if (route[i].stationName == stationName) {
-            return i;
-        }
+bool Train::findSegment(const string& startStation, const string& endStation, int& startIndex, int& endIndex) const {
+    startIndex = route->findStation(startStation);
+    endIndex = route->findStation(endStation);
+    return startIndex != -1 && endIndex != -1 && startIndex < endIndex;
+}
+
+const Train::DailyInventory* Train::findDay(const string& date) const {
+    if (!inventory) return nullptr;
+    auto it = inventory->find(date);
+    return it == inventory->end() ? nullptr : it->second.get();
+}
+
+/**
+ * @brief Copies the map (its dates stay shared) if another train holds it.
+ */
+Train::InventoryMap& Train::mutableInventory() {
+    if (!inventory) {
+        inventory = make_shared<InventoryMap>();
+    } else if (!isUnique(inventory)) {
+        inventory = make_shared<InventoryMap>(*inventory);
+    }
+    return *inventory;
+}
+
+/**
+ * @brief Copies the per-class capacity into every segment of a new date,
+ * or copies a date another train still shares.
+ */
+Train::DailyInventory& Train::inventoryFor(const string& date) {
+    InventoryMap& days = mutableInventory();
+    auto it = days.find(date);
+    if (it == days.end()) {
+        auto day = make_shared<DailyInventory>();
+        day->seats.reserve((route->size() - 1) * SEAT_CLASS_COUNT);
+        for (size_t i = 0; i + 1 < route->size(); ++i) day->seats.insert(day->seats.end(), classSeats.begin(), classSeats.end());
+        it = days.emplace(date, move(day)).first;
+    } else if (!isUnique(it->second)) {
+        it->second = make_shared<DailyInventory>(*it->second);
     }
-    return -1;
+    return *it->second;
 }
 
 /**
  * @brief Checks ticket availability.
- * Verifies if there are enough seats in all segments between start and end stations.
+ * Verifies if there are enough seats of the class in all segments between start and end stations.
  */
-bool Train::hasTickets(const string& date, const string& startStation, const string& endStation, int count) {
-    int startIndex = getStationIndex(route, startStation);
-    int endIndex = getStationIndex(route, endStation);
+bool Train::hasTickets(const string& date, const string& startStation, const string& endStation, int count,
+                       SeatClass seatClass) const {
+    int startIndex, endIndex;
 
     // Validate stations order
-    if (startIndex == -1 || endIndex == -1 || startIndex >= endIndex) {
+    if (!findSegment(startStation, endStation, startIndex, endIndex) || !runsOn(date)) {
         return false;
     }
 
-    // Initialize inventory for this date if not exists
-    if (seatInventory.find(date) == seatInventory.end()) {
-        // By default, all segments have totalSeats
-        // Number of segments = route.size() - 1
-        seatInventory[date] = vector<int>(route.size() - 1, totalSeats);
+    // A date nobody has booked yet still has every seat free
+    const DailyInventory* day = findDay(date);
+    if (!day) {
+        return count <= classSeats[seatClass];
     }
 
-    const vector<int>& dailySeats = seatInventory[date];
+    const vector<int>& dailySeats = day->seats;
 
     // Check every segment from startIndex to endIndex-1
     for (int i = startIndex; i < endIndex; ++i) {
-        if (dailySeats[i] < count) {
+        if (dailySeats[i * SEAT_CLASS_COUNT + seatClass] < count) {
             return false;
         }
     }
     return true;
 }
 
+bool Train::hasSeats(const string& date, int startIndex, int endIndex) const {
+    for (int free : getClassAvailability(date, startIndex, endIndex)) {
+        if (free > 0) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Walks the journey's segments once, keeping a running minimum per class.
+ */
+array<int, SEAT_CLASS_COUNT> Train::getClassAvailability(const string& date, int startIndex, int endIndex) const {
+    array<int, SEAT_CLASS_COUNT> free = classSeats;
+    const DailyInventory* day = findDay(date);
+    if (!day) return free;
+    const int* seats = day->seats.data() + startIndex * SEAT_CLASS_COUNT;
+    for (int i = startIndex; i < endIndex; ++i, seats += SEAT_CLASS_COUNT) {
+        for (int c = 0; c < SEAT_CLASS_COUNT; ++c) free[c] = min(free[c], seats[c]);
+    }
+    return free;
+}
+
 /**
  * @brief Books tickets.
- * Decrements the available seat count for the specified segments.
+ * Decrements the available seat count of the class for the specified segments.
  */
-bool Train::bookTickets(const string& date, const string& startStation, const string& endStation, int count) {
-    if (!hasTickets(date, startStation, endStation, count)) {
+bool Train::bookTickets(const string& date, const string& startStation, const string& endStation, int count,
+                        SeatClass seatClass) {
+    TRACE_SPAN("Train::bookTickets");
+    if (!hasTickets(date, startStation, endStation, count, seatClass)) {
         return false;
     }
 
-    int startIndex = getStationIndex(route, startStation);
-    int endIndex = getStationIndex(route, endStation);
+    int startIndex = route->findStation(startStation);
+    int endIndex = route->findStation(endStation);
 
-    // We know inventory exists because hasTickets returned true (and it initializes if missing)
-    vector<int>& dailySeats = seatInventory[date];
+    // Initialize inventory for this date on its first booking
+    DailyInventory& day = inventoryFor(date);
     for (int i = startIndex; i < endIndex; ++i) {
-        dailySeats[i] -= count;
+        day.seats[i * SEAT_CLASS_COUNT + seatClass] -= count;
     }
+    notifyInventory(date, day, startIndex, endIndex, -count, seatClass);
     return true;
 }
 
+vector<int> Train::getAvailableSeats(const string& date) const {
+    size_t segments = route->isEmpty() ? 0 : route->size() - 1;
+    const DailyInventory* day = findDay(date);
+    if (!day) {
+        return vector<int>(segments, totalSeats);
+    }
+    vector<int> free(segments, 0);
+    for (size_t i = 0; i < segments; ++i) {
+        for (int c = 0; c < SEAT_CLASS_COUNT; ++c) free[i] += day->seats[i * SEAT_CLASS_COUNT + c];
+    }
+    return free;
+}
+
+/**
+ * @brief A date is sold out once no segment has a free seat left in any class.
+ */
+bool Train::isSoldOut(const string& date) const {
+    const DailyInventory* day = findDay(date);
+    if (!day) return totalSeats <= 0;
+    for (int seats : day->seats) {
+        if (seats > 0) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Books a batch of requests against one date's inventory.
+ */
+void Train::bookSegments(const string& date, vector<SegmentRequest>& requests) {
+    TRACE_SPAN("Train::bookSegments");
+    if (!runsOn(date)) {
+        for (auto& req : requests) req.granted = false;
+        return;
+    }
+    DailyInventory& day = inventoryFor(date);
+    vector<int>& dailySeats = day.seats;
+
+    for (auto& req : requests) {
+        req.granted = true;
+        for (int i = req.startIndex; i < req.endIndex; ++i) {
+            if (dailySeats[i * SEAT_CLASS_COUNT + req.seatClass] < req.count) {
+                req.granted = false;
+                break;
+            }
+        }
+        if (!req.granted) continue;
+        for (int i = req.startIndex; i < req.endIndex; ++i) {
+            dailySeats[i * SEAT_CLASS_COUNT + req.seatClass] -= req.count;
+        }
+        notifyInventory(date, day, req.startIndex, req.endIndex, -req.count, req.seatClass);
+    }
+}
+
 /**
  * @brief Releases tickets.
- * Increments the available seat count for the specified segments.
+ * Increments the available seat count of the class for the specified segments.
  * Used for cancellations/refunds.
  */
-void Train::releaseTickets(const string& date, const string& startStation, const string& endStation, int count) {
-    int startIndex = getStationIndex(route, startStation);
-    int endIndex = getStationIndex(route, endStation);
+void Train::releaseTickets(const string& date, const string& startStation, const string& endStation, int count,
+                           SeatClass seatClass) {
+    TRACE_SPAN("Train::releaseTickets");
+    int startIndex = route->findStation(startStation);
+    int endIndex = route->findStation(endStation);
     
     // If date not in inventory, nothing to release (should not happen if order exists)
-    if (seatInventory.find(date) == seatInventory.end()) return;
+    if (!findDay(date)) return;
 
-    vector<int>& dailySeats = seatInventory[date];
+    DailyInventory& day = inventoryFor(date);
     for (int i = startIndex; i < endIndex; ++i) {
-        dailySeats[i] += count;
-        // Cap at total seats
-        if (dailySeats[i] > totalSeats) dailySeats[i] = totalSeats;
+        int& seats = day.seats[i * SEAT_CLASS_COUNT + seatClass];
+        seats += count;
+        // Cap at the class capacity
+        if (seats > classSeats[seatClass]) seats = classSeats[seatClass];
     }
+    notifyInventory(date, day, startIndex, endIndex, count, seatClass);
+}
+
+/**
+ * @brief Only the changed segments are repriced; the prefix entries after them
+ * move by the total difference, so quotes stay two lookups.
+ */
+void Train::repriceSegments(DailyInventory& day, int startIndex, int endIndex, SeatClass seatClass) {
+    if (day.farePrefix.empty()) day.farePrefix = *emptyFarePrefix;
+    vector<Money>& prefix = day.farePrefix;
+    const vector<int>& dailySeats = day.seats;
+    const int k = SEAT_CLASS_COUNT;
+    Money shift;
+    for (int i = startIndex; i < endIndex; ++i) {
+        Money oldFare = prefix[(i + 1) * k + seatClass] - prefix[i * k + seatClass] + shift;
+        Money base = route->baseFare(i + 1, seatClass) - route->baseFare(i, seatClass);
+        Money newFare = pricing->segmentFare(base, dailySeats[i * k + seatClass], classSeats[seatClass]);
+        shift += newFare - oldFare;
+        prefix[(i + 1) * k + seatClass] += shift;
+    }
+    if (shift == Money()) return;
+    for (size_t i = endIndex + 1; i < route->size(); ++i) {
+        prefix[i * k + seatClass] += shift;
+    }
+}
+
+void Train::buildFarePrefix(const vector<int>& dailySeats, vector<Money>& prefix) const {
+    const int k = SEAT_CLASS_COUNT;
+    prefix.assign(route->size() * k, Money());
+    for (size_t i = 0; i + 1 < route->size(); ++i) {
+        for (int c = 0; c < k; ++c) {
+            Money base = route->baseFare(i + 1, static_cast<SeatClass>(c)) - route->baseFare(i, static_cast<SeatClass>(c));
+            prefix[(i + 1) * k + c] = prefix[i * k + c] + pricing->segmentFare(base, dailySeats[i * k + c], classSeats[c]);
+        }
+    }
+}
+
+void Train::buildEmptyFarePrefix() {
+    vector<int> empty;
+    for (size_t i = 0; i + 1 < route->size(); ++i) empty.insert(empty.end(), classSeats.begin(), classSeats.end());
+    auto prefix = make_shared<vector<Money>>();
+    buildFarePrefix(empty, *prefix);
+    emptyFarePrefix = move(prefix);
+}
+
+void Train::setPricingPolicy(shared_ptr<const PricingPolicy> policy) {
+    pricing = move(policy);
+    emptyFarePrefix.reset();
+    bool priced = pricing && !route->isEmpty();
+    if (priced) buildEmptyFarePrefix();
+    if (!inventory) return;
+    for (const auto& pair : mutableInventory()) {
+        DailyInventory& day = inventoryFor(pair.first);
+        if (priced) {
+            buildFarePrefix(day.seats, day.farePrefix);
+        } else {
+            vector<Money>().swap(day.farePrefix);
+        }
+    }
+}
+
+/**
+ * @brief Bumps the version and, if someone listens, builds and delivers the event.
+ */
+void Train::notifyInventory(const string& date, DailyInventory& day, int startIndex, int endIndex, int delta,
+                            SeatClass seatClass) {
+    ++inventoryVersion;
+    if (pricing && startIndex < endIndex) repriceSegments(day, startIndex, endIndex, seatClass);
+    const vector<int>& dailySeats = day.seats;
+    if (!inventoryListener || !inventoryListener->isListening() || startIndex >= endIndex) return;
+    int newMin = totalSeats;
+    for (int i = startIndex; i < endIndex; ++i) {
+        int free = 0;
+        for (int c = 0; c < SEAT_CLASS_COUNT; ++c) free += dailySeats[i * SEAT_CLASS_COUNT + c];
+        newMin = min(newMin, free);
+    }
+    inventoryListener->onInventoryChange({trainId, date, startIndex, endIndex, delta, newMin, totalSeats,
+                                          static_cast<int>(dailySeats.size() / SEAT_CLASS_COUNT), inventoryVersion,
+                                          seatClass});
 }
 
 /**
  * @brief Calculates ticket price.
- * Price is determined by the difference in cumulative price between end and start stations.
+ * Price is determined by the difference in the class's cumulative price between end and start stations.
  */
-double Train::getPrice(const string& startStation, const string& endStation) {
-    int startIndex = getStationIndex(route, startStation);
-    int endIndex = getStationIndex(route, endStation);
+double Train::getPrice(const string& startStation, const string& endStation, SeatClass seatClass) {
+    int startIndex = route->findStation(startStation);
+    int endIndex = route->findStation(endStation);
     
     if (startIndex == -1 || endIndex == -1 || startIndex >= endIndex) return 0.0;
 
-    return route[endIndex].priceFromStart - route[startIndex].priceFromStart;
+    return (*route)[endIndex].classPrice(seatClass) - (*route)[startIndex].classPrice(seatClass);
+}
+
+/**
+ * @brief Quotes from the date's prefix table, or the empty-train table if
+ * nothing has been booked that day yet.
+ */
+Money Train::quote(int startIndex, int endIndex, const string& date, int today, SeatClass seatClass) const {
+    if (startIndex < 0 || endIndex >= static_cast<int>(route->size()) || startIndex >= endIndex) return Money();
+    const int k = SEAT_CLASS_COUNT;
+    if (!pricing) return route->baseFare(endIndex, seatClass) - route->baseFare(startIndex, seatClass);
+    const DailyInventory* day = findDay(date);
+    const vector<Money>& prefix = day && !day->farePrefix.empty() ? day->farePrefix : *emptyFarePrefix;
+    Money fare = prefix[endIndex * k + seatClass] - prefix[startIndex * k + seatClass];
+    int departureDay = Calendar::dayNumber(date) + getDayOffset(startIndex);
+    return fare.scaledBp(pricing->daysMultiplier(departureDay - today));
+}
+
+Money Train::quote(const string& startStation, const string& endStation, const string& date, int today,
+                   SeatClass seatClass) const {
+    int startIndex, endIndex;
+    if (!findSegment(startStation, endStation, startIndex, endIndex)) return Money();
+    return quote(startIndex, endIndex, date, today, seatClass);
 }
 
 /**
  * @brief Gets departure time.
  */
-string Train::getDepartureTime(const string& station) {
-    int idx = getStationIndex(route, station);
-    if (idx != -1) return route[idx].departureTime;
+string Train::getDepartureTime(const string& station) const {
+    int idx = route->findStation(station);
+    if (idx != -1) return Calendar::formatClock(getDepartureMinutes(idx));
     return "";
 }
 
 /**
  * @brief Gets arrival time.
  */
-string Train::getArrivalTime(const string& station) {
-    int idx = getStationIndex(route, station);
-    if (idx != -1) return route[idx].arrivalTime;
+string Train::getArrivalTime(const string& station) const {
+    int idx = route->findStation(station);
+    if (idx != -1) return Calendar::formatClock(getArrivalMinutes(idx));
     return "";
 }
 
@@ -146,7 +443,7 @@ string Train::getArrivalTime(const string& station) {
 ostream& operator<<(ostream& os, const Train& train) {
     os << "Train: " << train.trainId << " (" << train.type << ")" << endl;
     os << "Route: ";
-    for (const auto& stop : train.route) {
+    for (const auto& stop : train.getRoute()) {
         os << stop.stationName << " -> ";
     }
     os << "END";
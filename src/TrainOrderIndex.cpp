@@ -0,0 +1,77 @@
+/**
+ * @file TrainOrderIndex.cpp
+ * @brief Implementation of the index from trains to their orders.
+ */
+
+#include "TrainOrderIndex.h"
+#include "MemoryUsage.h"
+#include "Tracing.h"
+#include <functional>
+
+TrainOrderIndex::TrainOrderIndex(size_t shardCount) {
+    if (shardCount == 0) shardCount = 1;
+    shards.reserve(shardCount);
+    for (size_t i = 0; i < shardCount; ++i) {
+        shards.push_back(make_unique<Shard>());
+    }
+}
+
+TrainOrderIndex::Shard& TrainOrderIndex::shardFor(const string& trainId) const {
+    return *shards[hash<string>()(trainId) % shards.size()];
+}
+
+void TrainOrderIndex::add(const string& trainId, TrainOrderEntry entry) {
+    TRACE_SPAN("TrainOrderIndex::add");
+    Shard& shard = shardFor(trainId);
+    lock_guard<mutex> lock(shard.mtx);
+    shard.trains[trainId].push_back(move(entry));
+}
+
+/**
+ * @brief The entries kept are compacted in place, so taking every date is
+ * a move of the whole list.
+ */
+vector<TrainOrderEntry> TrainOrderIndex::take(const string& trainId, int firstDay, int lastDay) {
+    Shard& shard = shardFor(trainId);
+    lock_guard<mutex> lock(shard.mtx);
+    auto it = shard.trains.find(trainId);
+    if (it == shard.trains.end()) return {};
+    vector<TrainOrderEntry>& entries = it->second;
+    vector<TrainOrderEntry> taken;
+    size_t kept = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].serviceDay >= firstDay && entries[i].serviceDay <= lastDay) {
+            taken.push_back(move(entries[i]));
+        } else {
+            if (kept != i) entries[kept] = move(entries[i]);
+            ++kept;
+        }
+    }
+    if (kept == 0) {
+        shard.trains.erase(it);
+    } else {
+        entries.resize(kept);
+    }
+    return taken;
+}
+
+size_t TrainOrderIndex::size() const {
+    size_t total = 0;
+    for (const auto& shard : shards) {
+        lock_guard<mutex> lock(shard->mtx);
+        for (const auto& pair : shard->trains) total += pair.second.size();
+    }
+    return total;
+}
+
+size_t TrainOrderIndex::getMemoryBytes() const {
+    size_t total = sizeof(*this) + MemoryUsage::bufferBytes(shards);
+    for (const auto& shard : shards) {
+        lock_guard<mutex> lock(shard->mtx);
+        total += sizeof(Shard) + MemoryUsage::nodeBytes(shard->trains);
+        for (const auto& pair : shard->trains) {
+            total += MemoryUsage::heapBytes(pair.first) + MemoryUsage::bufferBytes(pair.second);
+        }
+    }
+    return total;
+}
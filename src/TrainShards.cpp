@@ -0,0 +1,58 @@
+/**
+ * @file TrainShards.cpp
+ * @brief Implementation of the shard worker threads.
+ */
+
+#include "TrainShards.h"
+
+TrainShardPool::TrainShardPool(size_t shardCount) {
+    if (shardCount == 0) shardCount = 1;
+    shards.reserve(shardCount);
+    for (size_t i = 0; i < shardCount; ++i) {
+        shards.push_back(make_unique<Shard>());
+    }
+    for (auto& shard : shards) {
+        Shard* s = shard.get();
+        s->worker = thread([s]() { workerLoop(*s); });
+    }
+}
+
+/**
+ * @brief Stops the workers after they have drained their queues.
+ */
+TrainShardPool::~TrainShardPool() {
+    for (auto& shard : shards) {
+        {
+            lock_guard<mutex> lock(shard->mtx);
+            shard->stopping = true;
+        }
+        shard->cv.notify_one();
+    }
+    for (auto& shard : shards) {
+        shard->worker.join();
+    }
+}
+
+size_t TrainShardPool::shardOf(const string& trainId) const {
+    return hash<string>()(trainId) % shards.size();
+}
+
+/**
+ * @brief Processes messages in batches: the queue lock is taken once per
+ * batch, not once per message.
+ */
+void TrainShardPool::workerLoop(Shard& shard) {
+    deque<function<void()>> batch;
+    for (;;) {
+        {
+            unique_lock<mutex> lock(shard.mtx);
+            shard.cv.wait(lock, [&]() { return shard.stopping || !shard.queue.empty(); });
+            if (shard.queue.empty()) return; // stopping and drained
+            batch.swap(shard.queue);
+        }
+        for (auto& message : batch) {
+            message();
+        }
+        batch.clear();
+    }
+}
@@ -4,6 +4,13 @@
  */
 
 #include "User.h"
+#include "MemoryUsage.h"
+#include "Tracing.h"
+
+size_t User::getMemoryBytes() const {
+    using MemoryUsage::heapBytes;
+    return sizeof(User) + heapBytes(username) + heapBytes(password) + heapBytes(realName) + heapBytes(idCard);
+}
 
 /**
  * @brief Displays the passenger menu.
@@ -19,14 +26,25 @@ void Passenger::displayMenu() const {
 /**
  * @brief Adds an order to the history.
  */
-void Passenger::addOrder(const Order& order) {
+size_t Passenger::addOrder(const Order& order) {
+    TRACE_SPAN("Passenger::addOrder");
+    lock_guard<mutex> lock(ordersMutex);
     orderHistory.push_back(order);
+    return orderHistory.size() - 1;
+}
+
+size_t Passenger::addOrder(Order&& order) {
+    TRACE_SPAN("Passenger::addOrder");
+    lock_guard<mutex> lock(ordersMutex);
+    orderHistory.push_back(move(order));
+    return orderHistory.size() - 1;
 }
 
 /**
  * @brief Marks an order as cancelled.
  */
 void Passenger::cancelOrder(const string& orderId) {
+    lock_guard<mutex> lock(ordersMutex);
     for (auto& order : orderHistory) {
         if (order.getOrderId() == orderId) {
             order.setStatus(CANCELLED);
@@ -35,6 +53,98 @@ void Passenger::cancelOrder(const string& orderId) {
     }
 }
 
+/**
+ * @brief Cancels a PAID order under the history lock.
+ */
+bool Passenger::cancelPaidOrder(const string& orderId, Order& cancelled) {
+    lock_guard<mutex> lock(ordersMutex);
+    for (auto& order : orderHistory) {
+        if (order.getOrderId() == orderId && order.getStatus() == PAID) {
+            order.setStatus(CANCELLED);
+            cancelled = order;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Cancels a PAID order at a known position.
+ */
+bool Passenger::cancelPaidOrderAt(size_t position, const string& orderId, Order& cancelled) {
+    lock_guard<mutex> lock(ordersMutex);
+    if (position >= orderHistory.size()) return false;
+    Order& order = orderHistory[position];
+    if (order.getOrderId() != orderId || order.getStatus() != PAID) return false;
+    order.setStatus(CANCELLED);
+    cancelled = order;
+    return true;
+}
+
+size_t Passenger::addOrderGroup(vector<Order>&& orders) {
+    TRACE_SPAN("Passenger::addOrderGroup");
+    lock_guard<mutex> lock(ordersMutex);
+    size_t first = orderHistory.size();
+    orderHistory.insert(orderHistory.end(), make_move_iterator(orders.begin()), make_move_iterator(orders.end()));
+    return first;
+}
+
+/**
+ * @brief Verifies the order ID, then cancels the order's journey.
+ */
+bool Passenger::cancelPaidJourneyAt(size_t position, const string& orderId, vector<Order>& cancelled) {
+    lock_guard<mutex> lock(ordersMutex);
+    if (position >= orderHistory.size()) return false;
+    const Order& order = orderHistory[position];
+    if (order.getOrderId() != orderId || order.getStatus() != PAID) return false;
+    cancelJourneyLocked(position, cancelled);
+    return true;
+}
+
+size_t Passenger::cancelPaidAt(const vector<size_t>& positions, vector<Order>& cancelled) {
+    lock_guard<mutex> lock(ordersMutex);
+    size_t before = cancelled.size();
+    for (size_t position : positions) {
+        if (position < orderHistory.size() && orderHistory[position].getStatus() == PAID) {
+            cancelJourneyLocked(position, cancelled);
+        }
+    }
+    return cancelled.size() - before;
+}
+
+/**
+ * @brief Journeys are stored contiguously (addOrderGroup), so the other
+ * legs are found from the order's position in its journey.
+ */
+void Passenger::cancelJourneyLocked(size_t position, vector<Order>& cancelled) {
+    const Order& order = orderHistory[position];
+    size_t first = position - order.getJourneyLeg();
+    size_t end = first + order.getJourneyLegs();
+    const string journeyId = order.getJourneyId();
+    for (size_t i = first; i < end; ++i) {
+        Order& leg = orderHistory[i];
+        if (leg.getJourneyId() != journeyId || leg.getStatus() != PAID) continue;
+        leg.setStatus(CANCELLED);
+        cancelled.push_back(leg);
+    }
+}
+
+/**
+ * @brief Copies the order history under the history lock.
+ */
+vector<Order> Passenger::getOrdersSnapshot() const {
+    lock_guard<mutex> lock(ordersMutex);
+    return orderHistory;
+}
+
+size_t Passenger::getOrderHistoryBytes(size_t* orderCount) const {
+    lock_guard<mutex> lock(ordersMutex);
+    size_t total = MemoryUsage::bufferBytes(orderHistory);
+    for (const Order& order : orderHistory) total += order.getHeapBytes();
+    if (orderCount) *orderCount = orderHistory.size();
+    return total;
+}
+
 /**
  * @brief Displays the admin menu.
  */
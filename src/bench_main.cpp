@@ -0,0 +1,170 @@
+/**
+ * @file bench_main.cpp
+ * @brief Microbenchmarks of the core API over a synthetic network.
+ *
+ * Usage: Benchmarks [--stations N] [--trains N] [--stops N] [--days N]
+ *                   [--shared-patterns PERCENT] [--iterations N] [--seed N]
+ *                   [--filter name]
+ *
+ * Results are written to stdout as one JSON document so runs can be
+ * diffed or compared by a script.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include "SystemManager.h"
+#include "NetworkGenerator.h"
+
+namespace {
+
+using BenchClock = chrono::steady_clock;
+
+struct BenchResult {
+    string name;
+    size_t iterations;
+    double meanNs;
+    double p50Ns;
+    double p99Ns;
+    double maxNs;
+};
+
+/**
+ * @brief Times op(i) for i in [0, iterations) individually.
+ */
+BenchResult measure(const string& name, size_t iterations, const function<void(size_t)>& op) {
+    vector<double> samples;
+    samples.reserve(iterations);
+    double total = 0.0;
+    for (size_t i = 0; i < iterations; ++i) {
+        BenchClock::time_point start = BenchClock::now();
+        op(i);
+        double ns = chrono::duration<double, nano>(BenchClock::now() - start).count();
+        samples.push_back(ns);
+        total += ns;
+    }
+    sort(samples.begin(), samples.end());
+    auto at = [&](double q) { return samples.empty() ? 0.0 : samples[static_cast<size_t>(q * (samples.size() - 1))]; };
+    return {name, iterations, iterations ? total / iterations : 0.0, at(0.50), at(0.99), samples.empty() ? 0.0 : samples.back()};
+}
+
+string toJson(const NetworkConfig& cfg, const vector<BenchResult>& results, const MemoryReport& memory) {
+    stringstream ss;
+    ss << fixed << setprecision(1);
+    ss << "{\n  \"config\": {\"stations\": " << cfg.stations << ", \"trains\": " << cfg.trains
+       << ", \"stopsPerTrain\": " << cfg.stopsPerTrain << ", \"daysOnSale\": " << cfg.daysOnSale
+       << ", \"seatsPerTrain\": " << cfg.seatsPerTrain << ", \"sharedPatternPercent\": " << cfg.sharedPatternPercent
+       << ", \"seed\": " << cfg.seed << "},\n";
+    ss << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        ss << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+           << ", \"mean_ns\": " << r.meanNs << ", \"p50_ns\": " << r.p50Ns << ", \"p99_ns\": " << r.p99Ns
+           << ", \"max_ns\": " << r.maxNs << ", \"ops_per_sec\": " << (r.meanNs > 0 ? 1e9 / r.meanNs : 0.0) << "}"
+           << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    ss << "  ],\n  \"memory\": " << memory.toJson(5) << "\n}\n";
+    return ss.str();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    NetworkConfig cfg;
+    size_t iterations = 20000;
+    string filter;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string flag = argv[i];
+        const char* value = argv[i + 1];
+        if (flag == "--stations") cfg.stations = atoi(value);
+        else if (flag == "--trains") cfg.trains = atoi(value);
+        else if (flag == "--stops") cfg.stopsPerTrain = atoi(value);
+        else if (flag == "--days") cfg.daysOnSale = atoi(value);
+        else if (flag == "--shared-patterns") cfg.sharedPatternPercent = atoi(value);
+        else if (flag == "--iterations") iterations = strtoul(value, nullptr, 10);
+        else if (flag == "--seed") cfg.seed = strtoul(value, nullptr, 10);
+        else if (flag == "--filter") filter = value;
+        else {
+            cerr << "unknown option " << flag << endl;
+            return 1;
+        }
+    }
+
+    NetworkGenerator network(cfg);
+    SystemManager sys;
+    network.populate(sys);
+    cfg = network.getConfig();
+
+    auto enabled = [&](const string& name) { return filter.empty() || name.find(filter) != string::npos; };
+    vector<BenchResult> results;
+
+    // Pre-draw the workload so random number generation is not timed
+    mt19937 rng(cfg.seed + 1);
+    vector<NetworkGenerator::Trip> trips;
+    for (size_t i = 0; i < iterations; ++i) trips.push_back(network.randomTrip(rng));
+
+    if (enabled("registerUser")) {
+        results.push_back(measure("registerUser", iterations, [&](size_t i) {
+            string name = "bench" + to_string(i);
+            sys.registerUser(name, "pw", name, to_string(i));
+        }));
+    }
+    sys.registerUser("benchuser", "pw", "Bench User", "0");
+
+    if (enabled("login")) {
+        results.push_back(measure("login", iterations, [&](size_t) {
+            string session = sys.login("benchuser", "pw");
+            sys.logout(session);
+        }));
+    }
+
+    if (enabled("searchTrains")) {
+        size_t searches = max<size_t>(1, iterations / 10); // a search scans every train
+        results.push_back(measure("searchTrains", searches, [&](size_t i) {
+            sys.searchTrains(trips[i].from, trips[i].to, trips[i].date);
+        }));
+    }
+
+    if (enabled("getPrice")) {
+        vector<Train> trains = network.getTrains();
+        results.push_back(measure("getPrice", iterations, [&](size_t i) {
+            trains[trips[i].trainIndex].getPrice(trips[i].from, trips[i].to);
+        }));
+    }
+
+    if (enabled("quote")) {
+        vector<Train> trains = network.getTrains();
+        auto policy = make_shared<const PricingPolicy>(PricingPolicy::standard());
+        for (Train& t : trains) t.setPricingPolicy(policy);
+        int today = sys.getCurrentDay();
+        results.push_back(measure("quote", iterations, [&](size_t i) {
+            trains[trips[i].trainIndex].quote(trips[i].from, trips[i].to, trips[i].date, today);
+        }));
+    }
+
+    string session = sys.login("benchuser", "pw");
+    vector<string> orderIds;
+    orderIds.reserve(iterations);
+    if (enabled("bookTicket") || enabled("refundTicket")) {
+        results.push_back(measure("bookTicket", iterations, [&](size_t i) {
+            BookingResult r = sys.placeBooking(session, trips[i].trainId, trips[i].from, trips[i].to, trips[i].date);
+            if (r.status == BOOKED) orderIds.push_back(r.orderId);
+        }));
+        if (!enabled("bookTicket")) results.pop_back();
+    }
+
+    if (enabled("refundTicket")) {
+        results.push_back(measure("refundTicket", orderIds.size(), [&](size_t i) {
+            sys.refundTicket(session, orderIds[i]);
+        }));
+    }
+
+    cout << toJson(cfg, results, sys.getMemoryReport());
+    return 0;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file bench_pipeline.cpp
+ * @brief Flash-sale benchmark: BookingPipeline versus synchronous bookTicket.
+ *
+ * Usage: PipelineBench [threads] [bookingsPerThread]
+ * All threads book the same hot train and date. Reports throughput and
+ * p50/p99 latency for both paths.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include "BookingPipeline.h"
+
+namespace {
+
+using BenchClock = chrono::steady_clock;
+
+struct RunStats {
+    double throughput;
+    double p50Micros;
+    double p99Micros;
+};
+
+void setupHotTrain(SystemManager& sys) {
+    Train hot("HOT1", "High-Speed", 100000000);
+    hot.addStop({"Beijing", 8 * 60, 8 * 60, 0.0, 0});
+    hot.addStop({"Jinan", 9 * 60 + 30, 9 * 60 + 35, 150.0, 400});
+    hot.addStop({"Nanjing", 11 * 60 + 30, 11 * 60 + 35, 350.0, 1000});
+    hot.addStop({"Shanghai", 13 * 60, 13 * 60, 553.0, 1318});
+    sys.addTrain(hot);
+}
+
+vector<string> openSessions(SystemManager& sys, int count) {
+    vector<string> sessions;
+    for (int i = 0; i < count; ++i) {
+        string name = "flash" + to_string(i);
+        sys.registerUser(name, "pw", name, to_string(i));
+        sessions.push_back(sys.login(name, "pw"));
+    }
+    return sessions;
+}
+
+RunStats summarize(vector<double>& latencies, double seconds) {
+    sort(latencies.begin(), latencies.end());
+    auto at = [&](double q) { return latencies.empty() ? 0.0 : latencies[static_cast<size_t>(q * (latencies.size() - 1))]; };
+    return {latencies.size() / seconds, at(0.50), at(0.99)};
+}
+
+RunStats runSynchronous(int threads, int perThread) {
+    SystemManager sys;
+    setupHotTrain(sys);
+    vector<string> sessions = openSessions(sys, threads);
+    vector<vector<double>> perWorker(threads);
+
+    BenchClock::time_point begin = BenchClock::now();
+    vector<thread> workers;
+    for (int w = 0; w < threads; ++w) {
+        workers.emplace_back([&, w]() {
+            perWorker[w].reserve(perThread);
+            for (int i = 0; i < perThread; ++i) {
+                BenchClock::time_point start = BenchClock::now();
+                sys.bookTicket(sessions[w], "HOT1", "Beijing", "Shanghai", "2024-02-10");
+                perWorker[w].push_back(chrono::duration<double, micro>(BenchClock::now() - start).count());
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    double seconds = chrono::duration<double>(BenchClock::now() - begin).count();
+
+    vector<double> all;
+    for (auto& part : perWorker) all.insert(all.end(), part.begin(), part.end());
+    return summarize(all, seconds);
+}
+
+RunStats runPipeline(int threads, int perThread) {
+    SystemManager sys;
+    setupHotTrain(sys);
+    vector<string> sessions = openSessions(sys, threads);
+
+    // Callbacks all run on the pipeline's order thread, so this needs no lock
+    vector<double> latencies;
+    latencies.reserve(static_cast<size_t>(threads) * perThread);
+    atomic<int> remaining{threads * perThread};
+
+    BenchClock::time_point begin = BenchClock::now();
+    {
+        BookingPipeline pipeline(sys);
+        vector<thread> workers;
+        for (int w = 0; w < threads; ++w) {
+            workers.emplace_back([&, w]() {
+                for (int i = 0; i < perThread; ++i) {
+                    BenchClock::time_point start = BenchClock::now();
+                    pipeline.submit(sessions[w], "HOT1", "Beijing", "Shanghai", "2024-02-10", 1, SECOND_CLASS,
+                                    [&latencies, &remaining, start](const BookingResult&) {
+                        latencies.push_back(chrono::duration<double, micro>(BenchClock::now() - start).count());
+                        remaining.fetch_sub(1);
+                    });
+                }
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        while (remaining.load() > 0) this_thread::yield();
+        cout << "pipeline batches: " << pipeline.getBatchCount()
+             << " (avg " << fixed << setprecision(1) << double(pipeline.getProcessedCount()) / max<uint64_t>(1, pipeline.getBatchCount())
+             << " requests/batch)" << endl;
+    }
+    double seconds = chrono::duration<double>(BenchClock::now() - begin).count();
+    return summarize(latencies, seconds);
+}
+
+void print(const string& name, const RunStats& stats) {
+    cout << setw(12) << name << setw(16) << fixed << setprecision(0) << stats.throughput
+         << setw(12) << setprecision(1) << stats.p50Micros << setw(12) << stats.p99Micros << endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int threads = argc > 1 ? atoi(argv[1]) : max(2u, thread::hardware_concurrency());
+    int perThread = argc > 2 ? atoi(argv[2]) : 50000;
+    cout << "threads=" << threads << " bookings/thread=" << perThread << " (one hot train)" << endl;
+
+    RunStats sync = runSynchronous(threads, perThread);
+    RunStats pipe = runPipeline(threads, perThread);
+
+    cout << setw(12) << "path" << setw(16) << "bookings/sec" << setw(12) << "p50(us)" << setw(12) << "p99(us)" << endl;
+    print("synchronous", sync);
+    print("pipeline", pipe);
+    return 0;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file bench_shards.cpp
+ * @brief Booking throughput versus shard count.
+ *
+ * Usage: ShardBench [threads] [bookingsPerThread]
+ * Every thread books random segments on random trains with its own session.
+ * Shard count 0 is the direct mode (one global lock) for comparison.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include "SystemManager.h"
+#include "NetworkGenerator.h"
+
+namespace {
+
+double runBookings(SystemManager& sys, const NetworkGenerator& network, const vector<string>& sessions, int perThread) {
+    auto begin = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (size_t w = 0; w < sessions.size(); ++w) {
+        workers.emplace_back([&, w]() {
+            mt19937 rng(static_cast<unsigned>(w) + 1);
+            for (int i = 0; i < perThread; ++i) {
+                NetworkGenerator::Trip trip = network.randomTrip(rng);
+                sys.bookTicket(sessions[w], trip.trainId, trip.from, trip.to, trip.date);
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - begin;
+    return sessions.size() * perThread / elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int threads = argc > 1 ? atoi(argv[1]) : max(2u, thread::hardware_concurrency());
+    int perThread = argc > 2 ? atoi(argv[2]) : 20000;
+
+    NetworkConfig cfg;
+    cfg.trains = 256;
+    cfg.stopsPerTrain = 8;
+    cfg.seatsPerTrain = 1000000;
+    NetworkGenerator network(cfg);
+
+    cout << "threads=" << threads << " bookings/thread=" << perThread << endl;
+    cout << setw(8) << "shards" << setw(16) << "bookings/sec" << endl;
+
+    for (size_t shards : {0, 1, 2, 4, 8, 16}) {
+        SystemManager sys;
+        network.populate(sys);
+        sys.setShardCount(shards);
+
+        vector<string> sessions;
+        for (int w = 0; w < threads; ++w) {
+            string name = "bench" + to_string(w);
+            sys.registerUser(name, "pw", name, to_string(w));
+            sessions.push_back(sys.login(name, "pw"));
+        }
+        double rate = runBookings(sys, network, sessions, perThread);
+        cout << setw(8) << shards << setw(16) << fixed << setprecision(0) << rate << endl;
+    }
+    return 0;
+}
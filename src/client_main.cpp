@@ -0,0 +1,58 @@
+/**
+ * @file client_main.cpp
+ * @brief Command-line front-end for TicketClient.
+ *
+ * Usage: TicketCli [socketPath] < requests.txt
+ * Each input line is one request; fields are separated by tabs, or by
+ * spaces when the line has no tab. All requests are pipelined, and the
+ * responses are printed in order, one per line.
+ */
+
+#include <iostream>
+#include <sstream>
+#include "TicketClient.h"
+
+static vector<string> splitRequest(const string& line) {
+    if (line.find('\t') != string::npos) return TicketProtocol::decodeLine(line);
+    vector<string> fields;
+    stringstream ss(line);
+    string field;
+    while (ss >> field) fields.push_back(field);
+    return fields;
+}
+
+int main(int argc, char* argv[]) {
+    string socketPath = argc > 1 ? argv[1] : "/tmp/railway-ticket.sock";
+
+    TicketClient client;
+    if (!client.connect(socketPath)) {
+        cerr << client.getLastError() << endl;
+        return 1;
+    }
+
+    size_t pending = 0;
+    string line;
+    while (getline(cin, line)) {
+        vector<string> request = splitRequest(line);
+        if (request.empty()) continue;
+        client.send(request);
+        ++pending;
+    }
+    if (!client.flush()) {
+        cerr << client.getLastError() << endl;
+        return 1;
+    }
+
+    vector<string> response;
+    for (; pending > 0; --pending) {
+        if (!client.receive(response)) {
+            cerr << client.getLastError() << endl;
+            return 1;
+        }
+        for (size_t i = 0; i < response.size(); ++i) {
+            cout << (i ? " " : "") << response[i];
+        }
+        cout << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file replay_main.cpp
+ * @brief Replays a recorded call trace against a fresh SystemManager.
+ *
+ * Usage: TraceReplay <trace> [--speed X|max] [--threads N] [--shards N] [--admission]
+ * --speed 1 (default) keeps the recorded pacing, --speed 10 compresses it
+ * tenfold and --speed max issues calls back to back. Prints latency
+ * percentiles and histograms per operation and lists divergent outcomes;
+ * exits with status 2 if any outcome diverged.
+ *
+ * Traces are written by TicketServer --record <path>.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include "TraceReplay.h"
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "Usage: TraceReplay <trace> [--speed X|max] [--threads N] [--shards N] [--admission]" << endl;
+        return 1;
+    }
+    string path = argv[1];
+    ReplayConfig config;
+    size_t shards = 0;
+    bool admission = false;
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        string value = i + 1 < argc ? argv[i + 1] : "";
+        if (arg == "--speed" && !value.empty()) {
+            config.speed = value == "max" ? 0.0 : atof(value.c_str());
+            ++i;
+        } else if (arg == "--threads" && !value.empty()) {
+            config.threads = strtoul(value.c_str(), nullptr, 10);
+            ++i;
+        } else if (arg == "--shards" && !value.empty()) {
+            shards = strtoul(value.c_str(), nullptr, 10);
+            ++i;
+        } else if (arg == "--admission") {
+            admission = true;
+        } else {
+            cerr << "Unknown option " << arg << endl;
+            return 1;
+        }
+    }
+
+    TraceReader reader;
+    if (!reader.open(path)) {
+        cerr << "Cannot read " << path << ": " << reader.getLastError() << endl;
+        return 1;
+    }
+    vector<TraceRecord> records;
+    TraceRecord record;
+    while (reader.next(record)) records.push_back(record);
+    if (!reader.getLastError().empty()) {
+        cerr << "Stopped at record " << records.size() << ": " << reader.getLastError() << endl;
+    }
+
+    SystemManager system;
+    if (shards > 0) system.setShardCount(shards);
+    if (admission) system.enableAdmissionControl();
+
+    TraceReplayer replayer(system, config);
+    ReplayReport report = replayer.run(records, reader.getStartTime());
+    report.print(cout);
+    return report.divergences > 0 ? 2 : 0;
+}
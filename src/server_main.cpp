@@ -0,0 +1,119 @@
+/**
+ * @file server_main.cpp
+ * @brief Entry point of the headless ticketing daemon.
+ *
+ * Usage: TicketServer [socketPath] [--admission] [--record tracePath] [--spans spansPath]
+ *                     [--replication-log logPath] [--replica-of logPath]
+ * Serves the demo data set on a Unix socket until SIGINT or SIGTERM.
+ * --admission turns on flash-sale admission control; bookings that find
+ * no token free are answered "ERR queued, retry shortly" instead of waiting.
+ * --record writes every call to a trace file for TraceReplay.
+ * --spans writes the tracing spans as Chrome trace JSON on shutdown
+ * (only populated in builds configured with ENABLE_TRACING).
+ * --replication-log writes every change to a mutation log for replicas;
+ * with --replica-of, the log is started once the replica is promoted.
+ * --replica-of follows a primary's mutation log as a read-only hot standby.
+ */
+
+#include <iostream>
+#include <thread>
+#include <csignal>
+#include <pthread.h>
+#include "TicketServer.h"
+#include "Tracing.h"
+
+int main(int argc, char* argv[]) {
+    string socketPath = "/tmp/railway-ticket.sock";
+    string tracePath;
+    string spansPath;
+    string replicationLogPath;
+    string primaryLogPath;
+    bool admission = false;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--admission") {
+            admission = true;
+        } else if (arg == "--record" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (arg == "--spans" && i + 1 < argc) {
+            spansPath = argv[++i];
+        } else if (arg == "--replication-log" && i + 1 < argc) {
+            replicationLogPath = argv[++i];
+        } else if (arg == "--replica-of" && i + 1 < argc) {
+            primaryLogPath = argv[++i];
+        } else {
+            socketPath = arg;
+        }
+    }
+
+    // Block termination signals in every thread; a dedicated thread waits for them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    SystemManager system;
+    if (admission) {
+        // The event loop must not wait for tokens: bookings without one get RETRY_LATER
+        AdmissionConfig config;
+        config.waitForToken = false;
+        system.enableAdmissionControl(config);
+    }
+    TraceRecorder recorder;
+    if (!tracePath.empty()) {
+        if (!recorder.open(tracePath)) {
+            cerr << "Cannot write trace " << tracePath << endl;
+            return 1;
+        }
+        system.setTraceRecorder(&recorder);
+    }
+    ReplicationLog replicationLog;
+    unique_ptr<Replica> replica;
+    if (!primaryLogPath.empty()) {
+        replica = make_unique<Replica>(system, primaryLogPath);
+        replica->setPromotionLog(replicationLogPath);
+        replica->start();
+    } else if (!replicationLogPath.empty()) {
+        if (!replicationLog.open(replicationLogPath)) {
+            cerr << "Cannot write replication log " << replicationLogPath << endl;
+            return 1;
+        }
+        system.setReplicationLog(&replicationLog);
+    }
+    TicketServer server(system, socketPath);
+    server.setReplica(replica.get());
+    if (!server.start()) {
+        cerr << "Failed to start server on " << socketPath << ": " << server.getLastError() << endl;
+        return 1;
+    }
+
+    thread signalWaiter([&]() {
+        int sig = 0;
+        sigwait(&signals, &sig);
+        server.stop();
+    });
+
+    cout << "Listening on " << socketPath << (replica ? " as a replica of " + primaryLogPath : "") << endl;
+    server.run();
+    cout << "Shutting down." << endl;
+    if (replica) replica->stop();
+    system.setReplicationLog(nullptr);
+    replicationLog.close();
+    if (recorder.isOpen()) {
+        recorder.close();
+        cout << "Recorded " << recorder.getRecordCount() << " calls to " << tracePath << endl;
+    }
+    if (!spansPath.empty()) {
+        if (SpanTracer::instance().writeChromeJson(spansPath)) {
+            cout << "Wrote " << SpanTracer::instance().getSpanCount() << " spans to " << spansPath << endl;
+        } else {
+            cerr << "Cannot write " << spansPath << endl;
+        }
+    }
+
+    // Unblock the waiter if the loop ended for another reason
+    pthread_kill(signalWaiter.native_handle(), SIGTERM);
+    signalWaiter.join();
+    return 0;
+}
@@ -0,0 +1,274 @@
+/**
+ * @file stress_main.cpp
+ * @brief Multi-threaded booking/refund stress test with inventory invariant checks.
+ *
+ * Usage: StressTest [--threads N] [--seconds S] [--trains N] [--stations N]
+ *                   [--stops N] [--days N] [--seats N] [--shards N] [--check-ms N] [--seed N]
+ *
+ * Worker threads book random segments over a synthetic network and refund
+ * random orders of their own. Every --check-ms the workers are paused
+ * between calls and the inventory is checked against the orders:
+ * - every segment has 0 <= free seats <= totalSeats;
+ * - the seats sold on every segment equal the ticket counts of the PAID
+ *   orders covering it.
+ * The network is small and seats are few by default, so trains sell out
+ * and threads contend on the same inventory. Prints throughput and exits
+ * with status 1 if any invariant was violated. Intended to be run under
+ * ThreadSanitizer as well (configure with -DENABLE_TSAN=ON).
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include "NetworkGenerator.h"
+#include "SystemManager.h"
+
+namespace {
+
+using StressClock = chrono::steady_clock;
+
+/// Violations printed in full; the rest are only counted
+const size_t MAX_REPORTED_VIOLATIONS = 20;
+
+struct StressConfig {
+    NetworkConfig network;
+    int threads = 8;
+    double seconds = 5.0;
+    size_t shards = 0;
+    int checkMillis = 200;
+};
+
+struct WorkerStats {
+    uint64_t booked = 0;
+    uint64_t rejected = 0;   ///< Sold out
+    uint64_t refunded = 0;
+    uint64_t searches = 0;
+    uint64_t failures = 0;   ///< Calls that should have succeeded but did not
+};
+
+/**
+ * @brief Lets the checker stop all workers between two calls.
+ */
+class PauseGate {
+public:
+    explicit PauseGate(int workerCount) : workers(workerCount) {}
+
+    /// Called by workers between calls
+    void checkpoint() {
+        if (!pauseRequested.load(memory_order_acquire)) return;
+        unique_lock<mutex> lock(mtx);
+        ++parked;
+        cv.notify_all();
+        cv.wait(lock, [this] { return !pauseRequested.load(memory_order_relaxed); });
+        --parked;
+    }
+
+    /// Called by a worker that exits, so pauses do not wait for it
+    void retire() {
+        lock_guard<mutex> lock(mtx);
+        --workers;
+        cv.notify_all();
+    }
+
+    void pause() {
+        unique_lock<mutex> lock(mtx);
+        pauseRequested.store(true, memory_order_release);
+        cv.wait(lock, [this] { return parked == workers; });
+    }
+
+    void resume() {
+        lock_guard<mutex> lock(mtx);
+        pauseRequested.store(false, memory_order_release);
+        cv.notify_all();
+    }
+
+private:
+    mutex mtx;
+    condition_variable cv;
+    atomic<bool> pauseRequested{false};
+    int parked = 0;
+    int workers;
+};
+
+/**
+ * @brief Checks both invariants while every worker is paused.
+ * @return Number of violations found.
+ */
+size_t checkInvariants(SystemManager& sys, const NetworkGenerator& network, const vector<string>& sessions, size_t& reported) {
+    map<string, Train> trains = sys.getAllTrains();
+
+    // Seats sold per train, date and segment according to the PAID orders
+    map<pair<string, string>, vector<int>> sold;
+    size_t violations = 0;
+    auto report = [&](const string& what) {
+        ++violations;
+        if (reported++ < MAX_REPORTED_VIOLATIONS) cerr << "VIOLATION: " << what << endl;
+    };
+
+    for (const string& session : sessions) {
+        for (const Order& order : sys.getOrders(session)) {
+            if (order.getStatus() != PAID) continue;
+            auto it = trains.find(order.getTrainId());
+            int startIndex, endIndex;
+            if (it == trains.end() || !it->second.findSegment(order.getStartStation(), order.getEndStation(), startIndex, endIndex)) {
+                report("order " + order.getOrderId() + " refers to an unknown train or segment");
+                continue;
+            }
+            // Orders carry the travel date at boarding; inventory is kept per service date
+            vector<int>& segments = sold[{order.getTrainId(), it->second.getServiceDate(order.getDate(), startIndex)}];
+            segments.resize(it->second.getRoute().size() - 1, 0);
+            for (int i = startIndex; i < endIndex; ++i) segments[i] += order.getTicketCount();
+        }
+    }
+
+    for (const auto& pair : trains) {
+        const Train& t = pair.second;
+        for (const string& date : network.getDates()) {
+            vector<int> free = t.getAvailableSeats(date);
+            auto soldIt = sold.find({pair.first, date});
+            for (size_t i = 0; i < free.size(); ++i) {
+                int expectedSold = soldIt == sold.end() ? 0 : soldIt->second[i];
+                string where = pair.first + " " + date + " segment " + to_string(i);
+                if (free[i] < 0 || free[i] > t.getTotalSeats()) {
+                    report(where + ": free seats " + to_string(free[i]) + " outside [0, " + to_string(t.getTotalSeats()) + "]");
+                }
+                if (t.getTotalSeats() - free[i] != expectedSold) {
+                    report(where + ": " + to_string(t.getTotalSeats() - free[i]) + " seats sold but PAID orders hold " + to_string(expectedSold));
+                }
+            }
+        }
+    }
+    return violations;
+}
+
+StressConfig parseArgs(int argc, char* argv[]) {
+    StressConfig cfg;
+    cfg.network.stations = 40;
+    cfg.network.trains = 40;
+    cfg.network.stopsPerTrain = 8;
+    cfg.network.daysOnSale = 3;
+    cfg.network.seatsPerTrain = 40;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string flag = argv[i];
+        const char* value = argv[i + 1];
+        if (flag == "--threads") cfg.threads = max(1, atoi(value));
+        else if (flag == "--seconds") cfg.seconds = atof(value);
+        else if (flag == "--trains") cfg.network.trains = atoi(value);
+        else if (flag == "--stations") cfg.network.stations = atoi(value);
+        else if (flag == "--stops") cfg.network.stopsPerTrain = atoi(value);
+        else if (flag == "--days") cfg.network.daysOnSale = atoi(value);
+        else if (flag == "--seats") cfg.network.seatsPerTrain = atoi(value);
+        else if (flag == "--shards") cfg.shards = strtoul(value, nullptr, 10);
+        else if (flag == "--check-ms") cfg.checkMillis = max(1, atoi(value));
+        else if (flag == "--seed") cfg.network.seed = strtoul(value, nullptr, 10);
+        else cerr << "Ignoring unknown option " << flag << endl;
+    }
+    return cfg;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    StressConfig cfg = parseArgs(argc, argv);
+
+    NetworkGenerator network(cfg.network);
+    SystemManager sys;
+    network.populate(sys);
+    if (cfg.shards > 0) sys.setShardCount(cfg.shards);
+
+    vector<string> sessions;
+    for (int i = 0; i < cfg.threads; ++i) {
+        string name = "stress" + to_string(i);
+        sys.registerUser(name, "pw", name, to_string(i));
+        sessions.push_back(sys.login(name, "pw"));
+    }
+
+    PauseGate gate(cfg.threads);
+    atomic<bool> stop{false};
+    vector<WorkerStats> stats(cfg.threads);
+
+    auto worker = [&](int id) {
+        mt19937 rng(cfg.network.seed * 1000 + id);
+        WorkerStats& s = stats[id];
+        vector<string> paidOrders;
+        while (!stop.load(memory_order_relaxed)) {
+            gate.checkpoint();
+            unsigned dice = rng() % 100;
+            if (dice < 10) {
+                NetworkGenerator::Trip trip = network.randomTrip(rng);
+                sys.searchTrains(trip.from, trip.to, trip.date);
+                ++s.searches;
+            } else if (dice < 65 || paidOrders.empty()) {
+                NetworkGenerator::Trip trip = network.randomTrip(rng);
+                int count = 1 + rng() % 3;
+                BookingResult r = sys.placeBooking(sessions[id], trip.trainId, trip.from, trip.to, trip.date, count);
+                if (r.status == BOOKED) {
+                    paidOrders.push_back(r.orderId);
+                    ++s.booked;
+                } else if (r.status == SOLD_OUT) {
+                    ++s.rejected;
+                } else {
+                    ++s.failures;
+                }
+            } else {
+                size_t pick = rng() % paidOrders.size();
+                if (sys.refundTicket(sessions[id], paidOrders[pick])) {
+                    ++s.refunded;
+                } else {
+                    ++s.failures;
+                }
+                paidOrders[pick] = paidOrders.back();
+                paidOrders.pop_back();
+            }
+        }
+        gate.retire();
+    };
+
+    cout << "Stress: " << cfg.threads << " threads, " << cfg.seconds << " s, " << cfg.network.trains << " trains x "
+         << cfg.network.seatsPerTrain << " seats, " << (cfg.shards ? to_string(cfg.shards) + " shards" : string("direct mode")) << endl;
+
+    StressClock::time_point begin = StressClock::now();
+    StressClock::time_point deadline = begin + chrono::duration_cast<StressClock::duration>(chrono::duration<double>(cfg.seconds));
+    vector<thread> threads;
+    for (int i = 0; i < cfg.threads; ++i) threads.emplace_back(worker, i);
+
+    size_t checks = 0, violations = 0, reported = 0;
+    while (StressClock::now() < deadline) {
+        this_thread::sleep_for(chrono::milliseconds(cfg.checkMillis));
+        gate.pause();
+        violations += checkInvariants(sys, network, sessions, reported);
+        ++checks;
+        gate.resume();
+    }
+    stop = true;
+    for (auto& t : threads) t.join();
+    double elapsed = chrono::duration<double>(StressClock::now() - begin).count();
+
+    // Final check once everything has quiesced
+    violations += checkInvariants(sys, network, sessions, reported);
+    ++checks;
+
+    WorkerStats total;
+    for (const WorkerStats& s : stats) {
+        total.booked += s.booked;
+        total.rejected += s.rejected;
+        total.refunded += s.refunded;
+        total.searches += s.searches;
+        total.failures += s.failures;
+    }
+    uint64_t calls = total.booked + total.rejected + total.refunded + total.searches + total.failures;
+    cout << fixed << setprecision(0)
+         << "bookings: " << total.booked << " (" << total.booked / elapsed << "/s), sold out: " << total.rejected
+         << ", refunds: " << total.refunded << " (" << total.refunded / elapsed << "/s), searches: " << total.searches << endl
+         << "calls: " << calls << " (" << calls / elapsed << "/s), unexpected failures: " << total.failures << endl
+         << "invariant checks: " << checks << ", violations: " << violations << endl;
+
+    bool ok = violations == 0 && total.failures == 0;
+    cout << (ok ? "PASS" : "FAIL") << endl;
+    return ok ? 0 : 1;
+}
@@ -1,6 +1,38 @@
 #include <iostream>
 #include <cassert>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
 #include "SystemManager.h"
+#include "BookingPipeline.h"
+#include "TraceReplay.h"
+#include "Tracing.h"
+#include <new>
+#include <cstdlib>
+#include <cstdio>
+#include <climits>
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+namespace {
+
+// Heap allocations made by the current thread while counting is on
+thread_local bool countAllocations = false;
+thread_local size_t allocationCount = 0;
+
+} // namespace
+
+void* operator new(size_t size) {
+    if (countAllocations) ++allocationCount;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
 
 void testLogic() {
     SystemManager sys;
@@ -8,17 +40,24 @@ void testLogic() {
 
     // Test Login
     cout << "Testing Login..." << endl;
-    auto user = sys.login("admin", "admin123");
+    string adminSession = sys.login("admin", "admin123");
+    assert(!adminSession.empty());
+    auto user = sys.getSessionUser(adminSession);
     assert(user != nullptr);
     assert(user->getRole() == "Admin");
     cout << "Admin login successful." << endl;
-    sys.logout();
+    sys.logout(adminSession);
+    assert(sys.getSessionUser(adminSession) == nullptr);
 
     // Test Register
     cout << "Testing Register..." << endl;
     bool reg = sys.registerUser("testuser", "pass", "Test User", "111");
     assert(reg == true);
-    user = sys.login("testuser", "pass");
+    string session = sys.login("testuser", "pass");
+    assert(!session.empty());
+    string rejected = sys.login("testuser", "wrong");
+    assert(rejected.empty());
+    user = sys.getSessionUser(session);
     assert(user != nullptr);
     assert(user->getRole() == "Passenger");
     cout << "User registration and login successful." << endl;
@@ -33,7 +72,7 @@ void testLogic() {
 
     // Test Booking
     cout << "Testing Booking..." << endl;
-    bool booked = sys.bookTicket(trains[0].getId(), "Beijing", "Shanghai", "2023-10-01");
+    bool booked = sys.bookTicket(session, trains[0].getId(), "Beijing", "Shanghai", "2023-10-01");
     assert(booked == true);
     cout << "Booking successful." << endl;
 
@@ -52,15 +91,1431 @@ void testLogic() {
     // Test Refund
     cout << "Testing Refund..." << endl;
     string orderId = p->getOrders()[0].getOrderId();
-    bool refunded = sys.refundTicket(orderId);
+    bool refunded = sys.refundTicket(session, orderId);
     assert(refunded == true);
     assert(p->getOrders()[0].getStatus() == CANCELLED);
+    bool refundedTwice = sys.refundTicket(session, orderId);
+    assert(refundedTwice == false);
     cout << "Refund successful." << endl;
 
+    // Test Sessions
+    cout << "Testing Sessions..." << endl;
+    string second = sys.login("testuser", "pass");
+    assert(second != session);
+    bool bookedInSecond = sys.bookTicket(second, "K505", "Beijing", "Xi'an", "2023-10-01");
+    assert(bookedInSecond);
+    assert(sys.getOrders(session).size() == 2); // both sessions share one history
+    bool bookedWithoutSession = sys.bookTicket("no-such-session", "K505", "Beijing", "Xi'an", "2023-10-01");
+    assert(bookedWithoutSession == false);
+    sys.getSessions().setIdleTimeout(chrono::seconds(0));
+    this_thread::sleep_for(chrono::milliseconds(5));
+    assert(sys.getSessionUser(second) == nullptr);
+    size_t purged = sys.getSessions().purgeExpired();
+    assert(purged == 1);
+    cout << "Session handling verified." << endl;
+
     cout << "ALL TESTS PASSED!" << endl;
 }
 
+void testShardedMode() {
+    SystemManager sys;
+    sys.setShardCount(4);
+    assert(sys.getShardCount() == 4);
+    assert(sys.getAllTrains().size() == 2);
+
+    cout << "Testing Sharded Booking..." << endl;
+    string session = sys.login("user1", "123456");
+    BookingResult booked = sys.placeBooking(session, "G101", "Beijing", "Nanjing", "2023-10-01", 2);
+    assert(booked.status == BOOKED && !booked.orderId.empty());
+    BookingResult unknown = sys.placeBooking(session, "G999", "Beijing", "Nanjing", "2023-10-01");
+    BookingResult reversed = sys.placeBooking(session, "G101", "Shanghai", "Beijing", "2023-10-01");
+    BookingResult tooMany = sys.placeBooking(session, "G101", "Beijing", "Jinan", "2023-10-01", 99);
+    BookingResult anonymous = sys.placeBooking("", "G101", "Beijing", "Jinan", "2023-10-01");
+    assert(unknown.status == UNKNOWN_TRAIN && reversed.status == INVALID_STATIONS);
+    assert(tooMany.status == SOLD_OUT && anonymous.status == NOT_LOGGED_IN);
+    vector<Train> found = sys.searchTrains("Beijing", "Shanghai", "2023-10-01");
+    assert(found.size() == 1);
+
+    cout << "Testing Transfer Booking..." << endl;
+    vector<string> orderIds;
+    // Second leg is sold out: the first leg must be rolled back
+    BookingStatus status = sys.bookTransfer(session, {"K505", "Beijing", "Zhengzhou", "2023-10-01"},
+                                            {"G101", "Jinan", "Shanghai", "2023-10-01"}, 99, orderIds);
+    assert(status == SOLD_OUT && orderIds.empty());
+    BookingResult fullTrain = sys.placeBooking(session, "K505", "Beijing", "Xi'an", "2023-10-01", 200);
+    assert(fullTrain.status == BOOKED);
+    status = sys.bookTransfer(session, {"G101", "Beijing", "Jinan", "2023-10-01"},
+                              {"K505", "Beijing", "Xi'an", "2023-10-02"}, 1, orderIds);
+    assert(status == BOOKED && orderIds.size() == 2);
+    assert(sys.getOrders(session)[2].getTrainId() == "G101");
+
+    // Switching back keeps the inventory
+    sys.setShardCount(0);
+    BookingResult afterSwitch = sys.placeBooking(session, "K505", "Beijing", "Xi'an", "2023-10-01");
+    assert(afterSwitch.status == SOLD_OUT);
+    bool refunded = sys.refundTicket(session, booked.orderId);
+    assert(refunded);
+    cout << "Sharded mode verified." << endl;
+}
+
+void testBookingPipeline() {
+    cout << "Testing Booking Pipeline..." << endl;
+    SystemManager sys;
+    string session = sys.login("user1", "123456");
+    {
+        BookingPipeline pipeline(sys, 8);
+        vector<future<BookingResult>> results;
+        // G101 has 100 seats: exactly 50 pairs fit on Beijing -> Jinan
+        for (int i = 0; i < 60; ++i) {
+            results.push_back(pipeline.submit(session, "G101", "Beijing", "Jinan", "2023-10-01", 2));
+        }
+        int booked = 0, soldOut = 0;
+        for (auto& r : results) {
+            BookingResult result = r.get();
+            if (result.status == BOOKED) {
+                assert(!result.orderId.empty());
+                ++booked;
+            } else {
+                assert(result.status == SOLD_OUT);
+                ++soldOut;
+            }
+        }
+        assert(booked == 50 && soldOut == 10);
+        BookingResult anonymous = pipeline.submit("bad", "G101", "Beijing", "Jinan", "2023-10-01").get();
+        BookingResult unknown = pipeline.submit(session, "X1", "Beijing", "Jinan", "2023-10-01").get();
+        assert(anonymous.status == NOT_LOGGED_IN && unknown.status == UNKNOWN_TRAIN);
+        // The seat class goes through to inventory and the order
+        Train d9("D9", "EMU", array<int, SEAT_CLASS_COUNT>{{0, 0, 2}});
+        d9.addStop({"Beijing", 6 * 60, 6 * 60, 0.0, 0, 0.0, 0.0});
+        d9.addStop({"Tianjin", 6 * 60 + 40, 6 * 60 + 40, 50.0, 120, 80.0, 150.0});
+        sys.addTrain(d9);
+        BookingResult business = pipeline.submit(session, "D9", "Beijing", "Tianjin", "2023-10-01", 1, BUSINESS_CLASS).get();
+        assert(business.status == BOOKED && sys.getOrders(session).back().getSeatClass() == BUSINESS_CLASS);
+    }
+    assert(sys.getOrders(session).size() == 51);
+    bool refunded = sys.refundTicket(session, sys.getOrders(session)[0].getOrderId());
+    assert(refunded);
+
+    // Reported like placeBooking, and admitted the same way
+    MetricsSnapshot snapshot = sys.getMetricsSnapshot();
+    assert(snapshot.latency[METRIC_BOOK].getCount() == 63 && snapshot.failures[METRIC_BOOK] == 12);
+    assert(snapshot.bookingOutcomes[BOOKED] == 51 && snapshot.bookingOutcomes[NOT_LOGGED_IN] == 1);
+    AdmissionConfig config;
+    config.burst = 2;
+    config.tokensPerSecond = 0;
+    config.waitForToken = false;
+    sys.enableAdmissionControl(config);
+    const string tracePath = "pipeline_trace_test.bin";
+    TraceRecorder recorder;
+    bool opened = recorder.open(tracePath);
+    assert(opened);
+    sys.setTraceRecorder(&recorder);
+    {
+        BookingPipeline pipeline(sys, 8);
+        vector<BookingStatus> statuses;
+        for (int i = 0; i < 3; ++i) statuses.push_back(pipeline.submit(session, "K505", "Beijing", "Xi'an", "2023-10-01").get().status);
+        assert(statuses == vector<BookingStatus>({BOOKED, BOOKED, RETRY_LATER}));
+    }
+    sys.setTraceRecorder(nullptr);
+    recorder.close();
+    assert(recorder.getRecordCount() == 3 && sys.getAdmissionController()->getCounters().deferred == 1);
+    remove(tracePath.c_str());
+    cout << "Booking pipeline verified." << endl;
+}
+
+void testAdmissionControl() {
+    cout << "Testing Admission Control..." << endl;
+    SystemManager sys;
+    AdmissionConfig config;
+    config.burst = 3;
+    config.tokensPerSecond = 1000;
+    config.maxQueuedPerUser = 1;
+    sys.enableAdmissionControl(config);
+    string session = sys.login("user1", "123456");
+
+    // Drain G101's 100 seats on every segment
+    for (int i = 0; i < 10; ++i) {
+        BookingResult r = sys.placeBooking(session, "G101", "Beijing", "Shanghai", "2023-10-01", 10);
+        assert(r.status == BOOKED);
+    }
+    const AdmissionController* ac = sys.getAdmissionController();
+    assert(ac->isSoldOut("G101", "2023-10-01"));
+    assert(ac->getCounters().queued > 0); // the burst of 3 was exceeded
+    vector<Train> found = sys.searchTrains("Beijing", "Shanghai", "2023-10-01");
+    assert(found.empty());
+
+    // Unknown trains and impossible dates are refused before they get an entry
+    size_t entries = ac->getEntryCount();
+    BookingResult unknown = sys.placeBooking(session, "X999", "Beijing", "Shanghai", "2023-10-01");
+    BookingResult badDate = sys.placeBooking(session, "G101", "Beijing", "Shanghai", "2023-10-32");
+    assert(unknown.status == UNKNOWN_TRAIN && badDate.status == INVALID_DATE);
+    assert(ac->getEntryCount() == entries);
+
+    uint64_t rejectedBefore = ac->getCounters().rejectedSoldOut;
+    BookingResult soldOut = sys.placeBooking(session, "G101", "Jinan", "Nanjing", "2023-10-01");
+    assert(soldOut.status == SOLD_OUT);
+    assert(ac->getCounters().rejectedSoldOut == rejectedBefore + 1);
+
+    // A refund reopens the train-date
+    bool refunded = sys.refundTicket(session, sys.getOrders(session)[0].getOrderId());
+    assert(refunded);
+    assert(!ac->isSoldOut("G101", "2023-10-01"));
+    BookingResult reopened = sys.placeBooking(session, "G101", "Jinan", "Nanjing", "2023-10-01");
+    assert(reopened.status == BOOKED);
+
+    // Without waiting: the burst goes through, then callers are told to retry
+    SystemManager eventLoop;
+    config.tokensPerSecond = 0;
+    config.waitForToken = false;
+    eventLoop.enableAdmissionControl(config);
+    session = eventLoop.login("user1", "123456");
+    for (int i = 0; i < 3; ++i) {
+        BookingResult r = eventLoop.placeBooking(session, "K505", "Beijing", "Xi'an", "2023-10-01");
+        assert(r.status == BOOKED);
+    }
+    auto started = chrono::steady_clock::now();
+    BookingResult deferred = eventLoop.placeBooking(session, "K505", "Beijing", "Xi'an", "2023-10-01");
+    assert(deferred.status == RETRY_LATER);
+    assert(chrono::steady_clock::now() - started < config.maxWait);
+    AdmissionCounters counters = eventLoop.getAdmissionController()->getCounters();
+    assert(counters.admitted == 3 && counters.deferred == 1 && counters.queued == 0 && counters.rejectedTimeout == 0);
+    assert(eventLoop.getMetricsSnapshot().bookingOutcomes[RETRY_LATER] == 1);
+
+    // Transfers pass admission on both legs; a refused leg gives the other's token back
+    vector<string> orderIds;
+    BookingStatus transfer = eventLoop.bookTransfer(session, {"G101", "Beijing", "Jinan", "2023-10-01"},
+                                                    {"K505", "Zhengzhou", "Xi'an", "2023-10-01"}, 1, orderIds);
+    counters = eventLoop.getAdmissionController()->getCounters();
+    assert(transfer == RETRY_LATER && orderIds.empty() && counters.admitted == 3 && counters.deferred == 2);
+    BookingResult g101 = eventLoop.placeBooking(session, "G101", "Beijing", "Jinan", "2023-10-01");
+    assert(g101.status == BOOKED);
+
+    // Journeys too: every admitted leg is handed back when a later one is refused
+    BookingStatus journey = eventLoop.bookJourney(session, {{"G101", "Beijing", "Jinan", "2023-10-01"},
+                                                            {"G101", "Jinan", "Shanghai", "2023-10-01"},
+                                                            {"K505", "Zhengzhou", "Xi'an", "2023-10-01"}}, 1, orderIds);
+    counters = eventLoop.getAdmissionController()->getCounters();
+    assert(journey == RETRY_LATER && orderIds.empty() && counters.admitted == 4 && counters.deferred == 3);
+    journey = eventLoop.bookJourney(session, {{"G101", "Beijing", "Jinan", "2023-10-01"}, {"G101", "Jinan", "Shanghai", "2023-10-01"}}, 1,
+                                    orderIds);
+    assert(journey == BOOKED && orderIds.size() == 2);
+    cout << "Admission control verified." << endl;
+}
+
+void testTraceReplay() {
+    cout << "Testing Trace Record/Replay..." << endl;
+    const string path = "trace_test.bin";
+    {
+        SystemManager sys;
+        TraceRecorder recorder;
+        bool opened = recorder.open(path);
+        assert(opened);
+        sys.setTraceRecorder(&recorder);
+        bool registered = sys.registerUser("tracer", "pw", "Trace User", "222");
+        assert(registered);
+        string session = sys.login("tracer", "pw");
+        vector<Train> found = sys.searchTrains("Beijing", "Shanghai", "2023-10-01");
+        assert(found.size() == 1);
+        string orderId = sys.placeBooking(session, "G101", "Beijing", "Shanghai", "2023-10-01", 2).orderId;
+        sys.placeBooking(session, "G101", "Jinan", "Nanjing", "2023-10-01", 500);  // sold out
+        sys.placeBooking(session, "X999", "Beijing", "Shanghai", "2023-10-01");    // unknown train
+        bool refundedOnce = sys.refundTicket(session, orderId);
+        bool refundedTwice = sys.refundTicket(session, orderId);
+        assert(refundedOnce && !refundedTwice);
+        sys.placeBooking(session, "K505", "Beijing", "Xi'an", "2023-10-02", 3);
+        vector<string> transferIds, journeyIds;
+        BookingStatus transfer = sys.bookTransfer(session, {"G101", "Beijing", "Jinan", "2023-10-03"},
+                                                  {"K505", "Zhengzhou", "Xi'an", "2023-10-03"}, 1, transferIds);
+        BookingStatus journey = sys.bookJourney(session, {{"G101", "Beijing", "Jinan", "2023-10-04"}, {"G101", "Jinan", "Nanjing", "2023-10-04"},
+                                                          {"K505", "Zhengzhou", "Xi'an", "2023-10-04"}}, 2, journeyIds);
+        assert(transfer == BOOKED && journey == BOOKED);
+        bool refunded = sys.refundTicket(session, transferIds[1]);
+        assert(refunded);
+        sys.logout(session);
+        recorder.close();
+        assert(recorder.getRecordCount() == 13);
+    }
+
+    TraceReader reader;
+    bool opened = reader.open(path);
+    assert(opened);
+    vector<TraceRecord> records;
+    TraceRecord record;
+    while (reader.next(record)) records.push_back(record);
+    assert(reader.getLastError().empty());
+    assert(records.size() == 13);
+    assert(records[0].op == TRACE_REGISTER && records[0].args[0] == "tracer");
+    assert(records[4].op == TRACE_BOOK && records[4].result == SOLD_OUT);
+    assert(records[9].op == TRACE_TRANSFER && records[9].args.size() == 2 + 2 * TRACE_LEG_ARGS && records[9].args[11] == "second");
+    assert(records[10].op == TRACE_JOURNEY && records[10].args[1] == "2" && records[10].result == BOOKED);
+
+    // Two replays: outcomes match the recording, and order stamps match each other
+    ReplayConfig config;
+    config.speed = 0;
+    config.threads = 1;
+    SystemManager first, second;
+    ReplayReport report = TraceReplayer(first, config).run(records, reader.getStartTime());
+    assert(report.replayed == 13);
+    assert(report.divergences == 0);
+    config.threads = 3;
+    ReplayReport threaded = TraceReplayer(second, config).run(records, reader.getStartTime());
+    assert(threaded.divergences == 0);
+
+    string s1 = first.login("tracer", "pw"), s2 = second.login("tracer", "pw");
+    vector<Order> a = first.getOrders(s1), b = second.getOrders(s2);
+    assert(a.size() == 7 && b.size() == 7);
+    for (size_t i = 0; i < a.size(); ++i) {
+        assert(a[i].getOrderId() == b[i].getOrderId());
+        assert(a[i].getCreateTime() == b[i].getCreateTime());
+        assert(a[i].getCreateTime() >= reader.getStartTime());
+    }
+    remove(path.c_str());
+    cout << "Trace replay verified." << endl;
+}
+
+void testMetrics() {
+    cout << "Testing Metrics..." << endl;
+    SystemManager sys;
+    string session = sys.login("user1", "123456");
+    sys.searchTrains("Beijing", "Shanghai", "2023-10-01");
+    BookingResult booked = sys.placeBooking(session, "G101", "Beijing", "Shanghai", "2023-10-01");
+    BookingResult unknown = sys.placeBooking(session, "X999", "Beijing", "Shanghai", "2023-10-01");
+    BookingResult reversed = sys.placeBooking(session, "G101", "Shanghai", "Beijing", "2023-10-01");
+    BookingResult tooMany = sys.placeBooking(session, "G101", "Beijing", "Jinan", "2023-10-01", 500);
+    BookingResult anonymous = sys.placeBooking("bogus", "G101", "Beijing", "Jinan", "2023-10-01");
+    assert(booked.status == BOOKED && unknown.status == UNKNOWN_TRAIN && reversed.status == INVALID_STATIONS);
+    assert(tooMany.status == SOLD_OUT && anonymous.status == NOT_LOGGED_IN);
+    bool refunded = sys.refundTicket(session, "nope");
+    assert(!refunded);
+
+    // Other threads record into their own slots
+    thread worker([&]() {
+        for (int i = 0; i < 100; ++i) sys.searchTrains("Beijing", "Xi'an", "2023-10-01");
+    });
+    worker.join();
+
+    MetricsSnapshot snap = sys.getMetricsSnapshot();
+    assert(snap.latency[METRIC_SEARCH].getCount() == 101);
+    assert(snap.latency[METRIC_BOOK].getCount() == 5);
+    assert(snap.failures[METRIC_BOOK] == 4);
+    assert(snap.latency[METRIC_LOGIN].getCount() == 1);
+    assert(snap.failures[METRIC_REFUND] == 1);
+    assert(snap.bookingOutcomes[BOOKED] == 1);
+    assert(snap.bookingOutcomes[UNKNOWN_TRAIN] == 1);
+    assert(snap.bookingOutcomes[INVALID_STATIONS] == 1);
+    assert(snap.bookingOutcomes[SOLD_OUT] == 1);
+    assert(snap.bookingOutcomes[NOT_LOGGED_IN] == 1);
+    assert(snap.toJson().find("\"sold_out\":1") != string::npos);
+
+    // Bucket bounds stay within 1/16 of the value
+    for (uint64_t v : {0ull, 15ull, 16ull, 1000ull, 123456789ull}) {
+        uint64_t low = LatencyHistogram::bucketLowerBound(LatencyHistogram::bucketIndex(v));
+        assert(low <= v && v - low <= v / 16);
+    }
+    cout << snap.toText();
+    cout << "Metrics verified." << endl;
+}
+
+void testTracingSpans() {
+    cout << "Testing Tracing Spans..." << endl;
+    SpanTracer& tracer = SpanTracer::instance();
+    tracer.clear();
+    {
+        SystemManager sys;
+        string session = sys.login("user1", "123456");
+        BookingResult booked = sys.placeBooking(session, "G101", "Beijing", "Shanghai", "2023-10-01");
+        assert(booked.status == BOOKED);
+    }
+    string json = tracer.exportChromeJson();
+    assert(json.find("\"traceEvents\"") != string::npos);
+#ifdef RAILWAY_TRACING
+    assert(tracer.getSpanCount() > 0);
+    assert(json.find("\"SystemManager::placeBooking\"") != string::npos);
+    assert(json.find("\"Train::bookTickets\"") != string::npos);
+    assert(json.find("\"Order::generateOrderId\"") != string::npos);
+    assert(json.find("\"Passenger::emplaceOrder\"") != string::npos);
+
+    // A full ring keeps only its newest spans
+    for (size_t i = 0; i < SPAN_RING_CAPACITY + 10; ++i) {
+        TRACE_SPAN("filler");
+    }
+    assert(tracer.getSpanCount() >= SPAN_RING_CAPACITY);
+
+    // Threads started one after another share a recycled ring
+    size_t ringsBefore = tracer.getRingCount();
+    for (int i = 0; i < 8; ++i) {
+        thread([] { TRACE_SPAN("short-lived"); }).join();
+    }
+    assert(tracer.getRingCount() <= ringsBefore + 1);
+    cout << "Tracing spans verified." << endl;
+#else
+    assert(tracer.getSpanCount() == 0);
+    cout << "Tracing spans compiled out (configure with -DENABLE_TRACING=ON)." << endl;
+#endif
+}
+
+void testMemoryReport() {
+    cout << "Testing Memory Report..." << endl;
+    SystemManager sys;
+    MemoryReport before = sys.getMemoryReport();
+    assert(before.perTrain.size() == 2);
+    assert(before.routes > 0 && before.users > 0);
+    assert(before.inventory == 0); // no date booked yet
+    assert(before.orderCount == 0);
+
+    string session = sys.login("user1", "123456");
+    for (int day = 1; day <= 5; ++day) {
+        string date = "2023-10-0" + to_string(day);
+        bool booked = sys.bookTicket(session, "K505", "Beijing", "Xi'an", date);
+        assert(booked);
+    }
+    MemoryReport after = sys.getMemoryReport();
+    assert(after.orderCount == 5);
+    assert(after.orders > before.orders);
+    assert(after.orderIndex > before.orderIndex);
+    assert(after.sessions > before.sessions);
+    assert(after.perTrain[0].trainId == "K505");
+    assert(after.perTrain[0].inventoryDates == 5);
+    assert(after.inventory == after.perTrain[0].inventoryBytes);
+    assert(after.total() > before.total());
+
+    // Sharded mode reports the same inventory
+    sys.setShardCount(2);
+    assert(sys.getMemoryReport().inventory == after.inventory);
+    cout << after.toText();
+    cout << "Memory report verified." << endl;
+}
+
+void testStreamingSearch() {
+    cout << "Testing Streaming Search..." << endl;
+    SystemManager sys;
+    for (int i = 0; i < 600; ++i) {
+        Train t("S" + to_string(1000 + i), "G", 10);
+        t.addStop({"Beijing", 8 * 60, 8 * 60, 0.0, 0});
+        t.addStop({"Shanghai", 13 * 60, 13 * 60, 500.0, 1300});
+        sys.addTrain(t);
+    }
+    string session = sys.login("user1", "123456");
+    size_t expected = sys.searchTrains("Beijing", "Shanghai", "2023-10-01").size();
+    assert(expected == 601); // plus the sample G101
+
+    // Batches arrive in ID order, and the read lock is released while the
+    // sink runs: booking from inside it must not deadlock
+    for (size_t shards : {0, 3}) {
+        if (shards) sys.setShardCount(shards);
+        size_t batches = 0, found = 0;
+        string last;
+        bool completed = sys.searchTrainsStreaming("Beijing", "Shanghai", "2023-10-01", [&](vector<Train>& batch) {
+            ++batches;
+            found += batch.size();
+            if (!shards) {
+                assert(batch.front().getId() > last);
+                last = batch.back().getId();
+            }
+            bool booked = sys.bookTicket(session, batch.front().getId(), "Beijing", "Shanghai", "2023-10-02");
+            assert(booked);
+        });
+        assert(completed);
+        assert(found == expected);
+        assert(batches == (shards ? shards : 3)); // 602 trains in chunks of 256
+    }
+
+    // Cancelling from the first batch stops the scan
+    atomic<bool> cancel{false};
+    sys.setShardCount(0);
+    size_t found = 0;
+    bool completed = sys.searchTrainsStreaming("Beijing", "Shanghai", "2023-10-01", [&](vector<Train>& batch) {
+        found += batch.size();
+        cancel = true;
+    }, &cancel);
+    assert(!completed);
+    assert(found > 0 && found <= SEARCH_CHUNK_TRAINS);
+    cout << "Streaming search verified." << endl;
+}
+
+void testInventoryEvents() {
+    cout << "Testing Inventory Events..." << endl;
+    struct Recorder : InventoryListener {
+        mutex mtx;
+        vector<InventoryEvent> events;
+        void onInventoryChange(const InventoryEvent& e) override {
+            lock_guard<mutex> lock(mtx);
+            events.push_back(e);
+        }
+    } recorder;
+
+    SystemManager sys;
+    string session = sys.login("user1", "123456");
+    bool unobserved = sys.bookTicket(session, "G101", "Beijing", "Shanghai", "2023-10-01");
+    assert(unobserved);
+    sys.addInventoryListener(&recorder);
+    vector<TrainOccupancy> snapshot = sys.getOccupancy("2023-10-01");
+    assert(snapshot.size() == 2 && snapshot[0].trainId == "G101");
+    assert(snapshot[0].freeSeats == vector<int>({99, 99, 99}));
+
+    for (size_t shards : {0, 2}) {
+        sys.setShardCount(shards);
+        recorder.events.clear();
+        BookingResult r = sys.placeBooking(session, "G101", "Jinan", "Nanjing", "2023-10-01", 3);
+        assert(r.status == BOOKED);
+        bool refunded = sys.refundTicket(session, r.orderId);
+        assert(refunded);
+        assert(recorder.events.size() == 2);
+        const InventoryEvent& booked = recorder.events[0];
+        assert(booked.trainId == "G101" && booked.date == "2023-10-01");
+        assert(booked.startSegment == 1 && booked.endSegment == 2);
+        assert(booked.delta == -3 && booked.newMin == 96);
+        assert(booked.segmentCount == 3 && booked.totalSeats == 100);
+        assert(booked.version > snapshot[0].version);
+        assert(recorder.events[1].delta == 3 && recorder.events[1].newMin == 99);
+        assert(recorder.events[1].version == booked.version + 1);
+    }
+
+    bool removed = sys.removeInventoryListener(&recorder);
+    assert(removed);
+    recorder.events.clear();
+    bool booked = sys.bookTicket(session, "G101", "Beijing", "Shanghai", "2023-10-01");
+    assert(booked && recorder.events.empty());
+    cout << "Inventory events verified." << endl;
+}
+
+void testChangeFeed() {
+    cout << "Testing Change Feed..." << endl;
+    // Queue: 4 producers and 2 consumers, every value delivered once
+    {
+        MpmcQueue<int> queue(1024);
+        const int perProducer = 20000;
+        atomic<long long> sum{0};
+        atomic<int> received{0};
+        vector<thread> threads;
+        for (int p = 0; p < 4; ++p) {
+            threads.emplace_back([&queue, p] {
+                for (int i = 1; i <= perProducer; ++i) {
+                    while (!queue.tryPush(p * perProducer + i)) this_thread::yield();
+                }
+            });
+        }
+        for (int c = 0; c < 2; ++c) {
+            threads.emplace_back([&] {
+                int value;
+                while (received.load() < 4 * perProducer) {
+                    if (queue.tryPop(value)) {
+                        sum += value;
+                        ++received;
+                    } else {
+                        this_thread::yield();
+                    }
+                }
+            });
+        }
+        for (auto& t : threads) t.join();
+        long long n = 4LL * perProducer;
+        assert(sum.load() == n * (n + 1) / 2);
+    }
+
+    SystemManager sys;
+    string session = sys.login("user1", "123456");
+    auto all = sys.subscribeChanges();
+    FeedFilter k505;
+    k505.trains = {"K505"};
+    k505.dates = {"2023-10-02"};
+    auto filtered = sys.subscribeChanges(k505);
+    auto tiny = sys.subscribeChanges(FeedFilter(), 4);
+
+    BookingResult r = sys.placeBooking(session, "G101", "Beijing", "Nanjing", "2023-10-01", 2);
+    assert(r.status == BOOKED);
+    bool refunded = sys.refundTicket(session, r.orderId);
+    bool second = sys.bookTicket(session, "K505", "Beijing", "Xi'an", "2023-10-02");
+    bool third = sys.bookTicket(session, "K505", "Beijing", "Xi'an", "2023-10-03");
+    assert(refunded && second && third);
+
+    vector<InventoryEvent> batch;
+    size_t polled = all->poll(batch);
+    assert(polled == 4);
+    assert(batch[0].trainId == "G101" && batch[0].startSegment == 0 && batch[0].endSegment == 2);
+    assert(batch[0].delta == -2 && batch[0].newMin == 98);
+    assert(batch[1].delta == 2 && batch[1].newMin == 100);
+    batch.clear();
+    polled = filtered->poll(batch);
+    assert(polled == 1 && batch[0].date == "2023-10-02");
+
+    // A full queue drops events instead of blocking bookings
+    for (int i = 0; i < 10; ++i) {
+        bool booked = sys.bookTicket(session, "G101", "Beijing", "Shanghai", "2023-10-05");
+        assert(booked);
+    }
+    assert(tiny->getDropped() == 14 - tiny->getCapacity());
+    batch.clear();
+    size_t head = tiny->poll(batch, 2);
+    size_t rest = tiny->poll(batch);
+    assert(head == 2 && rest == tiny->getCapacity() - 2);
+
+    polled = all->poll(batch, 100);
+    assert(polled == 10); // all kept up
+    assert(all->getDropped() == 0);
+
+    bool unsubscribed = sys.unsubscribeChanges(tiny);
+    bool unsubscribedTwice = sys.unsubscribeChanges(tiny);
+    assert(unsubscribed && !unsubscribedTwice);
+    unsubscribed = sys.unsubscribeChanges(all) && sys.unsubscribeChanges(filtered);
+    assert(unsubscribed);
+    bool booked = sys.bookTicket(session, "G101", "Beijing", "Shanghai", "2023-10-05");
+    polled = all->poll(batch);
+    assert(booked && polled == 0);
+    cout << "Change feed verified." << endl;
+}
+
+void testDynamicPricing() {
+    cout << "Testing Dynamic Pricing..." << endl;
+    assert(Money::fromYuan(0.1) + Money::fromYuan(0.2) == Money::fromYuan(0.3));
+    assert(Money(-5).toString() == "-0.05" && Money(123456).toString() == "1234.56");
+    assert(Money(15).scaledBp(5000) == Money(8) && Money(-15).scaledBp(5000) == Money(-8));
+    Money parsed;
+    assert(Money::parse("553.00", parsed) && parsed == Money(55300));
+    assert(Money::parse("-0.05", parsed) && parsed == Money(-5));
+    assert(Money::parse("7.5", parsed) && parsed == Money(750) && Money::parse("12", parsed) && parsed == Money(1200));
+    assert(!Money::parse("", parsed) && !Money::parse("1.234", parsed) && !Money::parse("1.", parsed) && !Money::parse("x1", parsed));
+    assert(Calendar::dayNumber("1970-01-01") == 0 && Calendar::dayNumber("2000-03-01") == 11017);
+    assert(Calendar::dayNumber("2023-10-01") - Calendar::dayNumber("2023-09-01") == 30);
+    assert(Calendar::formatClock(25 * 60 + 5) == "01:05" && Calendar::formatClock(-90) == "22:30");
+    int day = 0;
+    bool dateParsed = Calendar::parseDate("2024-02-29", day);
+    assert(dateParsed && Calendar::formatDate(day) == "2024-02-29");
+    assert(Calendar::parseDate("0000-01-01", day) && Calendar::formatDate(day) == "0000-01-01");
+    assert(!Calendar::isValidDate("2023-02-29") && !Calendar::isValidDate("2023-02-31") && !Calendar::isValidDate("1900-02-29"));
+    assert(!Calendar::isValidDate("2023-04-31") && !Calendar::isValidDate("garbage") && !Calendar::isValidDate("2023-1-01"));
+
+    SystemManager sys;
+    auto clock = make_shared<ManualClock>(static_cast<time_t>(Calendar::dayNumber("2023-09-01")) * 86400);
+    sys.setClock(clock);
+    string session = sys.login("user1", "123456");
+    int today = sys.getCurrentDay();
+
+    // Static fares until a policy is set
+    vector<Train> found = sys.searchTrains("Beijing", "Shanghai", "2023-10-01");
+    assert(found[0].quote("Beijing", "Shanghai", "2023-10-01", today) == Money(55300));
+
+    sys.setPricingPolicy(make_shared<const PricingPolicy>(PricingPolicy::standard()));
+    for (size_t shards : {0, 2}) {
+        sys.setShardCount(shards);
+        auto quote = [&](const string& from, const string& to, const string& date) {
+            return sys.searchTrains(from, to, date)[0].quote(from, to, date, today);
+        };
+        // Empty train, 30 days out: 0.9x on every segment
+        assert(quote("Beijing", "Shanghai", "2023-10-01") == Money(13500 + 18000 + 18270));
+
+        // Charged the fare quoted before the seats were taken
+        BookingResult r = sys.placeBooking(session, "G101", "Beijing", "Jinan", "2023-10-01", 60);
+        assert(r.status == BOOKED && r.price == Money(13500) * 60);
+        assert(sys.getOrders(session).back().getPrice() == r.price);
+
+        // Segment 0 is 60% sold: 1.0666x; the others are unchanged
+        assert(quote("Beijing", "Jinan", "2023-10-01") == Money(15999));
+        assert(quote("Beijing", "Shanghai", "2023-10-01") == Money(15999 + 18000 + 18270));
+        assert(quote("Jinan", "Shanghai", "2023-10-01") == Money(18000 + 18270));
+        assert(quote("Beijing", "Shanghai", "2023-09-30") == Money(49770));
+
+        bool refunded = sys.refundTicket(session, r.orderId);
+        assert(refunded);
+        assert(quote("Beijing", "Shanghai", "2023-10-01") == Money(49770));
+    }
+
+    // Multi-segment bookings reprice in place; the quotes match a full rebuild
+    BookingResult first = sys.placeBooking(session, "G101", "Beijing", "Shanghai", "2023-10-02", 60);
+    BookingResult second = sys.placeBooking(session, "G101", "Beijing", "Shanghai", "2023-10-02", 20);
+    assert(first.status == BOOKED && second.status == BOOKED);
+    Train incremental = sys.searchTrains("Beijing", "Shanghai", "2023-10-02")[0];
+    Train rebuilt = incremental;
+    rebuilt.setPricingPolicy(make_shared<const PricingPolicy>(PricingPolicy::standard()));
+    for (const char* from : {"Beijing", "Jinan", "Nanjing"}) {
+        for (const char* to : {"Jinan", "Nanjing", "Shanghai"}) {
+            assert(incremental.quote(from, to, "2023-10-02", today) == rebuilt.quote(from, to, "2023-10-02", today));
+        }
+    }
+    assert(incremental.quote("Beijing", "Shanghai", "2023-10-02", today) > Money(49770));
+
+    // Two days before departure: 1.1786x surcharge on the whole journey
+    Train g101 = sys.searchTrains("Beijing", "Shanghai", "2023-09-03")[0];
+    assert(g101.quote("Beijing", "Shanghai", "2023-09-03", today) == Money(58659));
+    assert(g101.quote("Shanghai", "Beijing", "2023-09-03", today) == Money());
+
+    sys.setPricingPolicy(nullptr);
+    BookingResult flat = sys.placeBooking(session, "G101", "Beijing", "Shanghai", "2023-10-01", 1);
+    assert(flat.price == Money(55300));
+    cout << "Dynamic pricing verified." << endl;
+}
+
+void testSeatClasses() {
+    cout << "Testing Seat Classes..." << endl;
+    SeatClass parsed;
+    assert(parseSeatClass("business", parsed) && parsed == BUSINESS_CLASS && !parseSeatClass("economy", parsed));
+
+    SystemManager sys;
+    string session = sys.login("user1", "123456");
+    Train d301("D301", "High-Speed", {{50, 10, 4}});
+    d301.addStop({"Beijing", 6 * 60, 6 * 60, 0.0, 0, 0.0, 0.0});
+    d301.addStop({"Tianjin", 6 * 60 + 40, 6 * 60 + 42, 50.0, 120, 80.0, 150.0});
+    d301.addStop({"Jinan", 8 * 60, 8 * 60 + 2, 180.0, 400, 290.0, 560.0});
+    assert(d301.getTotalSeats() == 64 && d301.getClassSeats(FIRST_CLASS) == 10);
+    sys.addTrain(d301);
+
+    for (size_t shards : {0, 2}) {
+        sys.setShardCount(shards);
+        BookingResult first = sys.placeBooking(session, "D301", "Beijing", "Jinan", "2023-10-01", 10, FIRST_CLASS);
+        assert(first.status == BOOKED && first.price == Money(29000) * 10);
+        assert(sys.getOrders(session).back().getSeatClass() == FIRST_CLASS);
+        // First class is gone; second class and business are unaffected
+        BookingResult noFirst = sys.placeBooking(session, "D301", "Tianjin", "Jinan", "2023-10-01", 1, FIRST_CLASS);
+        assert(noFirst.status == SOLD_OUT);
+        vector<Train> found = sys.searchTrains("Beijing", "Jinan", "2023-10-01");
+        auto it = find_if(found.begin(), found.end(), [](const Train& t) { return t.getId() == "D301"; });
+        assert(it != found.end());
+        int startIndex, endIndex;
+        assert(it->findSegment("Beijing", "Jinan", startIndex, endIndex));
+        assert((it->getClassAvailability("2023-10-01", startIndex, endIndex) == array<int, SEAT_CLASS_COUNT>{{50, 0, 4}}));
+        assert(it->getAvailableSeats("2023-10-01") == vector<int>({54, 54}));
+
+        // A transfer leg carries its class through reservation, order and refund
+        vector<string> orderIds;
+        TripLeg business{"D301", "Beijing", "Tianjin", "2023-10-01", BUSINESS_CLASS};
+        TripLeg onward{"G101", "Jinan", "Shanghai", "2023-10-01"};
+        BookingStatus transfer = sys.bookTransfer(session, business, onward, 4, orderIds);
+        assert(transfer == BOOKED);
+        bool businessLeft = sys.bookTicket(session, "D301", "Beijing", "Tianjin", "2023-10-01", 1, BUSINESS_CLASS);
+        assert(!businessLeft);
+        bool refunded = sys.refundTicket(session, orderIds[0]);
+        refunded = sys.refundTicket(session, orderIds[1]) && refunded;
+        refunded = sys.refundTicket(session, first.orderId) && refunded;
+        assert(refunded);
+        assert(sys.getOccupancy("2023-10-01")[0].trainId == "D301");
+        assert(sys.getOccupancy("2023-10-01")[0].freeSeats == vector<int>({64, 64}));
+    }
+
+    // Single-class trains sell only second class
+    BookingResult singleClass = sys.placeBooking(session, "G101", "Beijing", "Jinan", "2023-10-01", 1, FIRST_CLASS);
+    assert(singleClass.status == SOLD_OUT);
+    cout << "Seat classes verified." << endl;
+}
+
+void testTimeModel() {
+    cout << "Testing Time Model..." << endl;
+    assert(Calendar::parseClock("25:30") == 1530 && Calendar::formatClock(1530) == "01:30");
+    assert(Calendar::parseClock("7:5") == -1 && Calendar::parseClock("12:60") == -1);
+    assert(Calendar::addDays("2023-12-31", 1) == "2024-01-01" && Calendar::addDays("2024-03-01", -1) == "2024-02-29");
+
+    SystemManager sys;
+    string session = sys.login("user1", "123456");
+    // Overnight: leaves Beijing 20:00, Zhengzhou after midnight, Guangzhou the next morning
+    Train z1("Z1", "Sleeper", 10);
+    z1.addStop({"Beijing", 20 * 60, 20 * 60, 0.0, 0});
+    z1.addStop({"Zhengzhou", 25 * 60, 25 * 60 + 10, 150.0, 700});
+    z1.addStop({"Guangzhou", 33 * 60 + 30, 33 * 60 + 30, 400.0, 2300});
+    assert(z1.hasOvernightBoarding() && z1.getDayOffset(1) == 1 && z1.getTravelMinutes(1, 2) == 500);
+    assert(z1.getServiceDate("2023-10-02", 1) == "2023-10-01" && z1.getArrivalDate("2023-10-01", 2) == "2023-10-02");
+    sys.addTrain(z1);
+    sys.enableAdmissionControl();
+
+    auto found = [&sys](const string& from, const string& to, const string& date, TimeWindow window = TimeWindow()) {
+        vector<Train> trains = sys.searchTrains(from, to, date, window);
+        vector<string> ids;
+        for (const Train& t : trains) ids.push_back(t.getId());
+        return ids;
+    };
+
+    for (size_t shards : {0, 2}) {
+        sys.setShardCount(shards);
+        string service = shards ? "2023-11-01" : "2023-10-01";
+        string nextDay = Calendar::addDays(service, 1);
+        // Selling out the service that leaves Beijing on one day fills Zhengzhou the next
+        bool booked = sys.bookTicket(session, "Z1", "Beijing", "Guangzhou", service, 10);
+        assert(booked);
+        assert(found("Zhengzhou", "Guangzhou", nextDay).empty());
+        BookingResult full = sys.placeBooking(session, "Z1", "Zhengzhou", "Guangzhou", nextDay);
+        assert(full.status == SOLD_OUT);
+        assert(sys.getOccupancy(service)[2].freeSeats == vector<int>({0, 0}));
+
+        // The next service still has seats; the admission flag was not set for the overnight train
+        assert(!sys.getAdmissionController()->isSoldOut("Z1", service));
+        assert(found("Zhengzhou", "Guangzhou", Calendar::addDays(service, 2)) == vector<string>({"Z1"}));
+        BookingResult r = sys.placeBooking(session, "Z1", "Zhengzhou", "Guangzhou", Calendar::addDays(service, 2));
+        assert(r.status == BOOKED);
+        const Order order = sys.getOrders(session).back();
+        assert(order.getDate() == Calendar::addDays(service, 2) && order.getDepartureMinutes() == 25 * 60 + 10);
+        assert(sys.getOccupancy(nextDay)[2].freeSeats == vector<int>({10, 9}));
+        bool refunded = sys.refundTicket(session, r.orderId);
+        assert(refunded);
+        assert(sys.getOccupancy(nextDay)[2].freeSeats == vector<int>({10, 10}));
+    }
+
+    // Departure window at the boarding station
+    assert(found("Beijing", "Shanghai", "2023-10-03", {7 * 60, 9 * 60}) == vector<string>({"G101"}));
+    assert(found("Beijing", "Shanghai", "2023-10-03", {9 * 60, 12 * 60}).empty());
+    assert(found("Zhengzhou", "Guangzhou", "2023-10-05", {60, 2 * 60}) == vector<string>({"Z1"}));
+    assert(found("Beijing", "Xi'an", "2023-10-03", {7 * 60, 7 * 60}) == vector<string>({"K505"}));
+    cout << "Time model verified." << endl;
+}
+
+void testServiceCalendars() {
+    cout << "Testing Service Calendars..." << endl;
+    assert(Calendar::weekday(Calendar::dayNumber("2023-10-01")) == 6 && Calendar::weekday(-1) == 2);
+
+    // Weekdays in Q4 2023, not on the Monday holiday, plus one Saturday
+    auto weekdays = make_shared<ServiceCalendar>(WEEKDAYS, "2023-10-01", "2023-12-31");
+    weekdays->addException("2023-10-02", false);
+    weekdays->addException("2023-10-07", true);
+    weekdays->addException("2023-01-06", true);
+    assert(weekdays->getExceptionCount() == 3);
+    assert(!weekdays->runsOn("2023-10-01") && !weekdays->runsOn("2023-10-02") && weekdays->runsOn("2023-10-03"));
+    assert(weekdays->runsOn("2023-10-07") && !weekdays->runsOn("2023-10-08"));
+    assert(!weekdays->runsOn("2024-01-01") && weekdays->runsOn("2023-01-06") && !weekdays->runsOn("2023-01-05"));
+
+    // Dates that do not exist never get inventory of their own
+    Train daily("D0", "Daily", 10);
+    daily.addStop({"Beijing", 7 * 60, 7 * 60, 0.0, 0});
+    daily.addStop({"Tianjin", 7 * 60 + 30, 7 * 60 + 30, 55.0, 120});
+    bool bookedInvalid = daily.bookTickets("2023-02-31", "Beijing", "Tianjin");
+    vector<SegmentRequest> batch = {{0, 1, 1, SECOND_CLASS, false}};
+    daily.bookSegments("2023-02-31", batch);
+    assert(!bookedInvalid && !batch[0].granted && !daily.runsOn("2023-02-31") && daily.getInventoryDateCount() == 0);
+
+    SystemManager sys;
+    string session = sys.login("user1", "123456");
+    Train c1("C1", "Commuter", 20);
+    c1.addStop({"Beijing", 7 * 60, 7 * 60, 0.0, 0});
+    c1.addStop({"Tianjin", 7 * 60 + 30, 7 * 60 + 30, 55.0, 120});
+    c1.setServiceCalendar(weekdays);
+    sys.addTrain(c1);
+    // Fridays only; the Tianjin stop is reached after midnight, on Saturday
+    Train n1("N1", "Sleeper", 20);
+    n1.addStop({"Beijing", 23 * 60, 23 * 60, 0.0, 0});
+    n1.addStop({"Tianjin", 24 * 60 + 20, 24 * 60 + 30, 30.0, 120});
+    n1.addStop({"Qingdao", 30 * 60, 30 * 60, 200.0, 700});
+    n1.setServiceCalendar(make_shared<ServiceCalendar>(FRIDAY));
+    sys.addTrain(n1);
+
+    auto found = [&sys](const string& from, const string& to, const string& date) {
+        vector<string> ids;
+        for (const Train& t : sys.searchTrains(from, to, date)) ids.push_back(t.getId());
+        return ids;
+    };
+
+    for (size_t shards : {0, 3}) {
+        sys.setShardCount(shards);
+        assert(found("Beijing", "Tianjin", "2023-10-03") == vector<string>({"C1"}));
+        assert(found("Beijing", "Tianjin", "2023-10-02").empty());
+        assert(found("Beijing", "Tianjin", "2023-10-06") == vector<string>({"C1", "N1"}));
+        assert(found("Beijing", "Tianjin", "2023-10-07") == vector<string>({"C1"}));
+        assert(found("Tianjin", "Qingdao", "2023-10-07") == vector<string>({"N1"}));
+        assert(found("Tianjin", "Qingdao", "2023-10-06").empty());
+
+        // Refused without allocating inventory for the date
+        BookingResult holiday = sys.placeBooking(session, "C1", "Beijing", "Tianjin", "2023-10-02");
+        BookingResult thursdayNight = sys.placeBooking(session, "N1", "Tianjin", "Qingdao", "2023-10-06");
+        assert(holiday.status == NOT_RUNNING && thursdayNight.status == NOT_RUNNING);
+        assert(sys.getAllTrains().at("C1").getInventoryDateCount() == 0);
+        BookingResult fridayNight = sys.placeBooking(session, "N1", "Tianjin", "Qingdao", "2023-10-14");
+        assert(fridayNight.status == BOOKED);
+        assert(sys.getAllTrains().at("N1").getInventoryDateCount() == 1);
+
+        vector<string> streamed;
+        sys.searchTrainsStreaming("Beijing", "Tianjin", "2023-10-13", [&streamed](vector<Train>& batch) {
+            for (const Train& t : batch) streamed.push_back(t.getId());
+        });
+        assert(streamed.size() == 2);
+        sys.refundTicket(session, sys.getOrders(session).back().getOrderId());
+    }
+    assert(sys.getMetricsSnapshot().bookingOutcomes[NOT_RUNNING] == 4);
+
+    // Dates that do not exist are refused, not read as 1970-01-01
+    BookingResult impossible = sys.placeBooking(session, "G101", "Beijing", "Jinan", "2023-02-31");
+    BookingResult garbage = sys.placeBooking(session, "G101", "Beijing", "Jinan", "garbage");
+    vector<string> transferIds;
+    BookingStatus transfer = sys.bookTransfer(session, {"G101", "Beijing", "Jinan", "2023-10-03"},
+                                              {"K505", "Zhengzhou", "Xi'an", "2023-13-01"}, 1, transferIds);
+    vector<Train> searched = sys.searchTrains("Beijing", "Shanghai", "garbage");
+    TrainCancellation cancelled = sys.cancelTrain("G101", "2023-02-30", "2023-03-01");
+    assert(impossible.status == INVALID_DATE && garbage.status == INVALID_DATE && transfer == INVALID_DATE);
+    assert(searched.empty() && !cancelled.found && sys.getAllTrains().at("G101").runsOn("2023-03-01"));
+
+    // Deleted trains leave the index; re-adding one replaces its entries
+    size_t indexBytes = sys.getMemoryReport().stationIndex;
+    bool deleted = sys.deleteTrain("C1");
+    assert(indexBytes > 0 && deleted);
+    assert(found("Beijing", "Tianjin", "2023-10-03").empty());
+    assert(sys.getMemoryReport().stationIndex < indexBytes);
+    c1.setServiceCalendar(nullptr);
+    sys.addTrain(c1);
+    assert(found("Beijing", "Tianjin", "2023-10-01") == vector<string>({"C1"}));
+    cout << "Service calendars verified." << endl;
+}
+
+void testSharedRoutes() {
+    cout << "Testing Shared Routes..." << endl;
+    // The same stopping pattern at 06:00 and 18:30, built independently
+    auto build = [](const string& id, int departure) {
+        Train t(id, "Express", 50);
+        t.addStop({"Beijing", departure, departure, 0.0, 0});
+        t.addStop({"Jinan", departure + 90, departure + 95, 150.0, 400});
+        t.addStop({"Shanghai", departure + 300, departure + 300, 500.0, 1300});
+        return t;
+    };
+    Train early = build("E1", 6 * 60);
+    Train late = build("E2", 18 * 60 + 30);
+    assert(early.getRoute() == late.getRoute() && early.getSharedRoute() != late.getSharedRoute());
+    assert(late.getTimeOffset() == 18 * 60 + 30 && late.getDepartureTime("Jinan") == "20:05");
+
+    // Copies share the route; extending one rebuilds it for that train only
+    Train copy = early;
+    assert(copy.getSharedRoute() == early.getSharedRoute());
+    copy.addStop({"Hangzhou", 6 * 60 + 360, 6 * 60 + 360, 560.0, 1450});
+    assert(copy.getRoute().size() == 4 && early.getRoute().size() == 3);
+
+    SystemManager sys;
+    string session = sys.login("user1", "123456");
+    sys.addTrain(early);
+    sys.addTrain(late);
+    map<string, Train> stored = sys.getAllTrains();
+    assert(stored.at("E1").getSharedRoute() == stored.at("E2").getSharedRoute());
+    MemoryReport report = sys.getMemoryReport();
+    assert(report.routeCount == 3 && report.unsharedRoutes > report.routes);
+
+    BookingResult r = sys.placeBooking(session, "E2", "Jinan", "Shanghai", "2023-10-01");
+    assert(r.status == BOOKED && sys.getOrders(session).back().getDepartureMinutes() == 20 * 60 + 5);
+    vector<Train> evening = sys.searchTrains("Beijing", "Shanghai", "2023-10-01", {12 * 60, 23 * 60});
+    assert(evening[0].getId() == "E2");
+
+    // A timetable of 100 trains where 80 repeat one of 20 patterns at other hours
+    SystemManager shared;
+    for (int i = 0; i < 100; ++i) {
+        int pattern = i % 20;
+        Train t("P" + to_string(i), "Normal", 100);
+        int departure = 5 * 60 + (i / 20) * 120;
+        for (int s = 0; s < 12; ++s) {
+            int minutes = departure + s * (40 + pattern);
+            t.addStop({"Station" + to_string(pattern * 7 + s * 3), minutes, minutes + (s ? 2 : 0), s * 21.5, s * 60});
+        }
+        shared.addTrain(t);
+    }
+    report = shared.getMemoryReport();
+    assert(report.routeCount == 22 && report.routes * 4 < report.unsharedRoutes);
+    cout << "Routes: " << report.routes << " bytes for " << report.routeCount << " patterns, "
+         << report.unsharedRoutes << " bytes unshared" << endl;
+    cout << "Shared routes verified." << endl;
+}
+
+void testAllocations() {
+    cout << "Testing Allocations..." << endl;
+    SystemManager sys;
+    string session = sys.login("user1", "123456");
+
+    // Trains and orders built in place; the route is shared, not copied
+    shared_ptr<const Route> route = sys.getAllTrains().at("G101").getSharedRoute();
+    sys.emplaceTrain("G103", "High-Speed", array<int, SEAT_CLASS_COUNT>{{80, 20, 0}}, route, 14 * 60);
+    Train g103 = sys.getAllTrains().at("G103");
+    assert(g103.getSharedRoute() == route && g103.getDepartureTime("Jinan") == "15:35");
+    Passenger rider("rider", "pw", "Rider", "42");
+    size_t emplaced = rider.emplaceOrder("rider", "G103", "Beijing", "Jinan", "2023-10-01", 14 * 60, Money(15000), 1, "X1", 0);
+    size_t added = rider.addOrder(Order(rider.getOrders()[0]));
+    assert(emplaced == 0 && added == 1 && rider.getOrders()[1].getOrderId() == "X1");
+
+    // Warm up: the date's inventory and the history's first buffer
+    bool warmedUp = sys.bookTicket(session, "G101", "Beijing", "Shanghai", "2023-10-01");
+    assert(warmedUp);
+
+    // Search results share the inventory and fares; a copy that books gets its own date
+    sys.setPricingPolicy(make_shared<const PricingPolicy>(PricingPolicy::standard()));
+    Train found = sys.searchTrains("Beijing", "Shanghai", "2023-10-01")[0];
+    allocationCount = 0;
+    countAllocations = true;
+    Train copy = found;
+    countAllocations = false;
+    assert(allocationCount == 0);
+    bool copyBooked = copy.bookTickets("2023-10-01", "Beijing", "Shanghai", 50);
+    assert(copyBooked && copy.getAvailableSeats("2023-10-01")[0] == 49);
+    assert(found.getAvailableSeats("2023-10-01")[0] == 99);
+    assert(copy.quote("Beijing", "Jinan", "2023-10-01", 0) != found.quote("Beijing", "Jinan", "2023-10-01", 0));
+    Train stored = sys.searchTrains("Beijing", "Shanghai", "2023-10-01")[0];
+    assert(stored.getAvailableSeats("2023-10-01")[0] == 99);
+    sys.setPricingPolicy(nullptr);
+
+    // Per booking: the order ID, its copies in the order and the index,
+    // and the index node; plus the history buffer, the train's order list
+    // or an index shard's buckets when they grow
+    size_t total = 0;
+    const int bookings = 64;
+    for (int i = 0; i < bookings; ++i) {
+        allocationCount = 0;
+        countAllocations = true;
+        BookingResult r = sys.placeBooking(session, "G101", "Jinan", "Nanjing", "2023-10-01");
+        countAllocations = false;
+        assert(r.status == BOOKED);
+        assert(allocationCount <= 7);
+        total += allocationCount;
+    }
+    assert(total < bookings * 5);
+
+    string orderId = sys.getOrders(session)[1].getOrderId();
+    allocationCount = 0;
+    countAllocations = true;
+    bool refunded = sys.refundTicket(session, orderId);
+    countAllocations = false;
+    assert(refunded);
+    cout << "Bookings averaged " << static_cast<double>(total) / bookings << " allocations, refund " << allocationCount
+         << endl;
+    cout << "Allocations verified." << endl;
+}
+
+void testJourneyBooking() {
+    cout << "Testing Journey Booking..." << endl;
+    for (int shards : {0, 4}) {
+        SystemManager sys;
+        sys.setShardCount(shards);
+        string session = sys.login("user1", "123456");
+        auto freeSeats = [&sys](const string& trainId, const string& date) {
+            return sys.getAllTrains().at(trainId).getAvailableSeats(date);
+        };
+        vector<TripLeg> legs = {{"G101", "Beijing", "Jinan", "2023-10-01"},
+                                {"G101", "Jinan", "Nanjing", "2023-10-01"},
+                                {"K505", "Zhengzhou", "Xi'an", "2023-10-01"}};
+
+        // The last leg is short of seats: nothing is kept and no order exists
+        BookingResult filler = sys.placeBooking(session, "K505", "Zhengzhou", "Xi'an", "2023-10-01", 190);
+        assert(filler.status == BOOKED);
+        vector<string> orderIds;
+        BookingStatus status = sys.bookJourney(session, legs, 20, orderIds);
+        assert(status == SOLD_OUT && orderIds.empty());
+        assert(freeSeats("G101", "2023-10-01") == vector<int>({100, 100, 100}));
+        assert(sys.getOrders(session).size() == 1);
+        BookingStatus noLegs = sys.bookJourney(session, {}, 1, orderIds);
+        BookingStatus noTickets = sys.bookJourney(session, legs, 0, orderIds);
+        BookingStatus anonymous = sys.bookJourney("", legs, 1, orderIds);
+        assert(noLegs == INVALID_STATIONS && noTickets == INVALID_COUNT && anonymous == NOT_LOGGED_IN);
+
+        // Success links the orders in travel order
+        status = sys.bookJourney(session, legs, 5, orderIds);
+        assert(status == BOOKED && orderIds.size() == 3);
+        vector<Order> orders = sys.getOrders(session);
+        assert(orders.size() == 4);
+        for (int i = 0; i < 3; ++i) {
+            const Order& order = orders[1 + i];
+            assert(order.getOrderId() == orderIds[i] && order.getJourneyId() == orderIds[0]);
+            assert(order.getJourneyLeg() == i && order.getJourneyLegs() == 3 && order.getTrainId() == legs[i].trainId);
+        }
+        assert(!orders[0].isJourneyLeg());
+        assert(freeSeats("G101", "2023-10-01") == vector<int>({95, 95, 100}));
+        assert(freeSeats("K505", "2023-10-01")[2] == 5);
+
+        // Refunding any leg refunds the journey; the other legs cannot be refunded again
+        bool refunded = sys.refundTicket(session, orderIds[1]);
+        assert(refunded);
+        orders = sys.getOrders(session);
+        for (int i = 1; i <= 3; ++i) assert(orders[i].getStatus() == CANCELLED);
+        assert(orders[0].getStatus() == PAID);
+        bool firstAgain = sys.refundTicket(session, orderIds[0]);
+        bool lastAgain = sys.refundTicket(session, orderIds[2]);
+        assert(!firstAgain && !lastAgain);
+        assert(freeSeats("G101", "2023-10-01") == vector<int>({100, 100, 100}));
+        assert(freeSeats("K505", "2023-10-01")[2] == 10);
+
+        // Journeys over the same trains listed in opposite orders never
+        // leave one leg booked without the other
+        atomic<int> booked{0};
+        vector<thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&, t]() {
+                vector<TripLeg> journey = {{"G101", "Beijing", "Shanghai", "2023-10-02"},
+                                           {"K505", "Beijing", "Xi'an", "2023-10-02"}};
+                if (t % 2) swap(journey[0], journey[1]);
+                vector<string> ids;
+                for (int i = 0; i < 40; ++i) {
+                    if (sys.bookJourney(session, journey, 1, ids) == BOOKED) ++booked;
+                }
+            });
+        }
+        for (auto& th : threads) th.join();
+        assert(booked == 100);
+        assert(freeSeats("G101", "2023-10-02")[0] == 0 && freeSeats("K505", "2023-10-02")[0] == 100);
+    }
+    cout << "Journey booking verified." << endl;
+}
+
+void testTimetableSnapshots() {
+    cout << "Testing Timetable Snapshots..." << endl;
+    // Retired objects outlive every reader pinned before they were retired
+    {
+        EpochDomain domain;
+        bool reclaimed = false;
+        {
+            EpochDomain::Guard reader = domain.pin();
+            domain.retire([&reclaimed] { reclaimed = true; });
+            assert(!reclaimed && domain.getPendingCount() == 1);
+            EpochDomain::Guard later = domain.pin();
+            size_t collected = domain.collect();
+            assert(collected == 0);
+        }
+        size_t collected = domain.collect();
+        assert(collected == 1 && reclaimed && domain.getPendingCount() == 0);
+    }
+
+    SystemManager sys;
+    string session = sys.login("user1", "123456");
+    uint64_t initial = sys.getTimetable()->getVersion();
+    assert(initial == 2 && sys.getTimetable()->size() == 2);
+
+    // A pinned version stays intact while newer ones are published
+    TimetableSnapshot before = sys.getTimetable();
+    BookingResult booked = sys.placeBooking(session, "G101", "Beijing", "Jinan", "2023-10-01");
+    bool deleted = sys.deleteTrain("K505");
+    assert(booked.status == BOOKED && deleted);
+    assert(before->getVersion() == initial && before->find("K505") != nullptr);
+    assert(before->find("G101")->getInventoryDateCount() == 0);
+    assert(sys.getTimetable()->getVersion() == initial + 1 && sys.getTimetable()->find("K505") == nullptr);
+    vector<Train> found = sys.searchTrains("Beijing", "Xi'an", "2023-10-01");
+    assert(found.empty());
+
+    // A bulk load publishes a single version
+    vector<Train> batch;
+    for (int i = 0; i < 50; ++i) {
+        Train t("B" + to_string(100 + i), "Regional", 10);
+        t.addStop({"Beijing", 6 * 60 + i, 6 * 60 + i, 0.0, 0});
+        t.addStop({"Tianjin", 7 * 60 + i, 7 * 60 + i, 30.0, 120});
+        batch.push_back(t);
+    }
+    sys.addTrains(move(batch));
+    assert(sys.getTimetable()->getVersion() == initial + 2 && sys.getTimetable()->size() == 51);
+    found = sys.searchTrains("Beijing", "Tianjin", "2023-10-01", {6 * 60, 6 * 60 + 9});
+    assert(found.size() == 10);
+    assert(sys.getMemoryReport().timetable > 0);
+
+    // Readers search while the schedule changes under them
+    for (size_t shards : {0, 2}) {
+        sys.setShardCount(shards);
+        atomic<bool> stop{false};
+        atomic<int> searches{0};
+        vector<thread> readers;
+        for (int r = 0; r < 3; ++r) {
+            readers.emplace_back([&]() {
+                while (!stop) {
+                    size_t found = sys.searchTrains("Beijing", "Tianjin", "2023-10-01").size();
+                    assert(found >= 50 && found <= 51);
+                    ++searches;
+                }
+            });
+        }
+        Train extra("X1", "Regional", 10);
+        extra.addStop({"Beijing", 12 * 60, 12 * 60, 0.0, 0});
+        extra.addStop({"Tianjin", 13 * 60, 13 * 60, 30.0, 120});
+        for (int i = 0; i < 50 || searches < 20; ++i) {
+            sys.addTrain(extra);
+            bool deleted = sys.deleteTrain("X1");
+            assert(deleted);
+        }
+        stop = true;
+        for (auto& th : readers) th.join();
+    }
+    cout << "Timetable snapshots verified." << endl;
+}
+
+/**
+ * @brief The primary of testReplication: logs a registration, trains and a
+ * mix of bookings and refunds, then deletes a train.
+ * @return false if one of its own calls failed.
+ */
+bool runReplicationPrimary(const string& logPath) {
+    SystemManager primary;
+    ReplicationLog log;
+    if (!log.open(logPath)) return false;
+    primary.setReplicationLog(&log);
+    bool ok = primary.registerUser("alice", "secret", "Alice", "110101199001011234");
+    string alice = primary.login("alice", "secret");
+
+    Train c9("C9", "Commuter", {20, 5, 0});
+    c9.addStop({"Beijing", 7 * 60, 7 * 60, 0.0, 0, 0.0});
+    c9.addStop({"Tianjin", 24 * 60 + 30, 24 * 60 + 35, 55.5, 120, 90.25});
+    c9.addStop({"Tangshan", 25 * 60 + 10, 25 * 60 + 10, 80.0, 200, 130.0});
+    auto calendar = make_shared<ServiceCalendar>(WEEKDAYS, "2023-10-01", "2023-12-31");
+    calendar->addException("2023-10-02", false);
+    calendar->addException("2023-10-07", true);
+    c9.setServiceCalendar(calendar);
+    primary.addTrain(c9);
+
+    ok = ok && primary.placeBooking(alice, "C9", "Beijing", "Tangshan", "2023-10-03", 2).status == BOOKED;
+    ok = ok && primary.placeBooking(alice, "C9", "Tianjin", "Tangshan", "2023-10-04", 1, FIRST_CLASS).status == BOOKED;
+    vector<string> ids;
+    ok = ok && primary.bookJourney(alice, {{"G101", "Beijing", "Jinan", "2023-10-01"}, {"K505", "Zhengzhou", "Xi'an", "2023-10-01"}}, 3,
+                                   ids) == BOOKED;
+    ok = ok && primary.refundTicket(alice, ids[1]);
+    ok = ok && primary.bookJourney(alice, {{"G101", "Jinan", "Shanghai", "2023-10-05"}, {"C9", "Beijing", "Tianjin", "2023-10-05"}}, 4,
+                                   ids) == BOOKED;
+    ok = ok && primary.bookTransfer(alice, {"G101", "Beijing", "Nanjing", "2023-10-06"}, {"K505", "Beijing", "Xi'an", "2023-10-06"}, 1,
+                                    ids) == BOOKED;
+    ok = ok && primary.placeBooking(alice, "C9", "Beijing", "Tianjin", "2023-10-03", 50).status == SOLD_OUT;
+    ok = ok && primary.deleteTrain("K505");
+    log.close();
+    return ok;
+}
+
+void testReplication() {
+    cout << "Testing Replication..." << endl;
+    const string logPath = "replication_test.log";
+    const string promotedPath = "replication_promoted.log";
+    remove(logPath.c_str());
+
+    // The standby runs sharded while the primary runs direct; neither shows in the log
+    SystemManager standby;
+    standby.setShardCount(2);
+    Replica replica(standby, logPath);
+    replica.start();
+#ifndef _WIN32
+    // Primary and replica are separate processes sharing only the log file
+    cout.flush();
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) _exit(runReplicationPrimary(logPath) ? 0 : 1);
+    int exitStatus = 0;
+    waitpid(pid, &exitStatus, 0);
+    assert(WIFEXITED(exitStatus) && WEXITSTATUS(exitStatus) == 0);
+#else
+    bool primaryOk = runReplicationPrimary(logPath);
+    assert(primaryOk);
+#endif
+    replica.stop();
+    replica.poll();
+    ReplicationStatus status = replica.getStatus();
+    assert(status.errors == 0 && status.pendingBytes == 0 && status.lagMs >= 0 && !status.promoted);
+    // Register, train, 2 bookings, journey, cancel, journey, 2 transfer legs, delete
+    assert(status.appliedSequence >= 10 && status.appliedSequence == status.appliedRecords);
+
+    // Users, orders, journey links, seats and the schedule all arrived
+    string alice = standby.login("alice", "secret");
+    assert(!alice.empty());
+    vector<Order> orders = standby.getOrders(alice);
+    assert(orders.size() == 8);
+    assert(orders[0].getTrainId() == "C9" && orders[0].getPrice() == Money(16000) && orders[0].getDepartureMinutes() == 7 * 60);
+    assert(orders[1].getSeatClass() == FIRST_CLASS && orders[1].getPrice() == Money(3975));
+    assert(orders[2].getJourneyId() == orders[2].getOrderId() && orders[3].getJourneyId() == orders[2].getOrderId());
+    assert(orders[2].getStatus() == CANCELLED && orders[3].getStatus() == CANCELLED);
+    assert(orders[5].getJourneyLeg() == 1 && orders[5].getJourneyLegs() == 2 && orders[5].getStatus() == PAID);
+    assert(!orders[6].isJourneyLeg() && !orders[7].isJourneyLeg());
+    // Deleting K505 refunded its order
+    assert(orders[6].getStatus() == PAID && orders[7].getStatus() == CANCELLED);
+    map<string, Train> trains = standby.getAllTrains();
+    assert(trains.count("K505") == 0 && standby.getTimetable()->find("K505") == nullptr);
+    assert(trains.at("C9").getAvailableSeats("2023-10-03") == vector<int>({23, 22}));
+    assert(trains.at("C9").getAvailableSeats("2023-10-05") == vector<int>({21, 25}));
+    assert(trains.at("G101").getAvailableSeats("2023-10-01") == vector<int>({100, 100, 100}));
+    assert(trains.at("G101").getAvailableSeats("2023-10-05") == vector<int>({100, 96, 96}));
+    vector<Train> holiday = standby.searchTrains("Beijing", "Tangshan", "2023-10-02");
+    vector<Train> extraSaturday = standby.searchTrains("Beijing", "Tangshan", "2023-10-07");
+    vector<Train> afterMidnight = standby.searchTrains("Tianjin", "Tangshan", "2023-10-08");
+    assert(holiday.empty() && extraSaturday.size() == 1 && afterMidnight.size() == 1);
+    // Refunded after promotion, with the seats of the whole journey
+    string orderId = orders[5].getOrderId();
+
+    // Promotion: the standby takes writes and logs them after the old primary's records
+    replica.setPromotionLog(promotedPath);
+    uint64_t last = replica.promote();
+    uint64_t appliedAfterPromotion = replica.poll();
+    assert(last == status.appliedSequence && replica.isPromoted() && appliedAfterPromotion == 0);
+    assert(standby.getReplicationLog() != nullptr);
+    BookingResult booked = standby.placeBooking(alice, "C9", "Beijing", "Tianjin", "2023-10-03", 18);
+    assert(booked.status == BOOKED);
+    for (const Order& order : orders) assert(order.getOrderId() != booked.orderId);
+    bool refunded = standby.refundTicket(alice, orderId);
+    assert(refunded);
+    standby.getReplicationLog()->flush();
+    assert(standby.getReplicationLog()->getSequence() >= last + 2);
+
+    // A replica of the new primary replays both logs in turn
+    SystemManager follower;
+    Replica fromOld(follower, logPath);
+    Replica fromNew(follower, promotedPath);
+    uint64_t appliedOld = fromOld.poll();
+    uint64_t appliedNew = fromNew.poll();
+    assert(appliedOld == last && appliedNew >= 2);
+    assert(fromOld.getStatus().errors == 0 && fromNew.getStatus().errors == 0 && fromNew.getStatus().appliedSequence >= last + 2);
+    string followerSession = follower.login("alice", "secret");
+    orders = follower.getOrders(followerSession);
+    assert(orders.size() == 9 && orders[8].getOrderId() == booked.orderId);
+    assert(orders[4].getStatus() == CANCELLED && orders[5].getStatus() == CANCELLED);
+    assert(follower.getAllTrains().at("C9").getAvailableSeats("2023-10-03") == vector<int>({5, 22}));
+    assert(follower.getAllTrains().at("C9").getAvailableSeats("2023-10-05") == vector<int>({25, 25}));
+
+    standby.setReplicationLog(nullptr);
+    remove(logPath.c_str());
+    remove(promotedPath.c_str());
+    cout << "Replication verified." << endl;
+}
+
+void testTrainCancellation() {
+    cout << "Testing Train Cancellation..." << endl;
+    // Cancelled days leave the calendar by range where possible, by exception otherwise
+    ServiceCalendar weekdays(WEEKDAYS, "2023-10-01", "2023-12-31");
+    weekdays.addException("2023-10-07", true);
+    weekdays.addException("2023-10-10", false);
+    ServiceCalendar middle = weekdays.withoutDays(Calendar::dayNumber("2023-10-04"), Calendar::dayNumber("2023-10-09"));
+    assert(middle.runsOn("2023-10-03") && !middle.runsOn("2023-10-05") && !middle.runsOn("2023-10-07"));
+    assert(!middle.runsOn("2023-10-10") && middle.runsOn("2023-10-11") && middle.getFirstDate() == "2023-10-01");
+    ServiceCalendar start = weekdays.withoutDays(INT_MIN, Calendar::dayNumber("2023-10-08"));
+    assert(start.getFirstDate() == "2023-10-09" && start.getExceptionCount() == 1 && !start.runsOn("2023-10-07"));
+    assert(!start.runsOn("2023-10-10") && start.runsOn("2023-10-09"));
+    assert(weekdays.withoutDays(INT_MIN, INT_MAX).getExceptionCount() == 0 && !weekdays.withoutDays(INT_MIN, INT_MAX).runsOn("2023-10-09"));
+    // Cancellations outside the validity range leave it alone
+    ServiceCalendar year(EVERY_DAY, "2024-01-01", "2024-12-31");
+    year.addException("2023-06-30", true);
+    ServiceCalendar before = year.withoutDays(Calendar::dayNumber("2023-01-01"), Calendar::dayNumber("2023-06-30"));
+    assert(before.getFirstDate() == "2024-01-01" && before.getLastDate() == "2024-12-31" && before.getExceptionCount() == 0);
+    assert(!before.runsOn("2023-06-30") && !before.runsOn("2023-08-01") && before.runsOn("2024-01-01"));
+    ServiceCalendar after = year.withoutDays(Calendar::dayNumber("2025-03-01"), INT_MAX);
+    assert(after.getFirstDate() == "2024-01-01" && after.getLastDate() == "2024-12-31" && after.getExceptionCount() == 1);
+    assert(!after.runsOn("2025-01-15") && after.runsOn("2023-06-30") && after.runsOn("2024-12-31"));
+    // Partial overlaps shrink the range to the days left
+    ServiceCalendar head = year.withoutDays(Calendar::dayNumber("2023-12-01"), Calendar::dayNumber("2024-01-31"));
+    assert(head.getFirstDate() == "2024-02-01" && head.getLastDate() == "2024-12-31" && head.runsOn("2023-06-30"));
+    assert(!head.runsOn("2023-12-15") && !head.runsOn("2024-01-31") && head.runsOn("2024-02-01"));
+    ServiceCalendar tail = year.withoutDays(Calendar::dayNumber("2024-12-01"), Calendar::dayNumber("2025-01-31"));
+    assert(tail.getFirstDate() == "2024-01-01" && tail.getLastDate() == "2024-11-30" && !tail.runsOn("2025-01-15"));
+
+    for (size_t shards : {0, 3}) {
+        SystemManager sys;
+        sys.setShardCount(shards);
+        ReplicationLog log;
+        const string logPath = "cancellation_test.log";
+        bool opened = log.open(logPath);
+        assert(opened);
+        sys.setReplicationLog(&log);
+        string session = sys.login("user1", "123456");
+        // Overnight train: the Tianjin stop of the 10-02 run is reached on 10-03
+        Train n2("N2", "Sleeper", 50);
+        n2.addStop({"Beijing", 23 * 60, 23 * 60, 0.0, 0});
+        n2.addStop({"Tianjin", 24 * 60 + 20, 24 * 60 + 30, 30.0, 120});
+        n2.addStop({"Qingdao", 30 * 60, 30 * 60, 200.0, 700});
+        sys.addTrain(n2);
+
+        BookingResult otherDay = sys.placeBooking(session, "G101", "Beijing", "Jinan", "2023-10-01", 2);
+        BookingResult sameDay = sys.placeBooking(session, "G101", "Beijing", "Shanghai", "2023-10-02", 3);
+        BookingResult n2Boarding = sys.placeBooking(session, "N2", "Tianjin", "Qingdao", "2023-10-03", 1);
+        BookingResult n2Previous = sys.placeBooking(session, "N2", "Tianjin", "Qingdao", "2023-10-02", 1);
+        assert(otherDay.status == BOOKED && sameDay.status == BOOKED && n2Boarding.status == BOOKED && n2Previous.status == BOOKED);
+        BookingResult refunded = sys.placeBooking(session, "G101", "Jinan", "Nanjing", "2023-10-02");
+        bool refundOk = sys.refundTicket(session, refunded.orderId);
+        assert(refundOk);
+        vector<string> ids;
+        BookingStatus viaG101 = sys.bookJourney(session, {{"G101", "Beijing", "Jinan", "2023-10-02"}, {"K505", "Zhengzhou", "Xi'an", "2023-10-02"}},
+                                                4, ids);
+        BookingStatus viaN2 = sys.bookJourney(session, {{"K505", "Beijing", "Zhengzhou", "2023-10-02"}, {"N2", "Beijing", "Tianjin", "2023-10-02"}},
+                                              1, ids);
+        assert(viaG101 == BOOKED && viaN2 == BOOKED);
+
+        // One service date: its orders and the other legs of their journeys are refunded
+        vector<TrainCancellation> reports;
+        TrainCancellation g101 = sys.cancelTrain("G101", "2023-10-02", "2023-10-02",
+                                                 [&reports](const TrainCancellation& progress) { reports.push_back(progress); });
+        assert(g101.found && g101.droppedDates == 1 && g101.affectedOrders == 3 && g101.processedOrders == 3);
+        assert(g101.refundedOrders == 3 && g101.refundedAmount == Money(3 * 55300 + 4 * 15000 + 4 * 8000));
+        assert(reports.size() == 1 && reports[0].refundedOrders == 3);
+        vector<Order> orders = sys.getOrders(session);
+        assert(orders[0].getStatus() == PAID && orders[1].getStatus() == CANCELLED && orders[5].getStatus() == CANCELLED);
+        assert(orders[6].getStatus() == CANCELLED && orders[7].getStatus() == PAID && orders[8].getStatus() == PAID);
+        map<string, Train> trains = sys.getAllTrains();
+        assert(trains.at("G101").getInventoryDateCount() == 1 && trains.at("K505").getAvailableSeats("2023-10-02")[2] == 200);
+        BookingResult cancelledDay = sys.placeBooking(session, "G101", "Beijing", "Jinan", "2023-10-02");
+        assert(cancelledDay.status == NOT_RUNNING);
+        vector<Train> cancelledSearch = sys.searchTrains("Beijing", "Shanghai", "2023-10-02");
+        vector<Train> nextDaySearch = sys.searchTrains("Beijing", "Shanghai", "2023-10-03");
+        assert(cancelledSearch.empty() && nextDaySearch.size() == 1);
+        TrainCancellation unknown = sys.cancelTrain("X9");
+        TrainCancellation emptyRange = sys.cancelTrain("G101", "2023-10-05", "2023-10-04");
+        assert(!unknown.found && !emptyRange.found);
+
+        // The 10-03 Tianjin boarding belongs to the 10-02 run
+        TrainCancellation n2Run = sys.cancelTrain("N2", "2023-10-02", "2023-10-02");
+        assert(n2Run.refundedOrders == 3 && n2Run.affectedOrders == 2);
+        orders = sys.getOrders(session);
+        assert(orders[2].getStatus() == CANCELLED && orders[3].getStatus() == PAID && orders[7].getStatus() == CANCELLED);
+        assert(sys.getAllTrains().at("K505").getAvailableSeats("2023-10-02") == vector<int>({200, 200, 200}));
+
+        // Deleting a train refunds what is left on it
+        bool deleted = sys.deleteTrain("N2");
+        assert(deleted && sys.getOrders(session)[3].getStatus() == CANCELLED);
+
+        // Bulk: several parallel batches over many passengers
+        Train m1("M1", "Charter", 100000);
+        m1.addStop({"Beijing", 9 * 60, 9 * 60, 0.0, 0});
+        m1.addStop({"Tianjin", 10 * 60, 10 * 60, 10.0, 120});
+        sys.addTrain(m1);
+        const int passengers = 40;
+        const size_t bulk = 3 * CANCELLATION_BATCH_ORDERS + 100;
+        vector<string> sessions;
+        for (int i = 0; i < passengers; ++i) {
+            string name = "bulk" + to_string(i);
+            bool registered = sys.registerUser(name, "pw", name, to_string(i));
+            assert(registered);
+            sessions.push_back(sys.login(name, "pw"));
+        }
+        for (size_t i = 0; i < bulk; ++i) {
+            string date = "2023-11-0" + to_string(1 + i % 5);
+            BookingResult r = sys.placeBooking(sessions[i % passengers], "M1", "Beijing", "Tianjin", date);
+            assert(r.status == BOOKED);
+        }
+        reports.clear();
+        TrainCancellation m1All = sys.cancelTrain("M1", "", "", [&reports](const TrainCancellation& progress) { reports.push_back(progress); });
+        assert(m1All.found && m1All.droppedDates == 5 && m1All.affectedOrders == bulk && m1All.refundedOrders == bulk);
+        assert(m1All.refundedAmount == Money(1000 * static_cast<int64_t>(bulk)) && reports.size() == 4);
+        for (size_t i = 1; i < reports.size(); ++i) assert(reports[i].processedOrders > reports[i - 1].processedOrders);
+        assert(reports.back().processedOrders == bulk);
+        for (const string& s : sessions) {
+            for (const Order& order : sys.getOrders(s)) assert(order.getStatus() == CANCELLED);
+        }
+        assert(sys.getAllTrains().at("M1").getInventoryDateCount() == 0);
+        BookingResult afterCancel = sys.placeBooking(sessions[0], "M1", "Beijing", "Tianjin", "2024-01-01");
+        TrainCancellation again = sys.cancelTrain("M1");
+        assert(afterCancel.status == NOT_RUNNING && again.affectedOrders == 0);
+
+        // A replica replays the cancellations and refunds
+        sys.setReplicationLog(nullptr);
+        log.close();
+        SystemManager follower;
+        Replica replica(follower, logPath);
+        replica.poll();
+        assert(replica.getStatus().errors == 0);
+        string followerSession = follower.login("user1", "123456");
+        vector<Order> replayed = follower.getOrders(followerSession);
+        orders = sys.getOrders(session);
+        assert(replayed.size() == orders.size());
+        for (size_t i = 0; i < orders.size(); ++i) assert(replayed[i].getStatus() == orders[i].getStatus());
+        trains = follower.getAllTrains();
+        assert(trains.count("N2") == 0 && trains.at("G101").getInventoryDateCount() == 1);
+        assert(trains.at("K505").getAvailableSeats("2023-10-02") == vector<int>({200, 200, 200}));
+        vector<Train> g101Day = follower.searchTrains("Beijing", "Shanghai", "2023-10-02");
+        vector<Train> m1Day = follower.searchTrains("Beijing", "Tianjin", "2023-11-01");
+        assert(g101Day.empty() && m1Day.empty());
+        remove(logPath.c_str());
+    }
+    cout << "Train cancellation verified." << endl;
+}
+
 int main() {
     testLogic();
+    testShardedMode();
+    testBookingPipeline();
+    testAdmissionControl();
+    testTraceReplay();
+    testMetrics();
+    testTracingSpans();
+    testMemoryReport();
+    testStreamingSearch();
+    testInventoryEvents();
+    testChangeFeed();
+    testDynamicPricing();
+    testSeatClasses();
+    testTimeModel();
+    testServiceCalendars();
+    testSharedRoutes();
+    testAllocations();
+    testJourneyBooking();
+    testTimetableSnapshots();
+    testReplication();
+    testTrainCancellation();
     return 0;
 }